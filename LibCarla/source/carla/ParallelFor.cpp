@@ -0,0 +1,27 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/ParallelFor.h"
+
+#include <thread>
+
+namespace carla {
+
+  size_t SharedThreadPool::GetNumberOfWorkers() {
+    static const size_t number_of_workers = std::max(1u, std::thread::hardware_concurrency());
+    return number_of_workers;
+  }
+
+  ThreadPool &SharedThreadPool::Get() {
+    static ThreadPool thread_pool;
+    static std::once_flag started;
+    std::call_once(started, []() {
+      thread_pool.AsyncRun(GetNumberOfWorkers());
+    });
+    return thread_pool;
+  }
+
+} // namespace carla
@@ -0,0 +1,112 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "carla/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+namespace carla {
+
+  /// Long-lived pool shared by the library's parallel loops, started on first
+  /// use with one thread per hardware thread.
+  class SharedThreadPool {
+  public:
+
+    static ThreadPool &Get();
+
+    static size_t GetNumberOfWorkers();
+  };
+
+  /// Calls functor(chunk) for every chunk in [0, number_of_chunks), on the
+  /// calling thread and on up to @a number_of_workers threads of
+  /// @a thread_pool. Returns once every chunk is done, rethrowing the first
+  /// exception thrown by any of them.
+  ///
+  /// Chunks are handed out to whichever thread asks first, and the calling
+  /// thread never waits for a pool task that has not started. It is therefore
+  /// safe to call from a task running on the same pool.
+  template <typename FunctorT>
+  void ParallelForChunks(
+      ThreadPool &thread_pool,
+      size_t number_of_workers,
+      size_t number_of_chunks,
+      FunctorT &&functor) {
+
+    if (number_of_chunks <= 1u || number_of_workers == 0u) {
+      for (size_t chunk = 0u; chunk < number_of_chunks; ++chunk) {
+        functor(chunk);
+      }
+      return;
+    }
+
+    // Shared with the pool tasks, which may start after this call returns.
+    struct State {
+      std::atomic<size_t> next_chunk{0u};
+      std::mutex mutex;
+      std::condition_variable done_condition;
+      size_t done_chunks = 0u;
+      std::exception_ptr exception;
+    };
+    auto state = std::make_shared<State>();
+
+    // Late tasks find no chunk left and never touch functor.
+    auto run_chunks = [state, &functor, number_of_chunks]() {
+      for (size_t chunk = state->next_chunk++; chunk < number_of_chunks; chunk = state->next_chunk++) {
+        std::exception_ptr exception;
+        try {
+          functor(chunk);
+        } catch (...) {
+          exception = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (exception && !state->exception) {
+          state->exception = exception;
+        }
+        if (++state->done_chunks == number_of_chunks) {
+          state->done_condition.notify_all();
+        }
+      }
+    };
+
+    const size_t number_of_tasks = std::min(number_of_workers, number_of_chunks - 1u);
+    for (size_t i = 0u; i < number_of_tasks; ++i) {
+      thread_pool.Post(run_chunks);
+    }
+    run_chunks();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done_condition.wait(lock, [&state, number_of_chunks]() {
+      return state->done_chunks == number_of_chunks;
+    });
+    if (state->exception) {
+      std::rethrow_exception(state->exception);
+    }
+  }
+
+  /// Splits [0, size) into chunks of @a chunk_size and calls
+  /// functor(begin, end) for each of them on the shared thread pool.
+  template <typename FunctorT>
+  void ParallelFor(size_t size, size_t chunk_size, FunctorT &&functor) {
+    const size_t number_of_chunks = (size + chunk_size - 1u) / chunk_size;
+    ParallelForChunks(
+        SharedThreadPool::Get(),
+        SharedThreadPool::GetNumberOfWorkers(),
+        number_of_chunks,
+        [&functor, size, chunk_size](size_t chunk) {
+          const size_t begin = chunk * chunk_size;
+          functor(begin, std::min(size, begin + chunk_size));
+        });
+  }
+
+} // namespace carla
@@ -1,44 +1,119 @@
 #include "AABBMap.h"
 
+#include <algorithm>
+#include <boost/geometry.hpp>
+#include <stdexcept>
+
 namespace carla {
 namespace aabb {
 
+namespace bgi = boost::geometry::index;
+
 AABBMap::AABBMap() {
 
 }
 
-AABBMap::AABBMap(const std::vector<geom::AABB2D>& aabbs) {
-  std::vector<b_box_t> boxes(aabbs.size());
-  for (const geom::AABB2D& aabb : aabbs) {
-    boxes.emplace_back(
-        b_point_t(aabb.bounds_min.x, aabb.bounds_min.y),
-        b_point_t(aabb.bounds_max.x, aabb.bounds_max.y));
+AABBMap::AABBMap(const std::vector<geom::AABB2D>& aabbs)
+  : _aabbs(aabbs),
+    _valid(aabbs.size(), true) {
+  std::vector<b_value_t> values;
+  values.reserve(aabbs.size());
+  for (size_t i = 0; i < aabbs.size(); i++) {
+    values.emplace_back(ToBox(aabbs[i]), i);
   }
-  _tree = b_rtree_t(boxes);
+  // The range constructor packs the tree (STR bulk load).
+  _tree = b_rtree_t(values);
+}
+
+AABBMap::b_box_t AABBMap::ToBox(const geom::AABB2D& aabb) {
+  return b_box_t(
+      b_point_t(aabb.bounds_min.x, aabb.bounds_min.y),
+      b_point_t(aabb.bounds_max.x, aabb.bounds_max.y));
 }
   
 size_t AABBMap::Count() const {
   return _tree.size();
 }
   
-void AABBMap::Insert(const geom::AABB2D& aabb) {
-  _tree.insert(b_box_t(
-      b_point_t(aabb.bounds_min.x, aabb.bounds_min.y),
-      b_point_t(aabb.bounds_max.x, aabb.bounds_max.y)));
+size_t AABBMap::Insert(const geom::AABB2D& aabb) {
+  size_t handle;
+  if (!_free_handles.empty()) {
+    handle = _free_handles.back();
+    _free_handles.pop_back();
+    _aabbs[handle] = aabb;
+    _valid[handle] = true;
+  } else {
+    handle = _aabbs.size();
+    _aabbs.emplace_back(aabb);
+    _valid.emplace_back(true);
+  }
+  _tree.insert(b_value_t(ToBox(aabb), handle));
+  return handle;
+}
+
+bool AABBMap::Remove(size_t handle) {
+  if (!Contains(handle)) {
+    return false;
+  }
+  _tree.remove(b_value_t(ToBox(_aabbs[handle]), handle));
+  _valid[handle] = false;
+  _free_handles.emplace_back(handle);
+  return true;
+}
+
+void AABBMap::Update(size_t handle, const geom::AABB2D& aabb) {
+  if (!Contains(handle)) {
+    throw std::out_of_range("invalid AABBMap handle!");
+  }
+  _tree.remove(b_value_t(ToBox(_aabbs[handle]), handle));
+  _aabbs[handle] = aabb;
+  _tree.insert(b_value_t(ToBox(aabb), handle));
+}
+
+bool AABBMap::Contains(size_t handle) const {
+  return handle < _valid.size() && _valid[handle];
+}
+
+const geom::AABB2D& AABBMap::Get(size_t handle) const {
+  if (!Contains(handle)) {
+    throw std::out_of_range("invalid AABBMap handle!");
+  }
+  return _aabbs[handle];
 }
 
 bool AABBMap::Intersects(const geom::AABB2D& aabb) const {
-  std::vector<b_box_t> intersections;
+  // Stops at the first hit.
+  return _tree.qbegin(bgi::intersects(ToBox(aabb))) != _tree.qend();
+}
 
-  b_box_t box(
-      b_point_t(aabb.bounds_min.x, aabb.bounds_min.y),
-      b_point_t(aabb.bounds_max.x, aabb.bounds_max.y));
+std::vector<bool> AABBMap::IntersectsMany(const std::vector<geom::AABB2D>& aabbs) const {
+  std::vector<bool> results(aabbs.size());
+  for (size_t i = 0; i < aabbs.size(); i++) {
+    results[i] = Intersects(aabbs[i]);
+  }
+  return results;
+}
 
-  _tree.query(
-      boost::geometry::index::intersects(box), 
-      std::back_inserter(intersections));
+std::vector<size_t> AABBMap::QueryIntersects(const geom::AABB2D& aabb) const {
+  std::vector<size_t> handles;
+  for (auto it = _tree.qbegin(bgi::intersects(ToBox(aabb))); it != _tree.qend(); ++it) {
+    handles.emplace_back(it->second);
+  }
+  return handles;
+}
 
-  return intersections.size() > 0;
+std::vector<size_t> AABBMap::QueryNearest(const geom::Vector2D& point, size_t k) const {
+  std::vector<size_t> handles;
+  if (k == 0) {
+    return handles;
+  }
+  handles.reserve(std::min(k, _tree.size()));
+  // Unlike query(), incremental nearest queries return results nearest first.
+  for (auto it = _tree.qbegin(bgi::nearest(b_point_t(point.x, point.y), static_cast<unsigned>(k)));
+      it != _tree.qend(); ++it) {
+    handles.emplace_back(it->second);
+  }
+  return handles;
 }
 
 }
@@ -1,31 +1,52 @@
 #pragma once
 
 #include "carla/geom/AABB2D.h"
+#include "carla/geom/Vector2D.h"
 #include <boost/geometry/geometries/geometries.hpp>
 #include <boost/geometry/geometries/point_xy.hpp>
 #include <boost/geometry/index/rtree.hpp>
+#include <utility>
 #include <vector>
 
 namespace carla {
 namespace aabb {
 
+// R-tree of AABBs. Every inserted AABB gets a handle, which stays valid until
+// the AABB is removed. Removed handles are handed out again by later inserts,
+// so storage stays bounded by the peak number of AABBs. The constructor bulk
+// loads the tree, which gives handles 0 to aabbs.size() - 1.
 class AABBMap {
 public:
 
   AABBMap();
   AABBMap(const std::vector<geom::AABB2D>& aabbs);
 
-  void Insert(const geom::AABB2D& aabb);
+  size_t Insert(const geom::AABB2D& aabb);
+  bool Remove(size_t handle);
+  void Update(size_t handle, const geom::AABB2D& aabb);
+  bool Contains(size_t handle) const;
+  const geom::AABB2D& Get(size_t handle) const;
+
   bool Intersects(const geom::AABB2D& aabb) const;
+  std::vector<bool> IntersectsMany(const std::vector<geom::AABB2D>& aabbs) const;
+  std::vector<size_t> QueryIntersects(const geom::AABB2D& aabb) const;
+  // Handles of the (up to) k AABBs nearest to point, nearest first.
+  std::vector<size_t> QueryNearest(const geom::Vector2D& point, size_t k) const;
   size_t Count() const;
 
 private:
     
   typedef boost::geometry::model::d2::point_xy<float> b_point_t;
   typedef boost::geometry::model::box<b_point_t> b_box_t;
-  typedef boost::geometry::index::rtree<b_box_t, boost::geometry::index::quadratic<16>> b_rtree_t;
+  typedef std::pair<b_box_t, size_t> b_value_t;
+  typedef boost::geometry::index::rtree<b_value_t, boost::geometry::index::quadratic<16>> b_rtree_t;
+
+  static b_box_t ToBox(const geom::AABB2D& aabb);
 
   b_rtree_t _tree;
+  std::vector<geom::AABB2D> _aabbs;
+  std::vector<bool> _valid;
+  std::vector<size_t> _free_handles;
 };
 
 }
@@ -45,6 +45,10 @@ namespace client {
     return _episode.Lock()->SpawnDynamicMesh(triangles, material, semantic_segmentation_label);
   }
   
+  uint32_t World::SpawnDynamicIndexedMesh(const geom::IndexedMesh &mesh, std::string material, uint8_t semantic_segmentation_label) {
+    return _episode.Lock()->SpawnDynamicIndexedMesh(mesh, material, semantic_segmentation_label);
+  }
+
   uint32_t World::SpawnDynamicTileMesh(const geom::Vector3D& bounds_min, const geom::Vector3D& bounds_max, const std::vector<uint8_t>& data, uint8_t semantic_segmentation_label) {
     return _episode.Lock()->SpawnDynamicTileMesh(bounds_min, bounds_max, data, semantic_segmentation_label);
   }
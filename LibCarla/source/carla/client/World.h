@@ -12,6 +12,7 @@
 #include "carla/client/Timestamp.h"
 #include "carla/client/WorldSnapshot.h"
 #include "carla/client/detail/EpisodeProxy.h"
+#include "carla/geom/IndexedMesh.h"
 #include "carla/geom/Transform.h"
 #include "carla/rpc/Actor.h"
 #include "carla/rpc/AttachmentType.h"
@@ -71,6 +72,9 @@ namespace client {
     // Spawns a dynamic mesh in the world.
     uint32_t SpawnDynamicMesh(const std::vector<geom::Vector3D> &triangles, std::string material, uint8_t semantic_segmentation_label);
     
+    // Spawns a dynamic mesh from a shared vertex buffer and triangle indices.
+    uint32_t SpawnDynamicIndexedMesh(const geom::IndexedMesh &mesh, std::string material, uint8_t semantic_segmentation_label);
+
     uint32_t SpawnDynamicTileMesh(const geom::Vector3D& bounds_min, const geom::Vector3D& bounds_max, const std::vector<uint8_t>& data, uint8_t semantic_segmentation_label);
     
     // Destroys a dynamic mesh in the world.
@@ -170,6 +170,10 @@ namespace detail {
     return _pimpl->CallAndWait<uint32_t>("spawn_dynamic_mesh", triangles, material, semantic_segmentation_label);
   }
     
+  uint32_t Client::SpawnDynamicIndexedMesh(const geom::IndexedMesh& mesh, std::string material, uint8_t semantic_segmentation_label) {
+    return _pimpl->CallAndWait<uint32_t>("spawn_dynamic_indexed_mesh", mesh, material, semantic_segmentation_label);
+  }
+
   uint32_t Client::SpawnDynamicTileMesh(const geom::Vector3D& bounds_min, const geom::Vector3D& bounds_max, const std::vector<uint8_t>& data, uint8_t semantic_segmentation_label) {
     return _pimpl->CallAndWait<uint32_t>("spawn_dynamic_tile_mesh", bounds_min, bounds_max, data, semantic_segmentation_label);
   }
@@ -9,6 +9,7 @@
 #include "carla/Memory.h"
 #include "carla/NonCopyable.h"
 #include "carla/Time.h"
+#include "carla/geom/IndexedMesh.h"
 #include "carla/geom/Transform.h"
 #include "carla/rpc/Actor.h"
 #include "carla/rpc/ActorDefinition.h"
@@ -98,6 +99,8 @@ namespace detail {
 
     uint32_t SpawnDynamicMesh(const std::vector<geom::Vector3D>& triangles, std::string material, uint8_t semantic_segmentation_label);
     
+    uint32_t SpawnDynamicIndexedMesh(const geom::IndexedMesh& mesh, std::string material, uint8_t semantic_segmentation_label);
+
     uint32_t SpawnDynamicTileMesh(const geom::Vector3D& bounds_min, const geom::Vector3D& bounds_max, const std::vector<uint8_t>& data, uint8_t semantic_segmentation_label);
     
     bool DestroyDynamicMesh(uint32_t id);
@@ -110,6 +110,10 @@ namespace detail {
       return _client.SpawnDynamicMesh(triangles, material, semantic_segmentation_label);
     }
     
+    uint32_t SpawnDynamicIndexedMesh(const geom::IndexedMesh &mesh, std::string material, uint8_t semantic_segmentation_label) {
+      return _client.SpawnDynamicIndexedMesh(mesh, material, semantic_segmentation_label);
+    }
+
     uint32_t SpawnDynamicTileMesh(const geom::Vector3D& bounds_min, const geom::Vector3D& bounds_max, const std::vector<uint8_t>& data, uint8_t semantic_segmentation_label) {
       return _client.SpawnDynamicTileMesh(bounds_min, bounds_max, data, semantic_segmentation_label);
     }
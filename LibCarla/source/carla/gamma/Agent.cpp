@@ -592,6 +592,9 @@ namespace RVO {
 
 		const float invTimeHorizon = 1.0f / timeHorizon_;
 
+		// Reused across neighbors and steps; doStep runs agents in parallel.
+		static thread_local std::vector<Vector2> minkowski_diff;
+
 		/* Create agent ORCA lines. */
 		for (size_t i = 0; i < agentNeighbors_.size(); ++i) {
 
@@ -601,7 +604,7 @@ namespace RVO {
 			if (attention == 0.0f)
 				continue;
 
-			std::vector<Vector2> minkowski_diff = Minkowski::Diff(other->bounding_corners_, bounding_corners_);
+			Minkowski::DiffConvex(other->bounding_hull_, bounding_hull_, minkowski_diff);
 
 			bool in_collision = inCollision (minkowski_diff, Vector2(0,0));
 
@@ -938,9 +941,12 @@ namespace RVO {
 
 	void Agent::insertAgentNeighbor(const Agent *agent, float &rangeSq)
 	{
-		if (this != agent) {
-			const float distSq = absSq(position_ - agent->position_);
+		insertAgentNeighbor(agent, absSq(position_ - agent->position_), rangeSq);
+	}
 
+	void Agent::insertAgentNeighbor(const Agent *agent, float distSq, float &rangeSq)
+	{
+		if (this != agent) {
 			if (distSq < rangeSq) {
 				if (agentNeighbors_.size() < maxNeighbors_) {
 					agentNeighbors_.push_back(std::make_pair(distSq, agent));
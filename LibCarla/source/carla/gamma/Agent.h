@@ -75,6 +75,15 @@ namespace RVO {
 		 */
 		void insertAgentNeighbor(const Agent *agent, float &rangeSq);
 
+		/**
+		 * \brief      Inserts an agent neighbor whose squared distance to this
+		 *             agent is already known.
+		 * \param      agent           A pointer to the agent to be inserted.
+		 * \param      distSq          The squared distance to the agent.
+		 * \param      rangeSq         The squared range around this agent.
+		 */
+		void insertAgentNeighbor(const Agent *agent, float distSq, float &rangeSq);
+
 		/**
 		 * \brief      Inserts a static obstacle neighbor into the set of neighbors
 		 *             of this agent.
@@ -124,6 +133,8 @@ namespace RVO {
 		size_t id_;
 
 		std::vector<Vector2> bounding_corners_;
+		// Convex hull of bounding_corners_ in counter-clockwise order.
+		std::vector<Vector2> bounding_hull_;
 		std::vector<Vector2> velocity_convex_;
 		std::string tag_;
 		float max_tracking_angle_;
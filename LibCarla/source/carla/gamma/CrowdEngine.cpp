@@ -0,0 +1,883 @@
+#include "CrowdEngine.h"
+
+#include "carla/Logging.h"
+#include "carla/aabb/AABBMap.h"
+#include "carla/client/ActorList.h"
+#include "carla/client/BlueprintLibrary.h"
+#include "carla/client/Vehicle.h"
+#include "carla/client/Walker.h"
+#include "carla/client/WorldSnapshot.h"
+#include "carla/gamma/RVOSimulator.h"
+#include "carla/geom/AABB2D.h"
+#include "carla/geom/Math.h"
+#include "carla/geom/Segment2D.h"
+#include "carla/rpc/VehicleControl.h"
+#include "carla/rpc/WalkerControl.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace carla {
+namespace gamma {
+
+static const size_t PATH_MIN_POINTS = 20;
+static const float PATH_INTERVAL = 1.0f;
+static const size_t SPAWN_REPETITIONS = 3;
+static const size_t SPAWN_MAX_TRIES = 16;
+// Spawned actors may take a few ticks to show up in the world snapshot.
+static const double SPAWN_GRACE_PERIOD = 1.0;
+
+// Ziegler-Nichols tuning params: K_p, T_u.
+static const std::unordered_map<std::string, std::pair<float, float>> CAR_SPEED_PID_PROFILES = {
+  {"vehicle.volkswagen.t2", {1.5f, 25.0f / 25}},
+  {"vehicle.carlamotors.carlacola", {3.0f, 25.0f / 25}},
+  {"vehicle.jeep.wrangler_rubicon", {1.5f, 25.0f / 27}},
+  {"vehicle.nissan.patrol", {1.5f, 25.0f / 24}},
+  {"vehicle.chevrolet.impala", {0.8f, 20.0f / 17}},
+  {"vehicle.audi.tt", {0.8f, 20.0f / 15}},
+  {"vehicle.mustang.mustang", {1.0f, 20.0f / 15}},
+  {"vehicle.citroen.c3", {0.7f, 20.0f / 14}},
+  {"vehicle.toyota.prius", {1.2f, 20.0f / 15}},
+  {"vehicle.dodge_charger.police", {1.0f, 20.0f / 17}},
+  {"vehicle.mini.cooperst", {0.8f, 20.0f / 14}},
+  {"vehicle.audi.a2", {0.8f, 20.0f / 18}},
+  {"vehicle.nissan.micra", {0.8f, 20.0f / 19}},
+  {"vehicle.seat.leon", {0.8f, 20.0f / 16}},
+  {"vehicle.tesla.model3", {1.5f, 20.0f / 16}},
+  {"vehicle.mercedes-benz.coupe", {0.8f, 20.0f / 15}},
+  {"vehicle.lincoln.mkz2017", {1.3f, 20.0f / 15}},
+  {"vehicle.bmw.grandtourer", {1.5f, 20.0f / 16}},
+  {"default", {1.6f, 25.0f / 34}}
+};
+
+static const std::unordered_map<std::string, std::pair<float, float>> BIKE_SPEED_PID_PROFILES = {
+  {"vehicle.diamondback.century", {1.5f, 20.0f / 23}},
+  {"vehicle.gazelle.omafiets", {1.5f, 20.0f / 23}},
+  {"vehicle.bh.crossbike", {1.5f, 20.0f / 23}},
+  {"default", {0.75f, 25.0f / 35}}
+};
+
+static const std::unordered_map<std::string, std::pair<float, float>> CAR_STEER_PID_PROFILES = {
+  {"vehicle.volkswagen.t2", {2.5f, 10.0f / 13}},
+  {"vehicle.carlamotors.carlacola", {2.5f, 10.0f / 15}},
+  {"vehicle.jeep.wrangler_rubicon", {2.8f, 10.0f / 17}},
+  {"vehicle.nissan.patrol", {3.2f, 10.0f / 14}},
+  {"vehicle.audi.etron", {3.0f, 10.0f / 15}},
+  {"vehicle.chevrolet.impala", {2.5f, 10.0f / 19}},
+  {"vehicle.audi.tt", {2.3f, 10.0f / 20}},
+  {"vehicle.mustang.mustang", {2.8f, 10.0f / 19}},
+  {"vehicle.citroen.c3", {2.0f, 10.0f / 17}},
+  {"vehicle.toyota.prius", {2.1f, 10.0f / 18}},
+  {"vehicle.dodge_charger.police", {2.3f, 10.0f / 21}},
+  {"vehicle.mini.cooperst", {2.0f, 10.0f / 16}},
+  {"vehicle.audi.a2", {2.0f, 10.0f / 18}},
+  {"vehicle.nissan.micra", {3.3f, 10.0f / 23}},
+  {"vehicle.seat.leon", {2.2f, 10.0f / 20}},
+  {"vehicle.tesla.model3", {2.7f, 10.0f / 19}},
+  {"vehicle.mercedes-benz.coupe", {2.7f, 10.0f / 20}},
+  {"vehicle.lincoln.mkz2017", {2.7f, 10.0f / 16}},
+  {"vehicle.bmw.grandtourer", {2.7f, 10.0f / 17}},
+  {"default", {2.8f, 10.0f / 15}}
+};
+
+static const std::unordered_map<std::string, std::pair<float, float>> BIKE_STEER_PID_PROFILES = {
+  {"vehicle.diamondback.century", {1.7f, 10.0f / 8}},
+  {"vehicle.gazelle.omafiets", {1.7f, 10.0f / 8}},
+  {"vehicle.harley-davidson.low_rider", {1.5f, 10.0f / 9}},
+  {"vehicle.bh.crossbike", {2.5f, 10.0f / 8}},
+  {"default", {2.0f, 10.0f / 9}}
+};
+
+static std::pair<float, float> GetPidProfile(
+    const std::unordered_map<std::string, std::pair<float, float>>& profiles,
+    const std::string& type_id) {
+  auto it = profiles.find(type_id);
+  return it == profiles.end() ? profiles.at("default") : it->second;
+}
+
+static float Clip(float value, float min, float max) {
+  return std::min(std::max(value, min), max);
+}
+
+// Signed angle (degrees) from v2 to v1, in [-180, 180].
+static float GetSignedAngleDiff(const geom::Vector2D& v1, const geom::Vector2D& v2) {
+  float theta = geom::Math::ToDegrees(std::atan2(v1.y, v1.x) - std::atan2(v2.y, v2.x));
+  if (theta > 180) {
+    theta -= 360;
+  } else if (theta < -180) {
+    theta += 360;
+  }
+  return theta;
+}
+
+static RVO::Vector2 ToGamma(const geom::Vector2D& v) {
+  return RVO::Vector2(v.x, v.y);
+}
+
+static std::vector<RVO::Vector2> ToGamma(const std::vector<geom::Vector2D>& vs) {
+  std::vector<RVO::Vector2> result;
+  result.reserve(vs.size());
+  for (const geom::Vector2D& v : vs) {
+    result.emplace_back(ToGamma(v));
+  }
+  return result;
+}
+
+static std::vector<geom::Vector2D> GetBoundingBoxCorners(
+    const geom::Vector2D& center, const geom::Vector2D& forward,
+    float half_length_forward, float half_length_backward, float half_width) {
+  geom::Vector2D sideward = forward.Rotate(geom::Math::Pi<float>() / 2);
+  return {
+    center - half_length_backward * forward + half_width * sideward,
+    center + half_length_forward * forward + half_width * sideward,
+    center + half_length_forward * forward - half_width * sideward,
+    center - half_length_backward * forward - half_width * sideward};
+}
+
+static geom::AABB2D GetAABB(const geom::Vector2D& position, const geom::Vector2D& forward, const geom::BoundingBox& bounding_box) {
+  geom::Vector2D center = position + geom::Vector2D(bounding_box.location.x, bounding_box.location.y);
+  std::vector<geom::Vector2D> corners = GetBoundingBoxCorners(
+      center, forward, bounding_box.extent.x, bounding_box.extent.x, bounding_box.extent.y);
+
+  geom::AABB2D aabb(corners[0], corners[0]);
+  for (const geom::Vector2D& corner : corners) {
+    aabb.bounds_min.x = std::min(aabb.bounds_min.x, corner.x);
+    aabb.bounds_min.y = std::min(aabb.bounds_min.y, corner.y);
+    aabb.bounds_max.x = std::max(aabb.bounds_max.x, corner.x);
+    aabb.bounds_max.y = std::max(aabb.bounds_max.y, corner.y);
+  }
+  return aabb;
+}
+
+static boost::optional<geom::BoundingBox> GetBoundingBox(const SharedPtr<client::Actor>& actor) {
+  if (auto vehicle = boost::dynamic_pointer_cast<client::Vehicle>(actor)) {
+    return vehicle->GetBoundingBox();
+  } else if (auto walker = boost::dynamic_pointer_cast<client::Walker>(actor)) {
+    return walker->GetBoundingBox();
+  }
+  return boost::none;
+}
+
+static bool InBounds(const geom::Vector2D& point, const geom::Vector2D& bounds_min, const geom::Vector2D& bounds_max) {
+  return point.x >= bounds_min.x && point.x <= bounds_max.x &&
+    point.y >= bounds_min.y && point.y <= bounds_max.y;
+}
+
+static int GetNumberOfWheels(const client::Actor& actor) {
+  for (const auto& attribute : actor.GetAttributes()) {
+    if (attribute.GetId() == "number_of_wheels") {
+      return attribute.As<int>();
+    }
+  }
+  return 0;
+}
+
+CrowdEngine::CrowdEngine(
+    client::Client client,
+    const sumonetwork::SumoNetwork& sumo_network,
+    const occupancy::OccupancyMap& sumo_network_occupancy,
+    uint32_t seed)
+  : _client(std::move(client)),
+    _sumo_network(sumo_network),
+    _sumo_network_occupancy(sumo_network_occupancy),
+    _sidewalk(sumo_network_occupancy.CreateSidewalk(1.5f)),
+    _num_agents(0),
+    _spawn_area(sumo_network.CreateSegmentMap(), _sidewalk.CreateSegmentMap()),
+    _rng(seed),
+    _gamma(std::make_unique<RVO::RVOSimulator>()),
+    _gamma_tick(0),
+    _start_time(std::chrono::steady_clock::now()),
+    _last_control_time(-1),
+    _running(false) {
+
+  SharedPtr<client::BlueprintLibrary> blueprint_library = _client.GetWorld().GetBlueprintLibrary();
+  for (const client::ActorBlueprint& blueprint : *blueprint_library->Filter("vehicle.*")) {
+    int number_of_wheels = blueprint.GetAttribute("number_of_wheels").As<int>();
+    if (number_of_wheels == 4) {
+      // These move too slowly.
+      if (blueprint.GetId() == "vehicle.bmw.isetta" || blueprint.GetId() == "vehicle.tesla.cybertruck") continue;
+      _car_blueprints.emplace_back(blueprint);
+    } else if (number_of_wheels == 2) {
+      _bike_blueprints.emplace_back(blueprint);
+    }
+  }
+  for (const client::ActorBlueprint& blueprint : *blueprint_library->Filter("walker.pedestrian.*")) {
+    _pedestrian_blueprints.emplace_back(blueprint);
+  }
+
+  _gamma->setNumWorkers(std::max(1u, std::thread::hardware_concurrency()));
+
+  _settings.bounds_min = _sumo_network.BoundsMin();
+  _settings.bounds_max = _sumo_network.BoundsMax();
+  _tick_settings = _settings;
+  _spawn_area.Update(_settings.bounds_min, _settings.bounds_max, _rng);
+}
+
+CrowdEngine::~CrowdEngine() {
+  Stop();
+}
+
+void CrowdEngine::Configure(const CrowdEngineSettings& settings) {
+  ValidateCrowdEngineSettings(settings);
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  _settings = settings;
+}
+
+CrowdEngineSettings CrowdEngine::GetSettings() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _settings;
+}
+
+CrowdStatistics CrowdEngine::GetStatistics() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _statistics;
+}
+
+size_t CrowdEngine::NumAgents() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _num_agents;
+}
+
+void CrowdEngine::Start() {
+  if (_running.exchange(true)) return;
+
+  _thread = std::thread([this]() {
+    while (_running) {
+      auto start = std::chrono::steady_clock::now();
+      try {
+        Tick();
+      } catch (const std::exception& e) {
+        log_warning("CrowdEngine: tick failed:", e.what());
+      }
+      float rate = GetSettings().rate;
+      auto next_start = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(1.0 / rate));
+      std::unique_lock<std::mutex> stop_lock(_stop_mutex);
+      _stop_condition.wait_until(stop_lock, next_start, [this]() { return !_running; });
+    }
+  });
+}
+
+void CrowdEngine::Stop() {
+  {
+    // Holding the lock so the notification cannot slip in between the
+    // thread checking _running and starting to wait.
+    std::lock_guard<std::mutex> lock(_stop_mutex);
+    _running = false;
+  }
+  _stop_condition.notify_all();
+  if (_thread.joinable()) {
+    _thread.join();
+  }
+}
+
+void CrowdEngine::Tick() {
+  // Ticks run one at a time, but only take _mutex briefly, so that settings
+  // and statistics stay available while the tick waits on the simulator.
+  std::lock_guard<std::mutex> tick_lock(_tick_mutex);
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _tick_settings = _settings;
+  }
+  _spawn_area.Update(_tick_settings.bounds_min, _tick_settings.bounds_max, _rng);
+
+  client::World world = _client.GetWorld();
+  client::WorldSnapshot snapshot = world.GetSnapshot();
+  SharedPtr<client::ActorList> actors = world.GetActors();
+
+  WorldState world_state;
+  for (const SharedPtr<client::Actor>& actor : *actors) {
+    ActorState actor_state;
+    if (boost::dynamic_pointer_cast<client::Vehicle>(actor) != nullptr) {
+      actor_state.type = GetNumberOfWheels(*actor) == 2 ? CrowdAgentType::Bike : CrowdAgentType::Car;
+    } else if (boost::dynamic_pointer_cast<client::Walker>(actor) != nullptr) {
+      actor_state.type = CrowdAgentType::Pedestrian;
+    } else {
+      continue;
+    }
+
+    boost::optional<client::ActorSnapshot> actor_snapshot = snapshot.Find(actor->GetId());
+    if (!actor_snapshot) continue;
+
+    geom::Vector3D forward = actor_snapshot->transform.GetForwardVector();
+    actor_state.actor_id = actor->GetId();
+    actor_state.position = geom::Vector2D(actor_snapshot->transform.location.x, actor_snapshot->transform.location.y);
+    actor_state.z = actor_snapshot->transform.location.z;
+    actor_state.velocity = geom::Vector2D(actor_snapshot->velocity.x, actor_snapshot->velocity.y);
+    actor_state.forward = geom::Vector2D(forward.x, forward.y).MakeUnitVector();
+    actor_state.bounding_box = *GetBoundingBox(actor);
+
+    world_state.actor_lookup.emplace(actor_state.actor_id, world_state.actors.size());
+    world_state.actors.emplace_back(actor_state);
+  }
+
+  std::vector<rpc::ActorId> destroy_list;
+  std::vector<rpc::Command> commands;
+
+  DoSpeedStatistics(world_state);
+  DoGamma(world_state, destroy_list);
+  DoDeath(world_state, destroy_list);
+  DoControl(world_state, commands);
+
+  for (rpc::ActorId actor_id : destroy_list) {
+    commands.emplace_back(rpc::Command::DestroyActor{actor_id});
+  }
+  if (!commands.empty()) {
+    _client.ApplyBatch(std::move(commands));
+  }
+
+  // New agents show up in the world state from the next tick onwards.
+  DoSpawn(world, world_state);
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  _statistics = _tick_statistics;
+  _num_agents = _agents.size();
+}
+
+double CrowdEngine::Now() const {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start_time).count();
+}
+
+void CrowdEngine::DoSpeedStatistics(const WorldState& world_state) {
+  float speed_sums[3] = {0, 0, 0};
+  size_t counts[3] = {0, 0, 0};
+  for (const Agent& agent : _agents) {
+    const ActorState* actor_state = world_state.Find(agent.actor_id);
+    if (actor_state == nullptr) continue;
+    speed_sums[static_cast<size_t>(agent.type)] += actor_state->velocity.Length();
+    counts[static_cast<size_t>(agent.type)]++;
+  }
+
+  _tick_statistics.avg_speed_cars = counts[0] > 0 ? speed_sums[0] / counts[0] : 0.0f;
+  _tick_statistics.avg_speed_bikes = counts[1] > 0 ? speed_sums[1] / counts[1] : 0.0f;
+  _tick_statistics.avg_speed_pedestrians = counts[2] > 0 ? speed_sums[2] / counts[2] : 0.0f;
+}
+
+void CrowdEngine::DoSpawn(client::World& world, const WorldState& world_state) {
+  size_t counts[3] = {0, 0, 0};
+  for (const Agent& agent : _agents) {
+    counts[static_cast<size_t>(agent.type)]++;
+  }
+  bool spawn_car = counts[0] < _tick_settings.num_cars && !_car_blueprints.empty();
+  bool spawn_bike = counts[1] < _tick_settings.num_bikes && !_bike_blueprints.empty();
+  bool spawn_pedestrian = counts[2] < _tick_settings.num_pedestrians && !_pedestrian_blueprints.empty();
+  if (!spawn_car && !spawn_bike && !spawn_pedestrian) return;
+
+  aabb::AABBMap occupied;
+  for (const ActorState& actor_state : world_state.actors) {
+    occupied.Insert(GetAABB(actor_state.position, actor_state.forward, actor_state.bounding_box));
+  }
+  if (_tick_settings.use_forbidden_bounds) {
+    occupied.Insert(geom::AABB2D(_tick_settings.forbidden_bounds_min, _tick_settings.forbidden_bounds_max));
+  }
+
+  // Sampled points are clear, but snapping them to the network or sidewalk
+  // moves them slightly, so the snapped position is checked again.
+  auto is_clear = [&](const geom::Vector2D& position, float clearance) {
+    return !occupied.Intersects(geom::AABB2D(
+          position - geom::Vector2D(clearance, clearance),
+          position + geom::Vector2D(clearance, clearance)));
+  };
+
+  auto spawn_actor = [&](const std::vector<client::ActorBlueprint>& blueprints,
+      const geom::Vector2D& position, const geom::Vector2D& next_position, float z) -> SharedPtr<client::Actor> {
+    geom::Transform transform;
+    transform.location = geom::Location(position.x, position.y, z);
+    transform.rotation.yaw = geom::Math::ToDegrees(std::atan2(next_position.y - position.y, next_position.x - position.x));
+
+    const client::ActorBlueprint& blueprint = blueprints[std::uniform_int_distribution<size_t>(0, blueprints.size() - 1)(_rng)];
+    SharedPtr<client::Actor> actor = world.TrySpawnActor(blueprint, transform);
+    if (actor != nullptr) {
+      actor->SetCollisionEnabled(_tick_settings.collision);
+      geom::Vector2D forward = (next_position - position).MakeUnitVector();
+      boost::optional<geom::BoundingBox> bounding_box = GetBoundingBox(actor);
+      if (bounding_box) {
+        occupied.Insert(GetAABB(position, forward, *bounding_box));
+      }
+    }
+    return actor;
+  };
+
+  auto make_agent = [&](CrowdAgentType type, float speed) {
+    Agent agent;
+    agent.type = type;
+    agent.preferred_speed = speed + std::uniform_real_distribution<float>(-0.5f, 0.5f)(_rng);
+    agent.spawn_time = Now();
+    agent.stuck_time = -1;
+    agent.control_velocity = geom::Vector2D(0, 0);
+    return agent;
+  };
+
+  auto add_agent = [&](Agent&& agent, const SharedPtr<client::Actor>& actor) {
+    CrowdAgentType type = agent.type;
+    agent.actor_id = actor->GetId();
+    agent.type_id = actor->GetTypeId();
+
+    std::pair<float, float> speed_profile;
+    std::pair<float, float> steer_profile;
+    if (type == CrowdAgentType::Car) {
+      speed_profile = GetPidProfile(CAR_SPEED_PID_PROFILES, agent.type_id);
+      steer_profile = GetPidProfile(CAR_STEER_PID_PROFILES, agent.type_id);
+      // Convert (K_p, T_u) -> (K_p, K_i, K_d).
+      agent.speed_kp = 0.8f * speed_profile.first;
+      agent.speed_ki = 0.0f;
+      agent.speed_kd = speed_profile.first * speed_profile.second / 10.0f;
+      agent.steer_kp = steer_profile.first / 2.0f;
+      agent.steer_ki = 0.0f;
+      agent.steer_kd = 0.0f;
+    } else if (type == CrowdAgentType::Bike) {
+      speed_profile = GetPidProfile(BIKE_SPEED_PID_PROFILES, agent.type_id);
+      steer_profile = GetPidProfile(BIKE_STEER_PID_PROFILES, agent.type_id);
+      agent.speed_kp = speed_profile.first / 2.0f;
+      agent.speed_ki = 0.0f;
+      agent.speed_kd = 0.0f;
+      agent.steer_kp = 0.8f * steer_profile.first * 0.9f;
+      agent.steer_ki = 0.0f;
+      agent.steer_kd = steer_profile.first * steer_profile.second / 10.0f * 0.9f;
+    } else {
+      agent.speed_kp = agent.speed_ki = agent.speed_kd = 0.0f;
+      agent.steer_kp = agent.steer_ki = agent.steer_kd = 0.0f;
+    }
+    agent.speed_integral = 0.0f;
+    agent.steer_integral = 0.0f;
+    agent.speed_last_error = 0.0f;
+    agent.steer_last_error = 0.0f;
+    agent.has_last_error = false;
+    _agents.emplace_back(std::move(agent));
+
+    if (type == CrowdAgentType::Car) {
+      _tick_statistics.total_num_cars++;
+    } else if (type == CrowdAgentType::Bike) {
+      _tick_statistics.total_num_bikes++;
+    } else {
+      _tick_statistics.total_num_pedestrians++;
+    }
+  };
+
+  auto spawn_vehicle = [&](CrowdAgentType type, size_t num_spawns) {
+    const std::vector<client::ActorBlueprint>& blueprints = type == CrowdAgentType::Car ? _car_blueprints : _bike_blueprints;
+    float clearance = type == CrowdAgentType::Car ? _tick_settings.clearance_car : _tick_settings.clearance_bike;
+    float speed = type == CrowdAgentType::Car ? _tick_settings.speed_car : _tick_settings.speed_bike;
+
+    for (size_t i = 0; i < num_spawns; i++) {
+      // Each try draws a single sample, so a spawn costs at most
+      // SPAWN_MAX_TRIES samples.
+      for (size_t j = 0; j < SPAWN_MAX_TRIES; j++) {
+        boost::optional<geom::Vector2D> sample = _spawn_area.GetSumoNetworkSegments().RandPointExcluding(
+            occupied, clearance, 1);
+        if (!sample) continue;
+        sumonetwork::IndexedRoutePoint spawn_point = _sumo_network.GetNearestIndexedRoutePoint(*sample);
+        geom::Vector2D position = _sumo_network.GetRoutePointPosition(spawn_point);
+        if (!is_clear(position, clearance)) continue;
+
+        std::vector<sumonetwork::IndexedRoutePoint> route_points = _sumo_network.SampleNextRoutePath(
+            spawn_point, PATH_MIN_POINTS - 1, PATH_INTERVAL, _rng);
+        if (route_points.empty()) continue;
+
+        SharedPtr<client::Actor> actor = spawn_actor(
+            blueprints, position, _sumo_network.GetRoutePointPosition(route_points[1]), 0.2f);
+        if (actor == nullptr) continue;
+
+        Agent agent = make_agent(type, speed);
+        agent.route_points = std::move(route_points);
+        add_agent(std::move(agent), actor);
+        break;
+      }
+    }
+  };
+
+  auto spawn_pedestrian_agent = [&](size_t num_spawns) {
+    for (size_t i = 0; i < num_spawns; i++) {
+      for (size_t j = 0; j < SPAWN_MAX_TRIES; j++) {
+        boost::optional<geom::Vector2D> sample = _spawn_area.GetSidewalkSegments().RandPointExcluding(
+            occupied, _tick_settings.clearance_pedestrian, 1);
+        if (!sample) continue;
+        sidewalk::SidewalkRoutePoint spawn_point = _sidewalk.GetNearestRoutePoint(*sample);
+        geom::Vector2D position = _sidewalk.GetRoutePointPosition(spawn_point);
+        if (!is_clear(position, _tick_settings.clearance_pedestrian)) continue;
+
+        Agent agent = make_agent(CrowdAgentType::Pedestrian, _tick_settings.speed_pedestrian);
+        agent.sidewalk_route_points.emplace_back(spawn_point);
+        agent.sidewalk_route_orientations.emplace_back(std::uniform_int_distribution<int>(0, 1)(_rng) == 1);
+        ResizePath(agent);
+
+        SharedPtr<client::Actor> actor = spawn_actor(
+            _pedestrian_blueprints, position, GetPathPosition(agent, 1), 0.5f);
+        if (actor == nullptr) continue;
+
+        add_agent(std::move(agent), actor);
+        break;
+      }
+    }
+  };
+
+  if (spawn_car) spawn_vehicle(CrowdAgentType::Car, std::min(SPAWN_REPETITIONS, _tick_settings.num_cars - counts[0]));
+  if (spawn_bike) spawn_vehicle(CrowdAgentType::Bike, std::min(SPAWN_REPETITIONS, _tick_settings.num_bikes - counts[1]));
+  if (spawn_pedestrian) spawn_pedestrian_agent(std::min(SPAWN_REPETITIONS, _tick_settings.num_pedestrians - counts[2]));
+}
+
+void CrowdEngine::DoGamma(const WorldState& world_state, std::vector<rpc::ActorId>& destroy_list) {
+  if (_agents.empty()) return;
+
+  // The simulator persists across ticks; actors keep their GAMMA agent until
+  // they leave the world, and only the per-tick state is written.
+  ++_gamma_tick;
+  auto acquire_gamma_agent = [this](rpc::ActorId actor_id, bool tracked, const AgentParams& params) {
+    auto it = _gamma_handles.find(actor_id);
+    if (it != _gamma_handles.end() && it->second.tracked != tracked) {
+      _gamma->removeAgent(it->second.agent_no);
+      _gamma_handles.erase(it);
+      it = _gamma_handles.end();
+    }
+    if (it == _gamma_handles.end()) {
+      it = _gamma_handles.emplace(actor_id, GammaHandle{_gamma->addAgent(params), tracked, 0}).first;
+    }
+    it->second.last_tick = _gamma_tick;
+    return it->second.agent_no;
+  };
+
+  std::vector<size_t> state_agent_nos;
+  std::vector<float> state_positions;
+  std::vector<float> state_velocities;
+  std::vector<float> state_pref_velocities;
+  std::vector<float> state_headings;
+  auto push_state = [&](size_t agent_no, const geom::Vector2D& position, const geom::Vector2D& velocity,
+      const geom::Vector2D& pref_velocity, const geom::Vector2D& heading) {
+    state_agent_nos.emplace_back(agent_no);
+    state_positions.insert(state_positions.end(), {position.x, position.y});
+    state_velocities.insert(state_velocities.end(), {velocity.x, velocity.y});
+    state_pref_velocities.insert(state_pref_velocities.end(), {pref_velocity.x, pref_velocity.y});
+    state_headings.insert(state_headings.end(), {heading.x, heading.y});
+  };
+
+  std::unordered_set<rpc::ActorId> tracked;
+  for (const Agent& agent : _agents) {
+    tracked.insert(agent.actor_id);
+  }
+
+  // Actors not controlled by the engine are simulated at their current velocity.
+  for (const ActorState& actor_state : world_state.actors) {
+    if (tracked.count(actor_state.actor_id) > 0) continue;
+
+    AgentParams params;
+    std::vector<geom::Vector2D> corners;
+    geom::Vector2D center = actor_state.position +
+      geom::Vector2D(actor_state.bounding_box.location.x, actor_state.bounding_box.location.y);
+    if (actor_state.type == CrowdAgentType::Pedestrian) {
+      params = AgentParams::getDefaultAgentParam("People");
+      params.maxSpeed = _tick_settings.speed_pedestrian;
+      corners = GetBoundingBoxCorners(center, actor_state.forward, 0.25f, 0.25f, 0.25f);
+    } else {
+      if (actor_state.type == CrowdAgentType::Car) {
+        params = AgentParams::getDefaultAgentParam("Car");
+        params.maxSpeed = _tick_settings.speed_car;
+      } else {
+        params = AgentParams::getDefaultAgentParam("Bicycle");
+        params.maxSpeed = _tick_settings.speed_bike;
+      }
+      corners = GetBoundingBoxCorners(center, actor_state.forward,
+          actor_state.bounding_box.extent.x + 1.0f,
+          actor_state.bounding_box.extent.x + 0.1f,
+          actor_state.bounding_box.extent.y + 0.3f);
+    }
+
+    size_t gamma_id = acquire_gamma_agent(actor_state.actor_id, false, params);
+    push_state(gamma_id, actor_state.position, actor_state.velocity, actor_state.velocity, actor_state.forward);
+    _gamma->setAgentBoundingBoxCorners(static_cast<int>(gamma_id), ToGamma(corners));
+  }
+
+  std::vector<Agent> next_agents;
+  std::vector<size_t> next_agent_gamma_ids;
+  double now = Now();
+
+  for (Agent& agent : _agents) {
+    const ActorState* actor_state = world_state.Find(agent.actor_id);
+    if (actor_state == nullptr) {
+      if (now - agent.spawn_time < SPAWN_GRACE_PERIOD) {
+        next_agents.emplace_back(std::move(agent));
+        next_agent_gamma_ids.emplace_back(RVO::RVO_ERROR);
+      }
+      continue;
+    }
+
+    const geom::Vector2D& position = actor_state->position;
+    geom::Vector2D pref_vel;
+    geom::Vector2D path_forward(0, 0);
+    std::vector<geom::Vector2D> corners;
+    bool left_lane_constrained = false;
+    bool right_lane_constrained = false;
+    geom::Vector2D center = position +
+      geom::Vector2D(actor_state->bounding_box.location.x, actor_state->bounding_box.location.y);
+
+    if (agent.type == CrowdAgentType::Car || agent.type == CrowdAgentType::Bike) {
+      // Lane change if possible.
+      if (std::uniform_real_distribution<float>(0.0f, 1.0f)(_rng) <= _tick_settings.lane_change_probability) {
+        std::vector<sumonetwork::IndexedRoutePoint> route_points = _sumo_network.SampleNextRoutePath(
+            _sumo_network.GetNearestIndexedRoutePoint(position), PATH_MIN_POINTS - 1, PATH_INTERVAL, _rng);
+        if (!route_points.empty()) {
+          agent.route_points = std::move(route_points);
+        }
+      }
+
+      if (!ResizePath(agent)) {
+        destroy_list.emplace_back(agent.actor_id);
+        continue;
+      }
+      CutPath(agent, position);
+      if (!ResizePath(agent)) {
+        destroy_list.emplace_back(agent.actor_id);
+        continue;
+      }
+
+      pref_vel = agent.preferred_speed * (GetPathPosition(agent, 5) - position).MakeUnitVector();
+      path_forward = (GetPathPosition(agent, 1) - GetPathPosition(agent, 0)).MakeUnitVector();
+      corners = GetBoundingBoxCorners(center, actor_state->forward,
+          actor_state->bounding_box.extent.x + 1.0f,
+          actor_state->bounding_box.extent.x + 0.1f,
+          actor_state->bounding_box.extent.y + 0.3f);
+
+      float constraint_distance = 1.5f + 2.0f + 0.8f;
+      left_lane_constrained = _sidewalk.Intersects(geom::Segment2D(
+            position, position + constraint_distance * path_forward.Rotate(-geom::Math::Pi<float>() / 2)));
+      right_lane_constrained = _sidewalk.Intersects(geom::Segment2D(
+            position, position + constraint_distance * path_forward.Rotate(geom::Math::Pi<float>() / 2)));
+    } else {
+      ResizePath(agent);
+      CutPath(agent, position);
+      ResizePath(agent);
+
+      pref_vel = agent.preferred_speed * (GetPathPosition(agent, 0) - position).MakeUnitVector();
+      corners = GetBoundingBoxCorners(center, actor_state->forward, 0.25f, 0.25f, 0.25f);
+    }
+
+    size_t gamma_id = acquire_gamma_agent(agent.actor_id, true, AgentParams::getDefaultAgentParam(
+          agent.type == CrowdAgentType::Car ? "Car" : agent.type == CrowdAgentType::Bike ? "Bicycle" : "People"));
+    push_state(gamma_id, position, actor_state->velocity, pref_vel, actor_state->forward);
+    _gamma->setAgentBoundingBoxCorners(static_cast<int>(gamma_id), ToGamma(corners));
+    _gamma->setAgentPathForward(gamma_id, ToGamma(path_forward));
+    if (agent.type != CrowdAgentType::Pedestrian) {
+      // GAMMA is right-handed, so left and right are flipped.
+      _gamma->setAgentLaneConstraints(gamma_id, right_lane_constrained, left_lane_constrained);
+    }
+    _gamma->setAgentBehaviorType(static_cast<int>(gamma_id), RVO::Gamma);
+
+    next_agents.emplace_back(std::move(agent));
+    next_agent_gamma_ids.emplace_back(gamma_id);
+  }
+
+  // Drop the agents of actors that were not seen this tick.
+  for (auto it = _gamma_handles.begin(); it != _gamma_handles.end();) {
+    if (it->second.last_tick != _gamma_tick) {
+      _gamma->removeAgent(it->second.agent_no);
+      it = _gamma_handles.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  _gamma->setAgentStates(state_agent_nos.size(), state_agent_nos.data(),
+      state_positions.data(), state_velocities.data(), state_pref_velocities.data(), state_headings.data());
+  _gamma->doStep();
+
+  for (size_t i = 0; i < next_agents.size(); i++) {
+    if (next_agent_gamma_ids[i] == RVO::RVO_ERROR) continue;
+    const RVO::Vector2& velocity = _gamma->getAgentVelocity(next_agent_gamma_ids[i]);
+    next_agents[i].control_velocity = geom::Vector2D(velocity.x(), velocity.y());
+  }
+
+  _agents = std::move(next_agents);
+}
+
+void CrowdEngine::DoDeath(const WorldState& world_state, std::vector<rpc::ActorId>& destroy_list) {
+  double now = Now();
+
+  std::vector<Agent> next_agents;
+  for (Agent& agent : _agents) {
+    const ActorState* actor_state = world_state.Find(agent.actor_id);
+    if (actor_state == nullptr) {
+      next_agents.emplace_back(std::move(agent));
+      continue;
+    }
+
+    bool is_vehicle = agent.type == CrowdAgentType::Car || agent.type == CrowdAgentType::Bike;
+    size_t path_size = is_vehicle ? agent.route_points.size() : agent.sidewalk_route_points.size();
+    bool destroy =
+      !InBounds(actor_state->position, _tick_settings.bounds_min, _tick_settings.bounds_max) ||
+      actor_state->z < -10 ||
+      (is_vehicle && !_sumo_network_occupancy.Contains(actor_state->position)) ||
+      path_size < PATH_MIN_POINTS;
+
+    if (actor_state->velocity.Length() < _tick_settings.stuck_speed) {
+      if (agent.stuck_time >= 0) {
+        if (now - agent.stuck_time >= _tick_settings.stuck_duration) {
+          if (agent.type == CrowdAgentType::Car) {
+            _tick_statistics.stuck_num_cars++;
+          } else if (agent.type == CrowdAgentType::Bike) {
+            _tick_statistics.stuck_num_bikes++;
+          } else {
+            _tick_statistics.stuck_num_pedestrians++;
+          }
+          destroy = true;
+        }
+      } else {
+        agent.stuck_time = now;
+      }
+    } else {
+      agent.stuck_time = -1;
+    }
+
+    if (destroy) {
+      destroy_list.emplace_back(agent.actor_id);
+    } else {
+      next_agents.emplace_back(std::move(agent));
+    }
+  }
+
+  _agents = std::move(next_agents);
+}
+
+void CrowdEngine::DoControl(const WorldState& world_state, std::vector<rpc::Command>& commands) {
+  double now = Now();
+  float dt = _last_control_time < 0 ? 0.0f : static_cast<float>(now - _last_control_time);
+  _last_control_time = now;
+
+  for (Agent& agent : _agents) {
+    const ActorState* actor_state = world_state.Find(agent.actor_id);
+    if (actor_state == nullptr) continue;
+
+    const geom::Vector2D& cur_vel = actor_state->velocity;
+    const geom::Vector2D& control_velocity = agent.control_velocity;
+
+    if (agent.type == CrowdAgentType::Pedestrian) {
+      geom::Vector2D velocity = Clip(control_velocity.Length(), 0.0f, agent.preferred_speed) * control_velocity.MakeUnitVector();
+      commands.emplace_back(rpc::Command::ApplyWalkerControl{
+          agent.actor_id, rpc::WalkerControl(geom::Vector3D(velocity.x, velocity.y, 0), 1.0f, false)});
+      continue;
+    }
+
+    float speed = cur_vel.Length();
+    float target_speed = control_velocity.Length();
+
+    // Clip to stabilize PID against sudden changes in GAMMA.
+    if (agent.type == CrowdAgentType::Car) {
+      target_speed = Clip(target_speed, speed - 2.0f, std::min(speed + 1.0f, _tick_settings.speed_car));
+    } else {
+      target_speed = Clip(target_speed, speed - 1.5f, std::min(speed + 1.0f, _tick_settings.speed_bike));
+    }
+
+    float speed_error = target_speed - speed;
+    float heading_error = geom::Math::ToRadians(GetSignedAngleDiff(control_velocity, cur_vel));
+
+    // Add to integral. Clip to stablize integral term and prevent windup.
+    agent.speed_integral += Clip(speed_error, -0.3f / agent.speed_kp, 0.3f / agent.speed_kp) * dt;
+    agent.steer_integral += Clip(heading_error, -0.3f / agent.steer_kp, 0.3f / agent.steer_kp) * dt;
+    agent.steer_integral = Clip(agent.steer_integral, -0.02f, 0.02f);
+
+    float speed_control = agent.speed_kp * speed_error + agent.speed_ki * agent.speed_integral;
+    float steer_control = agent.steer_kp * heading_error + agent.steer_ki * agent.steer_integral;
+    if (dt > 0 && agent.has_last_error) {
+      speed_control += agent.speed_kd * (speed_error - agent.speed_last_error) / dt;
+      steer_control += agent.steer_kd * (heading_error - agent.steer_last_error) / dt;
+    }
+
+    agent.speed_last_error = speed_error;
+    agent.steer_last_error = heading_error;
+    agent.has_last_error = true;
+
+    rpc::VehicleControl control;
+    if (speed_control >= 0) {
+      control.throttle = speed_control;
+      control.brake = 0.0f;
+    } else {
+      control.throttle = 0.0f;
+      control.brake = -speed_control;
+    }
+    control.hand_brake = false;
+    control.steer = Clip(steer_control, -1.0f, 1.0f);
+    // Manual first gear reduces transmission lag.
+    control.manual_gear_shift = true;
+    control.gear = 1;
+
+    commands.emplace_back(rpc::Command::ApplyVehicleControl{agent.actor_id, control});
+  }
+}
+
+geom::Vector2D CrowdEngine::GetPathPosition(const Agent& agent, size_t index) const {
+  if (agent.type == CrowdAgentType::Pedestrian) {
+    return _sidewalk.GetRoutePointPosition(agent.sidewalk_route_points[index]);
+  } else {
+    return _sumo_network.GetRoutePointPosition(agent.route_points[index]);
+  }
+}
+
+bool CrowdEngine::ResizePath(Agent& agent) {
+  if (agent.type == CrowdAgentType::Pedestrian) {
+    while (agent.sidewalk_route_points.size() < PATH_MIN_POINTS) {
+      const sidewalk::SidewalkRoutePoint& last = agent.sidewalk_route_points.back();
+      if (std::uniform_real_distribution<float>(0.0f, 1.0f)(_rng) <= _tick_settings.cross_probability) {
+        boost::optional<sidewalk::SidewalkRoutePoint> adjacent = _sidewalk.GetAdjacentRoutePoint(last, 50.0f);
+        if (adjacent) {
+          agent.sidewalk_route_points.emplace_back(*adjacent);
+          agent.sidewalk_route_orientations.emplace_back(std::uniform_int_distribution<int>(0, 1)(_rng) == 1);
+          continue;
+        }
+      }
+
+      if (agent.sidewalk_route_orientations.back()) {
+        agent.sidewalk_route_points.emplace_back(_sidewalk.GetNextRoutePoint(last, PATH_INTERVAL));
+        agent.sidewalk_route_orientations.emplace_back(true);
+      } else {
+        agent.sidewalk_route_points.emplace_back(_sidewalk.GetPreviousRoutePoint(last, PATH_INTERVAL));
+        agent.sidewalk_route_orientations.emplace_back(false);
+      }
+    }
+    return true;
+  }
+
+  std::vector<sumonetwork::IndexedRoutePoint> next_route_points;
+  while (agent.route_points.size() < PATH_MIN_POINTS) {
+    next_route_points.clear();
+    _sumo_network.GetNextRoutePoints(agent.route_points.back(), PATH_INTERVAL, next_route_points);
+    if (next_route_points.empty()) return false;
+    agent.route_points.emplace_back(next_route_points[
+        std::uniform_int_distribution<size_t>(0, next_route_points.size() - 1)(_rng)]);
+  }
+  return true;
+}
+
+void CrowdEngine::CutPath(Agent& agent, const geom::Vector2D& position) {
+  size_t path_size = agent.type == CrowdAgentType::Pedestrian ? agent.sidewalk_route_points.size() : agent.route_points.size();
+
+  size_t cut_index = 0;
+  float min_offset = std::numeric_limits<float>::infinity();
+  size_t min_offset_index = 0;
+  for (size_t i = 0; i < path_size / 2; i++) {
+    float offset = (position - GetPathPosition(agent, i)).Length();
+    if (offset < min_offset) {
+      min_offset = offset;
+      min_offset_index = i;
+    }
+    if (offset <= 1.0f) {
+      cut_index = i + 1;
+    }
+  }
+
+  // Too far away from the path; restart from the nearest point.
+  if (min_offset > 1.0f) {
+    cut_index = min_offset_index;
+  }
+
+  if (agent.type == CrowdAgentType::Pedestrian) {
+    agent.sidewalk_route_points.erase(agent.sidewalk_route_points.begin(), agent.sidewalk_route_points.begin() + cut_index);
+    agent.sidewalk_route_orientations.erase(agent.sidewalk_route_orientations.begin(), agent.sidewalk_route_orientations.begin() + cut_index);
+  } else {
+    agent.route_points.erase(agent.route_points.begin(), agent.route_points.begin() + cut_index);
+  }
+}
+
+}
+}
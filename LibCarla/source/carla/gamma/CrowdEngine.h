@@ -0,0 +1,174 @@
+#pragma once
+
+#include "carla/client/ActorBlueprint.h"
+#include "carla/client/Client.h"
+#include "carla/client/World.h"
+#include "carla/gamma/CrowdEngineSettings.h"
+#include "carla/gamma/CrowdSpawnArea.h"
+#include "carla/geom/BoundingBox.h"
+#include "carla/geom/Vector2D.h"
+#include "carla/occupancy/OccupancyMap.h"
+#include "carla/rpc/ActorId.h"
+#include "carla/rpc/Command.h"
+#include "carla/segments/SegmentMap.h"
+#include "carla/sidewalk/Sidewalk.h"
+#include "carla/sumonetwork/SumoNetwork.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace RVO {
+  class RVOSimulator;
+}
+
+namespace carla {
+namespace gamma {
+
+enum class CrowdAgentType {
+  Car,
+  Bike,
+  Pedestrian
+};
+
+// Spawns, steers and destroys crowd agents. Each tick updates agent paths,
+// steps GAMMA on all vehicles and walkers in the world, runs PID control, and
+// sends the resulting commands to the simulator in a single batch.
+class CrowdEngine {
+
+public:
+
+  CrowdEngine(
+      client::Client client,
+      const sumonetwork::SumoNetwork& sumo_network,
+      const occupancy::OccupancyMap& sumo_network_occupancy,
+      uint32_t seed);
+  ~CrowdEngine();
+
+  CrowdEngine(const CrowdEngine&) = delete;
+  CrowdEngine& operator=(const CrowdEngine&) = delete;
+
+  // Takes effect from the next tick. Throws std::invalid_argument if the
+  // settings are invalid, see ValidateCrowdEngineSettings.
+  void Configure(const CrowdEngineSettings& settings);
+  CrowdEngineSettings GetSettings() const;
+  CrowdStatistics GetStatistics() const;
+  size_t NumAgents() const;
+
+  // Runs Tick at the configured rate on a background thread until Stop.
+  void Start();
+  void Stop();
+  bool IsRunning() const { return _running; }
+
+  void Tick();
+
+private:
+
+  struct Agent {
+    rpc::ActorId actor_id;
+    CrowdAgentType type;
+    std::string type_id;
+    float preferred_speed;
+
+    std::vector<sumonetwork::IndexedRoutePoint> route_points;
+    std::vector<sidewalk::SidewalkRoutePoint> sidewalk_route_points;
+    std::vector<bool> sidewalk_route_orientations;
+
+    double spawn_time;
+    double stuck_time;
+    geom::Vector2D control_velocity;
+
+    float speed_kp, speed_ki, speed_kd;
+    float steer_kp, steer_ki, steer_kd;
+    float speed_integral;
+    float steer_integral;
+    float speed_last_error;
+    float steer_last_error;
+    bool has_last_error;
+  };
+
+  struct ActorState {
+    rpc::ActorId actor_id;
+    CrowdAgentType type;
+    geom::Vector2D position;
+    float z;
+    geom::Vector2D velocity;
+    geom::Vector2D forward;
+    geom::BoundingBox bounding_box;
+  };
+
+  // Agent of the persistent GAMMA simulator that stands for an actor.
+  struct GammaHandle {
+    size_t agent_no;
+    bool tracked;
+    uint64_t last_tick;
+  };
+
+  struct WorldState {
+    std::vector<ActorState> actors;
+    std::unordered_map<rpc::ActorId, size_t> actor_lookup;
+
+    const ActorState* Find(rpc::ActorId actor_id) const {
+      auto it = actor_lookup.find(actor_id);
+      return it == actor_lookup.end() ? nullptr : &actors[it->second];
+    }
+  };
+
+  client::Client _client;
+  sumonetwork::SumoNetwork _sumo_network;
+  occupancy::OccupancyMap _sumo_network_occupancy;
+  sidewalk::Sidewalk _sidewalk;
+
+  std::vector<client::ActorBlueprint> _car_blueprints;
+  std::vector<client::ActorBlueprint> _bike_blueprints;
+  std::vector<client::ActorBlueprint> _pedestrian_blueprints;
+
+  // Guarded by _mutex, which is never held across calls to the simulator.
+  CrowdEngineSettings _settings;
+  CrowdStatistics _statistics;
+  size_t _num_agents;
+  mutable std::mutex _mutex;
+
+  // Owned by the running tick, guarded by _tick_mutex. Settings are copied in
+  // at the start of a tick and statistics published at its end.
+  std::mutex _tick_mutex;
+  CrowdEngineSettings _tick_settings;
+  CrowdStatistics _tick_statistics;
+  CrowdSpawnArea _spawn_area;
+  std::vector<Agent> _agents;
+  std::mt19937 _rng;
+
+  std::unique_ptr<RVO::RVOSimulator> _gamma;
+  std::unordered_map<rpc::ActorId, GammaHandle> _gamma_handles;
+  uint64_t _gamma_tick;
+
+  std::chrono::steady_clock::time_point _start_time;
+  double _last_control_time;
+
+  std::atomic<bool> _running;
+  std::thread _thread;
+  // Wakes the background thread up from its wait between ticks on Stop.
+  std::mutex _stop_mutex;
+  std::condition_variable _stop_condition;
+
+  double Now() const;
+
+  void DoSpeedStatistics(const WorldState& world_state);
+  void DoSpawn(client::World& world, const WorldState& world_state);
+  void DoGamma(const WorldState& world_state, std::vector<rpc::ActorId>& destroy_list);
+  void DoDeath(const WorldState& world_state, std::vector<rpc::ActorId>& destroy_list);
+  void DoControl(const WorldState& world_state, std::vector<rpc::Command>& commands);
+
+  geom::Vector2D GetPathPosition(const Agent& agent, size_t index) const;
+  bool ResizePath(Agent& agent);
+  void CutPath(Agent& agent, const geom::Vector2D& position);
+};
+
+}
+}
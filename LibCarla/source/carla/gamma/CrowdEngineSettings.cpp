@@ -0,0 +1,28 @@
+#include "CrowdEngineSettings.h"
+
+#include "carla/Exception.h"
+#include <cmath>
+#include <stdexcept>
+
+namespace carla {
+namespace gamma {
+
+// Written so that NaN fails the checks.
+static bool IsProbability(float value) {
+  return value >= 0.0f && value <= 1.0f;
+}
+
+void ValidateCrowdEngineSettings(const CrowdEngineSettings& settings) {
+  if (!(settings.rate > 0.0f) || std::isinf(settings.rate)) {
+    throw_exception(std::invalid_argument("CrowdEngine: rate must be a positive number"));
+  }
+  if (!IsProbability(settings.lane_change_probability)) {
+    throw_exception(std::invalid_argument("CrowdEngine: lane_change_probability must be within [0, 1]"));
+  }
+  if (!IsProbability(settings.cross_probability)) {
+    throw_exception(std::invalid_argument("CrowdEngine: cross_probability must be within [0, 1]"));
+  }
+}
+
+}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "carla/geom/Vector2D.h"
+#include <cstddef>
+
+namespace carla {
+namespace gamma {
+
+struct CrowdEngineSettings {
+  geom::Vector2D bounds_min;
+  geom::Vector2D bounds_max;
+  // Spawning is disabled inside the forbidden bounds, if set.
+  bool use_forbidden_bounds = false;
+  geom::Vector2D forbidden_bounds_min;
+  geom::Vector2D forbidden_bounds_max;
+
+  size_t num_cars = 20;
+  size_t num_bikes = 20;
+  size_t num_pedestrians = 20;
+  float speed_car = 4.0f;
+  float speed_bike = 2.0f;
+  float speed_pedestrian = 1.0f;
+  float clearance_car = 10.0f;
+  float clearance_bike = 10.0f;
+  float clearance_pedestrian = 1.0f;
+  float lane_change_probability = 0.0f;
+  float cross_probability = 0.1f;
+  float stuck_speed = 0.2f;
+  float stuck_duration = 5.0f;
+  bool collision = false;
+
+  // Rate (Hz) of the loop run by CrowdEngine::Start. Must be positive.
+  float rate = 40.0f;
+};
+
+// Throws std::invalid_argument if rate is not a positive number, or if a
+// probability is not within [0, 1].
+void ValidateCrowdEngineSettings(const CrowdEngineSettings& settings);
+
+struct CrowdStatistics {
+  size_t total_num_cars = 0;
+  size_t total_num_bikes = 0;
+  size_t total_num_pedestrians = 0;
+  size_t stuck_num_cars = 0;
+  size_t stuck_num_bikes = 0;
+  size_t stuck_num_pedestrians = 0;
+  float avg_speed_cars = 0;
+  float avg_speed_bikes = 0;
+  float avg_speed_pedestrians = 0;
+};
+
+}
+}
@@ -0,0 +1,29 @@
+#include "CrowdSpawnArea.h"
+
+#include "carla/occupancy/OccupancyMap.h"
+
+namespace carla {
+namespace gamma {
+
+CrowdSpawnArea::CrowdSpawnArea(segments::SegmentMap sumo_network_segments, segments::SegmentMap sidewalk_segments)
+  : _sumo_network_segments(std::move(sumo_network_segments)),
+    _sidewalk_segments(std::move(sidewalk_segments)),
+    _has_bounds(false) { }
+
+bool CrowdSpawnArea::Update(const geom::Vector2D& bounds_min, const geom::Vector2D& bounds_max, std::mt19937& rng) {
+  if (_has_bounds && bounds_min == _bounds_min && bounds_max == _bounds_max) return false;
+
+  occupancy::OccupancyMap bounds_occupancy(bounds_min, bounds_max);
+  _sumo_network_spawn_segments = _sumo_network_segments.Intersection(bounds_occupancy);
+  _sumo_network_spawn_segments.SeedRand(rng());
+  _sidewalk_spawn_segments = _sidewalk_segments.Intersection(bounds_occupancy);
+  _sidewalk_spawn_segments.SeedRand(rng());
+
+  _has_bounds = true;
+  _bounds_min = bounds_min;
+  _bounds_max = bounds_max;
+  return true;
+}
+
+}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "carla/geom/Vector2D.h"
+#include "carla/segments/SegmentMap.h"
+#include <random>
+
+namespace carla {
+namespace gamma {
+
+// Network and sidewalk segments that crowd agents are spawned on, clipped to
+// the spawn bounds. Segments are only clipped again when the bounds change.
+class CrowdSpawnArea {
+
+public:
+
+  CrowdSpawnArea(segments::SegmentMap sumo_network_segments, segments::SegmentMap sidewalk_segments);
+
+  // Clips the segments to the given bounds and seeds their sampling from rng,
+  // unless the bounds are those of the last update. Returns whether the
+  // segments were clipped.
+  bool Update(const geom::Vector2D& bounds_min, const geom::Vector2D& bounds_max, std::mt19937& rng);
+
+  segments::SegmentMap& GetSumoNetworkSegments() { return _sumo_network_spawn_segments; }
+  segments::SegmentMap& GetSidewalkSegments() { return _sidewalk_spawn_segments; }
+
+private:
+
+  segments::SegmentMap _sumo_network_segments;
+  segments::SegmentMap _sidewalk_segments;
+  segments::SegmentMap _sumo_network_spawn_segments;
+  segments::SegmentMap _sidewalk_spawn_segments;
+
+  bool _has_bounds;
+  geom::Vector2D _bounds_min;
+  geom::Vector2D _bounds_max;
+};
+
+}
+}
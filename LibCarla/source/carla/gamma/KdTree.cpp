@@ -38,8 +38,12 @@
 #include "RVOSimulator.h"
 #include "Obstacle.h"
 
+#if defined(__SSE2__) || defined(__AVX__)
+#include <immintrin.h>
+#endif
+
 namespace RVO {
-	KdTree::KdTree(RVOSimulator *sim) : obstacleTree_(NULL), sim_(sim) { }
+	KdTree::KdTree(RVOSimulator *sim) : agentsChanged_(true), obstacleTree_(NULL), sim_(sim) { }
 
 	KdTree::~KdTree()
 	{
@@ -48,56 +52,110 @@ namespace RVO {
 
 	void KdTree::clearAllAgents(){
 		agents_.clear();
+		agentIndices_.clear();
+		agentX_.clear();
+		agentY_.clear();
+		agentBuildX_.clear();
+		agentBuildY_.clear();
+		agentsChanged_ = true;
+	}
+
+	void KdTree::invalidateAgentTree()
+	{
+		agentsChanged_ = true;
 	}
 
 	void KdTree::buildAgentTree()
 	{
-		//if (agents_.size() < sim_->agents_.size()) {
-		if(true){
-			for (size_t i = agents_.size(); i < sim_->agents_.size(); ++i) {
-				agents_.push_back(sim_->agents_[i]);
+		bool rebuild = agentsChanged_;
+
+		if (agentsChanged_) {
+			agents_.clear();
+			for (size_t i = 0; i < sim_->agents_.size(); ++i) {
+				if (sim_->agents_[i] != NULL) {
+					agents_.push_back(sim_->agents_[i]);
+				}
 			}
-			agentTree_.resize(2 * agents_.size() - 1);
+
+			agentIndices_.resize(agents_.size());
+			for (size_t i = 0; i < agents_.size(); ++i) {
+				agentIndices_[i] = i;
+			}
+			agentX_.resize(agents_.size());
+			agentY_.resize(agents_.size());
+			agentsChanged_ = false;
+		}
+
+		if (agents_.empty()) {
+			agentTree_.clear();
+			return;
 		}
 
-		if (!agents_.empty()) {
-			buildAgentTreeRecursive(0, agents_.size(), 0);
+		for (size_t i = 0; i < agents_.size(); ++i) {
+			const Vector2 &position = agents_[agentIndices_[i]]->position_;
+			agentX_[i] = position.x();
+			agentY_[i] = position.y();
 		}
+
+		if (!rebuild) {
+			size_t numMoved = 0;
+			const size_t maxMoved = static_cast<size_t>(REFIT_MAX_MOVED_FRACTION * static_cast<float>(agents_.size()));
+
+			for (size_t i = 0; i < agents_.size() && numMoved <= maxMoved; ++i) {
+				if (sqr(agentX_[i] - agentBuildX_[i]) + sqr(agentY_[i] - agentBuildY_[i]) > REFIT_MAX_DISPLACEMENT_SQ) {
+					++numMoved;
+				}
+			}
+
+			if (numMoved <= maxMoved) {
+				refitAgentTreeRecursive(0);
+				return;
+			}
+		}
+
+		agentTree_.resize(2 * agents_.size() - 1);
+		buildAgentTreeRecursive(0, agents_.size(), 0);
+
+		agentBuildX_ = agentX_;
+		agentBuildY_ = agentY_;
 	}
 
 	void KdTree::buildAgentTreeRecursive(size_t begin, size_t end, size_t node)
 	{
 		agentTree_[node].begin = begin;
 		agentTree_[node].end = end;
-		agentTree_[node].minX = agentTree_[node].maxX = agents_[begin]->position_.x();
-		agentTree_[node].minY = agentTree_[node].maxY = agents_[begin]->position_.y();
+		agentTree_[node].minX = agentTree_[node].maxX = agentX_[begin];
+		agentTree_[node].minY = agentTree_[node].maxY = agentY_[begin];
 
 		for (size_t i = begin + 1; i < end; ++i) {
-			agentTree_[node].maxX = std::max(agentTree_[node].maxX, agents_[i]->position_.x());
-			agentTree_[node].minX = std::min(agentTree_[node].minX, agents_[i]->position_.x());
-			agentTree_[node].maxY = std::max(agentTree_[node].maxY, agents_[i]->position_.y());
-			agentTree_[node].minY = std::min(agentTree_[node].minY, agents_[i]->position_.y());
+			agentTree_[node].maxX = std::max(agentTree_[node].maxX, agentX_[i]);
+			agentTree_[node].minX = std::min(agentTree_[node].minX, agentX_[i]);
+			agentTree_[node].maxY = std::max(agentTree_[node].maxY, agentY_[i]);
+			agentTree_[node].minY = std::min(agentTree_[node].minY, agentY_[i]);
 		}
 
 		if (end - begin > MAX_LEAF_SIZE) {
 			/* No leaf node. */
 			const bool isVertical = (agentTree_[node].maxX - agentTree_[node].minX > agentTree_[node].maxY - agentTree_[node].minY);
 			const float splitValue = (isVertical ? 0.5f * (agentTree_[node].maxX + agentTree_[node].minX) : 0.5f * (agentTree_[node].maxY + agentTree_[node].minY));
+			const std::vector<float> &coords = isVertical ? agentX_ : agentY_;
 
 			size_t left = begin;
 			size_t right = end;
 
 			while (left < right) {
-				while (left < right && (isVertical ? agents_[left]->position_.x() : agents_[left]->position_.y()) < splitValue) {
+				while (left < right && coords[left] < splitValue) {
 					++left;
 				}
 
-				while (right > left && (isVertical ? agents_[right - 1]->position_.x() : agents_[right - 1]->position_.y()) >= splitValue) {
+				while (right > left && coords[right - 1] >= splitValue) {
 					--right;
 				}
 
 				if (left < right) {
-					std::swap(agents_[left], agents_[right - 1]);
+					std::swap(agentIndices_[left], agentIndices_[right - 1]);
+					std::swap(agentX_[left], agentX_[right - 1]);
+					std::swap(agentY_[left], agentY_[right - 1]);
 					++left;
 					--right;
 				}
@@ -116,6 +174,67 @@ namespace RVO {
 		}
 	}
 
+	void KdTree::refitAgentTreeRecursive(size_t node)
+	{
+		AgentTreeNode &treeNode = agentTree_[node];
+
+		if (treeNode.end - treeNode.begin > MAX_LEAF_SIZE) {
+			refitAgentTreeRecursive(treeNode.left);
+			refitAgentTreeRecursive(treeNode.right);
+
+			const AgentTreeNode &leftNode = agentTree_[treeNode.left];
+			const AgentTreeNode &rightNode = agentTree_[treeNode.right];
+			treeNode.minX = std::min(leftNode.minX, rightNode.minX);
+			treeNode.maxX = std::max(leftNode.maxX, rightNode.maxX);
+			treeNode.minY = std::min(leftNode.minY, rightNode.minY);
+			treeNode.maxY = std::max(leftNode.maxY, rightNode.maxY);
+		}
+		else {
+			treeNode.minX = treeNode.maxX = agentX_[treeNode.begin];
+			treeNode.minY = treeNode.maxY = agentY_[treeNode.begin];
+
+			for (size_t i = treeNode.begin + 1; i < treeNode.end; ++i) {
+				treeNode.maxX = std::max(treeNode.maxX, agentX_[i]);
+				treeNode.minX = std::min(treeNode.minX, agentX_[i]);
+				treeNode.maxY = std::max(treeNode.maxY, agentY_[i]);
+				treeNode.minY = std::min(treeNode.minY, agentY_[i]);
+			}
+		}
+	}
+
+	void KdTree::computeAgentDistSq(float x, float y, size_t begin, size_t end, float *distSq) const
+	{
+		size_t i = begin;
+
+#if defined(__AVX__)
+		const __m256 x8 = _mm256_set1_ps(x);
+		const __m256 y8 = _mm256_set1_ps(y);
+
+		for (; i + 8 <= end; i += 8) {
+			const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&agentX_[i]), x8);
+			const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&agentY_[i]), y8);
+			_mm256_storeu_ps(distSq + (i - begin), _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+		}
+#endif
+
+#if defined(__SSE2__)
+		const __m128 x4 = _mm_set1_ps(x);
+		const __m128 y4 = _mm_set1_ps(y);
+
+		for (; i + 4 <= end; i += 4) {
+			const __m128 dx = _mm_sub_ps(_mm_loadu_ps(&agentX_[i]), x4);
+			const __m128 dy = _mm_sub_ps(_mm_loadu_ps(&agentY_[i]), y4);
+			_mm_storeu_ps(distSq + (i - begin), _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+		}
+#endif
+
+		for (; i < end; ++i) {
+			const float dx = agentX_[i] - x;
+			const float dy = agentY_[i] - y;
+			distSq[i - begin] = dx * dx + dy * dy;
+		}
+	}
+
 	void KdTree::buildObstacleTree()
 	{
 		deleteObstacleTree(obstacleTree_);
@@ -272,8 +391,16 @@ namespace RVO {
 	void KdTree::queryAgentTreeRecursive(Agent *agent, float &rangeSq, size_t node) const
 	{
 		if (agentTree_[node].end - agentTree_[node].begin <= MAX_LEAF_SIZE) {
-			for (size_t i = agentTree_[node].begin; i < agentTree_[node].end; ++i) {
-				agent->insertAgentNeighbor(agents_[i], rangeSq);
+			const size_t begin = agentTree_[node].begin;
+			const size_t end = agentTree_[node].end;
+			float distSq[MAX_LEAF_SIZE];
+
+			computeAgentDistSq(agent->position_.x(), agent->position_.y(), begin, end, distSq);
+
+			for (size_t i = begin; i < end; ++i) {
+				if (distSq[i - begin] < rangeSq) {
+					agent->insertAgentNeighbor(agents_[agentIndices_[i]], distSq[i - begin], rangeSq);
+				}
 			}
 		}
 		else {
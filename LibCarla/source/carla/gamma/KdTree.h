@@ -128,12 +128,35 @@ namespace RVO {
 		void clearAllAgents();
 
 		/**
-		 * \brief      Builds an agent <i>k</i>d-tree.
+		 * \brief      Marks the agent set as changed, forcing the next
+		 *             buildAgentTree to rebuild the tree from scratch.
+		 */
+		void invalidateAgentTree();
+
+		/**
+		 * \brief      Builds an agent <i>k</i>d-tree. If the agent set is
+		 *             unchanged since the last build and few agents moved
+		 *             far from where they were at that build, the node bounds
+		 *             are refit in place instead.
 		 */
 		void buildAgentTree();
 
 		void buildAgentTreeRecursive(size_t begin, size_t end, size_t node);
 
+		void refitAgentTreeRecursive(size_t node);
+
+		/**
+		 * \brief      Computes the squared distances from a point to the
+		 *             agents in the range [begin, end) of the tree order.
+		 * \param      x               The x-coordinate of the point.
+		 * \param      y               The y-coordinate of the point.
+		 * \param      begin           The first agent of the range.
+		 * \param      end             One past the last agent of the range.
+		 * \param      distSq          Receives end - begin squared distances.
+		 */
+		void computeAgentDistSq(float x, float y, size_t begin, size_t end,
+								float *distSq) const;
+
 		/**
 		 * \brief      Builds an obstacle <i>k</i>d-tree.
 		 */
@@ -190,13 +213,50 @@ namespace RVO {
 									  float radius,
 									  const ObstacleTreeNode *node) const;
 
+		/**
+		 * \brief      The agents in the tree, in simulator order.
+		 */
 		std::vector<Agent *> agents_;
+
+		/**
+		 * \brief      Indices into agents_ in tree order. Node ranges refer to
+		 *             this order, as do the coordinate arrays below.
+		 */
+		std::vector<size_t> agentIndices_;
+
+		/**
+		 * \brief      Agent coordinates in tree order, contiguous so that leaf
+		 *             scans neither chase agent pointers nor touch their other
+		 *             members.
+		 */
+		std::vector<float> agentX_;
+		std::vector<float> agentY_;
+
+		/**
+		 * \brief      Agent coordinates in tree order at the last full build.
+		 */
+		std::vector<float> agentBuildX_;
+		std::vector<float> agentBuildY_;
+
+		bool agentsChanged_;
 		std::vector<AgentTreeNode> agentTree_;
 		ObstacleTreeNode *obstacleTree_;
 		RVOSimulator *sim_;
 
 		static const size_t MAX_LEAF_SIZE = 10;
 
+		/**
+		 * \brief      Squared distance an agent may move from its position at
+		 *             the last full build before it counts as moved.
+		 */
+		static constexpr float REFIT_MAX_DISPLACEMENT_SQ = 1.0f;
+
+		/**
+		 * \brief      Fraction of moved agents above which the tree is rebuilt
+		 *             instead of refit.
+		 */
+		static constexpr float REFIT_MAX_MOVED_FRACTION = 0.1f;
+
 		friend class Agent;
 		friend class RVOSimulator;
 	};
@@ -10,12 +10,13 @@
 namespace RVO {
 	class Minkowski {
 		public:
-		static std::vector<Vector2> Sum(std::vector<Vector2> a_points, std::vector<Vector2> b_points) {
+		static std::vector<Vector2> Sum(const std::vector<Vector2> &a_points, const std::vector<Vector2> &b_points) {
 			std::vector<Vector2> sum; // = new std::vector<Vector2>();
+			sum.reserve(a_points.size() * b_points.size());
 			for(size_t i=0; i<a_points.size(); i++){
-				Vector2 a_p = a_points[i];
+				const Vector2 &a_p = a_points[i];
 				for(size_t j=0; j<b_points.size(); j++){
-					Vector2 b_p = b_points[j];
+					const Vector2 &b_p = b_points[j];
 					sum.push_back (a_p + b_p);
 				}
 			}
@@ -25,12 +26,13 @@ namespace RVO {
 			return results;
 		}
 
-		static std::vector<Vector2> Diff(std::vector<Vector2> a_points, std::vector<Vector2> b_points) {
+		static std::vector<Vector2> Diff(const std::vector<Vector2> &a_points, const std::vector<Vector2> &b_points) {
 			std::vector<Vector2> diff;// = new std::vector<Vector2>();
+			diff.reserve(a_points.size() * b_points.size());
 			for(size_t i=0; i<a_points.size(); i++){
-				Vector2 a_p = a_points[i];
+				const Vector2 &a_p = a_points[i];
 				for(size_t j=0; j<b_points.size(); j++){
-					Vector2 b_p = b_points[j];
+					const Vector2 &b_p = b_points[j];
 					diff.push_back (a_p - b_p);
 				}
 			}
@@ -39,6 +41,82 @@ namespace RVO {
 			std::reverse(results.begin(), results.end()); // return the points in counter-clockwise order
 			return results;
 		}
+
+		// Returns the convex hull of the points in counter-clockwise order, as
+		// expected by DiffConvex.
+		static std::vector<Vector2> Hull(const std::vector<Vector2> &points) {
+			std::vector<Vector2> results = makeConvexHull(points);
+			std::reverse(results.begin(), results.end());
+			return results;
+		}
+
+		// Same as Diff, for a_hull and b_hull already convex and counter-clockwise
+		// (see Hull). Merges the edges of a_hull and -b_hull by angle in
+		// O(n + m) and writes the result into diff, reusing its storage. The
+		// result starts at the same vertex as Diff would.
+		static void DiffConvex(const std::vector<Vector2> &a_hull, const std::vector<Vector2> &b_hull, std::vector<Vector2> &diff) {
+			const size_t n = a_hull.size();
+			const size_t m = b_hull.size();
+			diff.clear();
+
+			if (n < 3 || m < 3) {
+				diff = Diff(a_hull, b_hull);
+				return;
+			}
+
+			// Lowest vertex of a_hull, and lowest vertex of -b_hull (highest of b_hull).
+			size_t a_start = 0;
+			for (size_t i = 1; i < n; i++) {
+				if (a_hull[i].y() < a_hull[a_start].y() || (a_hull[i].y() == a_hull[a_start].y() && a_hull[i].x() < a_hull[a_start].x()))
+					a_start = i;
+			}
+			size_t b_start = 0;
+			for (size_t j = 1; j < m; j++) {
+				if (b_hull[j].y() > b_hull[b_start].y() || (b_hull[j].y() == b_hull[b_start].y() && b_hull[j].x() > b_hull[b_start].x()))
+					b_start = j;
+			}
+
+			size_t i = 0;
+			size_t j = 0;
+			while (i < n || j < m) {
+				const Vector2 &a_p = a_hull[(a_start + i) % n];
+				const Vector2 &b_p = b_hull[(b_start + j) % m];
+				PushHullVertex(diff, a_p - b_p);
+
+				if (i == n) {
+					j++;
+				} else if (j == m) {
+					i++;
+				} else {
+					const float cross = det(a_hull[(a_start + i + 1) % n] - a_p, b_p - b_hull[(b_start + j + 1) % m]);
+					if (cross >= 0.0f)
+						i++;
+					if (cross <= 0.0f)
+						j++;
+				}
+			}
+
+			// Drop collinear vertices across the wrap-around.
+			while (diff.size() >= 3 && det(diff[diff.size() - 1] - diff[diff.size() - 2], diff[0] - diff[diff.size() - 1]) <= 0.0f)
+				diff.pop_back();
+			while (diff.size() >= 3 && det(diff[0] - diff[diff.size() - 1], diff[1] - diff[0]) <= 0.0f)
+				diff.erase(diff.begin());
+
+			// Diff starts right after the lexicographically smallest vertex.
+			size_t min_index = 0;
+			for (size_t k = 1; k < diff.size(); k++) {
+				if (diff[k] < diff[min_index])
+					min_index = k;
+			}
+			std::rotate(diff.begin(), diff.begin() + static_cast<std::ptrdiff_t>((min_index + 1) % diff.size()), diff.end());
+		}
+
+		private:
+		static void PushHullVertex(std::vector<Vector2> &hull, const Vector2 &p) {
+			while (hull.size() >= 2 && det(hull[hull.size() - 1] - hull[hull.size() - 2], p - hull[hull.size() - 1]) <= 0.0f)
+				hull.pop_back();
+			hull.push_back(p);
+		}
 	};
 }
 
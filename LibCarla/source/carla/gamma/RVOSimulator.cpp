@@ -36,21 +36,24 @@
 
 #include "Agent.h"
 #include "KdTree.h"
+#include "Minkowski.h"
 #include "Obstacle.h"
 
 
-#ifdef _OPENMP
-#include <omp.h>
-#endif
+#include "carla/ThreadPool.h"
+
+#include <algorithm>
+#include <future>
+#include <stdexcept>
 
 namespace RVO {
-	RVOSimulator::RVOSimulator() : defaultAgent_(NULL), globalTime_(0.0f), kdTree_(NULL), timeStep_(0.0f)
+	RVOSimulator::RVOSimulator() : numAgents_(0), defaultAgent_(NULL), globalTime_(0.0f), kdTree_(NULL), timeStep_(0.0f), numWorkers_(1), threadPool_(NULL)
 	{
 		kdTree_ = new KdTree(this);
 
 	}
 
-	RVOSimulator::RVOSimulator(float timeStep, float neighborDist, size_t maxNeighbors, float timeHorizon, float timeHorizonObst, float radius, float maxSpeed, const Vector2 &velocity) : defaultAgent_(NULL), globalTime_(0.0f), kdTree_(NULL), timeStep_(timeStep)
+	RVOSimulator::RVOSimulator(float timeStep, float neighborDist, size_t maxNeighbors, float timeHorizon, float timeHorizonObst, float radius, float maxSpeed, const Vector2 &velocity) : numAgents_(0), defaultAgent_(NULL), globalTime_(0.0f), kdTree_(NULL), timeStep_(timeStep), numWorkers_(1), threadPool_(NULL)
 	{
 		kdTree_ = new KdTree(this);
 		defaultAgent_ = new Agent(this);
@@ -66,6 +69,8 @@ namespace RVO {
 
 	RVOSimulator::~RVOSimulator()
 	{
+		delete threadPool_;
+
 		if (defaultAgent_ != NULL) {
 			delete defaultAgent_;
 		}
@@ -91,9 +96,84 @@ namespace RVO {
 			}
 		}
 		agents_.clear();
+		freeAgentSlots_.clear();
+		numAgents_ = 0;
 		kdTree_->clearAllAgents();
 	}
 
+	size_t RVOSimulator::insertAgent(Agent *agent)
+	{
+		size_t agentNo;
+
+		if (!freeAgentSlots_.empty()) {
+			agentNo = freeAgentSlots_.back();
+			freeAgentSlots_.pop_back();
+			agents_[agentNo] = agent;
+		}
+		else {
+			agentNo = agents_.size();
+			agents_.push_back(agent);
+		}
+
+		agent->id_ = agentNo;
+		++numAgents_;
+		kdTree_->invalidateAgentTree();
+
+		return agentNo;
+	}
+
+	void RVOSimulator::removeAgent(size_t agentNo)
+	{
+		if (!hasAgent(agentNo)) {
+			return;
+		}
+
+		delete agents_[agentNo];
+		agents_[agentNo] = NULL;
+		freeAgentSlots_.push_back(agentNo);
+		--numAgents_;
+		kdTree_->invalidateAgentTree();
+	}
+
+	bool RVOSimulator::hasAgent(size_t agentNo) const
+	{
+		return agentNo < agents_.size() && agents_[agentNo] != NULL;
+	}
+
+	Agent *RVOSimulator::getAgent(size_t agentNo) const
+	{
+		if (!hasAgent(agentNo)) {
+			throw std::out_of_range("RVOSimulator: no agent with this number");
+		}
+
+		return agents_[agentNo];
+	}
+
+	void RVOSimulator::setAgentStates(size_t count, const size_t *agentNos, const float *positions, const float *velocities, const float *prefVelocities, const float *headings)
+	{
+		// Checked up front, so that no agent is updated if any number is invalid.
+		for (size_t i = 0; i < count; ++i) {
+			getAgent(agentNos[i]);
+		}
+
+		for (size_t i = 0; i < count; ++i) {
+			Agent *agent = agents_[agentNos[i]];
+
+			if (positions != NULL) {
+				agent->position_ = Vector2(positions[2 * i], positions[2 * i + 1]);
+			}
+			if (velocities != NULL) {
+				agent->velocity_ = Vector2(velocities[2 * i], velocities[2 * i + 1]);
+			}
+			if (prefVelocities != NULL) {
+				agent->prefVelocity_ = Vector2(prefVelocities[2 * i], prefVelocities[2 * i + 1]);
+			}
+			if (headings != NULL) {
+				agent->heading_ = Vector2(headings[2 * i], headings[2 * i + 1]);
+			}
+		}
+	}
+
 
 	size_t RVOSimulator::addAgent(const Vector2 &position)
 	{
@@ -112,15 +192,11 @@ namespace RVO {
 		agent->timeHorizonObst_ = defaultAgent_->timeHorizonObst_;
 		agent->velocity_ = defaultAgent_->velocity_;
 
-		agent->id_ = agents_.size();
-
 		agent->path_forward_ = Vector2(0.0f, 0.0f);
 		agent->left_lane_constrained_ = false;
 		agent->right_lane_constrained_ = false;
 
-		agents_.push_back(agent);
-
-		return agents_.size() - 1;
+		return insertAgent(agent);
 	}
 
 	size_t RVOSimulator::addAgent(const Vector2 &position, float neighborDist, size_t maxNeighbors, float timeHorizon, float timeHorizonObst, float radius, float maxSpeed, const Vector2 &velocity)
@@ -136,16 +212,11 @@ namespace RVO {
 		agent->timeHorizonObst_ = timeHorizonObst;
 		agent->velocity_ = velocity;
 
-		agent->id_ = agents_.size();
-
-
 		agent->path_forward_ = Vector2(0.0f, 0.0f);
 		agent->left_lane_constrained_ = false;
 		agent->right_lane_constrained_ = false;
 
-		agents_.push_back(agent);
-
-		return agents_.size() - 1;
+		return insertAgent(agent);
 	}
 
 	size_t RVOSimulator::addAgent(const Vector2 &position, float neighborDist, size_t maxNeighbors, float timeHorizon, float timeHorizonObst, float radius, float maxSpeed, const Vector2 &velocity, std::string tag, float max_tracking_angle)
@@ -161,8 +232,6 @@ namespace RVO {
 		agent->timeHorizonObst_ = timeHorizonObst;
 		agent->velocity_ = velocity;
 
-		agent->id_ = agents_.size();
-
 		agent->tag_ = tag;
 		agent->max_tracking_angle_ = max_tracking_angle;
 
@@ -170,9 +239,7 @@ namespace RVO {
 		agent->left_lane_constrained_ = false;
 		agent->right_lane_constrained_ = false;
 
-		agents_.push_back(agent);
-
-		return agents_.size() - 1;
+		return insertAgent(agent);
 	}
 
 
@@ -189,8 +256,6 @@ namespace RVO {
 		agent->timeHorizonObst_ = timeHorizonObst;
 		agent->velocity_ = velocity;
 
-		agent->id_ = agents_.size();
-
 		agent->tag_ = tag;
 		agent->max_tracking_angle_ = max_tracking_angle;
 
@@ -200,9 +265,7 @@ namespace RVO {
 		agent->left_lane_constrained_ = false;
 		agent->right_lane_constrained_ = false;
 
-		agents_.push_back(agent);
-
-		return agents_.size() - 1;
+		return insertAgent(agent);
 	}
 
 
@@ -219,8 +282,6 @@ namespace RVO {
 		agent->timeHorizonObst_ = agt.timeHorizonObst;
 		agent->velocity_ = agt.velocity;
 
-		agent->id_ = agents_.size();
-
 		agent->tag_ = agt.tag;
 		agent->max_tracking_angle_ = agt.max_tracking_angle;
 
@@ -236,14 +297,12 @@ namespace RVO {
 		agent->left_lane_constrained_ = false;
 		agent->right_lane_constrained_ = false;
 
-		agents_.push_back(agent);
-
-		return agents_.size() - 1;
+		return insertAgent(agent);
 	}
 
 	void RVOSimulator::setAgent(int agentNo, const AgentParams agt)
 	{
-		Agent *agent = agents_[static_cast<size_t>(agentNo)];
+		Agent *agent = getAgent(static_cast<size_t>(agentNo));
 
 		agent->position_ = agt.position;
 		agent->maxNeighbors_ = static_cast<size_t> (agt.maxNeighbors);
@@ -275,50 +334,51 @@ namespace RVO {
 
 
 	void RVOSimulator::setAgentID(int agentNo, int tracking_id){
-		agents_[static_cast<size_t>(agentNo)]->tracking_id_ = tracking_id;
+		getAgent(static_cast<size_t>(agentNo))->tracking_id_ = tracking_id;
 	}
 
 	int RVOSimulator::getAgentID(int agentNo){
-		return agents_[static_cast<size_t>(agentNo)]->tracking_id_;
+		return getAgent(static_cast<size_t>(agentNo))->tracking_id_;
 	}
 
 	std::string RVOSimulator::getAgentTag(int agentNo){
-		return agents_[static_cast<size_t>(agentNo)]->tag_;
+		return getAgent(static_cast<size_t>(agentNo))->tag_;
 	}
 
 	Vector2 RVOSimulator::getAgentHeading(int agentNo)
 	{
-		return agents_[static_cast<size_t>(agentNo)]->heading_;
+		return getAgent(static_cast<size_t>(agentNo))->heading_;
 	}
 	void RVOSimulator::setAgentBoundingBoxCorners(int agentNo, std::vector<Vector2> corners)
 	{
-		agents_[static_cast<size_t>(agentNo)]->bounding_corners_ = corners;
+		getAgent(static_cast<size_t>(agentNo))->bounding_hull_ = Minkowski::Hull(corners);
+		getAgent(static_cast<size_t>(agentNo))->bounding_corners_ = std::move(corners);
 	}
 
 	void RVOSimulator::setAgentHeading(int agentNo, Vector2 heading){
-		agents_[static_cast<size_t>(agentNo)]->heading_ = heading;
+		getAgent(static_cast<size_t>(agentNo))->heading_ = heading;
 	}
 
 	void RVOSimulator::setAgentMaxTrackingAngle(int agentNo, float max_tracking_angle){
-		agents_[static_cast<size_t>(agentNo)]->max_tracking_angle_ = max_tracking_angle;
+		getAgent(static_cast<size_t>(agentNo))->max_tracking_angle_ = max_tracking_angle;
 	}
 
 	void RVOSimulator::setAgentVelocityConvex(int agentNo, std::vector<Vector2> velocity_convex){
-		agents_[static_cast<size_t>(agentNo)]->velocity_convex_ = velocity_convex;
+		getAgent(static_cast<size_t>(agentNo))->velocity_convex_ = velocity_convex;
 	}
 
 	void RVOSimulator::setAgentAttentionRadius(int agentNo, float r_front, float r_rear){
-		agents_[static_cast<size_t>(agentNo)]->r_front_ = r_front;
-		agents_[static_cast<size_t>(agentNo)]->r_rear_ = r_rear;
+		getAgent(static_cast<size_t>(agentNo))->r_front_ = r_front;
+		getAgent(static_cast<size_t>(agentNo))->r_rear_ = r_rear;
 	}
 
 	void RVOSimulator::setAgentResDecRate(int agentNo, float res_dec_rate){
-		agents_[static_cast<size_t>(agentNo)]->res_dec_rate_ = res_dec_rate;
+		getAgent(static_cast<size_t>(agentNo))->res_dec_rate_ = res_dec_rate;
 	}
 
 	void RVOSimulator::setAgentBehaviorType(int agentNo, AgentBehaviorType agent_behavior_type){
-		agents_[static_cast<size_t>(agentNo)]->agent_behavior_type_ = agent_behavior_type;
-		agents_[static_cast<size_t>(agentNo)]->updateBehaviorParams();
+		getAgent(static_cast<size_t>(agentNo))->agent_behavior_type_ = agent_behavior_type;
+		getAgent(static_cast<size_t>(agentNo))->updateBehaviorParams();
 
 	}
 
@@ -365,22 +425,70 @@ namespace RVO {
 	{
 		kdTree_->buildAgentTree();
 
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-		for (int i = 0; i < static_cast<int>(agents_.size()); ++i) {
-			agents_[static_cast<size_t>(i)]->computeNeighbors();
-			agents_[static_cast<size_t>(i)]->computeNewVelocity();
+		// New velocities go to newVelocity_ and are only applied once every
+		// agent has computed its own, so no agent sees a partially updated step.
+		forEachAgent([](Agent *agent) {
+			agent->computeNeighbors();
+			agent->computeNewVelocity();
+		});
+
+		forEachAgent([](Agent *agent) {
+			agent->update();
+		});
+
+		globalTime_ += timeStep_;
+	}
+
+	void RVOSimulator::forEachAgent(void (*task)(Agent *))
+	{
+		if (threadPool_ == NULL || agents_.size() <= AGENT_CHUNK_SIZE) {
+			for (size_t i = 0; i < agents_.size(); ++i) {
+				if (agents_[i] != NULL) {
+					task(agents_[i]);
+				}
+			}
+			return;
 		}
 
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-		for (int i = 0; i < static_cast<int>(agents_.size()); ++i) {
-			agents_[static_cast<size_t>(i)]->update();
+		std::vector<std::future<void>> futures;
+		futures.reserve((agents_.size() + AGENT_CHUNK_SIZE - 1) / AGENT_CHUNK_SIZE);
+
+		for (size_t begin = 0; begin < agents_.size(); begin += AGENT_CHUNK_SIZE) {
+			const size_t end = std::min(begin + static_cast<size_t>(AGENT_CHUNK_SIZE), agents_.size());
+			futures.push_back(threadPool_->Post([this, task, begin, end]() {
+				for (size_t i = begin; i < end; ++i) {
+					if (agents_[i] != NULL) {
+						task(agents_[i]);
+					}
+				}
+			}));
 		}
 
-		globalTime_ += timeStep_;
+		for (size_t i = 0; i < futures.size(); ++i) {
+			futures[i].get();
+		}
+	}
+
+	void RVOSimulator::setNumWorkers(size_t numWorkers)
+	{
+		numWorkers = std::max(static_cast<size_t>(1), numWorkers);
+		if (numWorkers == numWorkers_) {
+			return;
+		}
+
+		delete threadPool_;
+		threadPool_ = NULL;
+		numWorkers_ = numWorkers;
+
+		if (numWorkers_ > 1) {
+			threadPool_ = new carla::ThreadPool();
+			threadPool_->AsyncRun(numWorkers_);
+		}
+	}
+
+	size_t RVOSimulator::getNumWorkers() const
+	{
+		return numWorkers_;
 	}
 
 	// return next position and heading for tracking pref_vel by applying bicycle model for dt time
@@ -471,77 +579,77 @@ namespace RVO {
 
 	size_t RVOSimulator::getAgentAgentNeighbor(size_t agentNo, size_t neighborNo) const
 	{
-		return agents_[agentNo]->agentNeighbors_[neighborNo].second->id_;
+		return getAgent(agentNo)->agentNeighbors_.at(neighborNo).second->id_;
 	}
 
 	size_t RVOSimulator::getAgentMaxNeighbors(size_t agentNo) const
 	{
-		return agents_[agentNo]->maxNeighbors_;
+		return getAgent(agentNo)->maxNeighbors_;
 	}
 
 	float RVOSimulator::getAgentMaxSpeed(size_t agentNo) const
 	{
-		return agents_[agentNo]->maxSpeed_;
+		return getAgent(agentNo)->maxSpeed_;
 	}
 
 	float RVOSimulator::getAgentNeighborDist(size_t agentNo) const
 	{
-		return agents_[agentNo]->neighborDist_;
+		return getAgent(agentNo)->neighborDist_;
 	}
 
 	size_t RVOSimulator::getAgentNumAgentNeighbors(size_t agentNo) const
 	{
-		return agents_[agentNo]->agentNeighbors_.size();
+		return getAgent(agentNo)->agentNeighbors_.size();
 	}
 
 	size_t RVOSimulator::getAgentNumObstacleNeighbors(size_t agentNo) const
 	{
-		return agents_[agentNo]->obstacleNeighbors_.size();
+		return getAgent(agentNo)->obstacleNeighbors_.size();
 	}
 
 	size_t RVOSimulator::getAgentNumORCALines(size_t agentNo) const
 	{
-		return agents_[agentNo]->orcaLines_.size();
+		return getAgent(agentNo)->orcaLines_.size();
 	}
 
 	size_t RVOSimulator::getAgentObstacleNeighbor(size_t agentNo, size_t neighborNo) const
 	{
-		return agents_[agentNo]->obstacleNeighbors_[neighborNo].second->id_;
+		return getAgent(agentNo)->obstacleNeighbors_.at(neighborNo).second->id_;
 	}
 
 	const Line &RVOSimulator::getAgentORCALine(size_t agentNo, size_t lineNo) const
 	{
-		return agents_[agentNo]->orcaLines_[lineNo];
+		return getAgent(agentNo)->orcaLines_.at(lineNo);
 	}
 
 	const Vector2 &RVOSimulator::getAgentPosition(size_t agentNo) const
 	{
-		return agents_[agentNo]->position_;
+		return getAgent(agentNo)->position_;
 	}
 
 	const Vector2 &RVOSimulator::getAgentPrefVelocity(size_t agentNo) const
 	{
-		return agents_[agentNo]->prefVelocity_;
+		return getAgent(agentNo)->prefVelocity_;
 	}
 
 	float RVOSimulator::getAgentRadius(size_t agentNo) const
 	{
-		return agents_[agentNo]->radius_;
+		return getAgent(agentNo)->radius_;
 	}
 
 	float RVOSimulator::getAgentTimeHorizon(size_t agentNo) const
 	{
-		return agents_[agentNo]->timeHorizon_;
+		return getAgent(agentNo)->timeHorizon_;
 	}
 
 	float RVOSimulator::getAgentTimeHorizonObst(size_t agentNo) const
 	{
-		return agents_[agentNo]->timeHorizonObst_;
+		return getAgent(agentNo)->timeHorizonObst_;
 	}
 
 	const Vector2 &RVOSimulator::getAgentVelocity(size_t agentNo) const
 	{
-		return agents_[agentNo]->velocity_;
+		return getAgent(agentNo)->velocity_;
 	}
 
 	float RVOSimulator::getGlobalTime() const
@@ -554,6 +662,11 @@ namespace RVO {
 		return agents_.size();
 	}
 
+	size_t RVOSimulator::getNumLiveAgents() const
+	{
+		return numAgents_;
+	}
+
 	size_t RVOSimulator::getNumObstacleVertices() const
 	{
 		return obstacles_.size();
@@ -606,57 +719,57 @@ namespace RVO {
 
 	void RVOSimulator::setAgentMaxNeighbors(size_t agentNo, size_t maxNeighbors)
 	{
-		agents_[agentNo]->maxNeighbors_ = maxNeighbors;
+		getAgent(agentNo)->maxNeighbors_ = maxNeighbors;
 	}
 
 	void RVOSimulator::setAgentMaxSpeed(size_t agentNo, float maxSpeed)
 	{
-		agents_[agentNo]->maxSpeed_ = maxSpeed;
+		getAgent(agentNo)->maxSpeed_ = maxSpeed;
 	}
 
 	void RVOSimulator::setAgentNeighborDist(size_t agentNo, float neighborDist)
 	{
-		agents_[agentNo]->neighborDist_ = neighborDist;
+		getAgent(agentNo)->neighborDist_ = neighborDist;
 	}
 
 	void RVOSimulator::setAgentPosition(size_t agentNo, const Vector2 &position)
 	{
-		agents_[agentNo]->position_ = position;
+		getAgent(agentNo)->position_ = position;
 	}
 
 	void RVOSimulator::setAgentPrefVelocity(size_t agentNo, const Vector2 &prefVelocity)
 	{
-		agents_[agentNo]->prefVelocity_ = prefVelocity;
+		getAgent(agentNo)->prefVelocity_ = prefVelocity;
 	}
 
 	void RVOSimulator::setAgentRadius(size_t agentNo, float radius)
 	{
-		agents_[agentNo]->radius_ = radius;
+		getAgent(agentNo)->radius_ = radius;
 	}
 
 	void RVOSimulator::setAgentTimeHorizon(size_t agentNo, float timeHorizon)
 	{
-		agents_[agentNo]->timeHorizon_ = timeHorizon;
+		getAgent(agentNo)->timeHorizon_ = timeHorizon;
 	}
 
 	void RVOSimulator::setAgentTimeHorizonObst(size_t agentNo, float timeHorizonObst)
 	{
-		agents_[agentNo]->timeHorizonObst_ = timeHorizonObst;
+		getAgent(agentNo)->timeHorizonObst_ = timeHorizonObst;
 	}
 
 	void RVOSimulator::setAgentVelocity(size_t agentNo, const Vector2 &velocity)
 	{
-		agents_[agentNo]->velocity_ = velocity;
+		getAgent(agentNo)->velocity_ = velocity;
 	}
 
 	void RVOSimulator::setAgentLaneConstraints(size_t agentNo, bool left_lane_constrained, bool right_lane_constrained)
 	{
-		agents_[agentNo]->left_lane_constrained_ = left_lane_constrained;
-		agents_[agentNo]->right_lane_constrained_ = right_lane_constrained;
+		getAgent(agentNo)->left_lane_constrained_ = left_lane_constrained;
+		getAgent(agentNo)->right_lane_constrained_ = right_lane_constrained;
 	}
 
 	void RVOSimulator::setAgentPathForward(size_t agentNo, Vector2 path_forward){
-		agents_[agentNo]->path_forward_ = path_forward;
+		getAgent(agentNo)->path_forward_ = path_forward;
 	}
 
 	void RVOSimulator::setTimeStep(float timeStep)
@@ -47,6 +47,10 @@
 #include "Vector2.h"
 #include "AgentParams.h"
 
+namespace carla {
+	class ThreadPool;
+}
+
 namespace RVO {
 
 	enum AgentBehaviorType
@@ -146,8 +150,10 @@ namespace RVO {
 		 */
 		~RVOSimulator();
 
-    // Guard against "definition of implicit copy constructor for 'RVOSimulator' is deprecated because it has a user-declared destructor [-Wdeprecated]"
-    RVOSimulator(const RVOSimulator&) = default;
+    // Agents, obstacles, the kd-tree and the thread pool are owned through raw
+    // pointers, so copies would free them twice.
+    RVOSimulator(const RVOSimulator&) = delete;
+    RVOSimulator &operator=(const RVOSimulator&) = delete;
 
 		/**
 		 * \brief      Adds a new agent with default properties to the
@@ -432,11 +438,21 @@ namespace RVO {
 		float getGlobalTime() const;
 
 		/**
-		 * \brief      Returns the count of agents in the simulation.
-		 * \return     The count of agents in the simulation.
+		 * \brief      Returns the count of agent slots, i.e. one past the
+		 *             largest agent number handed out. Slots of removed agents
+		 *             are empty until reused, so loops over agent numbers
+		 *             should skip those for which hasAgent is false.
+		 * \return     The count of agent slots in the simulation.
 		 */
 		size_t getNumAgents() const;
 
+		/**
+		 * \brief      Returns the count of agents in the simulation, not
+		 *             counting the empty slots of removed agents.
+		 * \return     The count of agents in the simulation.
+		 */
+		size_t getNumLiveAgents() const;
+
 		/**
 		 * \brief      Returns the count of obstacle vertices in the simulation.
 		 * \return     The count of obstacle vertices in the simulation.
@@ -640,15 +656,86 @@ namespace RVO {
 		 */
 		void setTimeStep(float timeStep);
 
+		/**
+		 * \brief      Sets the number of worker threads used by doStep. Agents
+		 *             are processed in fixed chunks and only read the state of
+		 *             other agents from before the step, so results do not
+		 *             depend on the number of workers.
+		 * \param      numWorkers      The number of worker threads; 0 or 1
+		 *                             steps on the calling thread.
+		 */
+		void setNumWorkers(size_t numWorkers);
+
+		/**
+		 * \brief      Returns the number of worker threads used by doStep.
+		 */
+		size_t getNumWorkers() const;
+
 		void clearAllAgents();
 
+		/**
+		 * \brief      Removes a specified agent from the simulation. The agent
+		 *             numbers of other agents are unaffected; the removed
+		 *             number may be handed out again by a later addAgent.
+		 * \param      agentNo         The number of the agent to be removed.
+		 */
+		void removeAgent(size_t agentNo);
+
+		/**
+		 * \brief      Returns whether a specified agent number refers to an
+		 *             agent in the simulation. Per-agent accessors and
+		 *             setters throw std::out_of_range for numbers for which
+		 *             this is false.
+		 * \param      agentNo         The agent number to be checked.
+		 */
+		bool hasAgent(size_t agentNo) const;
+
+		/**
+		 * \brief      Sets the state of several agents at once from
+		 *             contiguous arrays of interleaved (x, y) pairs.
+		 * \param      count           The number of agents to be updated.
+		 * \param      agentNos        The numbers of the agents to be updated.
+		 * \param      positions       2 * count position coordinates, or NULL.
+		 * \param      velocities      2 * count velocity coordinates, or NULL.
+		 * \param      prefVelocities  2 * count preferred velocity
+		 *                             coordinates, or NULL.
+		 * \param      headings        2 * count heading coordinates, or NULL.
+		 */
+		void setAgentStates(size_t count, const size_t *agentNos,
+							const float *positions, const float *velocities,
+							const float *prefVelocities,
+							const float *headings = NULL);
+
 	private:
+		size_t insertAgent(Agent *agent);
+
+		/**
+		 * \brief      Returns the specified agent, throwing
+		 *             std::out_of_range if there is none.
+		 */
+		Agent *getAgent(size_t agentNo) const;
+
+		/**
+		 * \brief      Runs a task on every agent, in parallel if workers are
+		 *             set, and returns when all are done.
+		 */
+		void forEachAgent(void (*task)(Agent *));
+
+		/**
+		 * \brief      Number of consecutive agent slots per parallel task.
+		 */
+		static const size_t AGENT_CHUNK_SIZE = 64;
+
 		std::vector<Agent *> agents_;
+		std::vector<size_t> freeAgentSlots_;
+		size_t numAgents_;
 		Agent *defaultAgent_;
 		float globalTime_;
 		KdTree *kdTree_;
 		std::vector<Obstacle *> obstacles_;
 		float timeStep_;
+		size_t numWorkers_;
+		carla::ThreadPool *threadPool_;
 
 		friend class Agent;
 		friend class KdTree;
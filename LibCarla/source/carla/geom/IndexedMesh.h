@@ -0,0 +1,25 @@
+#pragma once
+
+#include "carla/MsgPack.h"
+#include "carla/geom/Vector3D.h"
+#include <cstdint>
+#include <vector>
+
+namespace carla {
+namespace geom {
+
+// Triangle mesh with a shared vertex buffer. Each consecutive triple of
+// indices is a counterclockwise (front facing) triangle. Double sided meshes
+// get their back faces on the receiving end instead of in the buffers.
+struct IndexedMesh {
+  std::vector<Vector3D> vertices;
+  std::vector<uint32_t> indices;
+  bool double_sided = false;
+
+  size_t NumTriangles() const { return indices.size() / 3; }
+
+  MSGPACK_DEFINE_ARRAY(vertices, indices, double_sided);
+};
+
+}
+}
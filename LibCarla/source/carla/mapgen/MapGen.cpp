@@ -0,0 +1,91 @@
+#include "MapGen.h"
+
+#include "carla/ParallelFor.h"
+#include "carla/ThreadPool.h"
+#include "carla/osmlandmarks/OsmLandmarks.h"
+#include "carla/sidewalk/Sidewalk.h"
+#include "carla/sumonetwork/SumoNetwork.h"
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+
+namespace carla {
+namespace mapgen {
+
+void MapAssets::Save(const std::string& prefix) const {
+  auto save = [](const occupancy::OccupancyMap& occupancy_map, const std::string& path) {
+    occupancy_map.Save(path + ".wkt");
+    occupancy_map.SaveBinary(path + ".occ");
+  };
+
+  std::vector<std::function<void()>> tasks = {
+    [&]() { save(network_occupancy, prefix + ".network"); },
+    [&]() { save(roadmark_occupancy, prefix + ".roadmark"); },
+    [&]() { save(sidewalk_occupancy, prefix + ".sidewalk"); },
+    [&]() { occupancy::OccupancyMap::SaveBinaryPack(landmark_occupancies, prefix + ".landmarks.occp"); }
+  };
+  ParallelFor(tasks.size(), 1, [&tasks](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      tasks[i]();
+    }
+  });
+}
+
+MapAssets MapGen::Extract(
+    const std::string& sumo_network_file,
+    const std::string& osm_file,
+    const MapGenSettings& settings) {
+
+  ThreadPool thread_pool;
+  thread_pool.AsyncRun(settings.num_workers > 0 ?
+      settings.num_workers : std::max(1u, std::thread::hardware_concurrency()));
+
+  // Stages are posted from this thread once their inputs are ready, so none
+  // of them blocks a worker waiting on another. Inputs are shared, so that
+  // stages still running when another one throws keep them alive.
+  std::shared_ptr<const sumonetwork::SumoNetwork> sumo_network = std::make_shared<const sumonetwork::SumoNetwork>(
+      thread_pool.Post([&sumo_network_file]() {
+        return sumonetwork::SumoNetwork::Load(sumo_network_file);
+      }).get());
+
+  std::future<occupancy::OccupancyMap> network_occupancy_future = thread_pool.Post([sumo_network]() {
+    return sumo_network->CreateOccupancyMap();
+  });
+  std::future<occupancy::OccupancyMap> roadmark_occupancy_future = thread_pool.Post([sumo_network]() {
+    return sumo_network->CreateRoadmarkOccupancyMap();
+  });
+  std::future<std::vector<occupancy::OccupancyMap>> landmark_occupancies_future = thread_pool.Post([sumo_network, osm_file]() {
+    return osmlandmarks::OsmLandmarks::Load(osm_file, sumo_network->Offset());
+  });
+
+  MapAssets assets;
+  assets.network_occupancy = network_occupancy_future.get();
+
+  std::shared_ptr<const occupancy::OccupancyMap> network_occupancy =
+      std::make_shared<const occupancy::OccupancyMap>(assets.network_occupancy);
+  std::future<occupancy::OccupancyMap> sidewalk_occupancy_future = thread_pool.Post([network_occupancy, settings]() {
+    return network_occupancy->CreateSidewalk(settings.sidewalk_distance).CreateOccupancyMap(settings.sidewalk_width);
+  });
+  assets.sidewalk_occupancy = sidewalk_occupancy_future.get();
+
+  // Each building is only clipped against the road and sidewalk polygons
+  // around it.
+  std::vector<occupancy::OccupancyMap> landmark_occupancies = occupancy::OccupancyMap::DifferenceAll(
+      landmark_occupancies_future.get(), assets.network_occupancy);
+  landmark_occupancies = occupancy::OccupancyMap::DifferenceAll(
+      std::move(landmark_occupancies), assets.sidewalk_occupancy);
+  for (occupancy::OccupancyMap& landmark_occupancy : landmark_occupancies) {
+    if (!landmark_occupancy.IsEmpty()) {
+      assets.landmark_occupancies.emplace_back(std::move(landmark_occupancy));
+    }
+  }
+
+  assets.roadmark_occupancy = roadmark_occupancy_future.get();
+
+  return assets;
+}
+
+}
+}
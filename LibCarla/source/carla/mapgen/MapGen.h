@@ -0,0 +1,53 @@
+#pragma once
+
+#include "carla/occupancy/OccupancyMap.h"
+#include <string>
+#include <vector>
+
+namespace carla {
+namespace mapgen {
+
+struct MapGenSettings {
+  // Sidewalks run at sidewalk_distance from the road network.
+  float sidewalk_distance = 1.5f;
+  float sidewalk_width = 3.0f;
+  // Worker threads; 0 uses one per hardware thread.
+  size_t num_workers = 0;
+};
+
+struct MapAssets {
+  occupancy::OccupancyMap network_occupancy;
+  occupancy::OccupancyMap roadmark_occupancy;
+  occupancy::OccupancyMap sidewalk_occupancy;
+  // Buildings, without the parts on roads and sidewalks. Empty ones are
+  // dropped.
+  std::vector<occupancy::OccupancyMap> landmark_occupancies;
+
+  // Writes <prefix>.network.wkt, <prefix>.roadmark.wkt, <prefix>.sidewalk.wkt,
+  // each with its binary .occ, and all landmarks packed in
+  // <prefix>.landmarks.occp.
+  void Save(const std::string& prefix) const;
+};
+
+// Builds the assets of a map from its SUMO network and OSM file. The stages
+// run on a thread pool as soon as the stages they depend on are done:
+//
+//   SUMO network -> network occupancy -> sidewalk occupancy -> landmarks
+//                -> roadmark occupancy                        ^
+//                -> OSM landmarks ----------------------------'
+class MapGen {
+public:
+
+  static MapAssets Extract(
+      const std::string& sumo_network_file,
+      const std::string& osm_file,
+      const MapGenSettings& settings = MapGenSettings());
+
+private:
+
+  MapGen() { }
+
+};
+
+}
+}
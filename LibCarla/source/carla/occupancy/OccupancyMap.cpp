@@ -3,14 +3,57 @@
 #include <boost/geometry.hpp>
 #include <boost/geometry/geometries/point_xy.hpp>
 #include <boost/geometry/geometries/geometries.hpp>
+#include <boost/geometry/index/rtree.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "carla/Exception.h"
 #include "carla/geom/Triangulation.h"
+#include "carla/ParallelFor.h"
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <stdexcept>
 #include <sstream>
 #include <fstream>
+#include <functional>
+#include <memory>
 
 namespace carla {
 namespace occupancy {
 
+// Binary layout (native endianness):
+//   BinaryHeader
+//   uint32_t polygon_offsets[num_polygons + 1]  Index of first ring of each polygon (outer first).
+//   uint32_t ring_offsets[num_rings + 1]        Index of first vertex of each ring.
+//   float vertices[num_vertices][2]
+static constexpr char BINARY_MAGIC[4] = {'O', 'C', 'C', 'M'};
+static constexpr uint32_t BINARY_VERSION = 1;
+
+struct BinaryHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t num_polygons;
+  uint32_t num_rings;
+  uint32_t num_vertices;
+};
+
+// Binary pack layout (native endianness):
+//   PackHeader
+//   uint64_t offsets[num_maps + 1]  Byte offset of each map from the start of the file.
+//   Maps in the binary layout above.
+static constexpr char PACK_MAGIC[4] = {'O', 'C', 'C', 'P'};
+
+struct PackHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t num_maps;
+  uint32_t reserved;
+};
+
 OccupancyMap::OccupancyMap() {
 
 }
@@ -90,75 +133,89 @@ OccupancyMap::OccupancyMap(const geom::Vector2D& bounds_min, const geom::Vector2
       bounds_max, geom::Vector2D(bounds_max.x, bounds_min.y)}) {
 
 }
+
+OccupancyMap::OccupancyMap(const OccupancyMap& occupancy_map)
+  : _multi_polygon(occupancy_map._multi_polygon),
+    _spatial_index(std::atomic_load(&occupancy_map._spatial_index)) {
+
+}
+
+OccupancyMap& OccupancyMap::operator=(const OccupancyMap& occupancy_map) {
+  if (this != &occupancy_map) {
+    _multi_polygon = occupancy_map._multi_polygon;
+    _spatial_index = std::atomic_load(&occupancy_map._spatial_index);
+  }
+  return *this;
+}
   
 OccupancyMap OccupancyMap::Load(const std::string& file) {
   std::ifstream ifs;
-  ifs.open(file, std::ios::in);
-  std::ostringstream ss_data;
-  ss_data << ifs.rdbuf();
+  ifs.open(file, std::ios::in | std::ios::binary);
+  char magic[sizeof(BINARY_MAGIC)] = {};
+  ifs.read(magic, sizeof(magic));
+  if (ifs.gcount() == sizeof(magic) && std::memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0) {
+    ifs.close();
+    return LoadBinary(file);
+  }
+  ifs.clear();
+  ifs.seekg(0);
+  std::string data{std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
   ifs.close();
-  std::stringstream ss(ss_data.str());
 
-  auto read_point = [&ss] (b_point_t& point) {
-    std::string text;
-    while (true) {
-      char c; ss.get(c);
-      if (c == ')') {
-        break;
-      } else {
-        text += c;
-      }
-    }
+  const char* it = data.c_str();
+  const char* const data_end = it + data.size();
 
-    std::vector<std::string> text_split;
-    boost::split(text_split, text, boost::is_any_of(" "));
-    point.x(std::stof(text_split[0]));
-    point.y(std::stof(text_split[1]));
+  // Advances to the next structural character, returning '\0' at the end.
+  auto next_token = [&it, data_end]() {
+    while (it < data_end && *it != '(' && *it != ')') it++;
+    return it < data_end ? *(it++) : '\0';
   };
 
-  auto read_ring = [&ss, &read_point] (b_ring_t& ring) {
+  auto read_point = [&it] (b_point_t& point) {
+    char* end;
+    point.x(std::strtof(it, &end));
+    point.y(std::strtof(end, &end));
+    it = end;
+  };
+
+  auto read_ring = [&next_token, &read_point] (b_ring_t& ring) {
     while (true) {
-      char c; ss.get(c);
+      char c = next_token();
       if (c == '(') {
         b_point_t point; read_point(point);
         boost::geometry::append(ring, point);
-      } else if (c == ')') {
-        break;
+        next_token(); // ) of point.
       } else {
-        // Error
+        break;
       }
     }
   };
 
-  auto read_polygon = [&ss, &read_ring] (b_polygon_t& polygon) {
-    char c; ss.get(c);
+  auto read_polygon = [&next_token, &read_ring] (b_polygon_t& polygon) {
+    next_token(); // ( of outer ring.
     read_ring(polygon.outer());
 
     while (true) {
-      ss.get(c);
+      char c = next_token();
       if (c == '(') {
         polygon.inners().resize(polygon.inners().size() + 1);
         read_ring(polygon.inners()[polygon.inners().size() - 1]);
-      } else if (c == ')') {
-        break;
       } else {
-        // Error
+        break;
       }
     }
   };
 
-  auto read_multi_polygon = [&ss, &read_polygon] (b_multi_polygon_t& multi_polygon) {
-    char c; ss.get(c); // ( of multi_polygon.
+  auto read_multi_polygon = [&next_token, &read_polygon] (b_multi_polygon_t& multi_polygon) {
+    next_token(); // ( of multi_polygon.
 
     while (true) {
-      ss.get(c); // ( of polygon, or ).
+      char c = next_token(); // ( of polygon, or ).
       if (c == '(') {
         multi_polygon.resize(multi_polygon.size() + 1);
         read_polygon(multi_polygon[multi_polygon.size() - 1]);
-      } else if (c == ')') {
-        break;
       } else {
-        // Error
+        break;
       }
     }
   };
@@ -170,6 +227,77 @@ OccupancyMap OccupancyMap::Load(const std::string& file) {
   return occupancy_map;
 }
 
+OccupancyMap OccupancyMap::LoadBinary(const std::string& file) {
+  boost::interprocess::file_mapping mapping(file.c_str(), boost::interprocess::read_only);
+  boost::interprocess::mapped_region region(mapping, boost::interprocess::read_only);
+  return FromBinary(static_cast<const char*>(region.get_address()), region.get_size());
+}
+
+OccupancyMap OccupancyMap::FromBinary(const char* data, size_t size) {
+  BinaryHeader header{};
+  if (size < sizeof(header)) {
+    throw_exception(std::runtime_error("OccupancyMap: binary data is truncated"));
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) {
+    throw_exception(std::runtime_error("OccupancyMap: binary data has an invalid header"));
+  }
+  if (header.version != BINARY_VERSION) {
+    throw_exception(std::runtime_error("OccupancyMap: unsupported binary version " + std::to_string(header.version)));
+  }
+
+  const size_t polygon_offsets_size = (static_cast<size_t>(header.num_polygons) + 1) * sizeof(uint32_t);
+  const size_t ring_offsets_size = (static_cast<size_t>(header.num_rings) + 1) * sizeof(uint32_t);
+  const size_t vertices_size = static_cast<size_t>(header.num_vertices) * 2 * sizeof(float);
+  if (size < sizeof(header) + polygon_offsets_size + ring_offsets_size + vertices_size) {
+    throw_exception(std::runtime_error("OccupancyMap: binary data is truncated"));
+  }
+
+  const char* polygon_offsets = data + sizeof(header);
+  const char* ring_offsets = polygon_offsets + polygon_offsets_size;
+  const char* vertices = ring_offsets + ring_offsets_size;
+
+  auto read_uint32 = [](const char* base, size_t i) {
+    uint32_t value;
+    std::memcpy(&value, base + i * sizeof(uint32_t), sizeof(uint32_t));
+    return value;
+  };
+
+  auto read_ring = [&](b_ring_t& ring, size_t ring_index) {
+    uint32_t vertex_begin = read_uint32(ring_offsets, ring_index);
+    uint32_t vertex_end = read_uint32(ring_offsets, ring_index + 1);
+    if (vertex_begin > vertex_end || vertex_end > header.num_vertices) {
+      throw_exception(std::runtime_error("OccupancyMap: binary data has an invalid ring offset"));
+    }
+    ring.resize(vertex_end - vertex_begin);
+    for (uint32_t i = vertex_begin; i < vertex_end; i++) {
+      float xy[2];
+      std::memcpy(xy, vertices + i * sizeof(xy), sizeof(xy));
+      ring[i - vertex_begin] = b_point_t(xy[0], xy[1]);
+    }
+  };
+
+  OccupancyMap occupancy_map;
+  occupancy_map._multi_polygon.resize(header.num_polygons);
+  for (uint32_t i = 0; i < header.num_polygons; i++) {
+    uint32_t ring_begin = read_uint32(polygon_offsets, i);
+    uint32_t ring_end = read_uint32(polygon_offsets, i + 1);
+    if (ring_begin >= ring_end || ring_end > header.num_rings) {
+      throw_exception(std::runtime_error("OccupancyMap: binary data has an invalid polygon offset"));
+    }
+
+    b_polygon_t& polygon = occupancy_map._multi_polygon[i];
+    read_ring(polygon.outer(), ring_begin);
+    polygon.inners().resize(ring_end - ring_begin - 1);
+    for (uint32_t j = ring_begin + 1; j < ring_end; j++) {
+      read_ring(polygon.inners()[j - ring_begin - 1], j);
+    }
+  }
+
+  // Geometry was corrected before being saved, so no need to correct again.
+  return occupancy_map;
+}
+
 void OccupancyMap::Save(const std::string& file) const {
   std::ofstream ofs;
   ofs.open(file, std::ios::out | std::ios::trunc);
@@ -203,6 +331,116 @@ void OccupancyMap::Save(const std::string& file) const {
   ofs.close();
 }
 
+std::vector<char> OccupancyMap::ToBinary() const {
+  BinaryHeader header{};
+  std::memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  header.version = BINARY_VERSION;
+  header.num_polygons = static_cast<uint32_t>(_multi_polygon.size());
+
+  std::vector<uint32_t> polygon_offsets{0};
+  std::vector<uint32_t> ring_offsets{0};
+  std::vector<float> vertices;
+
+  auto write_ring = [&](const b_ring_t& ring) {
+    for (const b_point_t& point : ring) {
+      vertices.emplace_back(point.x());
+      vertices.emplace_back(point.y());
+    }
+    ring_offsets.emplace_back(static_cast<uint32_t>(vertices.size() / 2));
+  };
+
+  for (const b_polygon_t& polygon : _multi_polygon) {
+    write_ring(polygon.outer());
+    for (const b_ring_t& inner : polygon.inners()) {
+      write_ring(inner);
+    }
+    polygon_offsets.emplace_back(static_cast<uint32_t>(ring_offsets.size() - 1));
+  }
+  header.num_rings = static_cast<uint32_t>(ring_offsets.size() - 1);
+  header.num_vertices = static_cast<uint32_t>(vertices.size() / 2);
+
+  std::vector<char> data;
+  auto write = [&data](const void* values, size_t size) {
+    const char* bytes = static_cast<const char*>(values);
+    data.insert(data.end(), bytes, bytes + size);
+  };
+  data.reserve(sizeof(header)
+      + (polygon_offsets.size() + ring_offsets.size()) * sizeof(uint32_t)
+      + vertices.size() * sizeof(float));
+  write(&header, sizeof(header));
+  write(polygon_offsets.data(), polygon_offsets.size() * sizeof(uint32_t));
+  write(ring_offsets.data(), ring_offsets.size() * sizeof(uint32_t));
+  write(vertices.data(), vertices.size() * sizeof(float));
+  return data;
+}
+
+void OccupancyMap::SaveBinary(const std::string& file) const {
+  std::vector<char> data = ToBinary();
+  std::ofstream ofs;
+  ofs.open(file, std::ios::out | std::ios::binary | std::ios::trunc);
+  ofs.write(data.data(), static_cast<std::streamsize>(data.size()));
+  ofs.close();
+}
+
+std::vector<OccupancyMap> OccupancyMap::LoadBinaryPack(const std::string& file) {
+  boost::interprocess::file_mapping mapping(file.c_str(), boost::interprocess::read_only);
+  boost::interprocess::mapped_region region(mapping, boost::interprocess::read_only);
+  const char* data = static_cast<const char*>(region.get_address());
+  const size_t size = region.get_size();
+
+  PackHeader header{};
+  if (size < sizeof(header)) {
+    throw_exception(std::runtime_error("OccupancyMap: binary pack is truncated"));
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0) {
+    throw_exception(std::runtime_error("OccupancyMap: binary pack has an invalid header"));
+  }
+  if (header.version != BINARY_VERSION) {
+    throw_exception(std::runtime_error("OccupancyMap: unsupported binary version " + std::to_string(header.version)));
+  }
+  const size_t offsets_size = (static_cast<size_t>(header.num_maps) + 1) * sizeof(uint64_t);
+  if (size < sizeof(header) + offsets_size) {
+    throw_exception(std::runtime_error("OccupancyMap: binary pack is truncated"));
+  }
+
+  std::vector<uint64_t> offsets(header.num_maps + 1);
+  std::memcpy(offsets.data(), data + sizeof(header), offsets_size);
+  std::vector<OccupancyMap> occupancy_maps;
+  occupancy_maps.reserve(header.num_maps);
+  for (uint32_t i = 0; i < header.num_maps; i++) {
+    if (offsets[i] > offsets[i + 1] || offsets[i + 1] > size) {
+      throw_exception(std::runtime_error("OccupancyMap: binary pack has an invalid offset"));
+    }
+    occupancy_maps.emplace_back(FromBinary(data + offsets[i], static_cast<size_t>(offsets[i + 1] - offsets[i])));
+  }
+  return occupancy_maps;
+}
+
+void OccupancyMap::SaveBinaryPack(const std::vector<OccupancyMap>& occupancy_maps, const std::string& file) {
+  PackHeader header{};
+  std::memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+  header.version = BINARY_VERSION;
+  header.num_maps = static_cast<uint32_t>(occupancy_maps.size());
+
+  std::vector<std::vector<char>> blobs;
+  blobs.reserve(occupancy_maps.size());
+  std::vector<uint64_t> offsets{sizeof(header) + (occupancy_maps.size() + 1) * sizeof(uint64_t)};
+  for (const OccupancyMap& occupancy_map : occupancy_maps) {
+    blobs.emplace_back(occupancy_map.ToBinary());
+    offsets.emplace_back(offsets.back() + blobs.back().size());
+  }
+
+  std::ofstream ofs;
+  ofs.open(file, std::ios::out | std::ios::binary | std::ios::trunc);
+  ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  ofs.write(reinterpret_cast<const char*>(offsets.data()), static_cast<std::streamsize>(offsets.size() * sizeof(uint64_t)));
+  for (const std::vector<char>& blob : blobs) {
+    ofs.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+  }
+  ofs.close();
+}
+
 bool OccupancyMap::IsEmpty() const {
   return boost::geometry::is_empty(_multi_polygon);
 }
@@ -221,12 +459,99 @@ OccupancyMap OccupancyMap::Union(const OccupancyMap& occupancy_map) const {
   return result;
 }
 
+OccupancyMap OccupancyMap::UnionAll(std::vector<OccupancyMap> occupancy_maps) {
+  typedef boost::geometry::model::box<b_point_t> b_box_t;
+  typedef std::pair<b_box_t, size_t> rt_value_t;
+
+  std::vector<rt_value_t> envelopes;
+  envelopes.reserve(occupancy_maps.size());
+  for (size_t i = 0; i < occupancy_maps.size(); i++) {
+    if (occupancy_maps[i].IsEmpty()) continue;
+    envelopes.emplace_back(
+        boost::geometry::return_envelope<b_box_t>(occupancy_maps[i]._multi_polygon), i);
+  }
+
+  // Bulk loading packs nearby envelopes into the same leaves, so walking the
+  // tree in node order yields the pieces bucketed by locality. Neighbouring
+  // pieces in the cascade below then mostly overlap and partial unions stay
+  // compact, instead of every step re-unioning the whole accumulated map.
+  boost::geometry::index::rtree<rt_value_t, boost::geometry::index::rstar<16>> envelopes_index(envelopes);
+  std::vector<OccupancyMap> pieces;
+  pieces.reserve(envelopes.size());
+  for (auto it = envelopes_index.begin(); it != envelopes_index.end(); ++it) {
+    pieces.emplace_back(std::move(occupancy_maps[it->second]));
+  }
+  occupancy_maps.clear();
+
+  if (pieces.empty()) return OccupancyMap();
+
+  // Pairs are fixed by position, so the result does not depend on scheduling.
+  while (pieces.size() > 1) {
+    std::vector<OccupancyMap> next_pieces((pieces.size() + 1) / 2);
+    ParallelFor(pieces.size() / 2, 1, [&pieces, &next_pieces](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        next_pieces[i] = pieces[2 * i].Union(pieces[2 * i + 1]);
+      }
+    });
+    if (pieces.size() % 2 == 1) {
+      next_pieces.back() = std::move(pieces.back());
+    }
+    pieces = std::move(next_pieces);
+  }
+
+  return std::move(pieces[0]);
+}
+
 OccupancyMap OccupancyMap::Difference(const OccupancyMap& occupancy_map) const {
   OccupancyMap result;
   boost::geometry::difference(_multi_polygon, occupancy_map._multi_polygon, result._multi_polygon);
   return result;
 }
 
+std::vector<OccupancyMap> OccupancyMap::DifferenceAll(
+    std::vector<OccupancyMap> occupancy_maps, const OccupancyMap& occupancy_map) {
+  typedef boost::geometry::model::box<b_point_t> b_box_t;
+  typedef std::pair<b_box_t, size_t> rt_value_t;
+
+  std::vector<rt_value_t> envelopes;
+  envelopes.reserve(occupancy_map._multi_polygon.size());
+  for (size_t i = 0; i < occupancy_map._multi_polygon.size(); i++) {
+    envelopes.emplace_back(
+        boost::geometry::return_envelope<b_box_t>(occupancy_map._multi_polygon[i]), i);
+  }
+  boost::geometry::index::rtree<rt_value_t, boost::geometry::index::rstar<16>> envelopes_index(envelopes);
+
+  auto difference = [&](OccupancyMap& target) {
+    if (target.IsEmpty()) return;
+    std::vector<rt_value_t> candidates;
+    envelopes_index.query(
+        boost::geometry::index::intersects(boost::geometry::return_envelope<b_box_t>(target._multi_polygon)),
+        std::back_inserter(candidates));
+    if (candidates.empty()) return;
+
+    // Polygons of a valid map are disjoint, so any subset is a valid map.
+    b_multi_polygon_t nearby;
+    nearby.reserve(candidates.size());
+    for (const rt_value_t& candidate : candidates) {
+      nearby.emplace_back(occupancy_map._multi_polygon[candidate.second]);
+    }
+    b_multi_polygon_t result;
+    boost::geometry::difference(target._multi_polygon, nearby, result);
+    target._multi_polygon = std::move(result);
+    target._spatial_index.reset();
+  };
+
+  // Small chunks, since maps can vary a lot in size.
+  constexpr size_t CHUNK_SIZE = 16;
+  ParallelFor(occupancy_maps.size(), CHUNK_SIZE, [&occupancy_maps, &difference](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      difference(occupancy_maps[i]);
+    }
+  });
+
+  return occupancy_maps;
+}
+
 OccupancyMap OccupancyMap::Intersection(const OccupancyMap& occupancy_map) const {
   OccupancyMap result;
   boost::geometry::intersection(_multi_polygon, occupancy_map._multi_polygon, result._multi_polygon);
@@ -247,12 +572,339 @@ OccupancyMap OccupancyMap::Buffer(float width) const {
   return result;
 }
   
+// Uniform grid over the map. Each cell lists the edges overlapping it, and
+// whether each grid corner is inside the map is precomputed, so a point is
+// classified by casting a ray to a corner of its cell and counting crossings
+// with that cell's edges only.
+struct OccupancyMap::SpatialIndex {
+  typedef boost::geometry::model::box<b_point_t> b_box_t;
+  typedef std::pair<b_box_t, size_t> rt_value_t;
+
+  // Fewer edges than this are faster to test directly.
+  static constexpr size_t MIN_EDGES = 64;
+  static constexpr size_t MAX_CELLS = 1u << 22;
+
+  struct Edge {
+    double ax, ay, bx, by;
+  };
+
+  double origin_x;
+  double origin_y;
+  double cell_size;
+  int32_t num_columns;
+  int32_t num_rows;
+  b_box_t envelope;
+  std::vector<Edge> edges;
+  // Edges of cell (i, j) are cell_edges[cell_offsets[c]..cell_offsets[c + 1]),
+  // with c = j * num_columns + i.
+  std::vector<uint32_t> cell_offsets;
+  std::vector<uint32_t> cell_edges;
+  // Corner (i, j) is corner_inside[j * (num_columns + 1) + i].
+  std::vector<uint8_t> corner_inside;
+  boost::geometry::index::rtree<rt_value_t, boost::geometry::index::rstar<16>> polygon_envelopes;
+
+  // Build and queries must agree exactly on the grid lines.
+  double ColumnX(int32_t i) const { return origin_x + static_cast<double>(i) * cell_size; }
+  double RowY(int32_t j) const { return origin_y + static_cast<double>(j) * cell_size; }
+
+  static std::shared_ptr<const SpatialIndex> Build(const b_multi_polygon_t& multi_polygon);
+  bool Contains(double x, double y) const;
+};
+
+std::shared_ptr<const OccupancyMap::SpatialIndex> OccupancyMap::SpatialIndex::Build(
+    const b_multi_polygon_t& multi_polygon) {
+  auto index = std::make_shared<SpatialIndex>();
+
+  auto add_ring = [&index](const b_ring_t& ring) {
+    for (size_t i = 0; i < ring.size(); i++) {
+      const b_point_t& a = ring[i];
+      const b_point_t& b = ring[(i + 1) % ring.size()];
+      if (a.x() != b.x() || a.y() != b.y()) {
+        index->edges.push_back({a.x(), a.y(), b.x(), b.y()});
+      }
+    }
+  };
+  std::vector<rt_value_t> envelopes;
+  envelopes.reserve(multi_polygon.size());
+  for (size_t i = 0; i < multi_polygon.size(); i++) {
+    add_ring(multi_polygon[i].outer());
+    for (const b_ring_t& inner : multi_polygon[i].inners()) {
+      add_ring(inner);
+    }
+    envelopes.emplace_back(boost::geometry::return_envelope<b_box_t>(multi_polygon[i]), i);
+  }
+  index->polygon_envelopes = decltype(index->polygon_envelopes)(envelopes);
+  index->envelope = boost::geometry::return_envelope<b_box_t>(multi_polygon);
+
+  // About one edge per cell. The grid is offset by half a cell so that axis
+  // aligned map boundaries do not fall on grid lines.
+  const double min_x = index->envelope.min_corner().x();
+  const double min_y = index->envelope.min_corner().y();
+  const double width = std::max(static_cast<double>(index->envelope.max_corner().x()) - min_x, 1e-3);
+  const double height = std::max(static_cast<double>(index->envelope.max_corner().y()) - min_y, 1e-3);
+  const double num_cells = static_cast<double>(std::min(std::max<size_t>(index->edges.size(), 1), MAX_CELLS));
+  index->cell_size = std::max({
+      std::sqrt(width * height / num_cells),
+      std::max(width, height) / 4096.0,
+      1e-3});
+  index->origin_x = min_x - 0.5 * index->cell_size;
+  index->origin_y = min_y - 0.5 * index->cell_size;
+  index->num_columns = static_cast<int32_t>(std::floor(width / index->cell_size)) + 2;
+  index->num_rows = static_cast<int32_t>(std::floor(height / index->cell_size)) + 2;
+
+  auto clamp_column = [&index](double x) {
+    return static_cast<int32_t>(std::min(std::max(std::floor((x - index->origin_x) / index->cell_size), 0.0),
+        static_cast<double>(index->num_columns - 1)));
+  };
+  auto clamp_row = [&index](double y) {
+    return static_cast<int32_t>(std::min(std::max(std::floor((y - index->origin_y) / index->cell_size), 0.0),
+        static_cast<double>(index->num_rows - 1)));
+  };
+
+  // Edges go to every cell their slightly expanded envelope overlaps, so that
+  // rounding in the cell lookup never misses an edge.
+  const double margin = 1e-3 * index->cell_size;
+  auto for_each_cell = [&](const Edge& edge, const std::function<void(size_t)>& callback) {
+    int32_t i0 = clamp_column(std::min(edge.ax, edge.bx) - margin);
+    int32_t i1 = clamp_column(std::max(edge.ax, edge.bx) + margin);
+    int32_t j0 = clamp_row(std::min(edge.ay, edge.by) - margin);
+    int32_t j1 = clamp_row(std::max(edge.ay, edge.by) + margin);
+    for (int32_t j = j0; j <= j1; j++) {
+      for (int32_t i = i0; i <= i1; i++) {
+        callback(static_cast<size_t>(j) * static_cast<size_t>(index->num_columns) + static_cast<size_t>(i));
+      }
+    }
+  };
+  const size_t total_cells = static_cast<size_t>(index->num_columns) * static_cast<size_t>(index->num_rows);
+  index->cell_offsets.assign(total_cells + 1, 0);
+  for (const Edge& edge : index->edges) {
+    for_each_cell(edge, [&index](size_t c) { index->cell_offsets[c + 1]++; });
+  }
+  for (size_t c = 0; c < total_cells; c++) {
+    index->cell_offsets[c + 1] += index->cell_offsets[c];
+  }
+  index->cell_edges.resize(index->cell_offsets.back());
+  std::vector<uint32_t> cell_fill(index->cell_offsets.begin(), index->cell_offsets.end() - 1);
+  for (size_t e = 0; e < index->edges.size(); e++) {
+    for_each_cell(index->edges[e], [&index, &cell_fill, e](size_t c) {
+      index->cell_edges[cell_fill[c]++] = static_cast<uint32_t>(e);
+    });
+  }
+
+  // Corners by even-odd rule along each row line: a corner is inside if an
+  // odd number of edges cross the line at or left of it.
+  std::vector<std::pair<int32_t, double>> crossings;
+  for (const Edge& edge : index->edges) {
+    int32_t j0 = std::max(clamp_row(std::min(edge.ay, edge.by)) - 1, 0);
+    int32_t j1 = std::min(clamp_row(std::max(edge.ay, edge.by)) + 2, index->num_rows);
+    for (int32_t j = j0; j <= j1; j++) {
+      double y = index->RowY(j);
+      if ((edge.ay > y) != (edge.by > y)) {
+        crossings.emplace_back(j, edge.ax + (y - edge.ay) * (edge.bx - edge.ax) / (edge.by - edge.ay));
+      }
+    }
+  }
+  std::sort(crossings.begin(), crossings.end());
+  const size_t corners_per_row = static_cast<size_t>(index->num_columns) + 1;
+  index->corner_inside.assign(corners_per_row * (static_cast<size_t>(index->num_rows) + 1), 0);
+  auto crossing = crossings.begin();
+  for (int32_t j = 0; j <= index->num_rows; j++) {
+    bool inside = false;
+    for (int32_t i = 0; i <= index->num_columns; i++) {
+      double x = index->ColumnX(i);
+      for (; crossing != crossings.end() && crossing->first == j && crossing->second <= x; ++crossing) {
+        inside = !inside;
+      }
+      index->corner_inside[static_cast<size_t>(j) * corners_per_row + static_cast<size_t>(i)] = inside;
+    }
+    for (; crossing != crossings.end() && crossing->first == j; ++crossing);
+  }
+
+  return index;
+}
+
+bool OccupancyMap::SpatialIndex::Contains(double x, double y) const {
+  if (x < envelope.min_corner().x() || x > envelope.max_corner().x() ||
+      y < envelope.min_corner().y() || y > envelope.max_corner().y()) {
+    return false;
+  }
+
+  int32_t i = static_cast<int32_t>(std::floor((x - origin_x) / cell_size));
+  int32_t j = static_cast<int32_t>(std::floor((y - origin_y) / cell_size));
+  i = std::min(std::max(i, 0), num_columns - 1);
+  j = std::min(std::max(j, 0), num_rows - 1);
+  // Division may round across a grid line.
+  for (; i > 0 && x < ColumnX(i); i--);
+  for (; i < num_columns - 1 && x > ColumnX(i + 1); i++);
+  for (; j > 0 && y < RowY(j); j--);
+  for (; j < num_rows - 1 && y > RowY(j + 1); j++);
+  const double right = ColumnX(i + 1);
+  const double top = RowY(j + 1);
+
+  // Cast a ray right to the cell's right side, then up to its top right
+  // corner. Only edges in this cell can cross it.
+  bool inside = corner_inside[static_cast<size_t>(j + 1) * (static_cast<size_t>(num_columns) + 1) + static_cast<size_t>(i + 1)];
+  const size_t cell = static_cast<size_t>(j) * static_cast<size_t>(num_columns) + static_cast<size_t>(i);
+  for (uint32_t k = cell_offsets[cell]; k < cell_offsets[cell + 1]; k++) {
+    const Edge& edge = edges[cell_edges[k]];
+    // Points on the boundary are covered, as with boost::geometry::covered_by.
+    if ((edge.bx - edge.ax) * (y - edge.ay) == (edge.by - edge.ay) * (x - edge.ax) &&
+        x >= std::min(edge.ax, edge.bx) && x <= std::max(edge.ax, edge.bx) &&
+        y >= std::min(edge.ay, edge.by) && y <= std::max(edge.ay, edge.by)) {
+      return true;
+    }
+    if ((edge.ay > y) != (edge.by > y)) {
+      double x_crossing = edge.ax + (y - edge.ay) * (edge.bx - edge.ax) / (edge.by - edge.ay);
+      if (x_crossing > x && x_crossing <= right) {
+        inside = !inside;
+      }
+    }
+    if ((edge.ax > right) != (edge.bx > right)) {
+      double y_crossing = edge.ay + (right - edge.ax) * (edge.by - edge.ay) / (edge.bx - edge.ax);
+      if (y_crossing > y && y_crossing <= top) {
+        inside = !inside;
+      }
+    }
+  }
+  return inside;
+}
+
+std::shared_ptr<const OccupancyMap::SpatialIndex> OccupancyMap::GetSpatialIndex() const {
+  std::shared_ptr<const SpatialIndex> index = std::atomic_load(&_spatial_index);
+  if (!index) {
+    size_t num_edges = 0;
+    for (const b_polygon_t& polygon : _multi_polygon) {
+      num_edges += polygon.outer().size();
+      for (const b_ring_t& inner : polygon.inners()) {
+        num_edges += inner.size();
+      }
+    }
+    if (num_edges < SpatialIndex::MIN_EDGES) {
+      return nullptr;
+    }
+    // Threads racing here build identical indices; either may be kept.
+    index = SpatialIndex::Build(_multi_polygon);
+    std::atomic_store(&_spatial_index, index);
+  }
+  return index;
+}
+
 bool OccupancyMap::Contains(const geom::Vector2D& point) const {
-  return boost::geometry::covered_by(b_point_t(point.x, point.y), _multi_polygon);
+  std::shared_ptr<const SpatialIndex> index = GetSpatialIndex();
+  if (!index) {
+    return boost::geometry::covered_by(b_point_t(point.x, point.y), _multi_polygon);
+  }
+  return index->Contains(point.x, point.y);
+}
+
+std::vector<bool> OccupancyMap::ContainsMany(const std::vector<geom::Vector2D>& points) const {
+  std::shared_ptr<const SpatialIndex> index = GetSpatialIndex();
+  std::vector<bool> result(points.size());
+  for (size_t i = 0; i < points.size(); i++) {
+    result[i] = index ?
+        index->Contains(points[i].x, points[i].y) :
+        boost::geometry::covered_by(b_point_t(points[i].x, points[i].y), _multi_polygon);
+  }
+  return result;
 }
 
 bool OccupancyMap::Intersects(const OccupancyMap& occupancy_map) const {
-  return boost::geometry::intersects(_multi_polygon, occupancy_map._multi_polygon);
+  std::shared_ptr<const SpatialIndex> index = GetSpatialIndex();
+  if (!index) {
+    return boost::geometry::intersects(_multi_polygon, occupancy_map._multi_polygon);
+  }
+  typedef SpatialIndex::b_box_t b_box_t;
+  for (const b_polygon_t& polygon : occupancy_map._multi_polygon) {
+    b_box_t envelope = boost::geometry::return_envelope<b_box_t>(polygon);
+    if (!boost::geometry::intersects(envelope, index->envelope)) continue;
+    for (auto it = index->polygon_envelopes.qbegin(boost::geometry::index::intersects(envelope));
+        it != index->polygon_envelopes.qend(); ++it) {
+      if (boost::geometry::intersects(_multi_polygon[it->second], polygon)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+std::vector<bool> OccupancyMap::IntersectsMany(const std::vector<OccupancyMap>& occupancy_maps) const {
+  std::vector<bool> result(occupancy_maps.size());
+  for (size_t i = 0; i < occupancy_maps.size(); i++) {
+    result[i] = Intersects(occupancy_maps[i]);
+  }
+  return result;
+}
+
+std::vector<OccupancyTile> OccupancyMap::Tile(float tile_size) const {
+  typedef boost::geometry::model::box<b_point_t> b_box_t;
+
+  if (!(tile_size > 0)) {
+    throw_exception(std::invalid_argument("OccupancyMap: tile size must be positive"));
+  }
+
+  // Each polygon goes to every tile its envelope overlaps.
+  std::vector<b_box_t> envelopes;
+  envelopes.reserve(_multi_polygon.size());
+  std::map<std::pair<int32_t, int32_t>, std::vector<size_t>> tile_polygons;
+  for (size_t i = 0; i < _multi_polygon.size(); i++) {
+    envelopes.emplace_back(boost::geometry::return_envelope<b_box_t>(_multi_polygon[i]));
+    const b_box_t& envelope = envelopes.back();
+    int32_t x_min = static_cast<int32_t>(std::floor(envelope.min_corner().x() / tile_size));
+    int32_t x_max = static_cast<int32_t>(std::floor(envelope.max_corner().x() / tile_size));
+    int32_t y_min = static_cast<int32_t>(std::floor(envelope.min_corner().y() / tile_size));
+    int32_t y_max = static_cast<int32_t>(std::floor(envelope.max_corner().y() / tile_size));
+    for (int32_t x = x_min; x <= x_max; x++) {
+      for (int32_t y = y_min; y <= y_max; y++) {
+        tile_polygons[{x, y}].emplace_back(i);
+      }
+    }
+  }
+
+  std::vector<OccupancyTile> tiles;
+  tiles.reserve(tile_polygons.size());
+  for (const auto& entry : tile_polygons) {
+    tiles.emplace_back();
+    OccupancyTile& tile = tiles.back();
+    tile.x = entry.first.first;
+    tile.y = entry.first.second;
+    tile.bounds_min = geom::Vector2D(static_cast<float>(tile.x) * tile_size, static_cast<float>(tile.y) * tile_size);
+    tile.bounds_max = geom::Vector2D(static_cast<float>(tile.x + 1) * tile_size, static_cast<float>(tile.y + 1) * tile_size);
+  }
+
+  std::vector<const std::vector<size_t>*> tile_polygon_ids;
+  tile_polygon_ids.reserve(tile_polygons.size());
+  for (const auto& entry : tile_polygons) {
+    tile_polygon_ids.emplace_back(&entry.second);
+  }
+
+  // Polygons of a valid map are disjoint, so their pieces are simply
+  // concatenated. Polygons entirely inside a tile are copied without clipping.
+  ParallelFor(tiles.size(), 1, [this, &tiles, &envelopes, &tile_polygon_ids](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      OccupancyTile& tile = tiles[i];
+      b_box_t box(
+          b_point_t(tile.bounds_min.x, tile.bounds_min.y),
+          b_point_t(tile.bounds_max.x, tile.bounds_max.y));
+      b_multi_polygon_t& result = tile.occupancy_map._multi_polygon;
+      for (size_t polygon_id : *tile_polygon_ids[i]) {
+        if (boost::geometry::covered_by(envelopes[polygon_id], box)) {
+          result.emplace_back(_multi_polygon[polygon_id]);
+        } else {
+          b_multi_polygon_t clipped;
+          boost::geometry::intersection(_multi_polygon[polygon_id], box, clipped);
+          std::move(clipped.begin(), clipped.end(), std::back_inserter(result));
+        }
+      }
+    }
+  });
+
+  // Envelopes may overlap tiles that the polygons themselves do not.
+  tiles.erase(
+      std::remove_if(tiles.begin(), tiles.end(), [](const OccupancyTile& tile) {
+        return tile.occupancy_map.IsEmpty();
+      }),
+      tiles.end());
+  return tiles;
 }
 
 sidewalk::Sidewalk OccupancyMap::CreateSidewalk(float distance) const {
@@ -475,5 +1127,83 @@ std::vector<geom::Vector3D> OccupancyMap::GetWallMeshTriangles(float height) con
   return triangles;
 }
 
+geom::IndexedMesh OccupancyMap::GetIndexedMesh(float height, bool double_sided) const {
+  geom::IndexedMesh mesh;
+  mesh.double_sided = double_sided;
+
+  for (const b_polygon_t& polygon : _multi_polygon) {
+    std::vector<std::vector<geom::Vector2D>> polygon_with_holes(
+        1 + polygon.inners().size(),
+        std::vector<geom::Vector2D>());
+    for (const b_point_t& vertex : polygon.outer()) {
+      polygon_with_holes[0].emplace_back(vertex.x(), vertex.y());
+    }
+    for (size_t i = 0; i < polygon.inners().size(); i++) {
+      for (const b_point_t& vertex : polygon.inners()[i]) {
+        polygon_with_holes[1 + i].emplace_back(vertex.x(), vertex.y());
+      }
+    }
+
+    // Ring vertices are added the first time a triangle uses them, so the
+    // repeated closing vertex of each ring is left out.
+    std::vector<std::vector<uint32_t>> vertex_ids(polygon_with_holes.size());
+    for (size_t i = 0; i < polygon_with_holes.size(); i++) {
+      vertex_ids[i].assign(polygon_with_holes[i].size(), std::numeric_limits<uint32_t>::max());
+    }
+    auto vertex_id = [&](const std::pair<size_t, size_t>& ring_vertex) {
+      uint32_t& id = vertex_ids[ring_vertex.first][ring_vertex.second];
+      if (id == std::numeric_limits<uint32_t>::max()) {
+        const geom::Vector2D& vertex = polygon_with_holes[ring_vertex.first][ring_vertex.second];
+        id = static_cast<uint32_t>(mesh.vertices.size());
+        mesh.vertices.emplace_back(vertex.x, vertex.y, height);
+      }
+      return id;
+    };
+
+    std::vector<std::pair<size_t, size_t>> polygon_triangulation = geom::Triangulation::Triangulate(polygon_with_holes);
+    for (size_t i = 0; i < polygon_triangulation.size(); i += 3) {
+      // Same winding as the upward facing triangles of GetMeshTriangles.
+      mesh.indices.emplace_back(vertex_id(polygon_triangulation[i + 2]));
+      mesh.indices.emplace_back(vertex_id(polygon_triangulation[i + 1]));
+      mesh.indices.emplace_back(vertex_id(polygon_triangulation[i]));
+    }
+  }
+
+  return mesh;
+}
+
+geom::IndexedMesh OccupancyMap::GetIndexedWallMesh(float height, bool double_sided) const {
+  geom::IndexedMesh mesh;
+  mesh.double_sided = double_sided;
+
+  // Edges do not share vertices, so that corners stay sharp when normals are
+  // computed per vertex.
+  auto add_ring = [&](const b_ring_t& ring) {
+    for (size_t i = 0; i < ring.size(); i++) {
+      const b_point_t& start = ring[i];
+      const b_point_t& end = ring[(i + 1) % ring.size()];
+      if (start.x() == end.x() && start.y() == end.y()) continue;
+
+      uint32_t base = static_cast<uint32_t>(mesh.vertices.size());
+      mesh.vertices.emplace_back(start.x(), start.y(), 0);
+      mesh.vertices.emplace_back(start.x(), start.y(), height);
+      mesh.vertices.emplace_back(end.x(), end.y(), 0);
+      mesh.vertices.emplace_back(end.x(), end.y(), height);
+      mesh.indices.insert(mesh.indices.end(), {
+          base + 3, base + 2, base + 0,
+          base + 0, base + 1, base + 3});
+    }
+  };
+
+  for (const b_polygon_t& polygon : _multi_polygon) {
+    add_ring(polygon.outer());
+    for (const b_ring_t& inner : polygon.inners()) {
+      add_ring(inner);
+    }
+  }
+
+  return mesh;
+}
+
 }
 }
@@ -1,11 +1,15 @@
 #pragma once
 
+#include "carla/geom/IndexedMesh.h"
 #include "carla/geom/Triangle2D.h"
 #include "carla/geom/Vector3D.h"
 #include "carla/sidewalk/Sidewalk.h"
 #include "carla/segments/SegmentMap.h"
 #include <boost/geometry/geometries/point_xy.hpp>
 #include <boost/geometry/geometries/geometries.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
 namespace carla {
 namespace sidewalk { class Sidewalk; }
@@ -15,6 +19,8 @@ namespace segments { class SegmentMap; }
 namespace carla {
 namespace occupancy {
 
+struct OccupancyTile;
+
 class OccupancyMap {
 public:
 
@@ -33,26 +39,65 @@ public:
   // Rectangle.
   OccupancyMap(const geom::Vector2D& bounds_min, const geom::Vector2D& bounds_max);
 
+  // Copies share the spatial index, if already built.
+  OccupancyMap(const OccupancyMap& occupancy_map);
+  OccupancyMap(OccupancyMap&& occupancy_map) = default;
+  OccupancyMap& operator=(const OccupancyMap& occupancy_map);
+  OccupancyMap& operator=(OccupancyMap&& occupancy_map) = default;
+
+  // Loads either the text format written by Save, or the binary format
+  // written by SaveBinary, detected from the file header.
   static OccupancyMap Load(const std::string& file);
   void Save(const std::string& file) const;
 
+  // Versioned binary format of flat vertex arrays with ring and polygon offset
+  // tables. LoadBinary memory-maps the file instead of reading and parsing it.
+  static OccupancyMap LoadBinary(const std::string& file);
+  static OccupancyMap FromBinary(const char* data, size_t size);
+  std::vector<char> ToBinary() const;
+  void SaveBinary(const std::string& file) const;
+
+  // Many maps in one file, e.g. all landmarks of a city: a table of offsets
+  // followed by each map in the binary format above.
+  static std::vector<OccupancyMap> LoadBinaryPack(const std::string& file);
+  static void SaveBinaryPack(const std::vector<OccupancyMap>& occupancy_maps, const std::string& file);
+
   bool IsEmpty() const; 
   bool operator==(const OccupancyMap& occupancy_map) const;
   bool operator!=(const OccupancyMap& occupancy_map) const;
 
   OccupancyMap Union(const OccupancyMap& occupancy_map) const;
+  // Union of many maps through a cascaded pairwise reduction on a thread pool.
+  static OccupancyMap UnionAll(std::vector<OccupancyMap> occupancy_maps);
   OccupancyMap Difference(const OccupancyMap& occupancy_map) const;
+  // Difference of each map with occupancy_map, on a thread pool. Each map is
+  // only clipped against the polygons of occupancy_map near it.
+  static std::vector<OccupancyMap> DifferenceAll(
+      std::vector<OccupancyMap> occupancy_maps, const OccupancyMap& occupancy_map);
   OccupancyMap Intersection(const OccupancyMap& occupancy_map) const;
   OccupancyMap Buffer(float width) const;
 
+  // Except for small maps, the first query builds a spatial index, after
+  // which Contains takes constant time on average and Intersects only tests
+  // polygons whose envelopes overlap. Safe to call from multiple threads.
   bool Contains(const geom::Vector2D& point) const;
+  std::vector<bool> ContainsMany(const std::vector<geom::Vector2D>& points) const;
   bool Intersects(const OccupancyMap& occupancy_map) const;
+  std::vector<bool> IntersectsMany(const std::vector<OccupancyMap>& occupancy_maps) const;
+
+  // Clips the map to a grid of square tiles, in parallel. Only non-empty
+  // tiles are returned, ordered by x then y.
+  std::vector<OccupancyTile> Tile(float tile_size) const;
 
   sidewalk::Sidewalk CreateSidewalk(float distance) const;
   std::vector<std::vector<std::vector<geom::Vector2D>>> GetPolygons() const;
   std::vector<geom::Triangle2D> GetTriangles() const;
   std::vector<geom::Vector3D> GetMeshTriangles(float height=0) const;
   std::vector<geom::Vector3D> GetWallMeshTriangles(float height) const;
+  // Indexed versions of the two above, with vertices shared between
+  // triangles. Double sided, they describe the same surfaces.
+  geom::IndexedMesh GetIndexedMesh(float height=0, bool double_sided=true) const;
+  geom::IndexedMesh GetIndexedWallMesh(float height, bool double_sided=true) const;
 
   friend class segments::SegmentMap;
 
@@ -66,6 +111,24 @@ private:
 
   b_multi_polygon_t _multi_polygon;
 
+  // Built on demand from _multi_polygon, which must not be modified in place
+  // afterwards without resetting it. Accessed with std::atomic_load/store.
+  struct SpatialIndex;
+  mutable std::shared_ptr<const SpatialIndex> _spatial_index;
+
+  // Null for maps too small to benefit from an index.
+  std::shared_ptr<const SpatialIndex> GetSpatialIndex() const;
+
+};
+
+// Square tile (x, y) of a grid aligned to the origin, covering
+// [x * size, (x + 1) * size] x [y * size, (y + 1) * size].
+struct OccupancyTile {
+  int32_t x;
+  int32_t y;
+  geom::Vector2D bounds_min;
+  geom::Vector2D bounds_max;
+  OccupancyMap occupancy_map;
 };
 
 }
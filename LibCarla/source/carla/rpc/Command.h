@@ -8,6 +8,7 @@
 
 #include "carla/MsgPack.h"
 #include "carla/MsgPackAdaptors.h"
+#include "carla/geom/IndexedMesh.h"
 #include "carla/geom/Transform.h"
 #include "carla/rpc/ActorDescription.h"
 #include "carla/rpc/ActorId.h"
@@ -67,6 +68,18 @@ namespace rpc {
       MSGPACK_DEFINE_ARRAY(triangles, material, semantic_segmentation_label);
     };
     
+    struct SpawnDynamicIndexedMesh : CommandBase<SpawnDynamicIndexedMesh> {
+      SpawnDynamicIndexedMesh() = default;
+      SpawnDynamicIndexedMesh(geom::IndexedMesh mesh, std::string material, uint8_t semantic_segmentation_label)
+        : mesh(std::move(mesh)),
+        material(material),
+        semantic_segmentation_label(semantic_segmentation_label) {}
+      geom::IndexedMesh mesh;
+      std::string material;
+      uint8_t semantic_segmentation_label;
+      MSGPACK_DEFINE_ARRAY(mesh, material, semantic_segmentation_label);
+    };
+
     struct DestroyDynamicMesh : CommandBase<DestroyDynamicMesh> {
       DestroyDynamicMesh() = default;
       DestroyDynamicMesh(uint32_t id)
@@ -177,7 +190,8 @@ namespace rpc {
         ApplyAngularVelocity,
         ApplyImpulse,
         SetSimulatePhysics,
-        SetAutopilot>;
+        SetAutopilot,
+        SpawnDynamicIndexedMesh>;
 
     CommandType command;
 
@@ -1,5 +1,7 @@
 #include "SegmentMap.h"
 
+#include <algorithm>
+
 namespace carla {
 namespace segments {
 
@@ -8,80 +10,206 @@ SegmentMap::SegmentMap()
   Build();
 }
 
-SegmentMap::SegmentMap(const std::vector<geom::Segment2D>& segments)
-    : _rng(std::random_device()()) { 
-  _multi_linestring.resize(segments.size());
-  for (size_t i = 0; i < segments.size(); i++) {
-    boost::geometry::append(_multi_linestring[i], b_point_t(segments[i].start.x, segments[i].start.y));
-    boost::geometry::append(_multi_linestring[i], b_point_t(segments[i].end.x, segments[i].end.y));
-  }
-
+SegmentMap::SegmentMap(std::vector<geom::Segment2D> segments)
+    : _segments(std::move(segments)),
+      _rng(std::random_device()()) { 
   Build();
 }
 
 void SegmentMap::Build() {
-  std::vector<float> weights;
+  size_t n = _segments.size();
 
-  for (size_t i = 0; i < _multi_linestring.size(); i++) {
-    const b_linestring_t& linestring = _multi_linestring[i];
-    for (size_t j = 0; j < linestring.size() - 1; j++) {
-      weights.emplace_back(boost::geometry::distance(linestring[j], linestring[j + 1]));
-      _index_to_segment_map.emplace_back(std::make_pair(i, j));
-    }
+  std::vector<rt_value_t> index_entries;
+  index_entries.reserve(n);
+  std::vector<double> weights(n);
+  double total_weight = 0;
+  for (size_t i = 0; i < n; i++) {
+    const geom::Segment2D& segment = _segments[i];
+    index_entries.emplace_back(
+        b_box_t(
+          b_point_t(std::min(segment.start.x, segment.end.x), std::min(segment.start.y, segment.end.y)),
+          b_point_t(std::max(segment.start.x, segment.end.x), std::max(segment.start.y, segment.end.y))),
+        i);
+    weights[i] = (segment.end - segment.start).Length();
+    total_weight += weights[i];
   }
+  _segments_index = rt_tree_t(index_entries);
 
-  _index_distribution = std::discrete_distribution<size_t>(weights.begin(), weights.end());
+  // Vose's construction. Slots scaled below 1 are topped up by one slot
+  // scaled above 1; leftovers (from rounding) are kept whole.
+  _alias_probabilities.assign(n, 1.0f);
+  _aliases.resize(n);
+  std::vector<size_t> small;
+  std::vector<size_t> large;
+  for (size_t i = 0; i < n; i++) {
+    _aliases[i] = i;
+    // Degenerate maps of zero length sample segments uniformly.
+    weights[i] = total_weight > 0 ? weights[i] * static_cast<double>(n) / total_weight : 1.0;
+    (weights[i] < 1.0 ? small : large).emplace_back(i);
+  }
+  while (!small.empty() && !large.empty()) {
+    size_t s = small.back();
+    size_t l = large.back();
+    small.pop_back();
+    _alias_probabilities[s] = static_cast<float>(weights[s]);
+    _aliases[s] = l;
+    weights[l] = (weights[l] + weights[s]) - 1.0;
+    if (weights[l] < 1.0) {
+      large.pop_back();
+      small.emplace_back(l);
+    }
+  }
 }
   
 bool SegmentMap::IsEmpty() const {
-  return boost::geometry::is_empty(_multi_linestring);
+  return _segments.empty();
 }
 
 SegmentMap SegmentMap::Union(const SegmentMap& segment_map) const {
-  SegmentMap result;
-  boost::geometry::intersection(_multi_linestring, segment_map._multi_linestring, result._multi_linestring);
-  result.Build();
-  return result;
+  std::vector<geom::Segment2D> segments;
+  segments.reserve(_segments.size() + segment_map._segments.size());
+  segments.insert(segments.end(), _segments.begin(), _segments.end());
+  segments.insert(segments.end(), segment_map._segments.begin(), segment_map._segments.end());
+  return SegmentMap(std::move(segments));
+}
+
+std::vector<std::vector<size_t>> SegmentMap::FindCandidatePolygons(const occupancy::OccupancyMap& occupancy_map) const {
+  std::vector<std::vector<size_t>> candidates(_segments.size());
+  for (size_t i = 0; i < occupancy_map._multi_polygon.size(); i++) {
+    b_box_t envelope = boost::geometry::return_envelope<b_box_t>(occupancy_map._multi_polygon[i]);
+    for (auto it = _segments_index.qbegin(boost::geometry::index::intersects(envelope)); it != _segments_index.qend(); ++it) {
+      candidates[it->second].emplace_back(i);
+    }
+  }
+  return candidates;
+}
+
+// Splits clipped linestrings back into segments, dropping degenerate ones.
+template <typename LinestringT>
+static void AppendSegments(const std::vector<LinestringT>& linestrings, std::vector<geom::Segment2D>& segments) {
+  for (const auto& linestring : linestrings) {
+    for (size_t i = 0; i + 1 < linestring.size(); i++) {
+      geom::Vector2D start(linestring[i].x(), linestring[i].y());
+      geom::Vector2D end(linestring[i + 1].x(), linestring[i + 1].y());
+      if (start != end) {
+        segments.emplace_back(start, end);
+      }
+    }
+  }
 }
 
 SegmentMap SegmentMap::Difference(const occupancy::OccupancyMap& occupancy_map) const {
-  SegmentMap result;
-  boost::geometry::difference(_multi_linestring, occupancy_map._multi_polygon, result._multi_linestring);
-  result.Build();
-  return result;
+  std::vector<std::vector<size_t>> candidates = FindCandidatePolygons(occupancy_map);
+
+  std::vector<geom::Segment2D> segments;
+  std::vector<b_linestring_t> pieces;
+  std::vector<b_linestring_t> next_pieces;
+  for (size_t i = 0; i < _segments.size(); i++) {
+    const geom::Segment2D& segment = _segments[i];
+    if (candidates[i].empty()) {
+      segments.emplace_back(segment);
+      continue;
+    }
+
+    // Polygons of a valid occupancy map are disjoint, so they can be
+    // subtracted one at a time.
+    pieces.assign(1, b_linestring_t{
+        b_point_t(segment.start.x, segment.start.y),
+        b_point_t(segment.end.x, segment.end.y)});
+    for (size_t polygon_id : candidates[i]) {
+      next_pieces.clear();
+      for (const b_linestring_t& piece : pieces) {
+        boost::geometry::difference(piece, occupancy_map._multi_polygon[polygon_id], next_pieces);
+      }
+      std::swap(pieces, next_pieces);
+    }
+    AppendSegments(pieces, segments);
+  }
+
+  return SegmentMap(std::move(segments));
 }
 
 SegmentMap SegmentMap::Intersection(const occupancy::OccupancyMap& occupancy_map) const {
-  SegmentMap result;
-  boost::geometry::intersection(_multi_linestring, occupancy_map._multi_polygon, result._multi_linestring);
-  result.Build();
-  return result;
+  std::vector<std::vector<size_t>> candidates = FindCandidatePolygons(occupancy_map);
+
+  std::vector<geom::Segment2D> segments;
+  std::vector<b_linestring_t> pieces;
+  for (size_t i = 0; i < _segments.size(); i++) {
+    if (candidates[i].empty()) continue;
+
+    const geom::Segment2D& segment = _segments[i];
+    b_linestring_t linestring{
+        b_point_t(segment.start.x, segment.start.y),
+        b_point_t(segment.end.x, segment.end.y)};
+    pieces.clear();
+    for (size_t polygon_id : candidates[i]) {
+      boost::geometry::intersection(linestring, occupancy_map._multi_polygon[polygon_id], pieces);
+    }
+    AppendSegments(pieces, segments);
+  }
+
+  return SegmentMap(std::move(segments));
 }
 
 void SegmentMap::SeedRand(uint32_t seed) {
   _rng.seed(seed);
 }
 
+size_t SegmentMap::RandSegment() {
+  size_t slot = std::uniform_int_distribution<size_t>(0, _aliases.size() - 1)(_rng);
+  return std::uniform_real_distribution<float>(0.0f, 1.0f)(_rng) < _alias_probabilities[slot] ? slot : _aliases[slot];
+}
+
 geom::Vector2D SegmentMap::RandPoint() {
-  const std::pair<size_t, size_t>& segment = _index_to_segment_map[_index_distribution(_rng)];
-  geom::Vector2D start(
-      _multi_linestring[segment.first][segment.second].x(), 
-      _multi_linestring[segment.first][segment.second].y());
-  geom::Vector2D end(
-      _multi_linestring[segment.first][segment.second + 1].x(),
-      _multi_linestring[segment.first][segment.second + 1].y());
+  const geom::Segment2D& segment = _segments[RandSegment()];
+  return segment.start + std::uniform_real_distribution<float>(0.0f, 1.0f)(_rng) * (segment.end - segment.start);
+}
+
+std::vector<geom::Vector2D> SegmentMap::RandPoints(size_t count) {
+  std::vector<geom::Vector2D> points;
+  if (_segments.empty()) return points;
 
-  return start + std::uniform_real_distribution<float>(0.0f, 1.0f)(_rng) * (end - start);
+  points.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    points.emplace_back(RandPoint());
+  }
+  return points;
 }
-  
-std::vector<geom::Segment2D> SegmentMap::GetSegments() const {
-  std::vector<geom::Segment2D> segments; 
-  for (const b_linestring_t& linestring : _multi_linestring) {
-    segments.emplace_back(
-        geom::Vector2D(linestring[0].x(), linestring[0].y()),
-        geom::Vector2D(linestring[1].x(), linestring[1].y()));
+
+boost::optional<geom::Vector2D> SegmentMap::RandPointExcluding(const aabb::AABBMap& aabb_map, float clearance, size_t max_tries) {
+  if (_segments.empty()) return boost::none;
+
+  for (size_t i = 0; i < max_tries; i++) {
+    geom::Vector2D point = RandPoint();
+    geom::AABB2D clearance_box(
+        point - geom::Vector2D(clearance, clearance),
+        point + geom::Vector2D(clearance, clearance));
+    if (!aabb_map.Intersects(clearance_box)) {
+      return point;
+    }
+  }
+  return boost::none;
+}
+
+std::vector<geom::Vector2D> SegmentMap::RandPointsExcluding(const aabb::AABBMap& aabb_map, float clearance, size_t count, size_t max_tries) {
+  std::vector<geom::Vector2D> points;
+  if (_segments.empty()) return points;
+
+  aabb::AABBMap accepted;
+  for (size_t i = 0; i < count; i++) {
+    for (size_t j = 0; j < max_tries; j++) {
+      geom::Vector2D point = RandPoint();
+      geom::AABB2D clearance_box(
+          point - geom::Vector2D(clearance, clearance),
+          point + geom::Vector2D(clearance, clearance));
+      if (!aabb_map.Intersects(clearance_box) && !accepted.Intersects(clearance_box)) {
+        accepted.Insert(geom::AABB2D(point, point));
+        points.emplace_back(point);
+        break;
+      }
+    }
   }
-  return segments;
+  return points;
 }
 
 }
@@ -1,8 +1,10 @@
 #pragma once
 
+#include "carla/aabb/AABBMap.h"
 #include "carla/geom/Segment2D.h"
 #include "carla/occupancy/OccupancyMap.h"
 #include <vector>
+#include <boost/optional.hpp>
 #include <boost/geometry.hpp>
 #include <boost/geometry/geometries/point.hpp>
 #include <boost/geometry/geometries/box.hpp>
@@ -25,18 +27,27 @@ class SegmentMap {
 public:
 
   SegmentMap();
-  SegmentMap(const std::vector<geom::Segment2D>& segments);
+  SegmentMap(std::vector<geom::Segment2D> segments);
 
   bool IsEmpty() const;
 
+  // Concatenates the segments of both maps.
   SegmentMap Union(const SegmentMap& segment_map) const;
   SegmentMap Difference(const occupancy::OccupancyMap& occupancy_map) const;
   SegmentMap Intersection(const occupancy::OccupancyMap& occupancy_map) const;
 
   void SeedRand(uint32_t seed);
+  // Point uniformly distributed over the total length of the segments.
   geom::Vector2D RandPoint();
+  std::vector<geom::Vector2D> RandPoints(size_t count);
+  // Samples up to max_tries points by length and returns the first whose
+  // clearance box (point +- clearance) intersects nothing in aabb_map.
+  boost::optional<geom::Vector2D> RandPointExcluding(const aabb::AABBMap& aabb_map, float clearance, size_t max_tries);
+  // Returns up to count such points, each also at least clearance (in both
+  // axes) from the others, spending at most max_tries samples per point.
+  std::vector<geom::Vector2D> RandPointsExcluding(const aabb::AABBMap& aabb_map, float clearance, size_t count, size_t max_tries);
 
-  std::vector<geom::Segment2D> GetSegments() const;
+  const std::vector<geom::Segment2D>& GetSegments() const { return _segments; }
 
   friend class occupancy::OccupancyMap;
 
@@ -44,16 +55,27 @@ private:
   
   typedef boost::geometry::model::d2::point_xy<float> b_point_t;
   typedef boost::geometry::model::linestring<b_point_t> b_linestring_t;
-  typedef boost::geometry::model::multi_linestring<b_linestring_t> b_multi_linestring_t;
+  typedef boost::geometry::model::box<b_point_t> b_box_t;
+  typedef std::pair<b_box_t, size_t> rt_value_t;
+  typedef boost::geometry::index::rtree<rt_value_t, boost::geometry::index::rstar<16>> rt_tree_t;
 
-  b_multi_linestring_t _multi_linestring;
+  std::vector<geom::Segment2D> _segments;
+  // Envelopes of _segments, so clipping only visits segments near a polygon.
+  rt_tree_t _segments_index;
 
-  std::vector<std::pair<size_t, size_t>> _index_to_segment_map;
-  std::discrete_distribution<size_t> _index_distribution;
+  // Walker alias table over segment lengths: segment i is picked with
+  // probability _alias_probabilities[i] when slot i is drawn, otherwise
+  // _aliases[i] is.
+  std::vector<float> _alias_probabilities;
+  std::vector<size_t> _aliases;
 
   std::mt19937 _rng;
 
   void Build();
+  size_t RandSegment();
+  // For each segment, the polygons of occupancy_map whose envelopes intersect
+  // the segment's envelope.
+  std::vector<std::vector<size_t>> FindCandidatePolygons(const occupancy::OccupancyMap& occupancy_map) const;
 };
 
 }
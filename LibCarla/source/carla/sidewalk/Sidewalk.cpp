@@ -1,21 +1,42 @@
 #include "Sidewalk.h"
 #include "carla/geom/Math.h"
+#include "carla/ParallelFor.h"
 #include <boost/geometry/geometries/point_xy.hpp>
 #include <boost/geometry/geometries/geometries.hpp>
+#include <algorithm>
+#include <cmath>
 
 namespace carla {
 namespace sidewalk {
 
+// Calls f(i) for every i in [0, count), in chunks spread over the shared
+// thread pool.
+template <typename F>
+static void ParallelForEach(size_t count, F&& f) {
+  static constexpr size_t CHUNK_SIZE = 256;
+
+  ParallelFor(count, CHUNK_SIZE, [&f](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      f(i);
+    }
+  });
+}
+
 Sidewalk::Sidewalk(const std::vector<std::vector<geom::Vector2D>>& polygons)
   : _polygons(polygons) {
 
   std::vector<rt_value_t> index_entries;
+  _cumulative_lengths.reserve(_polygons.size());
 
   for (size_t i = 0; i < _polygons.size(); i++) {
     const std::vector<geom::Vector2D>& polygon = _polygons[i];
+    std::vector<float> cumulative_lengths;
+    cumulative_lengths.reserve(polygon.size() + 1);
+    cumulative_lengths.emplace_back(0.0f);
     for (size_t j = 0; j < polygon.size(); j++) {
       const geom::Vector2D& v_start = polygon[j];
       const geom::Vector2D& v_end = polygon[(j + 1) % polygon.size()];
+      cumulative_lengths.emplace_back(cumulative_lengths.back() + (v_end - v_start).Length());
 
       index_entries.emplace_back(
           rt_segment_t(
@@ -23,21 +44,21 @@ Sidewalk::Sidewalk(const std::vector<std::vector<geom::Vector2D>>& polygons)
             rt_point_t(v_end.x, v_end.y)),
           std::pair<size_t, size_t>(i, j));
     }
+    _cumulative_lengths.emplace_back(std::move(cumulative_lengths));
   }
 
   _segments_index = rt_tree_t(index_entries);
 }
   
 occupancy::OccupancyMap Sidewalk::CreateOccupancyMap(float width) const {
-  occupancy::OccupancyMap occupancy_map;
+  std::vector<occupancy::OccupancyMap> occupancy_maps;
   for (const std::vector<geom::Vector2D>& polygon : _polygons) {
     occupancy::OccupancyMap polygon_occupancy_map(polygon);
     occupancy::OccupancyMap outer_buffer = polygon_occupancy_map.Buffer(width / 2);
     occupancy::OccupancyMap inner_buffer = polygon_occupancy_map.Buffer(-width / 2);
-    occupancy::OccupancyMap buffer_difference = outer_buffer.Difference(inner_buffer);
-    occupancy_map = occupancy_map.Union(buffer_difference);
+    occupancy_maps.emplace_back(outer_buffer.Difference(inner_buffer));
   }
-  return occupancy_map;
+  return occupancy::OccupancyMap::UnionAll(std::move(occupancy_maps));
 }
 
 segments::SegmentMap Sidewalk::CreateSegmentMap() const {
@@ -54,6 +75,14 @@ segments::SegmentMap Sidewalk::CreateSegmentMap() const {
   return segments::SegmentMap(std::move(segments));
 }
   
+SidewalkRoutePoint Sidewalk::MakeRoutePoint(size_t polygon_id, size_t segment_id, float offset) const {
+  return SidewalkRoutePoint{
+      polygon_id,
+      segment_id,
+      offset,
+      _cumulative_lengths[polygon_id][segment_id] + offset};
+}
+
 geom::Vector2D Sidewalk::GetRoutePointPosition(const SidewalkRoutePoint& route_point) const {
   const geom::Vector2D segment_start = _polygons[route_point.polygon_id][route_point.segment_id]; 
   const geom::Vector2D& segment_end = _polygons[route_point.polygon_id][(route_point.segment_id + 1) % _polygons[route_point.polygon_id].size()];
@@ -78,50 +107,58 @@ SidewalkRoutePoint Sidewalk::GetNearestRoutePoint(const geom::Vector2D& position
       direction);
   offset = std::max(0.0f, std::min((segment_end - segment_start).Length(), offset));
 
-  return SidewalkRoutePoint{
+  return MakeRoutePoint(
       result.second.first,
       result.second.second,
-      offset};
+      offset);
 }
   
 SidewalkRoutePoint Sidewalk::GetNextRoutePoint(const SidewalkRoutePoint& route_point, float lookahead_distance) const {
-  const geom::Vector2D& segment_start = _polygons[route_point.polygon_id][route_point.segment_id];
-  const geom::Vector2D& segment_end = _polygons[route_point.polygon_id][(route_point.segment_id + 1) % _polygons[route_point.polygon_id].size()];
-  float segment_length = (segment_end - segment_start).Length();
-    
-  if (route_point.offset + lookahead_distance <= segment_length) {
-    return SidewalkRoutePoint{
-        route_point.polygon_id,
-        route_point.segment_id,
-        route_point.offset + lookahead_distance};
-  } else {
-    return GetNextRoutePoint(
-        SidewalkRoutePoint{
-          route_point.polygon_id, 
-          (route_point.segment_id + 1) % _polygons[route_point.polygon_id].size(),
-          0},
-        lookahead_distance - (segment_length - route_point.offset));
+  const std::vector<float>& cumulative_lengths = _cumulative_lengths[route_point.polygon_id];
+  float ring_length = cumulative_lengths.back();
+  if (ring_length <= 0) return route_point;
+
+  float arc_length = cumulative_lengths[route_point.segment_id] + route_point.offset + lookahead_distance;
+  if (arc_length > ring_length) {
+    arc_length = std::fmod(arc_length, ring_length);
+    if (arc_length == 0) arc_length = ring_length;
   }
+
+  // The first segment ending at or after arc_length, so that a point exactly
+  // on a vertex stays at the end of the preceding segment.
+  size_t segment_id = static_cast<size_t>(std::lower_bound(
+      cumulative_lengths.begin() + 1, cumulative_lengths.end(), arc_length) - (cumulative_lengths.begin() + 1));
+  segment_id = std::min(segment_id, cumulative_lengths.size() - 2);
+  float segment_length = cumulative_lengths[segment_id + 1] - cumulative_lengths[segment_id];
+
+  return MakeRoutePoint(
+      route_point.polygon_id,
+      segment_id,
+      std::max(0.0f, std::min(segment_length, arc_length - cumulative_lengths[segment_id])));
 }
 
 SidewalkRoutePoint Sidewalk::GetPreviousRoutePoint(const SidewalkRoutePoint& route_point, float lookahead_distance) const {
-  if (route_point.offset - lookahead_distance >= 0) {
-    return SidewalkRoutePoint{
-        route_point.polygon_id,
-        route_point.segment_id,
-        route_point.offset - lookahead_distance};
-  } else {
-    const geom::Vector2D& segment_start = _polygons[route_point.polygon_id][route_point.segment_id];
-    size_t previous_segment_id = (route_point.segment_id == 0 ? _polygons[route_point.polygon_id].size() : route_point.segment_id) - 1;
-    const geom::Vector2D& previous_segment_start = _polygons[route_point.polygon_id][previous_segment_id];
-
-    return GetPreviousRoutePoint(
-        SidewalkRoutePoint{
-          route_point.polygon_id,
-          previous_segment_id,
-          (segment_start - previous_segment_start).Length()},
-        lookahead_distance - route_point.offset);
+  const std::vector<float>& cumulative_lengths = _cumulative_lengths[route_point.polygon_id];
+  float ring_length = cumulative_lengths.back();
+  if (ring_length <= 0) return route_point;
+
+  float arc_length = cumulative_lengths[route_point.segment_id] + route_point.offset - lookahead_distance;
+  if (arc_length < 0) {
+    arc_length = std::fmod(arc_length, ring_length) + ring_length;
+    if (arc_length >= ring_length) arc_length = 0;
   }
+
+  // The last segment starting at or before arc_length, so that a point
+  // exactly on a vertex moves to the start of the following segment.
+  size_t segment_id = static_cast<size_t>(std::upper_bound(
+      cumulative_lengths.begin(), cumulative_lengths.end() - 1, arc_length) - cumulative_lengths.begin());
+  segment_id = segment_id == 0 ? 0 : segment_id - 1;
+  float segment_length = cumulative_lengths[segment_id + 1] - cumulative_lengths[segment_id];
+
+  return MakeRoutePoint(
+      route_point.polygon_id,
+      segment_id,
+      std::max(0.0f, std::min(segment_length, arc_length - cumulative_lengths[segment_id])));
 }
   
 boost::optional<SidewalkRoutePoint> Sidewalk::GetAdjacentRoutePoint(const SidewalkRoutePoint& route_point, float max_cross_distance) const {
@@ -164,8 +201,8 @@ boost::optional<SidewalkRoutePoint> Sidewalk::GetAdjacentRoutePoint(const Sidewa
     size_t best_segment_id = best_result->second.second;
     float best_offset = (geom::Vector2D(best_intersection->get<0>(), best_intersection->get<1>()) - _polygons[best_polygon_id][best_segment_id]).Length();
 
-    return boost::optional<SidewalkRoutePoint>({
-        best_polygon_id, best_segment_id, best_offset});
+    return boost::optional<SidewalkRoutePoint>(MakeRoutePoint(
+        best_polygon_id, best_segment_id, best_offset));
   } else {
     return boost::optional<SidewalkRoutePoint>();
   }
@@ -177,12 +214,57 @@ bool Sidewalk::Intersects(const geom::Segment2D& segment) const {
       rt_point_t(segment.start.x, segment.start.y),
       rt_point_t(segment.end.x, segment.end.y));
 
-  std::vector<rt_value_t> results;
-  _segments_index.query(
-      boost::geometry::index::intersects(segment_), 
-      std::back_inserter(results));
+  // Stops at the first hit.
+  return _segments_index.qbegin(boost::geometry::index::intersects(segment_)) != _segments_index.qend();
+}
+
+std::vector<geom::Vector2D> Sidewalk::GetRoutePointPositions(const std::vector<SidewalkRoutePoint>& route_points) const {
+  std::vector<geom::Vector2D> positions(route_points.size());
+  ParallelForEach(route_points.size(), [&](size_t i) {
+    positions[i] = GetRoutePointPosition(route_points[i]);
+  });
+  return positions;
+}
+
+std::vector<SidewalkRoutePoint> Sidewalk::GetNearestRoutePoints(const std::vector<geom::Vector2D>& positions) const {
+  std::vector<SidewalkRoutePoint> route_points(positions.size());
+  ParallelForEach(positions.size(), [&](size_t i) {
+    route_points[i] = GetNearestRoutePoint(positions[i]);
+  });
+  return route_points;
+}
+
+std::vector<SidewalkRoutePoint> Sidewalk::GetNextRoutePoints(const std::vector<SidewalkRoutePoint>& route_points, float lookahead_distance) const {
+  std::vector<SidewalkRoutePoint> next_route_points(route_points.size());
+  ParallelForEach(route_points.size(), [&](size_t i) {
+    next_route_points[i] = GetNextRoutePoint(route_points[i], lookahead_distance);
+  });
+  return next_route_points;
+}
+
+std::vector<SidewalkRoutePoint> Sidewalk::GetPreviousRoutePoints(const std::vector<SidewalkRoutePoint>& route_points, float lookahead_distance) const {
+  std::vector<SidewalkRoutePoint> previous_route_points(route_points.size());
+  ParallelForEach(route_points.size(), [&](size_t i) {
+    previous_route_points[i] = GetPreviousRoutePoint(route_points[i], lookahead_distance);
+  });
+  return previous_route_points;
+}
+
+std::vector<boost::optional<SidewalkRoutePoint>> Sidewalk::GetAdjacentRoutePoints(const std::vector<SidewalkRoutePoint>& route_points, float max_cross_distance) const {
+  std::vector<boost::optional<SidewalkRoutePoint>> adjacent_route_points(route_points.size());
+  ParallelForEach(route_points.size(), [&](size_t i) {
+    adjacent_route_points[i] = GetAdjacentRoutePoint(route_points[i], max_cross_distance);
+  });
+  return adjacent_route_points;
+}
 
-  return results.size() > 0;
+std::vector<bool> Sidewalk::IntersectsMany(const std::vector<geom::Segment2D>& segments) const {
+  // std::vector<bool> packs bits, so concurrent writes go to bytes first.
+  std::vector<uint8_t> intersects(segments.size());
+  ParallelForEach(segments.size(), [&](size_t i) {
+    intersects[i] = Intersects(segments[i]);
+  });
+  return std::vector<bool>(intersects.begin(), intersects.end());
 }
 
 }
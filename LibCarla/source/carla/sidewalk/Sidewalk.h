@@ -22,6 +22,8 @@ struct SidewalkRoutePoint {
   size_t polygon_id;
   size_t segment_id;
   float offset;
+  // Distance along the polygon ring from its first vertex.
+  float arc_length;
 };
 
 class Sidewalk {
@@ -31,6 +33,7 @@ public:
   Sidewalk(const std::vector<std::vector<geom::Vector2D>>& polygons);
 
   const std::vector<std::vector<geom::Vector2D>>& Polygons() const { return _polygons; }
+  float RingLength(size_t polygon_id) const { return _cumulative_lengths[polygon_id].back(); }
 
   occupancy::OccupancyMap CreateOccupancyMap(float width) const;
   segments::SegmentMap CreateSegmentMap() const;
@@ -42,6 +45,15 @@ public:
   boost::optional<SidewalkRoutePoint> GetAdjacentRoutePoint(const SidewalkRoutePoint& route_point, float max_cross_distance) const;
   bool Intersects(const geom::Segment2D& segment) const;
 
+  // Batch versions of the queries above. Large batches are split into chunks
+  // evaluated in parallel; results are in input order.
+  std::vector<geom::Vector2D> GetRoutePointPositions(const std::vector<SidewalkRoutePoint>& route_points) const;
+  std::vector<SidewalkRoutePoint> GetNearestRoutePoints(const std::vector<geom::Vector2D>& positions) const;
+  std::vector<SidewalkRoutePoint> GetNextRoutePoints(const std::vector<SidewalkRoutePoint>& route_points, float lookahead_distance) const;
+  std::vector<SidewalkRoutePoint> GetPreviousRoutePoints(const std::vector<SidewalkRoutePoint>& route_points, float lookahead_distance) const;
+  std::vector<boost::optional<SidewalkRoutePoint>> GetAdjacentRoutePoints(const std::vector<SidewalkRoutePoint>& route_points, float max_cross_distance) const;
+  std::vector<bool> IntersectsMany(const std::vector<geom::Segment2D>& segments) const;
+
 private:
   
   typedef boost::geometry::model::point<float, 2, boost::geometry::cs::cartesian> rt_point_t;
@@ -50,8 +62,13 @@ private:
   typedef boost::geometry::index::rtree<rt_value_t, boost::geometry::index::rstar<16> > rt_tree_t;
  
   std::vector<std::vector<geom::Vector2D>> _polygons;
+  // For each polygon, the arc length at the start of each segment, followed
+  // by the length of the ring.
+  std::vector<std::vector<float>> _cumulative_lengths;
   rt_tree_t _segments_index;
 
+  SidewalkRoutePoint MakeRoutePoint(size_t polygon_id, size_t segment_id, float offset) const;
+
 };
 
 }
@@ -1,87 +1,206 @@
 #include "SumoNetwork.h"
+#include "carla/Exception.h"
 #include "carla/geom/Math.h"
 #include "carla/geom/Triangulation.h"
-#include <boost/algorithm/string.hpp>
+#include <boost/filesystem/operations.hpp>
 #include <pugixml/pugixml.hpp>
-#include <string>
-#include <sstream>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 
 namespace carla {
 namespace sumonetwork {
 
-static std::vector<geom::Vector2D> parse_shape_list(const std::string& s) {
-  if (s.empty()) return {};
-
-  std::vector<std::string> split_list;
-  boost::split(
-      split_list, 
-      s,
-      boost::is_any_of(", "),
-      boost::token_compress_on);
+// Parses the next float from a separated list, advancing the cursor.
+// Returns false when the list is exhausted.
+static bool parse_float(const char*& it, float& value) {
+  while (*it == ' ' || *it == ',') it++;
+  if (*it == '\0') return false;
+
+  char* end;
+  value = std::strtof(it, &end);
+  if (end == it) return false;
+  it = end;
+  return true;
+}
 
+static std::vector<geom::Vector2D> parse_shape_list(const char* s) {
   std::vector<geom::Vector2D> position_list;
-  for (size_t i = 0; i < split_list.size(); i += 2) {
-    position_list.emplace_back(
-        std::stof(split_list[i + 1]), // Swap for SUMO -> CARLA.
-        std::stof(split_list[i]));    // Swap for SUMO -> CARLA.
+  float x, y;
+  while (parse_float(s, x) && parse_float(s, y)) {
+    position_list.emplace_back(y, x); // Swap for SUMO -> CARLA.
   }
-
   return position_list;
 }
 
-static geom::Vector2D parse_coordinates(const std::string& s) {
-  if (s.empty()) return geom::Vector2D(0, 0);
-
-  std::vector<std::string> split_list;
-  boost::split(
-      split_list, 
-      s,
-      boost::is_any_of(","),
-      boost::token_compress_on);
+static geom::Vector2D parse_coordinates(const char* s) {
+  float x = 0, y = 0;
+  if (parse_float(s, x)) parse_float(s, y);
 
   // Swap x, y for SUMO -> CARLA.
-  return geom::Vector2D(std::stof(split_list[1]), std::stof(split_list[0]));
+  return geom::Vector2D(y, x);
 }
 
-static std::pair<geom::Vector2D, geom::Vector2D> parse_bounds(const std::string& s) {
-  std::vector<std::string> split_list;
-  boost::split(
-      split_list, 
-      s,
-      boost::is_any_of(","),
-      boost::token_compress_on);
+static std::pair<geom::Vector2D, geom::Vector2D> parse_bounds(const char* s) {
+  float values[4] = {0, 0, 0, 0};
+  for (size_t i = 0; i < 4 && parse_float(s, values[i]); i++);
 
   // Swap x, y for SUMO -> CARLA.
   return std::make_pair(
-      geom::Vector2D(std::stof(split_list[1]), std::stof(split_list[0])),
-      geom::Vector2D(std::stof(split_list[3]), std::stof(split_list[2])));
+      geom::Vector2D(values[1], values[0]),
+      geom::Vector2D(values[3], values[2]));
 }
 
-static std::vector<std::string> parse_string_list(const std::string& s) {
-  if (s.empty()) return {};
-  
+static std::vector<std::string> parse_string_list(const char* s) {
   std::vector<std::string> split_list;
-  boost::split(
-      split_list, 
-      s,
-      boost::is_any_of(" "),
-      boost::token_compress_on);
+  while (true) {
+    while (*s == ' ') s++;
+    if (*s == '\0') break;
+    const char* token_start = s;
+    while (*s != ' ' && *s != '\0') s++;
+    split_list.emplace_back(token_start, s);
+  }
   return split_list;
 }
 
-SumoNetwork SumoNetwork::Load(const std::string& file) {
+// FNV-1a hash of the network file contents, used to key the compiled cache.
+static uint64_t hash_contents(const std::vector<char>& contents) {
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : contents) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// Compiled cache layout (native endianness): magic, version, content hash,
+// followed by the network fields in declaration order. Strings and vectors
+// are prefixed by their uint32_t size.
+static constexpr char CACHE_MAGIC[4] = {'S', 'N', 'E', 'T'};
+static constexpr uint32_t CACHE_VERSION = 2;
+
+class CacheWriter {
+public:
+
+  void Write(const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    _buffer.insert(_buffer.end(), bytes, bytes + size);
+  }
+
+  template <typename T>
+  void Write(const T& value) { 
+    static_assert(std::is_trivially_copyable<T>::value, "Value must be trivially copyable");
+    Write(&value, sizeof(T));
+  }
+
+  void Write(const std::string& value) {
+    Write(static_cast<uint32_t>(value.size()));
+    Write(value.data(), value.size());
+  }
+
+  void Write(const geom::Vector2D& value) {
+    Write(value.x);
+    Write(value.y);
+  }
+
+  template <typename T>
+  void Write(const std::vector<T>& values) {
+    Write(static_cast<uint32_t>(values.size()));
+    for (const T& value : values) Write(value);
+  }
+
+  const std::vector<char>& Buffer() const { return _buffer; }
+
+private:
+
+  std::vector<char> _buffer;
+};
+
+class CacheReader {
+public:
+
+  CacheReader(const std::vector<char>& buffer)
+    : _it(buffer.data()), _end(buffer.data() + buffer.size()) { }
+
+  bool Read(void* data, size_t size) {
+    if (Remaining() < size) return false;
+    std::memcpy(data, _it, size);
+    _it += size;
+    return true;
+  }
+
+  template <typename T>
+  bool Read(T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "Value must be trivially copyable");
+    return Read(&value, sizeof(T));
+  }
+
+  bool Read(std::string& value) {
+    uint32_t size;
+    if (!Read(size) || Remaining() < size) return false;
+    value.assign(_it, size);
+    _it += size;
+    return true;
+  }
+
+  bool Read(geom::Vector2D& value) {
+    return Read(value.x) && Read(value.y);
+  }
+
+  template <typename T>
+  bool Read(std::vector<T>& values) {
+    uint32_t size;
+    if (!Read(size)) return false;
+    // Rejects sizes that cannot fit in the rest of the buffer before
+    // allocating, since a corrupt size could ask for gigabytes.
+    if (Remaining() / MinimumSize(static_cast<const T*>(nullptr)) < size) return false;
+    values.resize(size);
+    for (T& value : values) {
+      if (!Read(value)) return false;
+    }
+    return true;
+  }
+
+  bool AtEnd() const { return _it == _end; }
+
+  size_t Remaining() const { return static_cast<size_t>(_end - _it); }
+
+private:
+
+  // Fewest bytes a value of type T takes in the buffer.
+  template <typename T>
+  static constexpr size_t MinimumSize(const T*) { return sizeof(T); }
+
+  static constexpr size_t MinimumSize(const std::string*) { return sizeof(uint32_t); }
+
+  const char* _it;
+  const char* _end;
+};
+
+static std::vector<char> read_file(const std::string& file) {
   std::ifstream ifs;
-  ifs.open(file, std::ios::in);
-  std::ostringstream ss;
-  ss << ifs.rdbuf();
-  ifs.close();
+  ifs.open(file, std::ios::in | std::ios::binary);
+  return std::vector<char>{std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+}
 
-  pugi::xml_document xml;
-  xml.load_string(ss.str().c_str());
+SumoNetwork SumoNetwork::Load(const std::string& file, bool use_cache) {
+  std::vector<char> contents = read_file(file);
+  uint64_t hash = hash_contents(contents);
+  std::string cache_file = file + ".cache";
 
   SumoNetwork sumo_network;
-  
+  if (use_cache && sumo_network.LoadCache(cache_file, hash)) {
+    return sumo_network;
+  }
+
+  // Parsed in place, so contents must outlive the document.
+  pugi::xml_document xml;
+  xml.load_buffer_inplace(contents.data(), contents.size());
+
   pugi::xml_node net_node = xml.child("net");
  
   pugi::xml_node location_node = net_node.child("location");
@@ -102,11 +221,11 @@ SumoNetwork SumoNetwork::Load(const std::string& file) {
     edge.from = edge_node.attribute("from").value();
     edge.to = edge_node.attribute("to").value();
     edge.priority = edge_node.attribute("priority").as_int();
-    std::string function = edge_node.attribute("function").value();
-    if (function == "internal") edge.function = Function::Internal;
-    else if (function == "connector") edge.function = Function::Connector;
-    else if (function == "crossing") edge.function = Function::Crossing;
-    else if (function == "walkingarea") edge.function = Function::WalkingArea;
+    const char* function = edge_node.attribute("function").value();
+    if (std::strcmp(function, "internal") == 0) edge.function = Function::Internal;
+    else if (std::strcmp(function, "connector") == 0) edge.function = Function::Connector;
+    else if (std::strcmp(function, "crossing") == 0) edge.function = Function::Crossing;
+    else if (std::strcmp(function, "walkingarea") == 0) edge.function = Function::WalkingArea;
     else edge.function = Function::Normal;
 
     // Temp vector required because order of lanes read do not necessarily match
@@ -128,6 +247,7 @@ SumoNetwork SumoNetwork::Load(const std::string& file) {
       edge.lanes[lanes_temp[i].index] = std::move(lanes_temp[i]);
     }
 
+    sumo_network._edge_ids.emplace_back(edge.id);
     sumo_network._edges.emplace(edge.id, std::move(edge));
   }
 
@@ -154,44 +274,307 @@ SumoNetwork SumoNetwork::Load(const std::string& file) {
   
   sumo_network.Build();
 
+  if (use_cache) {
+    sumo_network.SaveCache(cache_file, hash);
+  }
+
   return sumo_network;
 }
 
+bool SumoNetwork::LoadCache(const std::string& file, uint64_t hash) {
+  if (!boost::filesystem::exists(file)) return false;
+
+  std::vector<char> contents = read_file(file);
+  CacheReader reader(contents);
+
+  char magic[sizeof(CACHE_MAGIC)];
+  uint32_t version;
+  uint64_t cache_hash;
+  if (!reader.Read(magic, sizeof(magic)) || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0) return false;
+  if (!reader.Read(version) || version != CACHE_VERSION) return false;
+  if (!reader.Read(cache_hash) || cache_hash != hash) return false;
+
+  bool ok = reader.Read(_offset) && reader.Read(_bounds_min) && reader.Read(_bounds_max) &&
+      reader.Read(_original_bounds_min) && reader.Read(_original_bounds_max);
+
+  // Edges are stored in handle order.
+  uint32_t num_edges = 0;
+  ok = ok && reader.Read(num_edges);
+  for (uint32_t i = 0; ok && i < num_edges; i++) {
+    Edge edge;
+    uint32_t num_lanes = 0;
+    ok = reader.Read(edge.id) && reader.Read(edge.from) && reader.Read(edge.to) &&
+        reader.Read(edge.priority) && reader.Read(edge.function) && reader.Read(num_lanes);
+    ok = ok && num_lanes <= reader.Remaining();
+    edge.lanes.resize(ok ? num_lanes : 0);
+    for (Lane& lane : edge.lanes) {
+      ok = ok && reader.Read(lane.id) && reader.Read(lane.index) && reader.Read(lane.speed) &&
+          reader.Read(lane.length) && reader.Read(lane.shape);
+    }
+    if (ok) {
+      _edge_handles.emplace(edge.id, static_cast<uint32_t>(_edge_ids.size()));
+      _edge_ids.emplace_back(edge.id);
+      _edges.emplace(edge.id, std::move(edge));
+    }
+  }
+
+  uint32_t num_junctions = 0;
+  ok = ok && reader.Read(num_junctions);
+  for (uint32_t i = 0; ok && i < num_junctions; i++) {
+    Junction junction;
+    ok = reader.Read(junction.id) && reader.Read(junction.x) && reader.Read(junction.y) &&
+        reader.Read(junction.inc_lanes) && reader.Read(junction.int_lanes) && reader.Read(junction.shape);
+    if (ok) _junctions.emplace(junction.id, std::move(junction));
+  }
+
+  uint32_t num_connections = 0;
+  ok = ok && reader.Read(num_connections) && num_connections <= reader.Remaining();
+  _connections.resize(ok ? num_connections : 0);
+  for (Connection& connection : _connections) {
+    ok = ok && reader.Read(connection.from) && reader.Read(connection.to) &&
+        reader.Read(connection.from_lane) && reader.Read(connection.to_lane) && reader.Read(connection.via);
+  }
+
+  ok = ok && reader.Read(_edge_lane_offsets) && reader.Read(_lane_edges) &&
+      reader.Read(_lane_vertex_offsets) && reader.Read(_vertices) && reader.Read(_segment_lengths) &&
+      reader.Read(_lane_successor_offsets) && reader.Read(_lane_successors);
+
+  // Entries are stored in the leaf order of the packed tree, so re-packing
+  // them is cheap compared to building the tree from scratch.
+  uint32_t num_index_entries = 0;
+  ok = ok && reader.Read(num_index_entries) && num_index_entries <= reader.Remaining();
+  std::vector<rt_value_t> index_entries(ok ? num_index_entries : 0);
+  for (rt_value_t& entry : index_entries) {
+    geom::Vector2D start, end;
+    uint32_t lane_handle, segment_index;
+    ok = ok && reader.Read(start) && reader.Read(end) && reader.Read(lane_handle) && reader.Read(segment_index);
+    entry = rt_value_t(
+        rt_segment_t(rt_point_t(start.x, start.y), rt_point_t(end.x, end.y)),
+        std::make_pair(lane_handle, segment_index));
+  }
+  
+  if (!ok || !reader.AtEnd()) {
+    *this = SumoNetwork();
+    return false;
+  }
+
+  _segments_index = rt_tree_t(index_entries);
+  return true;
+}
+
+void SumoNetwork::SaveCache(const std::string& file, uint64_t hash) const {
+  CacheWriter writer;
+  writer.Write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  writer.Write(CACHE_VERSION);
+  writer.Write(hash);
+
+  writer.Write(_offset);
+  writer.Write(_bounds_min);
+  writer.Write(_bounds_max);
+  writer.Write(_original_bounds_min);
+  writer.Write(_original_bounds_max);
+
+  writer.Write(static_cast<uint32_t>(_edge_ids.size()));
+  for (const std::string& edge_id : _edge_ids) {
+    const Edge& edge = _edges.at(edge_id);
+    writer.Write(edge.id);
+    writer.Write(edge.from);
+    writer.Write(edge.to);
+    writer.Write(edge.priority);
+    writer.Write(edge.function);
+    writer.Write(static_cast<uint32_t>(edge.lanes.size()));
+    for (const Lane& lane : edge.lanes) {
+      writer.Write(lane.id);
+      writer.Write(lane.index);
+      writer.Write(lane.speed);
+      writer.Write(lane.length);
+      writer.Write(lane.shape);
+    }
+  }
+
+  writer.Write(static_cast<uint32_t>(_junctions.size()));
+  for (const auto& junction_entry : _junctions) {
+    const Junction& junction = junction_entry.second;
+    writer.Write(junction.id);
+    writer.Write(junction.x);
+    writer.Write(junction.y);
+    writer.Write(junction.inc_lanes);
+    writer.Write(junction.int_lanes);
+    writer.Write(junction.shape);
+  }
+
+  writer.Write(static_cast<uint32_t>(_connections.size()));
+  for (const Connection& connection : _connections) {
+    writer.Write(connection.from);
+    writer.Write(connection.to);
+    writer.Write(connection.from_lane);
+    writer.Write(connection.to_lane);
+    writer.Write(connection.via);
+  }
+
+  writer.Write(_edge_lane_offsets);
+  writer.Write(_lane_edges);
+  writer.Write(_lane_vertex_offsets);
+  writer.Write(_vertices);
+  writer.Write(_segment_lengths);
+  writer.Write(_lane_successor_offsets);
+  writer.Write(_lane_successors);
+
+  writer.Write(static_cast<uint32_t>(_segments_index.size()));
+  for (auto it = _segments_index.begin(); it != _segments_index.end(); ++it) {
+    writer.Write(geom::Vector2D(boost::geometry::get<0, 0>(it->first), boost::geometry::get<0, 1>(it->first)));
+    writer.Write(geom::Vector2D(boost::geometry::get<1, 0>(it->first), boost::geometry::get<1, 1>(it->first)));
+    writer.Write(it->second.first);
+    writer.Write(it->second.second);
+  }
+
+  // Written to a temporary file and renamed, so that concurrent loaders never
+  // observe a partial cache. Failing to write the cache is not an error.
+  boost::system::error_code error;
+  boost::filesystem::path temp_file = boost::filesystem::unique_path(file + ".%%%%-%%%%.tmp", error);
+  if (error) return;
+  {
+    std::ofstream ofs;
+    ofs.open(temp_file.string(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!ofs) return;
+    ofs.write(writer.Buffer().data(), static_cast<std::streamsize>(writer.Buffer().size()));
+    if (!ofs) {
+      ofs.close();
+      boost::filesystem::remove(temp_file, error);
+      return;
+    }
+  }
+  boost::filesystem::rename(temp_file, file, error);
+  if (error) {
+    boost::filesystem::remove(temp_file, error);
+  }
+}
+
 void SumoNetwork::Build() {
-  std::vector<rt_value_t> index_entries;
-  for (const auto& edge_entry : _edges) {
-    const Edge& edge = edge_entry.second;
+  std::unordered_map<std::string, uint32_t> lane_handles;
+
+  _edge_handles.clear();
+  _edge_lane_offsets.assign(1, 0);
+  _lane_edges.clear();
+  _lane_vertex_offsets.assign(1, 0);
+  _vertices.clear();
+  _segment_lengths.clear();
+
+  for (uint32_t edge_handle = 0; edge_handle < _edge_ids.size(); edge_handle++) {
+    const Edge& edge = _edges.at(_edge_ids[edge_handle]);
+    _edge_handles.emplace(edge.id, edge_handle);
     for (const Lane& lane : edge.lanes) {
-      for (size_t i = 0; i < lane.shape.size() - 1; i++) {
-        index_entries.emplace_back(
-            rt_segment_t(
-              rt_point_t(lane.shape[i].x, lane.shape[i].y),
-              rt_point_t(lane.shape[i + 1].x, lane.shape[i + 1].y)),
-            std::make_tuple(edge.id, lane.index, i));
+      lane_handles.emplace(lane.id, static_cast<uint32_t>(_lane_edges.size()));
+      _lane_edges.emplace_back(edge_handle);
+      for (size_t i = 0; i < lane.shape.size(); i++) {
+        _vertices.emplace_back(lane.shape[i]);
+        _segment_lengths.emplace_back(i + 1 < lane.shape.size() ? (lane.shape[i + 1] - lane.shape[i]).Length() : 0.0f);
       }
-      _lane_to_parent_edge_map[lane.id] = std::make_pair(edge.id, lane.index);
-      _outgoing_connections_map.emplace(lane.id, std::vector<size_t>());
+      _lane_vertex_offsets.emplace_back(static_cast<uint32_t>(_vertices.size()));
     }
+    _edge_lane_offsets.emplace_back(static_cast<uint32_t>(_lane_edges.size()));
   }
-  _segments_index = rt_tree_t(index_entries);
 
-  for (size_t i = 0; i < _connections.size(); i++) {
-    const Connection& connection = _connections[i];
+  std::vector<rt_value_t> index_entries;
+  for (uint32_t lane_handle = 0; lane_handle < _lane_edges.size(); lane_handle++) {
+    uint32_t vertex_begin = _lane_vertex_offsets[lane_handle];
+    uint32_t vertex_end = _lane_vertex_offsets[lane_handle + 1];
+    for (uint32_t i = vertex_begin; i + 1 < vertex_end; i++) {
+      index_entries.emplace_back(
+          rt_segment_t(
+            rt_point_t(_vertices[i].x, _vertices[i].y),
+            rt_point_t(_vertices[i + 1].x, _vertices[i + 1].y)),
+          std::make_pair(lane_handle, i - vertex_begin));
+    }
+  }
+  _segments_index = rt_tree_t(index_entries);
 
-    if (!connection.via.empty()){
-      _internal_edge_to_connection_map[connection.via] = i;
+  // Successor lists in CSR form, keeping the order of connections in the file.
+  std::vector<std::pair<uint32_t, uint32_t>> successors;
+  for (const Connection& connection : _connections) {
+    auto from_edge = _edge_handles.find(connection.from);
+    if (from_edge == _edge_handles.end()) continue;
+    if (connection.from_lane >= _edge_lane_offsets[from_edge->second + 1] - _edge_lane_offsets[from_edge->second]) continue;
+
+    uint32_t successor;
+    if (connection.via.empty()) {
+      auto to_edge = _edge_handles.find(connection.to);
+      if (to_edge == _edge_handles.end()) continue;
+      if (connection.to_lane >= _edge_lane_offsets[to_edge->second + 1] - _edge_lane_offsets[to_edge->second]) continue;
+      successor = GetLaneHandle(to_edge->second, connection.to_lane);
+    } else {
+      auto via_lane = lane_handles.find(connection.via);
+      if (via_lane == lane_handles.end()) continue;
+      successor = via_lane->second;
     }
-    _outgoing_connections_map.at(_edges[connection.from].lanes[connection.from_lane].id).emplace_back(i); 
+    successors.emplace_back(GetLaneHandle(from_edge->second, connection.from_lane), successor);
+  }
+
+  _lane_successor_offsets.assign(_lane_edges.size() + 1, 0);
+  for (const auto& successor : successors) {
+    _lane_successor_offsets[successor.first + 1]++;
+  }
+  for (size_t i = 0; i < _lane_edges.size(); i++) {
+    _lane_successor_offsets[i + 1] += _lane_successor_offsets[i];
+  }
+  _lane_successors.resize(successors.size());
+  std::vector<uint32_t> fill(_lane_successor_offsets.begin(), _lane_successor_offsets.end() - 1);
+  for (const auto& successor : successors) {
+    _lane_successors[fill[successor.first]++] = successor.second;
   }
 }
+
+IndexedRoutePoint SumoNetwork::ToIndexedRoutePoint(const RoutePoint& route_point) const {
+  return IndexedRoutePoint{
+    GetLaneHandle(_edge_handles.at(route_point.edge), route_point.lane),
+    route_point.segment,
+    route_point.offset};
+}
+
+RoutePoint SumoNetwork::ToRoutePoint(const IndexedRoutePoint& route_point) const {
+  return RoutePoint{
+    _edge_ids[_lane_edges[route_point.lane]],
+    GetLaneIndex(route_point.lane),
+    route_point.segment,
+    route_point.offset};
+}
   
 geom::Vector2D SumoNetwork::GetRoutePointPosition(const RoutePoint& route_point) const {
-  const geom::Vector2D& start = _edges.at(route_point.edge).lanes[route_point.lane].shape[route_point.segment];
-  const geom::Vector2D& end = _edges.at(route_point.edge).lanes[route_point.lane].shape[route_point.segment + 1];
-  return start + route_point.offset * (end - start).MakeUnitVector();
+  return GetRoutePointPosition(ToIndexedRoutePoint(route_point));
 }
   
 RoutePoint SumoNetwork::GetNearestRoutePoint(const geom::Vector2D& position) const {
+  return ToRoutePoint(GetNearestIndexedRoutePoint(position));
+}
+
+std::vector<RoutePoint> SumoNetwork::GetNextRoutePoints(const RoutePoint& route_point, float distance) const {
+  std::vector<RoutePoint> next_route_points;
+  for (const IndexedRoutePoint& next_route_point : GetNextRoutePoints(ToIndexedRoutePoint(route_point), distance)) {
+    next_route_points.emplace_back(ToRoutePoint(next_route_point));
+  }
+  return next_route_points;
+}
+
+std::vector<std::vector<RoutePoint>> SumoNetwork::GetNextRoutePaths(const RoutePoint& route_point, size_t num_points, float interval) const {
+  std::vector<std::vector<RoutePoint>> result;
+  for (const std::vector<IndexedRoutePoint>& path : GetNextRoutePaths(ToIndexedRoutePoint(route_point), num_points, interval)) {
+    result.emplace_back();
+    result.back().reserve(path.size());
+    for (const IndexedRoutePoint& path_route_point : path) {
+      result.back().emplace_back(ToRoutePoint(path_route_point));
+    }
+  }
+  return result;
+}
+
+geom::Vector2D SumoNetwork::GetRoutePointPosition(const IndexedRoutePoint& route_point) const {
+  uint32_t vertex = _lane_vertex_offsets[route_point.lane] + route_point.segment;
+  const geom::Vector2D& start = _vertices[vertex];
+  const geom::Vector2D& end = _vertices[vertex + 1];
+  return start + route_point.offset * (end - start).MakeUnitVector();
+}
+
+IndexedRoutePoint SumoNetwork::GetNearestIndexedRoutePoint(const geom::Vector2D& position) const {
   std::vector<rt_value_t> results;
   _segments_index.query(boost::geometry::index::nearest(rt_point_t(position.x, position.y), 1), std::back_inserter(results));
   rt_value_t& result = results[0];
@@ -209,101 +592,188 @@ RoutePoint SumoNetwork::GetNearestRoutePoint(const geom::Vector2D& position) con
       direction);
   t = std::max(0.0f, std::min((segment_end - segment_start).Length(), t));
   
-  return RoutePoint{
-    std::get<0>(result.second),
-    std::get<1>(result.second),
-    std::get<2>(result.second),
+  return IndexedRoutePoint{
+    result.second.first,
+    result.second.second,
     t};
 }
-  
-std::vector<RoutePoint> SumoNetwork::GetNextRoutePoints(const RoutePoint& route_point, float distance) const {
-  const Edge& edge = _edges.at(route_point.edge);
-  const Lane& lane = edge.lanes[route_point.lane];
-
-  const geom::Vector2D& segment_start = lane.shape[route_point.segment];
-  const geom::Vector2D& segment_end = lane.shape[route_point.segment + 1];
-  float segment_length = (segment_end - segment_start).Length();
-
-  if (route_point.offset + distance <= segment_length) {
-    return { {route_point.edge, route_point.lane, route_point.segment, route_point.offset + distance} };
-  } else if (route_point.segment < lane.shape.size() - 2) {
-    return GetNextRoutePoints(
-        RoutePoint{route_point.edge, route_point.lane, route_point.segment + 1, 0},
-        distance - (segment_length - route_point.offset));
-  } else {
-    std::vector<RoutePoint> next_route_points;
-    for (size_t connection_index : _outgoing_connections_map.at(lane.id)) {
-      const Connection& connection = _connections[connection_index];
-      if (connection.via == "") {
-        std::vector<RoutePoint> results = GetNextRoutePoints(
-            RoutePoint{connection.to, connection.to_lane, 0, 0},
-            distance - (segment_length - route_point.offset));
-        next_route_points.insert(next_route_points.end(), results.begin(), results.end());
+
+std::vector<IndexedRoutePoint> SumoNetwork::GetNextRoutePoints(const IndexedRoutePoint& route_point, float distance) const {
+  std::vector<IndexedRoutePoint> next_route_points;
+  GetNextRoutePoints(route_point, distance, next_route_points);
+  return next_route_points;
+}
+
+void SumoNetwork::GetNextRoutePoints(const IndexedRoutePoint& route_point, float distance, std::vector<IndexedRoutePoint>& next_route_points) const {
+  // Depth-first over successor lanes. Successors are pushed in reverse, so
+  // results follow the order of connections in the network file.
+  std::vector<std::pair<IndexedRoutePoint, float>> pending{{route_point, distance}};
+
+  while (!pending.empty()) {
+    IndexedRoutePoint current = pending.back().first;
+    float remaining = pending.back().second;
+    pending.pop_back();
+
+    uint32_t vertex_begin = _lane_vertex_offsets[current.lane];
+    uint32_t num_segments = _lane_vertex_offsets[current.lane + 1] - vertex_begin - 1;
+
+    while (true) {
+      float segment_length = _segment_lengths[vertex_begin + current.segment];
+      if (current.offset + remaining <= segment_length) {
+        next_route_points.emplace_back(IndexedRoutePoint{current.lane, current.segment, current.offset + remaining});
+        break;
+      }
+
+      remaining = remaining - (segment_length - current.offset);
+      if (current.segment + 1 < num_segments) {
+        current.segment++;
+        current.offset = 0;
       } else {
-        const std::pair<std::string, uint32_t>& lane_parent = _lane_to_parent_edge_map.at(connection.via);
-        std::vector<RoutePoint> results = GetNextRoutePoints(
-            RoutePoint{lane_parent.first, lane_parent.second, 0, 0},
-            distance - (segment_length - route_point.offset));
-        next_route_points.insert(next_route_points.end(), results.begin(), results.end());
+        for (uint32_t i = _lane_successor_offsets[current.lane + 1]; i-- > _lane_successor_offsets[current.lane];) {
+          pending.emplace_back(IndexedRoutePoint{_lane_successors[i], 0, 0}, remaining);
+        }
+        break;
       }
     }
+  }
+}
 
-    return next_route_points;
+std::vector<std::vector<IndexedRoutePoint>> SumoNetwork::GetNextRoutePaths(const IndexedRoutePoint& route_point, size_t num_points, float interval) const {
+  RoutePathTree tree = GetNextRoutePathTree(route_point, num_points, interval);
+
+  std::vector<std::vector<IndexedRoutePoint>> result;
+  result.reserve(tree.NumPaths());
+  for (size_t i = 0; i < tree.NumPaths(); i++) {
+    result.emplace_back(tree.GetPath(i));
   }
+  return result;
 }
 
-std::vector<std::vector<RoutePoint>> SumoNetwork::GetNextRoutePaths(const RoutePoint& route_point, size_t num_points, float interval) const {
-  if (num_points == 0) return {{route_point}};
+RoutePathTree SumoNetwork::GetNextRoutePathTree(const IndexedRoutePoint& route_point, size_t num_points, float interval) const {
+  RoutePathTree tree;
+  tree._num_points = num_points;
+  tree._nodes.push_back({route_point, 0});
+
+  // Expanded breadth first. Children of a node are contiguous and follow the
+  // order of their parents, so leaves end up in depth-first path order.
+  std::vector<IndexedRoutePoint> next_route_points;
+  size_t level_begin = 0;
+  size_t level_end = 1;
+  for (size_t depth = 0; depth < num_points && level_begin < level_end; depth++) {
+    for (size_t i = level_begin; i < level_end; i++) {
+      next_route_points.clear();
+      GetNextRoutePoints(tree._nodes[i].route_point, interval, next_route_points);
+      for (const IndexedRoutePoint& next_route_point : next_route_points) {
+        tree._nodes.push_back({next_route_point, static_cast<uint32_t>(i)});
+      }
+    }
+    level_begin = level_end;
+    level_end = tree._nodes.size();
+  }
 
-  std::vector<std::vector<RoutePoint>> result;
-  for (const RoutePoint& next_route_point : GetNextRoutePoints(route_point, interval)) {
-    std::vector<std::vector<RoutePoint>> next_route_paths = GetNextRoutePaths(next_route_point, num_points - 1, interval);
-    result.reserve(next_route_paths.size());
-    for (const std::vector<RoutePoint>& next_route_path : next_route_paths) {
-      result.emplace_back();
-      result.back().reserve(1 + next_route_path.size());
-      result.back().emplace_back(route_point);
-      result.back().insert(result.back().end(), next_route_path.begin(), next_route_path.end());
+  for (size_t i = level_begin; i < level_end; i++) {
+    tree._leaves.emplace_back(static_cast<uint32_t>(i));
+  }
+
+  return tree;
+}
+
+std::vector<IndexedRoutePoint> SumoNetwork::SampleNextRoutePath(const IndexedRoutePoint& route_point, size_t num_points, float interval, std::mt19937& rng) const {
+  std::vector<IndexedRoutePoint> path{route_point};
+  path.reserve(num_points + 1);
+
+  // candidates[i] holds the untried successors of path[i].
+  std::vector<std::vector<IndexedRoutePoint>> candidates;
+  candidates.reserve(num_points);
+
+  while (path.size() < num_points + 1) {
+    if (candidates.size() < path.size()) {
+      candidates.emplace_back();
+      GetNextRoutePoints(path.back(), interval, candidates.back());
     }
+
+    std::vector<IndexedRoutePoint>& next_route_points = candidates.back();
+    if (next_route_points.empty()) {
+      // Dead end; backtrack and try another successor of the previous point.
+      candidates.pop_back();
+      path.pop_back();
+      if (path.empty()) return {};
+      continue;
+    }
+
+    size_t choice = std::uniform_int_distribution<size_t>(0, next_route_points.size() - 1)(rng);
+    path.emplace_back(next_route_points[choice]);
+    next_route_points[choice] = next_route_points.back();
+    next_route_points.pop_back();
   }
-  return result;
+
+  return path;
+}
+
+std::vector<RoutePoint> SumoNetwork::SampleNextRoutePath(const RoutePoint& route_point, size_t num_points, float interval, std::mt19937& rng) const {
+  std::vector<RoutePoint> path;
+  for (const IndexedRoutePoint& path_route_point : SampleNextRoutePath(ToIndexedRoutePoint(route_point), num_points, interval, rng)) {
+    path.emplace_back(ToRoutePoint(path_route_point));
+  }
+  return path;
+}
+
+std::vector<IndexedRoutePoint> RoutePathTree::GetPath(size_t index) const {
+  if (index >= _leaves.size()) {
+    throw_exception(std::out_of_range("RoutePathTree: path index out of range"));
+  }
+  std::vector<IndexedRoutePoint> path(_num_points + 1);
+  uint32_t node = _leaves[index];
+  for (size_t i = _num_points + 1; i-- > 0;) {
+    path[i] = _nodes[node].route_point;
+    node = _nodes[node].parent;
+  }
+  return path;
+}
+
+std::vector<IndexedRoutePoint> RoutePathTree::Sample(std::mt19937& rng) const {
+  if (_leaves.empty()) {
+    throw_exception(std::out_of_range("RoutePathTree: cannot sample an empty tree"));
+  }
+  return GetPath(std::uniform_int_distribution<size_t>(0, _leaves.size() - 1)(rng));
 }
 
 occupancy::OccupancyMap SumoNetwork::CreateOccupancyMap() const {
-  occupancy::OccupancyMap occupancy_map;
+  std::vector<occupancy::OccupancyMap> occupancy_maps;
 
   for (const auto& edge_entry : _edges) {
     const Edge& edge = edge_entry.second;
     for (const Lane& lane : edge.lanes) {
       // Extra 0.10m to close any gap between lanes.
-      occupancy_map = occupancy_map.Union(occupancy::OccupancyMap(lane.shape, 4.10f));
+      occupancy_maps.emplace_back(lane.shape, 4.10f);
     }
   }
   
   for (const auto& junction_entry : _junctions) {
     const Junction& junction = junction_entry.second;
-    occupancy_map = occupancy_map.Union(occupancy::OccupancyMap(junction.shape));
+    occupancy_maps.emplace_back(junction.shape);
   }
 
-  return occupancy_map;
+  return occupancy::OccupancyMap::UnionAll(std::move(occupancy_maps));
 }
   
 occupancy::OccupancyMap SumoNetwork::CreateRoadmarkOccupancyMap() const {
-  occupancy::OccupancyMap roadmark_occupancy_map;
+  std::vector<occupancy::OccupancyMap> roadmark_occupancy_maps;
   for (const auto& edge_entry : _edges) {
     const Edge& edge = edge_entry.second;
     for (const Lane& lane : edge.lanes) {
-      roadmark_occupancy_map = roadmark_occupancy_map.Union(occupancy::OccupancyMap(lane.shape, 4.00f, 0.10f));
+      roadmark_occupancy_maps.emplace_back(lane.shape, 4.00f, 0.10f);
     }
   }
   
-  occupancy::OccupancyMap junction_occupancy_map;
+  std::vector<occupancy::OccupancyMap> junction_occupancy_maps;
   for (const auto& junction_entry : _junctions) {
     const Junction& junction = junction_entry.second;
-    junction_occupancy_map = junction_occupancy_map.Union(occupancy::OccupancyMap(junction.shape));
+    junction_occupancy_maps.emplace_back(junction.shape);
   }
 
-  return roadmark_occupancy_map.Difference(junction_occupancy_map);
+  return occupancy::OccupancyMap::UnionAll(std::move(roadmark_occupancy_maps)).Difference(
+      occupancy::OccupancyMap::UnionAll(std::move(junction_occupancy_maps)));
 }
 
 segments::SegmentMap SumoNetwork::CreateSegmentMap() const {
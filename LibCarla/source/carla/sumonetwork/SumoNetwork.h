@@ -10,6 +10,7 @@
 #include <boost/geometry/index/rtree.hpp>
 #include <boost/geometry/geometries/point_xy.hpp>
 #include <boost/geometry/geometries/geometries.hpp>
+#include <random>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -68,12 +69,52 @@ struct RoutePoint {
   float offset;
 };
 
+// Route point addressed by a dense lane handle instead of edge ID and lane index.
+// Handles are only valid for the SumoNetwork that produced them.
+struct IndexedRoutePoint {
+  uint32_t lane;
+  uint32_t segment;
+  float offset;
+};
+
+// All paths of a fixed number of points from a route point, stored as a tree
+// so that paths share their common prefixes. Paths are materialized lazily.
+class RoutePathTree {
+
+public:
+
+  size_t NumPaths() const { return _leaves.size(); }
+  size_t NumPoints() const { return _num_points; }
+
+  // Paths are ordered as returned by SumoNetwork::GetNextRoutePaths. Throws
+  // std::out_of_range if index is not less than NumPaths().
+  std::vector<IndexedRoutePoint> GetPath(size_t index) const;
+  // Uniformly samples one of the paths. Throws std::out_of_range if there are
+  // none.
+  std::vector<IndexedRoutePoint> Sample(std::mt19937& rng) const;
+
+  friend class SumoNetwork;
+
+private:
+
+  struct Node {
+    IndexedRoutePoint route_point;
+    uint32_t parent;
+  };
+
+  std::vector<Node> _nodes;
+  std::vector<uint32_t> _leaves;
+  size_t _num_points = 0u;
+};
 
 class SumoNetwork {
 
 public:
 
-  static SumoNetwork Load(const std::string& file);
+  // Parses the XML file. With use_cache, loads from the compiled cache next to
+  // the file (<file>.cache) if it matches the file contents, otherwise parses
+  // the XML and writes the cache.
+  static SumoNetwork Load(const std::string& file, bool use_cache = false);
 
   geom::Vector2D Offset() const { return _offset; }
   geom::Vector2D BoundsMin() const { return _bounds_min; }
@@ -84,11 +125,34 @@ public:
   const std::unordered_map<std::string, Junction>& Junctions() const { return _junctions; }
   const std::vector<Connection>& Connections() const { return _connections; }
 
+  uint32_t GetEdgeHandle(const std::string& edge_id) const { return _edge_handles.at(edge_id); }
+  const std::string& GetEdgeId(uint32_t edge_handle) const { return _edge_ids[edge_handle]; }
+  uint32_t GetLaneHandle(uint32_t edge_handle, uint32_t lane_index) const { return _edge_lane_offsets[edge_handle] + lane_index; }
+  uint32_t GetLaneEdgeHandle(uint32_t lane_handle) const { return _lane_edges[lane_handle]; }
+  uint32_t GetLaneIndex(uint32_t lane_handle) const { return lane_handle - _edge_lane_offsets[_lane_edges[lane_handle]]; }
+
+  IndexedRoutePoint ToIndexedRoutePoint(const RoutePoint& route_point) const;
+  RoutePoint ToRoutePoint(const IndexedRoutePoint& route_point) const;
+
   geom::Vector2D GetRoutePointPosition(const RoutePoint& route_point) const;
   RoutePoint GetNearestRoutePoint(const geom::Vector2D& position) const;
   std::vector<RoutePoint> GetNextRoutePoints(const RoutePoint& route_point, float distance) const;
   std::vector<std::vector<RoutePoint>> GetNextRoutePaths(const RoutePoint& route_point, size_t num_points, float interval) const;
 
+  geom::Vector2D GetRoutePointPosition(const IndexedRoutePoint& route_point) const;
+  IndexedRoutePoint GetNearestIndexedRoutePoint(const geom::Vector2D& position) const;
+  std::vector<IndexedRoutePoint> GetNextRoutePoints(const IndexedRoutePoint& route_point, float distance) const;
+  // Appends to next_route_points instead of returning a new vector.
+  void GetNextRoutePoints(const IndexedRoutePoint& route_point, float distance, std::vector<IndexedRoutePoint>& next_route_points) const;
+  std::vector<std::vector<IndexedRoutePoint>> GetNextRoutePaths(const IndexedRoutePoint& route_point, size_t num_points, float interval) const;
+  RoutePathTree GetNextRoutePathTree(const IndexedRoutePoint& route_point, size_t num_points, float interval) const;
+
+  // Samples a path of num_points points after route_point by choosing a random
+  // successor at every step, backtracking out of dead ends. Returns an empty
+  // path if there is no path of that length.
+  std::vector<IndexedRoutePoint> SampleNextRoutePath(const IndexedRoutePoint& route_point, size_t num_points, float interval, std::mt19937& rng) const;
+  std::vector<RoutePoint> SampleNextRoutePath(const RoutePoint& route_point, size_t num_points, float interval, std::mt19937& rng) const;
+
   occupancy::OccupancyMap CreateOccupancyMap() const;
   occupancy::OccupancyMap CreateRoadmarkOccupancyMap() const;
   segments::SegmentMap CreateSegmentMap() const;
@@ -98,7 +162,7 @@ private:
   typedef boost::geometry::model::point<float, 2, boost::geometry::cs::cartesian> rt_point_t;
   typedef boost::geometry::model::segment<rt_point_t> rt_segment_t;
   typedef boost::geometry::model::box<rt_point_t> rt_box_t;
-  typedef std::pair<rt_segment_t, std::tuple<std::string, uint32_t, uint32_t>> rt_value_t; // Segment -> (Edge, Lane Index, Segment Index)
+  typedef std::pair<rt_segment_t, std::pair<uint32_t, uint32_t>> rt_value_t; // Segment -> (Lane Handle, Segment Index)
   typedef boost::geometry::index::rtree<rt_value_t, boost::geometry::index::rstar<16> > rt_tree_t;
 
   geom::Vector2D _offset;
@@ -111,12 +175,30 @@ private:
   std::unordered_map<std::string, Junction> _junctions;
   std::vector<Connection> _connections;
 
+  // Edge handles follow the order of edges in the network file.
+  std::vector<std::string> _edge_ids;
+  std::unordered_map<std::string, uint32_t> _edge_handles;
+
+  // Lanes of edge e have handles [_edge_lane_offsets[e], _edge_lane_offsets[e + 1]).
+  std::vector<uint32_t> _edge_lane_offsets;
+  std::vector<uint32_t> _lane_edges;
+
+  // Vertices of lane l are [_lane_vertex_offsets[l], _lane_vertex_offsets[l + 1]).
+  // _segment_lengths[v] is the length of the segment starting at vertex v.
+  std::vector<uint32_t> _lane_vertex_offsets;
+  std::vector<geom::Vector2D> _vertices;
+  std::vector<float> _segment_lengths;
+
+  // Successor lanes of lane l (through internal lanes, if any) are
+  // _lane_successors[_lane_successor_offsets[l], _lane_successor_offsets[l + 1]).
+  std::vector<uint32_t> _lane_successor_offsets;
+  std::vector<uint32_t> _lane_successors;
+
   rt_tree_t _segments_index;
-  std::unordered_map<std::string, std::pair<std::string, uint32_t>> _lane_to_parent_edge_map;
-  std::unordered_map<std::string, size_t> _internal_edge_to_connection_map;
-  std::unordered_map<std::string, std::vector<size_t>> _outgoing_connections_map;
 
   void Build();
+  bool LoadCache(const std::string& file, uint64_t hash);
+  void SaveCache(const std::string& file, uint64_t hash) const;
 };
 
 }
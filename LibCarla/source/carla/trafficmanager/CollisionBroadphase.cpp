@@ -0,0 +1,109 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/trafficmanager/CollisionBroadphase.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace carla {
+namespace traffic_manager {
+
+namespace CollisionBroadphaseConstants {
+
+  /// Largest number of cells a box is listed in.
+  static const int64_t MAXIMUM_CELLS_PER_BOX = 1024;
+
+} // namespace CollisionBroadphaseConstants
+
+  using namespace CollisionBroadphaseConstants;
+
+  CollisionBroadphase::CollisionBroadphase(double cell_size) : cell_size(cell_size) {}
+
+  int32_t CollisionBroadphase::CellCoordinate(double value) const {
+    return static_cast<int32_t>(std::floor(value / cell_size));
+  }
+
+  uint64_t CollisionBroadphase::MakeKey(int32_t x, int32_t y) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+  }
+
+  void CollisionBroadphase::Build(const std::vector<BroadphaseBox> &boxes) {
+
+    this->boxes = boxes;
+    cell_boxes.clear();
+    oversized_boxes.clear();
+
+    for (uint32_t i = 0u; i < boxes.size(); ++i) {
+      const BroadphaseBox &box = boxes[i];
+      if (box.IsEmpty()) {
+        continue;
+      }
+      const int32_t min_x = CellCoordinate(box.min_x);
+      const int32_t min_y = CellCoordinate(box.min_y);
+      const int32_t max_x = CellCoordinate(box.max_x);
+      const int32_t max_y = CellCoordinate(box.max_y);
+      const int64_t number_of_cells =
+          (static_cast<int64_t>(max_x) - min_x + 1) * (static_cast<int64_t>(max_y) - min_y + 1);
+      if (number_of_cells > MAXIMUM_CELLS_PER_BOX) {
+        oversized_boxes.push_back(i);
+        continue;
+      }
+      for (int32_t x = min_x; x <= max_x; ++x) {
+        for (int32_t y = min_y; y <= max_y; ++y) {
+          cell_boxes.emplace_back(MakeKey(x, y), i);
+        }
+      }
+    }
+    std::sort(cell_boxes.begin(), cell_boxes.end());
+  }
+
+  void CollisionBroadphase::Query(const BroadphaseBox &query, std::vector<uint32_t> &result) const {
+
+    if (query.IsEmpty()) {
+      return;
+    }
+
+    const int32_t min_x = CellCoordinate(query.min_x);
+    const int32_t min_y = CellCoordinate(query.min_y);
+    const int32_t max_x = CellCoordinate(query.max_x);
+    const int32_t max_y = CellCoordinate(query.max_y);
+    const int64_t number_of_cells =
+        (static_cast<int64_t>(max_x) - min_x + 1) * (static_cast<int64_t>(max_y) - min_y + 1);
+
+    if (number_of_cells > MAXIMUM_CELLS_PER_BOX) {
+      // Visiting every cell would cost more than testing every box.
+      for (uint32_t i = 0u; i < boxes.size(); ++i) {
+        if (!boxes[i].IsEmpty() && boxes[i].Intersects(query)) {
+          result.push_back(i);
+        }
+      }
+    } else {
+      for (int32_t x = min_x; x <= max_x; ++x) {
+        for (int32_t y = min_y; y <= max_y; ++y) {
+          const uint64_t key = MakeKey(x, y);
+          auto it = std::lower_bound(cell_boxes.begin(), cell_boxes.end(), std::make_pair(key, 0u));
+          for (; it != cell_boxes.end() && it->first == key; ++it) {
+            if (boxes[it->second].Intersects(query)) {
+              result.push_back(it->second);
+            }
+          }
+        }
+      }
+      for (const uint32_t i : oversized_boxes) {
+        if (boxes[i].Intersects(query)) {
+          result.push_back(i);
+        }
+      }
+    }
+
+    // A box overlapping several of the visited cells is found once per cell.
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+  }
+
+} // namespace traffic_manager
+} // namespace carla
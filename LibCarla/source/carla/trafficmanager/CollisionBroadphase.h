@@ -0,0 +1,74 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace carla {
+namespace traffic_manager {
+
+  /// Axis-aligned box in the horizontal plane. A box with min_x > max_x is
+  /// empty.
+  struct BroadphaseBox {
+    double min_x;
+    double min_y;
+    double max_x;
+    double max_y;
+
+    bool IsEmpty() const {
+      return min_x > max_x || min_y > max_y;
+    }
+
+    bool Intersects(const BroadphaseBox &other) const {
+      return min_x <= other.max_x && other.min_x <= max_x &&
+             min_y <= other.max_y && other.min_y <= max_y;
+    }
+
+    /// Returns the box grown by margin on every side.
+    BroadphaseBox Expand(double margin) const {
+      return BroadphaseBox{min_x - margin, min_y - margin, max_x + margin, max_y + margin};
+    }
+  };
+
+  /// Uniform grid over a set of boxes, used to find the boxes near a query
+  /// box without testing all of them. Boxes are referred to by their index in
+  /// the list the grid was built from, and each is listed in every cell it
+  /// overlaps. The grid is rebuilt from scratch and is read-only afterwards,
+  /// so any number of threads may query it.
+  class CollisionBroadphase {
+
+  public:
+
+    explicit CollisionBroadphase(double cell_size);
+
+    /// Empty boxes are left out of the grid.
+    void Build(const std::vector<BroadphaseBox> &boxes);
+
+    /// Adds to result the indices of the boxes intersecting the query box.
+    /// result is left sorted and without duplicates, so several queries can
+    /// be gathered in it.
+    void Query(const BroadphaseBox &query, std::vector<uint32_t> &result) const;
+
+  private:
+
+    int32_t CellCoordinate(double value) const;
+
+    static uint64_t MakeKey(int32_t x, int32_t y);
+
+    double cell_size;
+    std::vector<BroadphaseBox> boxes;
+    /// Cell key and box index for each cell a box overlaps, sorted by key.
+    std::vector<std::pair<uint64_t, uint32_t>> cell_boxes;
+    /// Boxes spanning too many cells to be listed in each, tested on every
+    /// query instead.
+    std::vector<uint32_t> oversized_boxes;
+  };
+
+} // namespace traffic_manager
+} // namespace carla
@@ -25,6 +25,8 @@ namespace CollisionStageConstants {
   static const float EPSILON_VELOCITY = 0.1f;
   static const float INTER_BBOX_DISTANCE_THRESHOLD = 0.3f;
   static const float BBOX_EXTENT_MULTIPLIER = 1.4f;
+  static const double GEODESIC_DISTANCE_THRESHOLD = 0.1;
+  static const double BROADPHASE_CELL_SIZE = 20.0;
 } // namespace CollisionStageConstants
 
   using namespace CollisionStageConstants;
@@ -33,13 +35,18 @@ namespace CollisionStageConstants {
       std::string stage_name,
       std::shared_ptr<LocalizationToCollisionMessenger> localization_messenger,
       std::shared_ptr<CollisionToPlannerMessenger> planner_messenger,
+      const InMemoryMap &local_map,
+      std::shared_ptr<WorkerPool> worker_pool,
       Parameters &parameters,
       cc::DebugHelper &debug_helper)
     : PipelineStage(stage_name),
       localization_messenger(localization_messenger),
       planner_messenger(planner_messenger),
+      local_map(local_map),
       parameters(parameters),
-      debug_helper(debug_helper) {
+      debug_helper(debug_helper),
+      worker_pool(worker_pool),
+      broadphase(BROADPHASE_CELL_SIZE) {
 
     // Initializing clock for checking unregistered actors periodically.
     last_world_actors_pass_instance = chr::system_clock::now();
@@ -47,79 +54,189 @@ namespace CollisionStageConstants {
     frame_selector = true;
     // Initializing the number of vehicles to zero in the beginning.
     number_of_vehicles = 0u;
-    // Initializing srand.
-    srand(static_cast<unsigned>(time(NULL)));
+    // Initializing the seed of vehicles' random generators.
+    random_seed = static_cast<uint64_t>(time(NULL));
+    // Allocating a candidate list for each chunk of vehicles.
+    collision_candidates.resize(this->worker_pool->GetMaximumNumberOfChunks());
   }
 
   CollisionStage::~CollisionStage() {}
 
   void CollisionStage::Action() {
 
+    if (localization_frame == nullptr) {
+      return;
+    }
+
     const auto current_planner_frame = frame_selector ? planner_frame_a : planner_frame_b;
 
-    // Looping over registered actors.
-    for (uint64_t i = 0u; i < number_of_vehicles && localization_frame != nullptr; ++i) {
+    TimePoint pass_start = chr::system_clock::now();
+    UpdateActorGeometries();
+    performance_diagnostics.RegisterSnippet("Collision broadphase", chr::system_clock::now() - pass_start);
 
-      LocalizationToCollisionData &data = localization_frame->at(i);
-      if (!data.actor->IsAlive()) {
-        continue;
+    // Looping over registered actors, split in chunks over the worker pool.
+    pass_start = chr::system_clock::now();
+    worker_pool->ParallelFor(number_of_vehicles, [&, this](uint64_t chunk, uint64_t begin, uint64_t end) {
+      for (uint64_t i = begin; i < end; ++i) {
+        UpdateHazard(i, current_planner_frame->at(i), collision_candidates.at(chunk));
+      }
+    });
+    performance_diagnostics.RegisterSnippet("Collision check", chr::system_clock::now() - pass_start);
+  }
+
+  void CollisionStage::UpdateActorGeometries() {
+
+    actor_geometries.clear();
+    actor_geometry_index.clear();
+
+    auto add_actor = [this](const ActorId actor_id, const Actor &actor) {
+      if (actor_geometry_index.insert({actor_id, static_cast<uint32_t>(actor_geometries.size())}).second) {
+        ActorGeometry geometry;
+        geometry.actor = actor;
+        geometry.actor_id = actor_id;
+        geometry.valid = false;
+        actor_geometries.push_back(std::move(geometry));
       }
+    };
+    // Registered vehicles first, then the other actors around them.
+    for (const auto &data : *localization_frame.get()) {
+      add_actor(data.actor->GetId(), data.actor);
+    }
+    for (const auto &data : *localization_frame.get()) {
+      for (const auto &overlapping_actor : data.overlapping_actors) {
+        add_actor(overlapping_actor.first, overlapping_actor.second);
+      }
+    }
+
+    worker_pool->ParallelFor(actor_geometries.size(), [this](uint64_t, uint64_t begin, uint64_t end) {
+      for (uint64_t i = begin; i < end; ++i) {
+        UpdateActorGeometry(actor_geometries.at(i));
+      }
+    });
+
+    std::vector<BroadphaseBox> envelopes;
+    envelopes.reserve(actor_geometries.size());
+    for (const ActorGeometry &geometry : actor_geometries) {
+      envelopes.push_back(geometry.envelope);
+    }
+    broadphase.Build(envelopes);
+  }
 
-      const Actor ego_actor = data.actor;
-      const ActorId ego_actor_id = ego_actor->GetId();
-      const std::unordered_map<ActorId, Actor> overlapping_actors = data.overlapping_actors;
-      const cg::Location ego_location = ego_actor->GetLocation();
-      const SimpleWaypointPtr& closest_point = data.closest_waypoint;
-      const SimpleWaypointPtr& junction_look_ahead = data.junction_look_ahead_waypoint;
+  void CollisionStage::UpdateActorGeometry(ActorGeometry &geometry) {
+
+    try {
+      geometry.location = geometry.actor->GetLocation();
+      geometry.heading = geometry.actor->GetTransform().GetForwardVector();
+      const LocationList boundary = GetBoundary(geometry.actor, geometry.location);
+      geometry.polygon = GetPolygon(boundary);
+      geometry.geodesic_polygon = GetPolygon(GetGeodesicBoundary(geometry.actor, geometry.location, boundary));
+
+      bg::model::box<bg::model::d2::point_xy<double>> envelope;
+      bg::envelope(geometry.geodesic_polygon, envelope);
+      geometry.envelope = BroadphaseBox{envelope.min_corner().x(), envelope.min_corner().y(),
+                                        envelope.max_corner().x(), envelope.max_corner().y()};
+      geometry.valid = true;
+    } catch (const std::exception &e) {
+      carla::log_info("Actor might not be alive \n");
+      geometry.valid = false;
+      geometry.envelope = BroadphaseBox{1.0, 1.0, 0.0, 0.0};
+    }
+  }
 
-      // Retrieve actors around the path of the ego vehicle.
-      bool collision_hazard = false;
-      const SimpleWaypointPtr safe_point_junction = localization_frame->at(vehicle_id_to_index.at(ego_actor->GetId())).safe_point_after_junction;
+  void CollisionStage::UpdateHazard(const uint64_t index, CollisionToPlannerData &message,
+                                    std::vector<uint32_t> &candidates) {
 
-      // Check every actor in the vicinity if it poses a collision hazard.
-      for (auto j = overlapping_actors.begin(); (j != overlapping_actors.end()) && !collision_hazard; ++j) {
+    const LocalizationToCollisionData &data = localization_frame->at(index);
+    if (!data.actor->IsAlive()) {
+      return;
+    }
 
-        try {
+    const Actor ego_actor = data.actor;
+    const ActorId ego_actor_id = ego_actor->GetId();
+    const ActorGeometry &ego_geometry = actor_geometries.at(actor_geometry_index.at(ego_actor_id));
+    if (!ego_geometry.valid) {
+      message.hazard = false;
+      return;
+    }
 
-          const Actor other_actor = j->second;
-          const auto other_actor_type = other_actor->GetTypeId();
-          const ActorId other_actor_id = j->first;
-          const cg::Location other_location = other_actor->GetLocation();
+    const std::unordered_map<ActorId, Actor> &overlapping_actors = data.overlapping_actors;
+    const cg::Location &ego_location = ego_geometry.location;
+    const WaypointId closest_point = data.closest_waypoint;
+    const WaypointId junction_look_ahead = data.junction_look_ahead_waypoint;
+    const WaypointId safe_point_junction = data.safe_point_after_junction;
+
+    RandomGenerator &random_generator = random_generators.at(ego_actor_id);
+
+    // Only actors whose envelope comes close enough to the ego vehicle's path,
+    // or to its bounding box at the safe point after the junction, can pose
+    // a hazard.
+    candidates.clear();
+    broadphase.Query(ego_geometry.envelope.Expand(GEODESIC_DISTANCE_THRESHOLD), candidates);
+
+    Polygon safe_point_polygon;
+    if (safe_point_junction != InMemoryMap::NO_WAYPOINT) {
+      const LocationList safe_point_boundary = GetBoundaryAtWaypoint(ego_actor, safe_point_junction);
+      safe_point_polygon = GetPolygon(safe_point_boundary);
+
+      BroadphaseBox safe_point_envelope{safe_point_boundary.front().x, safe_point_boundary.front().y,
+                                        safe_point_boundary.front().x, safe_point_boundary.front().y};
+      for (const cg::Location &location : safe_point_boundary) {
+        safe_point_envelope.min_x = std::min(safe_point_envelope.min_x, static_cast<double>(location.x));
+        safe_point_envelope.min_y = std::min(safe_point_envelope.min_y, static_cast<double>(location.y));
+        safe_point_envelope.max_x = std::max(safe_point_envelope.max_x, static_cast<double>(location.x));
+        safe_point_envelope.max_y = std::max(safe_point_envelope.max_y, static_cast<double>(location.y));
+      }
+      broadphase.Query(safe_point_envelope.Expand(INTER_BBOX_DISTANCE_THRESHOLD), candidates);
+    }
 
-          // Collision checks increase with speed
-          float collision_distance = std::pow(floor(ego_actor->GetVelocity().Length()*3.6f/10.0f),2.0f);
-          collision_distance = cg::Math::Clamp(collision_distance, MIN_COLLISION_RADIUS, MAX_COLLISION_RADIUS);
+    // Collision checks increase with speed
+    float collision_distance = std::pow(floor(ego_actor->GetVelocity().Length()*3.6f/10.0f),2.0f);
+    collision_distance = cg::Math::Clamp(collision_distance, MIN_COLLISION_RADIUS, MAX_COLLISION_RADIUS);
 
-          // Temporary fix to (0,0,0) bug
-          if (!(other_location.x == 0 && other_location.y == 0 && other_location.z == 0)) {
+    // Check every candidate actor in the vicinity if it poses a collision hazard.
+    bool collision_hazard = false;
+    for (auto j = candidates.begin(); (j != candidates.end()) && !collision_hazard; ++j) {
 
-            if (other_actor_id != ego_actor_id &&
-                (cg::Math::DistanceSquared(ego_location, other_location)
-                < std::pow(MAX_COLLISION_RADIUS, 2)) &&
-                (std::abs(ego_location.z - other_location.z) < VERTICAL_OVERLAP_THRESHOLD)) {
+      const ActorGeometry &other_geometry = actor_geometries.at(*j);
+      const ActorId other_actor_id = other_geometry.actor_id;
+      if (!other_geometry.valid || other_actor_id == ego_actor_id ||
+          overlapping_actors.find(other_actor_id) == overlapping_actors.end()) {
+        continue;
+      }
+
+      try {
+
+        const Actor &other_actor = other_geometry.actor;
+        const auto other_actor_type = other_actor->GetTypeId();
+        const cg::Location &other_location = other_geometry.location;
 
-              if (parameters.GetCollisionDetection(ego_actor, other_actor)) {
+        // Temporary fix to (0,0,0) bug
+        if (!(other_location.x == 0 && other_location.y == 0 && other_location.z == 0)) {
 
-                if((safe_point_junction != nullptr && !IsLocationAfterJunctionSafe(ego_actor, other_actor, safe_point_junction, other_location)) ||
-                  NegotiateCollision(ego_actor, other_actor, ego_location, other_location, closest_point, junction_look_ahead)) {
+          if ((cg::Math::DistanceSquared(ego_location, other_location)
+              < std::pow(MAX_COLLISION_RADIUS, 2)) &&
+              (std::abs(ego_location.z - other_location.z) < VERTICAL_OVERLAP_THRESHOLD)) {
 
-                  if ((other_actor_type[0] == 'v' && parameters.GetPercentageIgnoreVehicles(ego_actor) <= (rand() % 101)) ||
-                      (other_actor_type[0] == 'w' && parameters.GetPercentageIgnoreWalkers(ego_actor) <= (rand() % 101))) {
+            if (parameters.GetCollisionDetection(ego_actor, other_actor)) {
 
-                    collision_hazard = true;
-                  }
+              if((safe_point_junction != InMemoryMap::NO_WAYPOINT && !IsLocationAfterJunctionSafe(safe_point_polygon, other_geometry)) ||
+                NegotiateCollision(ego_geometry, other_geometry, closest_point, junction_look_ahead)) {
+
+                if ((other_actor_type[0] == 'v' && parameters.GetPercentageIgnoreVehicles(ego_actor) <= random_generator.NextPercentage()) ||
+                    (other_actor_type[0] == 'w' && parameters.GetPercentageIgnoreWalkers(ego_actor) <= random_generator.NextPercentage())) {
+
+                  collision_hazard = true;
                 }
               }
             }
           }
-        } catch (const std::exception &e) {
-          carla::log_info("Actor might not be alive \n");
         }
+      } catch (const std::exception &e) {
+        carla::log_info("Actor might not be alive \n");
       }
-
-      CollisionToPlannerData &message = current_planner_frame->at(i);
-      message.hazard = collision_hazard;
     }
+
+    message.hazard = collision_hazard;
   }
 
   void CollisionStage::DataReceiver() {
@@ -138,6 +255,20 @@ namespace CollisionStageConstants {
         vehicle_id_to_index.insert({element.actor->GetId(), index++});
       }
 
+      // Creating random generators for new vehicles, so that the parallel
+      // loop only uses existing ones, and dropping those of removed vehicles.
+      for (auto &element: *localization_frame.get()) {
+        const ActorId actor_id = element.actor->GetId();
+        random_generators.insert({actor_id, RandomGenerator(random_seed, actor_id)});
+      }
+      for (auto it = random_generators.begin(); it != random_generators.end();) {
+        if (vehicle_id_to_index.find(it->first) == vehicle_id_to_index.end()) {
+          it = random_generators.erase(it);
+        } else {
+          ++it;
+        }
+      }
+
       // Allocating new containers for the changed number
       // of registered vehicles.
       if (number_of_vehicles != (*localization_frame.get()).size()) {
@@ -149,9 +280,6 @@ namespace CollisionStageConstants {
         planner_frame_b = std::make_shared<CollisionToPlannerFrame>(number_of_vehicles);
       }
     }
-
-    // Cleaning geodesic boundaries from the last iteration.
-    geodesic_boundaries.clear();
   }
 
   void CollisionStage::DataSender() {
@@ -162,24 +290,28 @@ namespace CollisionStageConstants {
     frame_selector = !frame_selector;
   }
 
-  bool CollisionStage::NegotiateCollision(const Actor &reference_vehicle, const Actor &other_vehicle,
-                                          const cg::Location &reference_location, const cg::Location &other_location,
-                                          const SimpleWaypointPtr& closest_point,
-                                          const SimpleWaypointPtr& junction_look_ahead) {
+  bool CollisionStage::NegotiateCollision(const ActorGeometry &reference, const ActorGeometry &other,
+                                          const WaypointId closest_point,
+                                          const WaypointId junction_look_ahead) {
 
     bool hazard = false;
 
-    const cg::Vector3D reference_heading = reference_vehicle->GetTransform().GetForwardVector();
+    const Actor &reference_vehicle = reference.actor;
+    const Actor &other_vehicle = other.actor;
+    const cg::Location &reference_location = reference.location;
+    const cg::Location &other_location = other.location;
+
+    const cg::Vector3D &reference_heading = reference.heading;
     cg::Vector3D reference_to_other = other_location - reference_location;
     reference_to_other = reference_to_other.MakeUnitVector();
 
-    const cg::Vector3D other_heading = other_vehicle->GetTransform().GetForwardVector();
+    const cg::Vector3D &other_heading = other.heading;
     cg::Vector3D other_to_reference = reference_location - other_location;
     other_to_reference = other_to_reference.MakeUnitVector();
 
     const auto &waypoint_buffer =  localization_frame->at(
-      vehicle_id_to_index.at(reference_vehicle->GetId())).buffer;
-    const SimpleWaypointPtr& reference_front_wp = waypoint_buffer.front();
+      vehicle_id_to_index.at(reference.actor_id)).buffer;
+    const WaypointId reference_front_wp = waypoint_buffer.front();
 
     const auto reference_vehicle_ptr = boost::static_pointer_cast<cc::Vehicle>(reference_vehicle);
     const auto other_vehicle_ptr = boost::static_pointer_cast<cc::Vehicle>(other_vehicle);
@@ -191,25 +323,25 @@ namespace CollisionStageConstants {
     float inter_vehicle_distance = cg::Math::DistanceSquared(reference_location, other_location);
     float minimum_inter_vehicle_distance = std::pow(GetBoundingBoxExtention(reference_vehicle) + inter_vehicle_length, 2.0f);
 
-    if (!(!reference_front_wp->CheckJunction() &&
+    if (!(!local_map.CheckJunction(reference_front_wp) &&
         cg::Math::Dot(reference_heading, reference_to_other) < 0 &&
         inter_vehicle_distance > minimum_inter_vehicle_distance) &&
 
-        !(!closest_point->CheckJunction() && junction_look_ahead->CheckJunction() &&
+        !(!local_map.CheckJunction(closest_point) && local_map.CheckJunction(junction_look_ahead) &&
         reference_vehicle_ptr->GetVelocity().SquaredLength() < 0.1 &&
         reference_vehicle_ptr->GetTrafficLightState() != carla::rpc::TrafficLightState::Green &&
         inter_vehicle_distance > minimum_inter_vehicle_distance) &&
 
-        !(!reference_front_wp->CheckJunction() &&
+        !(!local_map.CheckJunction(reference_front_wp) &&
         cg::Math::Dot(reference_heading, reference_to_other) > 0 &&
         inter_vehicle_distance > std::max(minimum_inter_vehicle_distance,
                                           std::pow(parameters.GetDistanceToLeadingVehicle(reference_vehicle)
                                                    + inter_vehicle_length, 2.0f)))) {
 
-      const Polygon reference_geodesic_polygon = GetPolygon(GetGeodesicBoundary(reference_vehicle, reference_location));
-      const Polygon other_geodesic_polygon = GetPolygon(GetGeodesicBoundary(other_vehicle, other_location));
-      const Polygon reference_polygon = GetPolygon(GetBoundary(reference_vehicle, reference_location));
-      const Polygon other_polygon = GetPolygon(GetBoundary(other_vehicle, other_location));
+      const Polygon &reference_geodesic_polygon = reference.geodesic_polygon;
+      const Polygon &other_geodesic_polygon = other.geodesic_polygon;
+      const Polygon &reference_polygon = reference.polygon;
+      const Polygon &other_polygon = other.polygon;
 
       const double reference_vehicle_to_other_geodesic = bg::distance(reference_polygon, other_geodesic_polygon);
       const double other_vehicle_to_reference_geodesic = bg::distance(other_polygon, reference_geodesic_polygon);
@@ -219,7 +351,7 @@ namespace CollisionStageConstants {
 
       // Whichever vehicle's path is farthest away from the other vehicle gets
       // priority to move.
-      if (inter_geodesic_distance < 0.1 &&
+      if (inter_geodesic_distance < GEODESIC_DISTANCE_THRESHOLD &&
           ((inter_bbox_distance > 0.1 &&
             reference_vehicle_to_other_geodesic > other_vehicle_to_reference_geodesic
             ) || (
@@ -238,26 +370,21 @@ namespace CollisionStageConstants {
 
   traffic_manager::Polygon CollisionStage::GetPolygon(const LocationList &boundary) {
 
-    std::string boundary_polygon_wkt;
-    for (const cg::Location &location: boundary) {
-      boundary_polygon_wkt += std::to_string(location.x) + " " + std::to_string(location.y) + ",";
-    }
-
-    boundary_polygon_wkt += std::to_string(boundary[0].x) + " " + std::to_string(boundary[0].y);
+    using Point = bg::model::d2::point_xy<double>;
 
     traffic_manager::Polygon boundary_polygon;
-    bg::read_wkt("POLYGON((" + boundary_polygon_wkt + "))", boundary_polygon);
+    boundary_polygon.outer().reserve(boundary.size() + 1u);
+    for (const cg::Location &location: boundary) {
+      bg::append(boundary_polygon.outer(), Point(location.x, location.y));
+    }
+    // Closing the ring.
+    bg::append(boundary_polygon.outer(), Point(boundary[0].x, boundary[0].y));
 
     return boundary_polygon;
   }
 
-  LocationList CollisionStage::GetGeodesicBoundary(const Actor &actor, const cg::Location &vehicle_location) {
-
-    if (geodesic_boundaries.find(actor->GetId()) != geodesic_boundaries.end()) {
-      return geodesic_boundaries.at(actor->GetId());
-    }
-
-    const LocationList bbox = GetBoundary(actor, vehicle_location);
+  LocationList CollisionStage::GetGeodesicBoundary(const Actor &actor, const cg::Location &vehicle_location,
+                                                   const LocationList &bbox) {
 
     if (vehicle_id_to_index.find(actor->GetId()) != vehicle_id_to_index.end()) {
 
@@ -276,15 +403,15 @@ namespace CollisionStageConstants {
       const float width = vehicle->GetBoundingBox().extent.y;
       const float length = vehicle->GetBoundingBox().extent.x*2;
 
-      SimpleWaypointPtr boundary_start = waypoint_buffer.front();
+      WaypointId boundary_start = waypoint_buffer.front();
       uint64_t boundary_start_index = 0u;
-      while (boundary_start->DistanceSquared(vehicle_location) < std::pow(length, 2) &&
+      while (cg::Math::DistanceSquared(local_map.GetLocation(boundary_start), vehicle_location) < std::pow(length, 2) &&
              boundary_start_index < waypoint_buffer.size() -1) {
         boundary_start = waypoint_buffer.at(boundary_start_index);
         ++boundary_start_index;
       }
-      SimpleWaypointPtr boundary_end = nullptr;
-      SimpleWaypointPtr current_point = waypoint_buffer.at(boundary_start_index);
+      WaypointId boundary_end = InMemoryMap::NO_WAYPOINT;
+      WaypointId current_point = waypoint_buffer.at(boundary_start_index);
 
       const auto vehicle_reference = boost::static_pointer_cast<cc::Vehicle>(actor);
       // At non-signalized junctions, we extend the boundary across the junction
@@ -292,16 +419,16 @@ namespace CollisionStageConstants {
       bool reached_distance = false;
       for (uint64_t j = boundary_start_index; !reached_distance && (j < waypoint_buffer.size()); ++j) {
 
-        if (boundary_start->DistanceSquared(current_point) > std::pow(bbox_extension, 2)) {
+        if (local_map.DistanceSquared(boundary_start, current_point) > std::pow(bbox_extension, 2)) {
           reached_distance = true;
         }
 
-        if (boundary_end == nullptr ||
-            boundary_end->DistanceSquared(current_point) > std::pow(BOUNDARY_EDGE_LENGTH, 2) ||
+        if (boundary_end == InMemoryMap::NO_WAYPOINT ||
+            local_map.DistanceSquared(boundary_end, current_point) > std::pow(BOUNDARY_EDGE_LENGTH, 2) ||
             reached_distance) {
 
-          const cg::Vector3D heading_vector = current_point->GetForwardVector();
-          const cg::Location location = current_point->GetLocation();
+          const cg::Vector3D heading_vector = local_map.GetForwardVector(current_point);
+          const cg::Location location = local_map.GetLocation(current_point);
           cg::Vector3D perpendicular_vector = cg::Vector3D(-heading_vector.y, heading_vector.x, 0.0f);
           perpendicular_vector = perpendicular_vector.MakeUnitVector();
           // Direction determined for the left-handed system.
@@ -327,11 +454,9 @@ namespace CollisionStageConstants {
       geodesic_boundary.insert(geodesic_boundary.end(), bbox.begin(), bbox.end());
       geodesic_boundary.insert(geodesic_boundary.end(), left_boundary.begin(), left_boundary.end());
 
-      geodesic_boundaries.insert({actor->GetId(), geodesic_boundary});
       return geodesic_boundary;
     } else {
 
-      geodesic_boundaries.insert({actor->GetId(), bbox});
       return bbox;
     }
 
@@ -392,38 +517,38 @@ namespace CollisionStageConstants {
     return bbox_boundary;
   }
 
-  bool CollisionStage::IsLocationAfterJunctionSafe(const Actor &ego_actor, const Actor &other_actor, const SimpleWaypointPtr safe_point , const cg::Location &other_location){
+  LocationList CollisionStage::GetBoundaryAtWaypoint(const Actor &actor, const WaypointId waypoint) {
 
-    bool safe_junction = true;
+    const cg::Location location = local_map.GetLocation(waypoint);
+    cg::Vector3D heading_vector = local_map.GetForwardVector(waypoint);
+    heading_vector.z = 0.0f;
+    heading_vector = heading_vector.MakeUnitVector();
 
-    if (other_actor->GetVelocity().Length() < EPSILON_VELOCITY){
+    const auto vehicle = boost::static_pointer_cast<cc::Vehicle>(actor);
+    const cg::Vector3D extent = vehicle->GetBoundingBox().extent;
 
-      cg::Location safe_location = safe_point->GetLocation();
-      cg::Vector3D heading_vector = safe_point->GetForwardVector();
-      heading_vector.z = 0.0f;
-      heading_vector = heading_vector.MakeUnitVector();
+    const cg::Vector3D perpendicular_vector = cg::Vector3D(-heading_vector.y, heading_vector.x, 0.0f);
 
-      cg::BoundingBox bbox;
-      const auto vehicle = boost::static_pointer_cast<cc::Vehicle>(ego_actor);
-      bbox = vehicle->GetBoundingBox();
-      const cg::Vector3D extent = bbox.extent;
+    const cg::Vector3D x_boundary_vector = heading_vector * extent.x;
+    const cg::Vector3D y_boundary_vector = perpendicular_vector * extent.y;
 
-      const cg::Vector3D perpendicular_vector = cg::Vector3D(-heading_vector.y, heading_vector.x, 0.0f);
+    LocationList boundary = {
+      location + cg::Location(x_boundary_vector - y_boundary_vector),
+      location + cg::Location(-1.0f * x_boundary_vector - y_boundary_vector),
+      location + cg::Location(-1.0f * x_boundary_vector + y_boundary_vector),
+      location + cg::Location(x_boundary_vector + y_boundary_vector),
+    };
 
-      const cg::Vector3D x_boundary_vector = heading_vector * extent.x;
-      const cg::Vector3D y_boundary_vector = perpendicular_vector * extent.y;
+    return boundary;
+  }
 
-      LocationList ego_actor_boundary = {
-        safe_location + cg::Location(x_boundary_vector - y_boundary_vector),
-        safe_location + cg::Location(-1.0f * x_boundary_vector - y_boundary_vector),
-        safe_location + cg::Location(-1.0f * x_boundary_vector + y_boundary_vector),
-        safe_location + cg::Location(x_boundary_vector + y_boundary_vector),
-      };
+  bool CollisionStage::IsLocationAfterJunctionSafe(const Polygon &safe_point_polygon, const ActorGeometry &other) {
 
-      const Polygon reference_polygon = GetPolygon(ego_actor_boundary);
-      const Polygon other_polygon = GetPolygon(GetBoundary(other_actor, other_location));
+    bool safe_junction = true;
 
-      const auto inter_bbox_distance = bg::distance(reference_polygon, other_polygon);
+    if (other.actor->GetVelocity().Length() < EPSILON_VELOCITY){
+
+      const auto inter_bbox_distance = bg::distance(safe_point_polygon, other.polygon);
       if (inter_bbox_distance < INTER_BBOX_DISTANCE_THRESHOLD){
         safe_junction = false;
       }
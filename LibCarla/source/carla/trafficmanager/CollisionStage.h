@@ -29,9 +29,13 @@
 #include "carla/rpc/ActorId.h"
 #include "carla/rpc/TrafficLightState.h"
 
+#include "carla/trafficmanager/CollisionBroadphase.h"
+#include "carla/trafficmanager/InMemoryMap.h"
 #include "carla/trafficmanager/MessengerAndDataTypes.h"
 #include "carla/trafficmanager/Parameters.h"
 #include "carla/trafficmanager/PipelineStage.h"
+#include "carla/trafficmanager/RandomGenerator.h"
+#include "carla/trafficmanager/WorkerPool.h"
 
 namespace carla {
 namespace traffic_manager {
@@ -45,7 +49,6 @@ namespace traffic_manager {
   using Actor = carla::SharedPtr<cc::Actor>;
   using Polygon = bg::model::polygon<bg::model::d2::point_xy<double>>;
   using LocationList = std::vector<cg::Location>;
-  using SimpleWaypointPtr = std::shared_ptr<SimpleWaypoint>;
   using TLS = carla::rpc::TrafficLightState;
 
   /// This class is the thread executable for the collision detection stage
@@ -55,6 +58,23 @@ namespace traffic_manager {
 
   private:
 
+    /// Geometry of an actor involved in collision checks, computed once per
+    /// iteration and shared by every pair the actor is part of.
+    struct ActorGeometry {
+      Actor actor;
+      ActorId actor_id;
+      /// False if the actor's state could not be read this iteration.
+      bool valid;
+      cg::Location location;
+      cg::Vector3D heading;
+      /// Bounding box of the actor.
+      Polygon polygon;
+      /// Bounding box extended along the actor's path.
+      Polygon geodesic_polygon;
+      /// Axis-aligned envelope of the geodesic polygon.
+      BroadphaseBox envelope;
+    };
+
     /// Selection key for switching between output frames.
     bool frame_selector;
     /// Pointer to data received from localization stage.
@@ -65,6 +85,8 @@ namespace traffic_manager {
     /// Pointers to messenger objects.
     std::shared_ptr<LocalizationToCollisionMessenger> localization_messenger;
     std::shared_ptr<CollisionToPlannerMessenger> planner_messenger;
+    /// Reference to local map-cache object.
+    const InMemoryMap &local_map;
     /// Runtime parameterization object.
     Parameters &parameters;
     /// Reference to Carla's debug helper object.
@@ -76,34 +98,65 @@ namespace traffic_manager {
     chr::time_point<chr::system_clock, chr::nanoseconds> last_world_actors_pass_instance;
     /// Number of vehicles registered with the traffic manager.
     uint64_t number_of_vehicles;
-    /// Structure to hold the geodesic boundaries during one iteration.
-    std::unordered_map<ActorId, LocationList> geodesic_boundaries;
+    /// Pool of threads the per-vehicle loop is split over.
+    std::shared_ptr<WorkerPool> worker_pool;
+    /// Geometry of registered vehicles and of the actors overlapping their
+    /// paths, rebuilt every iteration.
+    std::vector<ActorGeometry> actor_geometries;
+    /// The map used to connect actor ids to their index in actor_geometries.
+    std::unordered_map<ActorId, uint32_t> actor_geometry_index;
+    /// Grid over the envelopes of actor_geometries, used to find the actors
+    /// close enough to a vehicle to be checked for collision.
+    CollisionBroadphase broadphase;
+    /// Candidate actors found by the broadphase, one list for each chunk of
+    /// vehicles processed in parallel.
+    std::vector<std::vector<uint32_t>> collision_candidates;
+    /// Per-vehicle random generators, used instead of rand().
+    std::unordered_map<ActorId, RandomGenerator> random_generators;
+    /// Seed of the random generators of new vehicles.
+    uint64_t random_seed;
     /// Snippet profiler for measuring execution time.
     SnippetProfiler snippet_profiler;
 
     /// Returns the bounding box corners of the vehicle passed to the method.
     LocationList GetBoundary(const Actor &actor, const cg::Location &location);
 
+    /// Computes the geometry of all actors involved in collision checks and
+    /// builds the broadphase grid over it.
+    void UpdateActorGeometries();
+
+    /// Computes the geometry of a single actor.
+    void UpdateActorGeometry(ActorGeometry &geometry);
+
+    /// Checks the actors around the vehicle at the given index of the
+    /// localization frame for collision hazards.
+    void UpdateHazard(const uint64_t index, CollisionToPlannerData &message,
+                      std::vector<uint32_t> &candidates);
+
     /// Returns the extrapolated bounding box of the vehicle along its
     /// trajectory.
-    LocationList GetGeodesicBoundary(const Actor &actor, const cg::Location &location);
+    LocationList GetGeodesicBoundary(const Actor &actor, const cg::Location &location,
+                                     const LocationList &bbox);
 
     /// Method to construct a boost polygon object.
     Polygon GetPolygon(const LocationList &boundary);
 
     /// The method returns true if ego_vehicle should stop and wait for
     /// other_vehicle to pass.
-    bool NegotiateCollision(const Actor &ego_vehicle, const Actor &other_vehicle,
-                            const cg::Location &reference_location, const cg::Location &other_location,
-                            const SimpleWaypointPtr& closest_point,
-                            const SimpleWaypointPtr& junction_look_ahead);
+    bool NegotiateCollision(const ActorGeometry &reference, const ActorGeometry &other,
+                            const WaypointId closest_point,
+                            const WaypointId junction_look_ahead);
 
     /// Method to calculate the speed dependent bounding box extention for a vehicle.
     float GetBoundingBoxExtention(const Actor &ego_vehicle);
 
+    /// Returns the bounding box corners of the vehicle placed at the given
+    /// waypoint.
+    LocationList GetBoundaryAtWaypoint(const Actor &actor, const WaypointId waypoint);
+
     /// At intersections, used to see if there is space after the junction
-    bool IsLocationAfterJunctionSafe(const Actor &ego_actor, const Actor &overlapped_actor,
-                                    const SimpleWaypointPtr safe_point, const cg::Location &other_location);
+    /// for the ego vehicle, whose bounding box at the safe point is given.
+    bool IsLocationAfterJunctionSafe(const Polygon &safe_point_polygon, const ActorGeometry &other);
 
     /// A simple method used to draw bounding boxes around vehicles
     void DrawBoundary(const LocationList &boundary);
@@ -114,6 +167,8 @@ namespace traffic_manager {
         std::string stage_name,
         std::shared_ptr<LocalizationToCollisionMessenger> localization_messenger,
         std::shared_ptr<CollisionToPlannerMessenger> planner_messenger,
+        const InMemoryMap &local_map,
+        std::shared_ptr<WorkerPool> worker_pool,
         Parameters &parameters,
         cc::DebugHelper &debug_helper);
 
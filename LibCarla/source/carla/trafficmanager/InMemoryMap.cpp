@@ -21,7 +21,12 @@ namespace MapConstants {
   namespace cg = carla::geom;
   using namespace MapConstants;
 
-  InMemoryMap::InMemoryMap(WorldMap world_map) : _world_map(world_map) {}
+  constexpr WaypointId InMemoryMap::NO_WAYPOINT;
+
+  InMemoryMap::InMemoryMap(WorldMap world_map)
+    : _world_map(world_map),
+      waypoint_grid(GRID_SIZE),
+      ped_waypoint_grid(PED_GRID_SIZE) {}
   InMemoryMap::~InMemoryMap() {}
 
   SegmentId InMemoryMap::GetSegmentId(const WaypointPtr &wp) const {
@@ -177,23 +182,12 @@ namespace MapConstants {
     }
 
     // Localizing waypoints into grids.
+    dense_locations.reserve(dense_topology.size());
     for (auto &simple_waypoint: dense_topology) {
-      if (simple_waypoint != nullptr) {
-        const cg::Location loc = simple_waypoint->GetLocation();
-        const std::string grid_key = MakeGridKey(MakeGridId(loc.x, loc.y, true));
-        if (waypoint_grid.find(grid_key) == waypoint_grid.end()) {
-          waypoint_grid.insert({grid_key, {simple_waypoint}});
-        } else {
-          waypoint_grid.at(grid_key).insert(simple_waypoint);
-        }
-        const std::string ped_grid_key = MakeGridKey(MakeGridId(loc.x, loc.y, false));
-        if (ped_waypoint_grid.find(ped_grid_key) == ped_waypoint_grid.end()) {
-          ped_waypoint_grid.insert({ped_grid_key, {simple_waypoint}});
-        } else {
-          ped_waypoint_grid.at(ped_grid_key).insert(simple_waypoint);
-        }
-      }
+      dense_locations.push_back(simple_waypoint->GetLocation());
     }
+    waypoint_grid.Build(dense_locations);
+    ped_waypoint_grid.Build(dense_locations);
 
     // Placing inter-segment connections.
     for (auto &segment : segment_map) {
@@ -231,101 +225,85 @@ namespace MapConstants {
       }
     }
 
+    MakeDenseGraph();
     MakeGeodesiGridCenters();
   }
 
-  std::pair<int, int> InMemoryMap::MakeGridId(float x, float y, bool vehicle_or_pedestrian) {
-    if (vehicle_or_pedestrian) {
-      return {static_cast<int>(std::floor(x / GRID_SIZE)), static_cast<int>(std::floor(y / GRID_SIZE))};
-    } else {
-      return {static_cast<int>(std::floor(x / PED_GRID_SIZE)),
-              static_cast<int>(std::floor(y / PED_GRID_SIZE))};
-    }
-  }
-
-  std::string InMemoryMap::MakeGridKey(std::pair<int, int> grid_key) {
-    return std::to_string(grid_key.first) + "#" + std::to_string(grid_key.second);
-  }
-
-  SimpleWaypointPtr InMemoryMap::GetWaypointInVicinity(cg::Location location) {
-
-    const std::pair<int, int> grid_ids = MakeGridId(location.x, location.y, true);
-    SimpleWaypointPtr closest_waypoint = nullptr;
-    float closest_distance = INFINITE_DISTANCE;
-
-    // Search all surrounding grids for closest waypoint.
-    for (int i = -1; i <= 1; ++i) {
-      for (int j = -1; j <= 1; ++j) {
-
-        const std::string grid_key = MakeGridKey({grid_ids.first + i, grid_ids.second + j});
-        if (waypoint_grid.find(grid_key) != waypoint_grid.end()) {
-
-          const auto &waypoint_set = waypoint_grid.at(grid_key);
-          if (closest_waypoint == nullptr) {
-            closest_waypoint = *waypoint_set.begin();
-          }
+  void InMemoryMap::MakeDenseGraph() {
 
-          for (auto &simple_waypoint: waypoint_set) {
+    std::unordered_map<const SimpleWaypoint *, WaypointId> waypoint_ids;
+    waypoint_ids.reserve(dense_topology.size());
+    for (WaypointId i = 0u; i < dense_topology.size(); ++i) {
+      waypoint_ids.insert({dense_topology[i].get(), i});
+    }
+    auto get_id = [&waypoint_ids](const SimpleWaypointPtr &swp) {
+      return swp == nullptr ? NO_WAYPOINT : waypoint_ids.at(swp.get());
+    };
 
-            if (simple_waypoint->DistanceSquared(location) < std::pow(closest_distance, 2)) {
-              closest_waypoint = simple_waypoint;
-              closest_distance = simple_waypoint->DistanceSquared(location);
-            }
-          }
+    const std::size_t number_of_waypoints = dense_topology.size();
+    dense_forward_vectors.resize(number_of_waypoints);
+    dense_geodesic_grid_ids.resize(number_of_waypoints);
+    dense_junction_flags.resize(number_of_waypoints);
+    dense_left_waypoints.resize(number_of_waypoints);
+    dense_right_waypoints.resize(number_of_waypoints);
+    successor_offsets.assign(1u, 0u);
+    successor_offsets.reserve(number_of_waypoints + 1u);
+    successors.clear();
+
+    for (WaypointId i = 0u; i < number_of_waypoints; ++i) {
+      SimpleWaypoint &swp = *dense_topology[i];
+      dense_forward_vectors[i] = swp.GetForwardVector();
+      dense_geodesic_grid_ids[i] = swp.GetGeodesicGridId();
+      dense_junction_flags[i] = swp.CheckJunction() ? 1u : 0u;
+      dense_left_waypoints[i] = get_id(swp.GetLeftWaypoint());
+      dense_right_waypoints[i] = get_id(swp.GetRightWaypoint());
+      for (auto &next_waypoint : swp.GetNextWaypoint()) {
+        if (next_waypoint != nullptr) {
+          successors.push_back(get_id(next_waypoint));
         }
       }
+      successor_offsets.push_back(static_cast<uint32_t>(successors.size()));
     }
+  }
+
+  WaypointId InMemoryMap::GetWaypointInVicinity(cg::Location location) const {
+
+    const WaypointId closest_waypoint = waypoint_grid.FindClosest(location);
 
     // Return the closest waypoint in the surrounding grids
     // only if it is in the same horizontal plane as the requested location.
-    if (closest_waypoint != nullptr && std::abs(closest_waypoint->GetLocation().z - location.z) > 1.0) {
-      closest_waypoint = nullptr;
+    if (closest_waypoint != NO_WAYPOINT && std::abs(dense_locations[closest_waypoint].z - location.z) > 1.0) {
+      return NO_WAYPOINT;
     }
 
     return closest_waypoint;
   }
 
-  SimpleWaypointPtr InMemoryMap::GetPedWaypoint(cg::Location location) {
-
-    const std::pair<int, int> grid_ids = MakeGridId(location.x, location.y, false);
-    SimpleWaypointPtr closest_waypoint = nullptr;
-    float closest_distance = INFINITE_DISTANCE;
-
-    // Search all surrounding grids for closest waypoint.
-    for (int i = -1; i <= 1; ++i) {
-      for (int j = -1; j <= 1; ++j) {
+  std::vector<WaypointId> InMemoryMap::GetWaypointsInVicinity(const std::vector<cg::Location> &locations) const {
 
-        const std::string grid_key = MakeGridKey({grid_ids.first + i, grid_ids.second + j});
-        if (ped_waypoint_grid.find(grid_key) != ped_waypoint_grid.end()) {
-
-          const auto &waypoint_set = ped_waypoint_grid.at(grid_key);
-          if (closest_waypoint == nullptr) {
-            closest_waypoint = *waypoint_set.begin();
-          }
-
-          for (auto &simple_waypoint: waypoint_set) {
-
-            if (simple_waypoint->DistanceSquared(location) < std::pow(closest_distance, 2)) {
-              closest_waypoint = simple_waypoint;
-              closest_distance = simple_waypoint->DistanceSquared(location);
-            }
-          }
-        }
+    std::vector<WaypointId> closest_waypoints = waypoint_grid.FindClosest(locations);
+    for (std::size_t i = 0u; i < locations.size(); ++i) {
+      WaypointId &closest_waypoint = closest_waypoints[i];
+      if (closest_waypoint != NO_WAYPOINT && std::abs(dense_locations[closest_waypoint].z - locations[i].z) > 1.0) {
+        closest_waypoint = NO_WAYPOINT;
       }
     }
+    return closest_waypoints;
+  }
 
-    return closest_waypoint;
+  WaypointId InMemoryMap::GetPedWaypoint(cg::Location location) const {
+    return ped_waypoint_grid.FindClosest(location);
   }
 
-  SimpleWaypointPtr InMemoryMap::GetWaypoint(const cg::Location &location) const {
+  WaypointId InMemoryMap::GetWaypoint(const cg::Location &location) const {
 
-    SimpleWaypointPtr closest_waypoint;
+    WaypointId closest_waypoint = NO_WAYPOINT;
     float min_distance = INFINITE_DISTANCE;
-    for (auto &simple_waypoint : dense_topology) {
-      const float current_distance = simple_waypoint->DistanceSquared(location);
+    for (WaypointId i = 0u; i < dense_locations.size(); ++i) {
+      const float current_distance = cg::Math::DistanceSquared(dense_locations[i], location);
       if (current_distance < min_distance) {
         min_distance = current_distance;
-        closest_waypoint = simple_waypoint;
+        closest_waypoint = i;
       }
     }
     return closest_waypoint;
@@ -351,12 +329,11 @@ namespace MapConstants {
         right_waypoint->GetType() == crd::Lane::LaneType::Driving &&
         (right_waypoint->GetLaneId() * raw_waypoint->GetLaneId() > 0)) {
 
-          SimpleWaypointPtr closest_simple_waypoint =
-          GetWaypointInVicinity(right_waypoint->GetTransform().location);
-          if (closest_simple_waypoint == nullptr) {
-            closest_simple_waypoint = GetWaypoint(right_waypoint->GetTransform().location);
+          WaypointId closest_waypoint = GetWaypointInVicinity(right_waypoint->GetTransform().location);
+          if (closest_waypoint == NO_WAYPOINT) {
+            closest_waypoint = GetWaypoint(right_waypoint->GetTransform().location);
           }
-          reference_waypoint->SetRightWaypoint(closest_simple_waypoint);
+          reference_waypoint->SetRightWaypoint(dense_topology.at(closest_waypoint));
         }
       }
 
@@ -367,12 +344,11 @@ namespace MapConstants {
         left_waypoint->GetType() == crd::Lane::LaneType::Driving &&
         (left_waypoint->GetLaneId() * raw_waypoint->GetLaneId() > 0)) {
 
-          SimpleWaypointPtr closest_simple_waypoint =
-          GetWaypointInVicinity(left_waypoint->GetTransform().location);
-          if (closest_simple_waypoint == nullptr) {
-            closest_simple_waypoint = GetWaypoint(left_waypoint->GetTransform().location);
+          WaypointId closest_waypoint = GetWaypointInVicinity(left_waypoint->GetTransform().location);
+          if (closest_waypoint == NO_WAYPOINT) {
+            closest_waypoint = GetWaypoint(left_waypoint->GetTransform().location);
           }
-          reference_waypoint->SetLeftWaypoint(closest_simple_waypoint);
+          reference_waypoint->SetLeftWaypoint(dense_topology.at(closest_waypoint));
         }
       }
     } catch (const std::invalid_argument &e) {
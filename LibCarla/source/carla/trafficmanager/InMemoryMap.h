@@ -10,6 +10,7 @@
 #include <cmath>
 #include <limits>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 
@@ -22,6 +23,7 @@
 #include "carla/road/RoadTypes.h"
 
 #include "carla/trafficmanager/SimpleWaypoint.h"
+#include "carla/trafficmanager/WaypointGrid.h"
 
 namespace carla {
 namespace traffic_manager {
@@ -37,17 +39,67 @@ namespace crd = carla::road;
   using RawNodeList = std::vector<WaypointPtr>;
   using GeoGridId = crd::JuncId;
   using WorldMap = carla::SharedPtr<cc::Map>;
-  using WaypointGrid = std::unordered_map<std::string, std::unordered_set<SimpleWaypointPtr>>;
 
   using SegmentId = std::tuple<crd::RoadId, crd::LaneId, crd::SectionId>;
   using SegmentTopology = std::map<SegmentId, std::pair<std::vector<SegmentId>, std::vector<SegmentId>>>;
   using SegmentMap = std::map<SegmentId, std::vector<SimpleWaypointPtr>>;
 
+  /// Read-only view of a contiguous list of waypoint ids.
+  class WaypointIdRange {
+
+  public:
+
+    WaypointIdRange(const WaypointId *first, const WaypointId *last) : first(first), last(last) {}
+
+    const WaypointId *begin() const {
+      return first;
+    }
+
+    const WaypointId *end() const {
+      return last;
+    }
+
+    uint64_t size() const {
+      return static_cast<uint64_t>(last - first);
+    }
+
+    bool empty() const {
+      return first == last;
+    }
+
+    WaypointId operator[](uint64_t index) const {
+      return first[index];
+    }
+
+    WaypointId at(uint64_t index) const {
+      if (index >= size()) {
+        throw std::out_of_range("WaypointIdRange::at");
+      }
+      return first[index];
+    }
+
+  private:
+
+    const WaypointId *first;
+    const WaypointId *last;
+  };
+
   /// This class builds a discretized local map-cache.
   /// Instantiate the class with the world and run SetUp() to construct the
   /// local map.
+  ///
+  /// Waypoints are identified by their index in the dense topology. Their
+  /// properties and connections used every tick are stored in contiguous
+  /// arrays indexed by WaypointId, so that following paths does not touch
+  /// the SimpleWaypoint objects.
   class InMemoryMap {
 
+  public:
+
+    /// Id returned by lookups that find no waypoint, and stored for missing
+    /// lane change links.
+    static constexpr WaypointId NO_WAYPOINT = WaypointGrid::NO_WAYPOINT;
+
   private:
 
     /// Object to hold the world map received by the constructor.
@@ -55,6 +107,17 @@ namespace crd = carla::road;
     /// Structure to hold all custom waypoint objects after interpolation of
     /// sparse topology.
     NodeList dense_topology;
+    /// Locations of dense_topology, for cache friendly scans.
+    std::vector<cg::Location> dense_locations;
+    /// Dense waypoint graph, parallel to dense_topology.
+    std::vector<cg::Vector3D> dense_forward_vectors;
+    std::vector<GeoGridId> dense_geodesic_grid_ids;
+    std::vector<uint8_t> dense_junction_flags;
+    std::vector<WaypointId> dense_left_waypoints;
+    std::vector<WaypointId> dense_right_waypoints;
+    /// Successors of waypoint i are successors[successor_offsets[i]..successor_offsets[i + 1]).
+    std::vector<uint32_t> successor_offsets;
+    std::vector<WaypointId> successors;
     /// Grid localization map for all waypoints in the system.
     WaypointGrid waypoint_grid;
     /// Larger localization map for all waypoints to be used for localizing pedestrians.
@@ -78,30 +141,70 @@ namespace crd = carla::road;
     SegmentId GetSegmentId(const SimpleWaypointPtr &swp) const;
 
     /// This method returns the closest waypoint to a given location on the map.
-    SimpleWaypointPtr GetWaypoint(const cg::Location &location) const;
+    WaypointId GetWaypoint(const cg::Location &location) const;
 
-    /// This method returns closest waypoint in the vicinity of the given co-ordinates.
-    SimpleWaypointPtr GetWaypointInVicinity(cg::Location location);
-    SimpleWaypointPtr GetPedWaypoint(cg::Location location);
+    /// This method returns closest waypoint in the vicinity of the given
+    /// co-ordinates, or NO_WAYPOINT if there is none.
+    WaypointId GetWaypointInVicinity(cg::Location location) const;
+    WaypointId GetPedWaypoint(cg::Location location) const;
+
+    /// GetWaypointInVicinity for many locations.
+    std::vector<WaypointId> GetWaypointsInVicinity(const std::vector<cg::Location> &locations) const;
 
     /// This method returns the full list of discrete samples of the map in the
     /// local cache.
     NodeList GetDenseTopology() const;
 
+    /// Returns the waypoint object with the given id, for the properties not
+    /// kept in the dense graph.
+    const SimpleWaypointPtr &GetSimpleWaypoint(WaypointId id) const {
+      return dense_topology[id];
+    }
+
+    const cg::Location &GetLocation(WaypointId id) const {
+      return dense_locations[id];
+    }
+
+    const cg::Vector3D &GetForwardVector(WaypointId id) const {
+      return dense_forward_vectors[id];
+    }
+
+    GeoGridId GetGeodesicGridId(WaypointId id) const {
+      return dense_geodesic_grid_ids[id];
+    }
+
+    bool CheckJunction(WaypointId id) const {
+      return dense_junction_flags[id] != 0u;
+    }
+
+    WaypointId GetLeftWaypoint(WaypointId id) const {
+      return dense_left_waypoints[id];
+    }
+
+    WaypointId GetRightWaypoint(WaypointId id) const {
+      return dense_right_waypoints[id];
+    }
+
+    WaypointIdRange GetNextWaypoints(WaypointId id) const {
+      return {successors.data() + successor_offsets[id], successors.data() + successor_offsets[id + 1u]};
+    }
+
+    float DistanceSquared(WaypointId a, WaypointId b) const {
+      return cg::Math::DistanceSquared(dense_locations[a], dense_locations[b]);
+    }
+
     void MakeGeodesiGridCenters();
     cg::Location GetGeodesicGridCenter(GeoGridId ggid);
 
   private:
 
-    /// Method to generate the grid ids for given co-ordinates.
-    std::pair<int, int> MakeGridId(float x, float y, bool vehicle_or_pedestrian);
-
-    /// Method to generate map key for waypoint_grid.
-    std::string MakeGridKey(std::pair<int, int> gird_id);
-
     /// This method is used to find and place lane change links.
     void FindAndLinkLaneChange(SimpleWaypointPtr reference_waypoint);
 
+    /// Flattens the links between the objects in dense_topology into the
+    /// dense graph.
+    void MakeDenseGraph();
+
     std::vector<SimpleWaypointPtr> GetSuccessors(const SegmentId segment_id,
     const SegmentTopology &segment_topology, const SegmentMap &segment_map);
     std::vector<SimpleWaypointPtr> GetPredecessors(const SegmentId segment_id,
@@ -38,6 +38,7 @@ namespace LocalizationConstants {
       std::shared_ptr<LocalizationToTrafficLightMessenger> traffic_light_messenger,
       AtomicActorSet &registered_actors,
       InMemoryMap &local_map,
+      std::shared_ptr<WorkerPool> worker_pool,
       Parameters &parameters,
       carla::client::DebugHelper &debug_helper,
       carla::client::detail::EpisodeProxy &episodeProxy)
@@ -49,7 +50,8 @@ namespace LocalizationConstants {
       local_map(local_map),
       parameters(parameters),
       debug_helper(debug_helper),
-      episode_proxy_ls(episodeProxy) {
+      episode_proxy_ls(episodeProxy),
+      worker_pool(worker_pool) {
 
     // Initializing various output frame selectors.
     planner_frame_selector = true;
@@ -63,8 +65,8 @@ namespace LocalizationConstants {
     buffer_list = std::make_shared<BufferList>();
     // Initializing maximum idle time to null.
     maximum_idle_time = std::make_pair(nullptr, 0.0);
-    // Initializing srand.
-    srand(static_cast<unsigned>(time(NULL)));
+    // Initializing the seed of vehicles' random generators.
+    random_seed = static_cast<uint64_t>(time(NULL));
 
   }
 
@@ -83,238 +85,335 @@ namespace LocalizationConstants {
     // Selecting current timestamp from the world snapshot.
     current_timestamp = episode_proxy_ls.Lock()->GetWorldSnapshot().GetTimestamp();
 
-    // Looping over registered actors.
-    for (uint64_t i = 0u; i < actor_list.size(); ++i) {
-
-      const Actor vehicle = actor_list.at(i);
+    // Creating the entries of new vehicles up front, so that the parallel
+    // passes below only modify existing entries of their own vehicles.
+    for (const Actor &vehicle : actor_list) {
       const ActorId actor_id = vehicle->GetId();
-      const cg::Location vehicle_location = vehicle->GetLocation();
-      const float vehicle_velocity = vehicle->GetVelocity().Length();
-
-      // Initializing idle times.
       if (idle_time.find(actor_id) == idle_time.end() && current_timestamp.elapsed_seconds != 0) {
         idle_time[actor_id] = current_timestamp.elapsed_seconds;
       }
+      buffer_list->insert({actor_id, Buffer()});
+      approached.insert({actor_id, false});
+      final_safe_points.insert({actor_id, InMemoryMap::NO_WAYPOINT});
+      random_generators.insert({actor_id, RandomGenerator(random_seed, actor_id)});
+    }
 
-      const float horizon_size = std::max(
-          WAYPOINT_TIME_HORIZON * std::sqrt(vehicle_velocity * 10.0f),
-          MINIMUM_HORIZON_LENGTH);
+    vehicle_states.resize(actor_list.size());
+    passing_vehicle_updates.resize(worker_pool->GetMaximumNumberOfChunks());
+    chunk_maximum_idle_times.assign(worker_pool->GetMaximumNumberOfChunks(), std::make_pair(nullptr, 0.0));
 
-      if (buffer_list->find(actor_id) == buffer_list->end()) {
-        buffer_list->insert({actor_id, Buffer()});
+    // Purging passed waypoints from the buffers.
+    TimePoint pass_start = chr::system_clock::now();
+    worker_pool->ParallelFor(actor_list.size(), [this](uint64_t chunk, uint64_t begin, uint64_t end) {
+      for (uint64_t i = begin; i < end; ++i) {
+        PurgeBuffer(i, passing_vehicle_updates.at(chunk));
       }
+    });
+    ApplyPassingVehicleUpdates();
+    performance_diagnostics.RegisterSnippet("Buffer purge", chr::system_clock::now() - pass_start);
+
+    // Choosing lane changes. All vehicles see the same buffers and traffic
+    // here, whatever the order they are processed in.
+    pass_start = chr::system_clock::now();
+    worker_pool->ParallelFor(actor_list.size(), [this](uint64_t, uint64_t begin, uint64_t end) {
+      for (uint64_t i = begin; i < end; ++i) {
+        SelectLaneChange(i);
+      }
+    });
+    for (uint64_t i = 0u; i < actor_list.size(); ++i) {
+      if (vehicle_states.at(i).change_over_point != InMemoryMap::NO_WAYPOINT) {
+        last_lane_change_location[actor_list.at(i)->GetId()] = vehicle_states.at(i).location;
+      }
+    }
+    performance_diagnostics.RegisterSnippet("Lane change", chr::system_clock::now() - pass_start);
+
+    // Extending the buffers and generating output.
+    pass_start = chr::system_clock::now();
+    worker_pool->ParallelFor(actor_list.size(),
+        [&, this](uint64_t chunk, uint64_t begin, uint64_t end) {
+      for (uint64_t i = begin; i < end; ++i) {
+        UpdateVehicle(i,
+            current_planner_frame->at(i),
+            current_collision_frame->at(i),
+            current_traffic_light_frame->at(i),
+            passing_vehicle_updates.at(chunk),
+            chunk_maximum_idle_times.at(chunk));
+      }
+    });
+    ApplyPassingVehicleUpdates();
 
-      Buffer &waypoint_buffer = buffer_list->at(actor_id);
-
-      // Clear buffer if vehicle is too far from the first waypoint in the buffer.
-      if (!waypoint_buffer.empty() &&
-          cg::Math::DistanceSquared(waypoint_buffer.front()->GetLocation(), vehicle_location) > std::pow(30.0f, 2)) {
+    // Updating geodesic grid positions for all actors.
+    for (const Actor &vehicle : actor_list) {
+      const ActorId actor_id = vehicle->GetId();
+      track_traffic.UpdateGridPosition(actor_id, buffer_list->at(actor_id), local_map);
+    }
+    performance_diagnostics.RegisterSnippet("Buffer update", chr::system_clock::now() - pass_start);
 
-        auto number_of_pops = waypoint_buffer.size();
-        for (uint64_t j = 0u; j < number_of_pops; ++j) {
-          PopWaypoint(waypoint_buffer, actor_id);
-        }
+    // Collecting the actors around each vehicle's path.
+    pass_start = chr::system_clock::now();
+    worker_pool->ParallelFor(actor_list.size(), [&, this](uint64_t, uint64_t begin, uint64_t end) {
+      for (uint64_t i = begin; i < end; ++i) {
+        CollectOverlappingActors(actor_list.at(i)->GetId(), current_collision_frame->at(i));
+      }
+    });
+    performance_diagnostics.RegisterSnippet("Overlap tracking", chr::system_clock::now() - pass_start);
+
+    // Chunks are reduced in order, for the same result as a single pass.
+    for (const auto &chunk_maximum_idle_time : chunk_maximum_idle_times) {
+      if (chunk_maximum_idle_time.first != nullptr &&
+          (maximum_idle_time.first == nullptr || maximum_idle_time.second > chunk_maximum_idle_time.second)) {
+        maximum_idle_time = chunk_maximum_idle_time;
       }
+    }
 
-      // Purge passed waypoints.
-      if (!waypoint_buffer.empty()) {
-        float dot_product = DeviationDotProduct(vehicle, vehicle_location, waypoint_buffer.front()->GetLocation(), true);
+    if (IsVehicleStuck(maximum_idle_time.first)) {
+      TryDestroyVehicle(maximum_idle_time.first);
+    }
 
-        while (dot_product <= 0.0f && !waypoint_buffer.empty()) {
+    // Updating maximum idle time to null for the next iteration.
+    maximum_idle_time = std::make_pair(nullptr, current_timestamp.elapsed_seconds);
+  }
 
-          PopWaypoint(waypoint_buffer, actor_id);
-          if (!waypoint_buffer.empty()) {
-            dot_product = DeviationDotProduct(vehicle, vehicle_location, waypoint_buffer.front()->GetLocation(), true);
-          }
-        }
+  void LocalizationStage::PurgeBuffer(const uint64_t index, PassingVehicleUpdates &passing_updates) {
+
+    const Actor &vehicle = actor_list.at(index);
+    const ActorId actor_id = vehicle->GetId();
+    VehicleState &vehicle_state = vehicle_states.at(index);
+    vehicle_state.location = vehicle->GetLocation();
+    vehicle_state.velocity = vehicle->GetVelocity().Length();
+    vehicle_state.change_over_point = InMemoryMap::NO_WAYPOINT;
+    const cg::Location &vehicle_location = vehicle_state.location;
+
+    Buffer &waypoint_buffer = buffer_list->at(actor_id);
+
+    // Clear buffer if vehicle is too far from the first waypoint in the buffer.
+    if (!waypoint_buffer.empty() &&
+        cg::Math::DistanceSquared(local_map.GetLocation(waypoint_buffer.front()), vehicle_location) > std::pow(30.0f, 2)) {
+
+      auto number_of_pops = waypoint_buffer.size();
+      for (uint64_t j = 0u; j < number_of_pops; ++j) {
+        PopWaypoint(waypoint_buffer, actor_id, passing_updates);
       }
+    }
+
+    // Purge passed waypoints.
+    if (!waypoint_buffer.empty()) {
+      float dot_product = DeviationDotProduct(vehicle, vehicle_location, local_map.GetLocation(waypoint_buffer.front()), true);
+
+      while (dot_product <= 0.0f && !waypoint_buffer.empty()) {
 
-      // Initializing buffer if it is empty.
-      if (waypoint_buffer.empty()) {
-        SimpleWaypointPtr closest_waypoint = local_map.GetWaypointInVicinity(vehicle_location);
-        if (closest_waypoint == nullptr) {
-          closest_waypoint = local_map.GetWaypoint(vehicle_location);
+        PopWaypoint(waypoint_buffer, actor_id, passing_updates);
+        if (!waypoint_buffer.empty()) {
+          dot_product = DeviationDotProduct(vehicle, vehicle_location, local_map.GetLocation(waypoint_buffer.front()), true);
         }
-        PushWaypoint(waypoint_buffer, actor_id, closest_waypoint);
       }
+    }
 
-      // Assign a lane change.
+    // Initializing buffer if it is empty.
+    if (waypoint_buffer.empty()) {
+      WaypointId closest_waypoint = local_map.GetWaypointInVicinity(vehicle_location);
+      if (closest_waypoint == InMemoryMap::NO_WAYPOINT) {
+        closest_waypoint = local_map.GetWaypoint(vehicle_location);
+      }
+      PushWaypoint(waypoint_buffer, actor_id, closest_waypoint, passing_updates);
+    }
+  }
 
-      const ChangeLaneInfo lane_change_info = parameters.GetForceLaneChange(vehicle);
-      bool force_lane_change = lane_change_info.change_lane;
-      bool lane_change_direction = lane_change_info.direction;
+  void LocalizationStage::SelectLaneChange(const uint64_t index) {
 
-      if (!force_lane_change) {
-        float perc_keep_right = parameters.GetKeepRightPercentage(vehicle);
-        if (perc_keep_right >= 0.0f && perc_keep_right >= (rand() % 101)) {
-            force_lane_change = true;
-            lane_change_direction = true;
-        }
+    const Actor &vehicle = actor_list.at(index);
+    const ActorId actor_id = vehicle->GetId();
+    VehicleState &vehicle_state = vehicle_states.at(index);
+    const cg::Location &vehicle_location = vehicle_state.location;
+
+    const ChangeLaneInfo lane_change_info = parameters.GetForceLaneChange(vehicle);
+    bool force_lane_change = lane_change_info.change_lane;
+    bool lane_change_direction = lane_change_info.direction;
+
+    if (!force_lane_change) {
+      float perc_keep_right = parameters.GetKeepRightPercentage(vehicle);
+      if (perc_keep_right >= 0.0f && perc_keep_right >= random_generators.at(actor_id).NextPercentage()) {
+          force_lane_change = true;
+          lane_change_direction = true;
       }
+    }
 
-      const SimpleWaypointPtr front_waypoint = waypoint_buffer.front();
-      const double lane_change_distance = std::pow(std::max(10.0f * vehicle_velocity, INTER_LANE_CHANGE_DISTANCE), 2);
+    const WaypointId front_waypoint = buffer_list->at(actor_id).front();
+    const double lane_change_distance = std::pow(std::max(10.0f * vehicle_state.velocity, INTER_LANE_CHANGE_DISTANCE), 2);
 
-      if (((parameters.GetAutoLaneChange(vehicle) || force_lane_change) && !front_waypoint->CheckJunction())
-          && (last_lane_change_location.find(actor_id) == last_lane_change_location.end()
-              || cg::Math::DistanceSquared(last_lane_change_location.at(actor_id), vehicle_location)
-                 > lane_change_distance )) {
+    if (((parameters.GetAutoLaneChange(vehicle) || force_lane_change) && !local_map.CheckJunction(front_waypoint))
+        && (last_lane_change_location.find(actor_id) == last_lane_change_location.end()
+            || cg::Math::DistanceSquared(last_lane_change_location.at(actor_id), vehicle_location)
+               > lane_change_distance )) {
 
-        SimpleWaypointPtr change_over_point = AssignLaneChange(
-            vehicle, vehicle_location, force_lane_change, lane_change_direction);
+      vehicle_state.change_over_point = AssignLaneChange(
+          vehicle, vehicle_location, force_lane_change, lane_change_direction);
+    }
+  }
 
-        if (change_over_point != nullptr) {
-          if (last_lane_change_location.find(actor_id) != last_lane_change_location.end()) {
-            last_lane_change_location.at(actor_id) = vehicle_location;
-          } else {
-            last_lane_change_location.insert({actor_id, vehicle_location});
-          }
-          auto number_of_pops = waypoint_buffer.size();
-          for (uint64_t j = 0u; j < number_of_pops; ++j) {
-            PopWaypoint(waypoint_buffer, actor_id);
-          }
-          PushWaypoint(waypoint_buffer, actor_id, change_over_point);
-        }
+  void LocalizationStage::UpdateVehicle(const uint64_t index,
+                                        LocalizationToPlannerData &planner_message,
+                                        LocalizationToCollisionData &collision_message,
+                                        LocalizationToTrafficLightData &traffic_light_message,
+                                        PassingVehicleUpdates &passing_updates,
+                                        std::pair<Actor, double> &chunk_maximum_idle_time) {
+
+    const Actor &vehicle = actor_list.at(index);
+    const ActorId actor_id = vehicle->GetId();
+    const VehicleState &vehicle_state = vehicle_states.at(index);
+    const cg::Location &vehicle_location = vehicle_state.location;
+    const float vehicle_velocity = vehicle_state.velocity;
+    RandomGenerator &random_generator = random_generators.at(actor_id);
+
+    const float horizon_size = std::max(
+        WAYPOINT_TIME_HORIZON * std::sqrt(vehicle_velocity * 10.0f),
+        MINIMUM_HORIZON_LENGTH);
+
+    Buffer &waypoint_buffer = buffer_list->at(actor_id);
+
+    // Restarting the buffer from the lane change point.
+    if (vehicle_state.change_over_point != InMemoryMap::NO_WAYPOINT) {
+      auto number_of_pops = waypoint_buffer.size();
+      for (uint64_t j = 0u; j < number_of_pops; ++j) {
+        PopWaypoint(waypoint_buffer, actor_id, passing_updates);
       }
+      PushWaypoint(waypoint_buffer, actor_id, vehicle_state.change_over_point, passing_updates);
+    }
 
-      // Populating the buffer.
-      while (waypoint_buffer.back()->DistanceSquared(waypoint_buffer.front())
-          <= std::pow(horizon_size, 2)) {
+    // Populating the buffer.
+    while (local_map.DistanceSquared(waypoint_buffer.back(), waypoint_buffer.front())
+        <= std::pow(horizon_size, 2)) {
 
-        std::vector<SimpleWaypointPtr> next_waypoints = waypoint_buffer.back()->GetNextWaypoint();
-        uint64_t selection_index = 0u;
-        // Pseudo-randomized path selection if found more than one choice.
-        if (next_waypoints.size() > 1) {
-          selection_index = static_cast<uint64_t>(rand()) % next_waypoints.size();
-        }
-        SimpleWaypointPtr next_wp = next_waypoints.at(selection_index);
-        if (next_wp == nullptr) {
-          for (auto& wp: next_waypoints) {
-            if (wp != nullptr) {
-              next_wp = wp;
-              break;
-            }
-          }
-        }
-        PushWaypoint(waypoint_buffer, actor_id, next_wp);
-      }
-
-      // Updating geodesic grid position for actor.
-      track_traffic.UpdateGridPosition(actor_id, waypoint_buffer);
-
-      // Generating output.
-      const float target_point_distance = std::max(std::ceil(vehicle_velocity * TARGET_WAYPOINT_TIME_HORIZON),
-          TARGET_WAYPOINT_HORIZON_LENGTH);
-      SimpleWaypointPtr target_waypoint = waypoint_buffer.front();
-      for (uint64_t j = 0u;
-          (j < waypoint_buffer.size()) &&
-          (waypoint_buffer.front()->DistanceSquared(target_waypoint)
-          < std::pow(target_point_distance, 2));
-          ++j) {
-        target_waypoint = waypoint_buffer.at(j);
-      }
-      const cg::Location target_location = target_waypoint->GetLocation();
-      float dot_product = DeviationDotProduct(vehicle, vehicle_location, target_location);
-      float cross_product = DeviationCrossProduct(vehicle, vehicle_location, target_location);
-      dot_product = 1.0f - dot_product;
-      if (cross_product < 0.0f) {
-        dot_product *= -1.0f;
-      }
-
-      float distance = 0.0f; // TODO: use in PID
-
-      // Filtering out false junctions on highways:
-      // on highways, if there is only one possible path and the section is
-      // marked as intersection, ignore it.
-      const auto vehicle_reference = boost::static_pointer_cast<cc::Vehicle>(vehicle);
-      const float speed_limit = vehicle_reference->GetSpeedLimit();
-      const float look_ahead_distance = std::max(2.0f * vehicle_velocity, MINIMUM_JUNCTION_LOOK_AHEAD);
-
-      SimpleWaypointPtr look_ahead_point = waypoint_buffer.front();
-      uint64_t look_ahead_index = 0u;
-      for (uint64_t j = 0u;
-          (waypoint_buffer.front()->DistanceSquared(look_ahead_point)
-          < std::pow(look_ahead_distance, 2)) &&
-          (j < waypoint_buffer.size());
-          ++j) {
-        look_ahead_point = waypoint_buffer.at(j);
-        look_ahead_index = j;
-      }
-
-      bool approaching_junction = false;
-      if (look_ahead_point->CheckJunction() && !(waypoint_buffer.front()->CheckJunction())) {
-        if (speed_limit*3.6f > HIGHWAY_SPEED) {
-          for (uint64_t j = 0u; (j < look_ahead_index) && !approaching_junction; ++j) {
-            SimpleWaypointPtr swp = waypoint_buffer.at(j);
-            if (swp->GetNextWaypoint().size() > 1) {
-              approaching_junction = true;
-            }
-          }
-        } else {
-          approaching_junction = true;
-        }
+      const WaypointIdRange next_waypoints = local_map.GetNextWaypoints(waypoint_buffer.back());
+      uint64_t selection_index = 0u;
+      // Pseudo-randomized path selection if found more than one choice.
+      if (next_waypoints.size() > 1) {
+        selection_index = random_generator.NextIndex(next_waypoints.size());
       }
+      PushWaypoint(waypoint_buffer, actor_id, next_waypoints.at(selection_index), passing_updates);
+    }
 
-      // Reset the variables when no longer approaching a junction.
-      if (!approaching_junction && approached[actor_id]){
-        final_safe_points[actor_id] = nullptr;
-        approached[actor_id] = false;
-      }
+    // Generating output.
+    const float target_point_distance = std::max(std::ceil(vehicle_velocity * TARGET_WAYPOINT_TIME_HORIZON),
+        TARGET_WAYPOINT_HORIZON_LENGTH);
+    WaypointId target_waypoint = waypoint_buffer.front();
+    for (uint64_t j = 0u;
+        (j < waypoint_buffer.size()) &&
+        (local_map.DistanceSquared(waypoint_buffer.front(), target_waypoint)
+        < std::pow(target_point_distance, 2));
+        ++j) {
+      target_waypoint = waypoint_buffer.at(j);
+    }
+    const cg::Location target_location = local_map.GetLocation(target_waypoint);
+    float dot_product = DeviationDotProduct(vehicle, vehicle_location, target_location);
+    float cross_product = DeviationCrossProduct(vehicle, vehicle_location, target_location);
+    dot_product = 1.0f - dot_product;
+    if (cross_product < 0.0f) {
+      dot_product *= -1.0f;
+    }
 
-      // Only do once, when the junction has just been seen.
-      else if (approaching_junction && !approached[actor_id]){
+    float distance = 0.0f; // TODO: use in PID
+
+    // Filtering out false junctions on highways:
+    // on highways, if there is only one possible path and the section is
+    // marked as intersection, ignore it.
+    const auto vehicle_reference = boost::static_pointer_cast<cc::Vehicle>(vehicle);
+    const float speed_limit = vehicle_reference->GetSpeedLimit();
+    const float look_ahead_distance = std::max(2.0f * vehicle_velocity, MINIMUM_JUNCTION_LOOK_AHEAD);
+
+    WaypointId look_ahead_point = waypoint_buffer.front();
+    uint64_t look_ahead_index = 0u;
+    for (uint64_t j = 0u;
+        (local_map.DistanceSquared(waypoint_buffer.front(), look_ahead_point)
+        < std::pow(look_ahead_distance, 2)) &&
+        (j < waypoint_buffer.size());
+        ++j) {
+      look_ahead_point = waypoint_buffer.at(j);
+      look_ahead_index = j;
+    }
 
-        SimpleWaypointPtr final_point = nullptr;
-        final_point = GetSafeLocationAfterJunction(vehicle_reference, waypoint_buffer);
-        if(final_point != nullptr){
-          final_safe_points[actor_id] = final_point;
-          approaching_junction = false;
-          approached[actor_id] = true;
+    bool approaching_junction = false;
+    if (local_map.CheckJunction(look_ahead_point) && !local_map.CheckJunction(waypoint_buffer.front())) {
+      if (speed_limit*3.6f > HIGHWAY_SPEED) {
+        for (uint64_t j = 0u; (j < look_ahead_index) && !approaching_junction; ++j) {
+          if (local_map.GetNextWaypoints(waypoint_buffer.at(j)).size() > 1) {
+            approaching_junction = true;
+          }
         }
+      } else {
+        approaching_junction = true;
       }
+    }
 
-      // Editing output frames.
-      LocalizationToPlannerData &planner_message = current_planner_frame->at(i);
-      planner_message.actor = vehicle;
-      planner_message.deviation = dot_product;
-      planner_message.distance = distance;
-      planner_message.approaching_true_junction = approaching_junction;
-
-      LocalizationToCollisionData &collision_message = current_collision_frame->at(i);
-      collision_message.actor = vehicle;
-      collision_message.buffer = waypoint_buffer;
-      collision_message.overlapping_actors.clear();
-      ActorIdSet overlapping_actor_set = track_traffic.GetOverlappingVehicles(actor_id);
-      for (ActorId overlapping_actor_id: overlapping_actor_set) {
-        Actor actor_ptr = nullptr;
-        if (vehicle_id_to_index.find(overlapping_actor_id) != vehicle_id_to_index.end()) {
-          actor_ptr = actor_list.at(vehicle_id_to_index.at(overlapping_actor_id));
-        } else if (unregistered_actors.find(overlapping_actor_id) != unregistered_actors.end()) {
-          actor_ptr = unregistered_actors.at(overlapping_actor_id);
-        }
-        if (actor_ptr!=nullptr) {
-          collision_message.overlapping_actors.insert({overlapping_actor_id, actor_ptr});
-        }
-        collision_message.safe_point_after_junction = final_safe_points[actor_id];
-      }
-      collision_message.closest_waypoint = waypoint_buffer.front();
-      collision_message.junction_look_ahead_waypoint = waypoint_buffer.at(look_ahead_index);
+    // Reset the variables when no longer approaching a junction.
+    bool &has_approached = approached.at(actor_id);
+    if (!approaching_junction && has_approached){
+      final_safe_points.at(actor_id) = InMemoryMap::NO_WAYPOINT;
+      has_approached = false;
+    }
 
-      LocalizationToTrafficLightData &traffic_light_message = current_traffic_light_frame->at(i);
-      traffic_light_message.actor = vehicle;
-      traffic_light_message.closest_waypoint = waypoint_buffer.front();
-      traffic_light_message.junction_look_ahead_waypoint = waypoint_buffer.at(look_ahead_index);
+    // Only do once, when the junction has just been seen.
+    else if (approaching_junction && !has_approached){
 
-      // Updating idle time when necessary.
-      UpdateIdleTime(vehicle);
+      WaypointId final_point = GetSafeLocationAfterJunction(vehicle_reference, waypoint_buffer,
+                                                            random_generator, passing_updates);
+      if(final_point != InMemoryMap::NO_WAYPOINT){
+        final_safe_points.at(actor_id) = final_point;
+        approaching_junction = false;
+        has_approached = true;
+      }
     }
 
-    if (IsVehicleStuck(maximum_idle_time.first)) {
-      TryDestroyVehicle(maximum_idle_time.first);
+    // Editing output frames.
+    planner_message.actor = vehicle;
+    planner_message.deviation = dot_product;
+    planner_message.distance = distance;
+    planner_message.approaching_true_junction = approaching_junction;
+
+    collision_message.actor = vehicle;
+    collision_message.buffer = waypoint_buffer;
+    collision_message.safe_point_after_junction = final_safe_points.at(actor_id);
+    collision_message.closest_waypoint = waypoint_buffer.front();
+    collision_message.junction_look_ahead_waypoint = waypoint_buffer.at(look_ahead_index);
+
+    traffic_light_message.actor = vehicle;
+    traffic_light_message.closest_waypoint = waypoint_buffer.front();
+    traffic_light_message.junction_look_ahead_waypoint = waypoint_buffer.at(look_ahead_index);
+
+    // Updating idle time when necessary.
+    UpdateIdleTime(vehicle, chunk_maximum_idle_time);
+  }
+
+  void LocalizationStage::CollectOverlappingActors(const ActorId actor_id,
+                                                   LocalizationToCollisionData &collision_message) const {
+
+    collision_message.overlapping_actors.clear();
+    ActorIdSet overlapping_actor_set = track_traffic.GetOverlappingVehicles(actor_id);
+    for (ActorId overlapping_actor_id: overlapping_actor_set) {
+      Actor actor_ptr = nullptr;
+      if (vehicle_id_to_index.find(overlapping_actor_id) != vehicle_id_to_index.end()) {
+        actor_ptr = actor_list.at(vehicle_id_to_index.at(overlapping_actor_id));
+      } else if (unregistered_actors.find(overlapping_actor_id) != unregistered_actors.end()) {
+        actor_ptr = unregistered_actors.at(overlapping_actor_id);
+      }
+      if (actor_ptr!=nullptr) {
+        collision_message.overlapping_actors.insert({overlapping_actor_id, actor_ptr});
+      }
     }
+  }
 
-    // Updating maximum idle time to null for the next iteration.
-    maximum_idle_time = std::make_pair(nullptr, current_timestamp.elapsed_seconds);
+  void LocalizationStage::ApplyPassingVehicleUpdates() {
+
+    for (PassingVehicleUpdates &passing_updates : passing_vehicle_updates) {
+      for (const PassingVehicleUpdate &update : passing_updates) {
+        if (update.passing) {
+          track_traffic.UpdatePassingVehicle(update.waypoint, update.actor_id);
+        } else {
+          track_traffic.RemovePassingVehicle(update.waypoint, update.actor_id);
+        }
+      }
+      passing_updates.clear();
+    }
   }
 
   void LocalizationStage::DataReceiver() {
@@ -350,6 +449,7 @@ namespace LocalizationConstants {
         actor_list_to_be_deleted.emplace_back(actor);
         track_traffic.DeleteActor(actor->GetId());
         last_lane_change_location.erase(actor->GetId());
+        random_generators.erase(actor->GetId());
       }
     }
 
@@ -408,28 +508,28 @@ namespace LocalizationConstants {
   void LocalizationStage::DrawBuffer(Buffer &buffer) {
 
     for (uint64_t i = 0u; i < buffer.size(); ++i) {
-      if(buffer.at(i)->GetWaypoint()->IsJunction()){
-        debug_helper.DrawPoint(buffer.at(i)->GetLocation() + cg::Location(0.0f,0.0f,2.0f), 0.3f, {0u, 0u, 255u}, 0.05f);
+      const cg::Location location = local_map.GetLocation(buffer.at(i));
+      if(local_map.GetSimpleWaypoint(buffer.at(i))->GetWaypoint()->IsJunction()){
+        debug_helper.DrawPoint(location + cg::Location(0.0f,0.0f,2.0f), 0.3f, {0u, 0u, 255u}, 0.05f);
       } else {
-        debug_helper.DrawPoint(buffer.at(i)->GetLocation() + cg::Location(0.0f,0.0f,2.0f), 0.3f, {0u, 255u, 255u}, 0.05f);
+        debug_helper.DrawPoint(location + cg::Location(0.0f,0.0f,2.0f), 0.3f, {0u, 255u, 255u}, 0.05f);
       }
     }
   }
 
-  void LocalizationStage::PushWaypoint(Buffer& buffer, ActorId actor_id, SimpleWaypointPtr& waypoint) {
+  void LocalizationStage::PushWaypoint(Buffer& buffer, ActorId actor_id, WaypointId waypoint,
+                                       PassingVehicleUpdates &passing_updates) {
 
-    const uint64_t waypoint_id = waypoint->GetId();
     buffer.push_back(waypoint);
-    track_traffic.UpdatePassingVehicle(waypoint_id, actor_id);
+    passing_updates.push_back({waypoint, actor_id, true});
   }
 
-  void LocalizationStage::PopWaypoint(Buffer& buffer, ActorId actor_id) {
+  void LocalizationStage::PopWaypoint(Buffer& buffer, ActorId actor_id,
+                                      PassingVehicleUpdates &passing_updates) {
 
-    SimpleWaypointPtr removed_waypoint = buffer.front();
-    SimpleWaypointPtr remaining_waypoint = nullptr;
-    const uint64_t removed_waypoint_id = removed_waypoint->GetId();
+    const WaypointId removed_waypoint = buffer.front();
     buffer.pop_front();
-    track_traffic.RemovePassingVehicle(removed_waypoint_id, actor_id);
+    passing_updates.push_back({removed_waypoint, actor_id, false});
   }
 
   void LocalizationStage::ScanUnregisteredVehicles() {
@@ -485,24 +585,24 @@ namespace LocalizationConstants {
         cg::Location location = it->second->GetLocation();
         const auto type = it->second->GetTypeId();
 
-        SimpleWaypointPtr nearest_waypoint = nullptr;
+        WaypointId nearest_waypoint = InMemoryMap::NO_WAYPOINT;
         if (type[0] == 'v') {
           nearest_waypoint = local_map.GetWaypointInVicinity(location);
         } else if (type[0] == 'w') {
           nearest_waypoint = local_map.GetPedWaypoint(location);
         }
-        if (nearest_waypoint == nullptr) {
+        if (nearest_waypoint == InMemoryMap::NO_WAYPOINT) {
           nearest_waypoint = local_map.GetWaypoint(location);
         }
 
-        track_traffic.UpdateUnregisteredGridPosition(it->first, nearest_waypoint);
+        track_traffic.UpdateUnregisteredGridPosition(it->first, nearest_waypoint, local_map);
 
         ++it;
       }
     }
   }
 
-  SimpleWaypointPtr LocalizationStage::AssignLaneChange(Actor vehicle, const cg::Location &vehicle_location,
+  WaypointId LocalizationStage::AssignLaneChange(Actor vehicle, const cg::Location &vehicle_location,
                                                         bool force, bool direction)
   {
 
@@ -510,8 +610,8 @@ namespace LocalizationConstants {
     const float vehicle_velocity = vehicle->GetVelocity().Length();
 
     // Waypoint representing the new starting point for the waypoint buffer
-    // due to lane change. Remains nullptr if lane change not viable.
-    SimpleWaypointPtr change_over_point = nullptr;
+    // due to lane change. Remains NO_WAYPOINT if lane change not viable.
+    WaypointId change_over_point = InMemoryMap::NO_WAYPOINT;
 
     // Retrieve waypoint buffer for current vehicle.
     const Buffer& waypoint_buffer = buffer_list->at(actor_id);
@@ -520,9 +620,9 @@ namespace LocalizationConstants {
     if (!waypoint_buffer.empty())
     {
       // Get the left and right waypoints for the current closest waypoint.
-      const SimpleWaypointPtr& current_waypoint = waypoint_buffer.front();
-      const SimpleWaypointPtr left_waypoint = current_waypoint->GetLeftWaypoint();
-      const SimpleWaypointPtr right_waypoint = current_waypoint->GetRightWaypoint();
+      const WaypointId current_waypoint = waypoint_buffer.front();
+      const WaypointId left_waypoint = local_map.GetLeftWaypoint(current_waypoint);
+      const WaypointId right_waypoint = local_map.GetRightWaypoint(current_waypoint);
 
       // Retrieve vehicles with overlapping waypoint buffers with current vehicle.
       const auto blocking_vehicles = track_traffic.GetOverlappingVehicles(actor_id);
@@ -542,21 +642,23 @@ namespace LocalizationConstants {
             && !buffer_list->at(other_actor_id).empty())
         {
           const Buffer& other_buffer = buffer_list->at(other_actor_id);
-          const SimpleWaypointPtr& other_current_waypoint = other_buffer.front();
-          const cg::Location other_location = other_current_waypoint->GetLocation();
+          const WaypointId other_current_waypoint = other_buffer.front();
+          const cg::Location other_location = local_map.GetLocation(other_current_waypoint);
 
-          const cg::Vector3D reference_heading = current_waypoint->GetForwardVector();
-          cg::Vector3D reference_to_other = other_current_waypoint->GetLocation()
-                                            - current_waypoint->GetLocation();
-          const cg::Vector3D other_heading = other_current_waypoint->GetForwardVector();
+          const cg::Vector3D reference_heading = local_map.GetForwardVector(current_waypoint);
+          cg::Vector3D reference_to_other = local_map.GetLocation(other_current_waypoint)
+                                            - local_map.GetLocation(current_waypoint);
+          const cg::Vector3D other_heading = local_map.GetForwardVector(other_current_waypoint);
 
           // Check both vehicles are not in junction,
           // Check if the other vehicle is in front of the current vehicle,
           // Check if the two vehicles have acceptable angular deviation between their headings.
-          if (!current_waypoint->CheckJunction()
-              && !other_current_waypoint->CheckJunction()
-              && other_current_waypoint->GetWaypoint()->GetRoadId() == current_waypoint->GetWaypoint()->GetRoadId()
-              && other_current_waypoint->GetWaypoint()->GetLaneId() == current_waypoint->GetWaypoint()->GetLaneId()
+          if (!local_map.CheckJunction(current_waypoint)
+              && !local_map.CheckJunction(other_current_waypoint)
+              && local_map.GetSimpleWaypoint(other_current_waypoint)->GetWaypoint()->GetRoadId()
+                 == local_map.GetSimpleWaypoint(current_waypoint)->GetWaypoint()->GetRoadId()
+              && local_map.GetSimpleWaypoint(other_current_waypoint)->GetWaypoint()->GetLaneId()
+                 == local_map.GetSimpleWaypoint(current_waypoint)->GetWaypoint()->GetLaneId()
               && cg::Math::Dot(reference_heading, reference_to_other) > 0.0f
               && cg::Math::Dot(reference_heading, other_heading) > MAXIMUM_LANE_OBSTACLE_CURVATURE)
           {
@@ -582,9 +684,9 @@ namespace LocalizationConstants {
       if (!obstacle_too_close && obstacle_actor_id != 0u && !force)
       {
         const Buffer& other_buffer = buffer_list->at(obstacle_actor_id);
-        const SimpleWaypointPtr& other_current_waypoint = other_buffer.front();
-        const auto other_neighbouring_lanes = {other_current_waypoint->GetLeftWaypoint(),
-                                               other_current_waypoint->GetRightWaypoint()};
+        const WaypointId other_current_waypoint = other_buffer.front();
+        const auto other_neighbouring_lanes = {local_map.GetLeftWaypoint(other_current_waypoint),
+                                               local_map.GetRightWaypoint(other_current_waypoint)};
 
         // Flags reflecting whether adjacent lanes are free near the obstacle.
         bool distant_left_lane_free = false;
@@ -592,9 +694,9 @@ namespace LocalizationConstants {
 
         // Check if the neighbouring lanes near the obstructing vehicle are free of other vehicles.
         bool left_right = true;
-        for (auto& candidate_lane_wp: other_neighbouring_lanes) {
-          if (candidate_lane_wp != nullptr &&
-              track_traffic.GetPassingVehicles(candidate_lane_wp->GetId()).size() == 0) {
+        for (WaypointId candidate_lane_wp: other_neighbouring_lanes) {
+          if (candidate_lane_wp != InMemoryMap::NO_WAYPOINT &&
+              track_traffic.GetPassingVehicles(candidate_lane_wp).size() == 0) {
 
             if (left_right) distant_left_lane_free = true;
             else distant_right_lane_free = true;
@@ -605,35 +707,35 @@ namespace LocalizationConstants {
 
         // Based on what lanes are free near the obstacle,
         // find the change over point with no vehicles passing through them.
-        if (distant_right_lane_free && right_waypoint != nullptr
-            && track_traffic.GetPassingVehicles(right_waypoint->GetId()).size() == 0)
+        if (distant_right_lane_free && right_waypoint != InMemoryMap::NO_WAYPOINT
+            && track_traffic.GetPassingVehicles(right_waypoint).size() == 0)
         {
           change_over_point = right_waypoint;
-        } else if (distant_left_lane_free && left_waypoint != nullptr
-                   && track_traffic.GetPassingVehicles(left_waypoint->GetId()).size() == 0)
+        } else if (distant_left_lane_free && left_waypoint != InMemoryMap::NO_WAYPOINT
+                   && track_traffic.GetPassingVehicles(left_waypoint).size() == 0)
         {
           change_over_point = left_waypoint;
         }
       } else if (force) {
-        if (direction && right_waypoint != nullptr) {
+        if (direction && right_waypoint != InMemoryMap::NO_WAYPOINT) {
           change_over_point = right_waypoint;
-        } else if (!direction && left_waypoint != nullptr) {
+        } else if (!direction && left_waypoint != InMemoryMap::NO_WAYPOINT) {
           change_over_point = left_waypoint;
         }
       }
 
-      if (change_over_point != nullptr)
+      if (change_over_point != InMemoryMap::NO_WAYPOINT)
       {
         const float change_over_distance =  cg::Math::Clamp(1.5f*vehicle_velocity, 3.0f, 20.0f);
         const auto starting_point = change_over_point;
-        while (change_over_point->DistanceSquared(starting_point) < std::pow(change_over_distance, 2) &&
-              !change_over_point->CheckJunction()) {
-          change_over_point = change_over_point->GetNextWaypoint()[0];
+        while (local_map.DistanceSquared(change_over_point, starting_point) < std::pow(change_over_distance, 2) &&
+              !local_map.CheckJunction(change_over_point)) {
+          change_over_point = local_map.GetNextWaypoints(change_over_point)[0];
         }
 
         // Reset this variable if needed
-        if (approached[actor_id]){
-          approached[actor_id] = false;
+        if (approached.at(actor_id)){
+          approached.at(actor_id) = false;
         }
       }
     }
@@ -641,38 +743,39 @@ namespace LocalizationConstants {
     return change_over_point;
   }
 
-  SimpleWaypointPtr LocalizationStage::GetSafeLocationAfterJunction(const Vehicle &vehicle, Buffer &waypoint_buffer){
+  WaypointId LocalizationStage::GetSafeLocationAfterJunction(const Vehicle &vehicle, Buffer &waypoint_buffer,
+                                                             RandomGenerator &random_generator,
+                                                             PassingVehicleUpdates &passing_updates){
 
     ActorId actor_id = vehicle->GetId();
     // Get the length of the car
     float length = vehicle->GetBoundingBox().extent.x;
     // First Waypoint before the junction
-    const SimpleWaypointPtr initial_point;
     uint64_t initial_index = 0;
     // First Waypoint after the junction
-    SimpleWaypointPtr safe_point = nullptr;
+    WaypointId safe_point = InMemoryMap::NO_WAYPOINT;
     uint64_t safe_index = 0;
     // Vehicle position after the junction
-    SimpleWaypointPtr final_point = nullptr;
+    WaypointId final_point = InMemoryMap::NO_WAYPOINT;
     // Safe space after the junction
     const float safe_distance = 1.5f*length;
 
     for (uint64_t j = 0u; j < waypoint_buffer.size(); ++j){
-      if (waypoint_buffer.at(j)->CheckJunction()){
+      if (local_map.CheckJunction(waypoint_buffer.at(j))){
         initial_index = j;
         break;
       }
     }
 
     // Stop if something failed
-    if (initial_index == 0 && !waypoint_buffer.front()->CheckJunction()){
+    if (initial_index == 0 && !local_map.CheckJunction(waypoint_buffer.front())){
       return final_point;
     }
 
     // 2) Search for the end of the intersection (if it is in the buffer)
     for (uint64_t i = initial_index; i < waypoint_buffer.size(); ++i){
 
-      if (!waypoint_buffer.at(i)->CheckJunction()){
+      if (!local_map.CheckJunction(waypoint_buffer.at(i))){
         safe_point = waypoint_buffer.at(i);
         safe_index = i;
         break;
@@ -680,16 +783,16 @@ namespace LocalizationConstants {
     }
 
     // If it hasn't been found, extend the buffer
-    if(safe_point == nullptr){
-      while (waypoint_buffer.back()->CheckJunction()) {
+    if(safe_point == InMemoryMap::NO_WAYPOINT){
+      while (local_map.CheckJunction(waypoint_buffer.back())) {
 
-          std::vector<SimpleWaypointPtr> next_waypoints = waypoint_buffer.back()->GetNextWaypoint();
+          const WaypointIdRange next_waypoints = local_map.GetNextWaypoints(waypoint_buffer.back());
           uint64_t selection_index = 0u;
           if (next_waypoints.size() > 1) {
-            selection_index = static_cast<uint64_t>(rand()) % next_waypoints.size();
+            selection_index = random_generator.NextIndex(next_waypoints.size());
           }
 
-          PushWaypoint(waypoint_buffer, actor_id, next_waypoints.at(selection_index));
+          PushWaypoint(waypoint_buffer, actor_id, next_waypoints.at(selection_index), passing_updates);
         }
       // Save the last one
       safe_point = waypoint_buffer.back();
@@ -704,25 +807,25 @@ namespace LocalizationConstants {
 
     for(uint64_t k = safe_index; k < waypoint_buffer.size(); ++k){
 
-      if(safe_point->Distance(waypoint_buffer.at(k)->GetLocation()) > safe_distance){
+      if(local_map.GetLocation(safe_point).Distance(local_map.GetLocation(waypoint_buffer.at(k))) > safe_distance){
         final_point = waypoint_buffer.at(k);
         break;
       }
     }
 
     // If it hasn't been found, extend the buffer
-    if(final_point == nullptr){
-      while (safe_point->Distance(waypoint_buffer.back()->GetLocation()) < safe_distance) {
+    if(final_point == InMemoryMap::NO_WAYPOINT){
+      while (local_map.GetLocation(safe_point).Distance(local_map.GetLocation(waypoint_buffer.back())) < safe_distance) {
 
         // Record the last point as a safe one and save it
-        std::vector<SimpleWaypointPtr> next_waypoints = waypoint_buffer.back()->GetNextWaypoint();
+        const WaypointIdRange next_waypoints = local_map.GetNextWaypoints(waypoint_buffer.back());
         uint64_t selection_index = 0u;
         // Pseudo-randomized path selection if found more than one choice.
         if (next_waypoints.size() > 1) {
-          selection_index = static_cast<uint64_t>(rand()) % next_waypoints.size();
+          selection_index = random_generator.NextIndex(next_waypoints.size());
         }
 
-        PushWaypoint(waypoint_buffer, actor_id, next_waypoints.at(selection_index));
+        PushWaypoint(waypoint_buffer, actor_id, next_waypoints.at(selection_index), passing_updates);
       }
       final_point = waypoint_buffer.back();
     }
@@ -730,19 +833,19 @@ namespace LocalizationConstants {
     return final_point;
   }
 
-  void LocalizationStage::UpdateIdleTime(const Actor& actor) {
+  void LocalizationStage::UpdateIdleTime(const Actor& actor, std::pair<Actor, double> &chunk_maximum_idle_time) {
     if (idle_time.find(actor->GetId()) == idle_time.end()) {
       return;
     }
 
     const auto vehicle = boost::static_pointer_cast<cc::Vehicle>(actor);
     if (actor->GetVelocity().Length() > STOPPED_VELOCITY_THRESHOLD || (vehicle->IsAtTrafficLight() && vehicle->GetTrafficLightState() != TLS::Green)) {
-      idle_time[actor->GetId()] = current_timestamp.elapsed_seconds;
+      idle_time.at(actor->GetId()) = current_timestamp.elapsed_seconds;
     }
 
     // Checking maximum idle time.
-    if (maximum_idle_time.first == nullptr || maximum_idle_time.second > idle_time[actor->GetId()]) {
-      maximum_idle_time = std::make_pair(actor, idle_time[actor->GetId()]);
+    if (chunk_maximum_idle_time.first == nullptr || chunk_maximum_idle_time.second > idle_time.at(actor->GetId())) {
+      chunk_maximum_idle_time = std::make_pair(actor, idle_time.at(actor->GetId()));
     }
   }
 
@@ -763,11 +866,12 @@ namespace LocalizationConstants {
   void LocalizationStage::CleanActor(const ActorId actor_id) {
     track_traffic.DeleteActor(actor_id);
     for (const auto& waypoint : buffer_list->at(actor_id)) {
-      track_traffic.RemovePassingVehicle(waypoint->GetId(), actor_id);
+      track_traffic.RemovePassingVehicle(waypoint, actor_id);
     }
 
     idle_time.erase(actor_id);
     buffer_list->erase(actor_id);
+    random_generators.erase(actor_id);
   }
 
   bool LocalizationStage::TryDestroyVehicle(const Actor& actor) {
@@ -32,8 +32,10 @@
 #include "carla/trafficmanager/MessengerAndDataTypes.h"
 #include "carla/trafficmanager/Parameters.h"
 #include "carla/trafficmanager/PipelineStage.h"
+#include "carla/trafficmanager/RandomGenerator.h"
 #include "carla/trafficmanager/SimpleWaypoint.h"
 #include "carla/trafficmanager/PerformanceDiagnostics.h"
+#include "carla/trafficmanager/WorkerPool.h"
 
 #include "carla/client/detail/ActorVariant.h"
 #include "carla/client/detail/EpisodeProxy.h"
@@ -58,6 +60,25 @@ namespace traffic_manager {
 
   private:
 
+    /// Change to the vehicles passing through a waypoint, recorded while
+    /// vehicles are processed in parallel and applied to the traffic tracker
+    /// afterwards.
+    struct PassingVehicleUpdate {
+      WaypointId waypoint;
+      ActorId actor_id;
+      /// True if the vehicle was added to the waypoint, false if removed.
+      bool passing;
+    };
+    using PassingVehicleUpdates = std::vector<PassingVehicleUpdate>;
+
+    /// State of a vehicle carried between the passes of one update cycle.
+    struct VehicleState {
+      cg::Location location;
+      float velocity;
+      /// Start of the new buffer if a lane change was chosen.
+      WaypointId change_over_point;
+    };
+
     /// Section keys to switch between the output data frames.
     bool planner_frame_selector;
     bool collision_frame_selector;
@@ -102,7 +123,7 @@ namespace traffic_manager {
     /// Used to only calculate the extended buffer once at junctions
     std::map<carla::ActorId, bool> approached;
     /// Point used to know if the junction has free space after its end, mapped to their respective actor id
-    std::map<carla::ActorId, SimpleWaypointPtr> final_safe_points;
+    std::map<carla::ActorId, WaypointId> final_safe_points;
     /// Object for tracking paths of the traffic vehicles.
     TrackTraffic track_traffic;
     /// Map of all vehicles' idle time.
@@ -122,26 +143,57 @@ namespace traffic_manager {
     SnippetProfiler snippet_profiler;
     /// Map to keep track of last lane change location.
     std::unordered_map<ActorId, cg::Location> last_lane_change_location;
+    /// Pool of threads the per-vehicle passes are split over.
+    std::shared_ptr<WorkerPool> worker_pool;
+    /// Per-vehicle random generators for path and lane choices.
+    std::unordered_map<ActorId, RandomGenerator> random_generators;
+    /// Seed of the random generators of new vehicles.
+    uint64_t random_seed;
+    /// Per-vehicle state of the current update cycle, indexed like actor_list.
+    std::vector<VehicleState> vehicle_states;
+    /// Per-chunk scratch state of the parallel passes. Chunks are contiguous
+    /// and in order, so applying them in order follows vehicle order.
+    std::vector<PassingVehicleUpdates> passing_vehicle_updates;
+    std::vector<std::pair<Actor, double>> chunk_maximum_idle_times;
+
+    /// Parallel passes over the registered vehicles, in the order they run
+    /// in each update cycle. Each only modifies data of its own vehicle.
+    void PurgeBuffer(const uint64_t index, PassingVehicleUpdates &passing_updates);
+    void SelectLaneChange(const uint64_t index);
+    void UpdateVehicle(const uint64_t index,
+                       LocalizationToPlannerData &planner_message,
+                       LocalizationToCollisionData &collision_message,
+                       LocalizationToTrafficLightData &traffic_light_message,
+                       PassingVehicleUpdates &passing_updates,
+                       std::pair<Actor, double> &chunk_maximum_idle_time);
+    void CollectOverlappingActors(const ActorId actor_id,
+                                  LocalizationToCollisionData &collision_message) const;
+
+    /// Applies the passing vehicle updates of all chunks to the traffic tracker.
+    void ApplyPassingVehicleUpdates();
 
     /// A simple method used to draw waypoint buffer ahead of a vehicle.
     void DrawBuffer(Buffer &buffer);
 
     /// Method to determine lane change and obtain target lane waypoint.
-    SimpleWaypointPtr AssignLaneChange(Actor vehicle, const cg::Location &vehicle_location, bool force, bool direction);
+    WaypointId AssignLaneChange(Actor vehicle, const cg::Location &vehicle_location, bool force, bool direction);
 
     // When near an intersection, extends the buffer throughout all the
     // intersection to see if there is space after it
-    SimpleWaypointPtr GetSafeLocationAfterJunction(const Vehicle &vehicle, Buffer &waypoint_buffer);
+    WaypointId GetSafeLocationAfterJunction(const Vehicle &vehicle, Buffer &waypoint_buffer,
+                                            RandomGenerator &random_generator,
+                                            PassingVehicleUpdates &passing_updates);
 
-    /// Methods to modify waypoint buffer and track traffic.
-    void PushWaypoint(Buffer& buffer, ActorId actor_id, SimpleWaypointPtr& waypoint);
-    void PopWaypoint(Buffer& buffer, ActorId actor_id);
+    /// Methods to modify waypoint buffer and record the traffic changes.
+    void PushWaypoint(Buffer& buffer, ActorId actor_id, WaypointId waypoint,
+                      PassingVehicleUpdates &passing_updates);
+    void PopWaypoint(Buffer& buffer, ActorId actor_id, PassingVehicleUpdates &passing_updates);
 
     /// Method to scan for unregistered actors and update their grid positioning.
     void ScanUnregisteredVehicles();
 
     /// Methods for idle vehicle elimination.
-    void UpdateIdleTime(const Actor& actor);
+    void UpdateIdleTime(const Actor& actor, std::pair<Actor, double> &chunk_maximum_idle_time);
     bool IsVehicleStuck(const Actor& actor);
     void CleanActor(const ActorId actor_id);
     bool TryDestroyVehicle(const Actor& actor);
@@ -155,6 +207,7 @@ namespace traffic_manager {
       std::shared_ptr<LocalizationToTrafficLightMessenger> traffic_light_messenger,
       AtomicActorSet &registered_actors,
       InMemoryMap &local_map,
+      std::shared_ptr<WorkerPool> worker_pool,
       Parameters &parameters,
       carla::client::DebugHelper &debug_helper,
       carla::client::detail::EpisodeProxy &episodeProxy);
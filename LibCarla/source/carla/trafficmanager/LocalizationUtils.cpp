@@ -61,7 +61,8 @@ namespace LocalizationConstants {
 
   TrackTraffic::TrackTraffic() {}
 
-  void TrackTraffic::UpdateUnregisteredGridPosition(const ActorId actor_id, const SimpleWaypointPtr& waypoint) {
+  void TrackTraffic::UpdateUnregisteredGridPosition(const ActorId actor_id, WaypointId waypoint,
+                                                    const InMemoryMap& local_map) {
 
     // Add actor entry, if not present.
     if (actor_to_grids.find(actor_id) == actor_to_grids.end()) {
@@ -84,9 +85,9 @@ namespace LocalizationConstants {
     current_grids.clear();
 
     // Step through buffer and update grid list for actor and actor list for grids.
-    if (waypoint != nullptr) {
+    if (waypoint != InMemoryMap::NO_WAYPOINT) {
 
-      GeoGridId ggid = waypoint->GetGeodesicGridId();
+      GeoGridId ggid = local_map.GetGeodesicGridId(waypoint);
       current_grids.insert(ggid);
 
       // Add grid entry, if not present.
@@ -102,7 +103,7 @@ namespace LocalizationConstants {
   }
 
 
-  void TrackTraffic::UpdateGridPosition(const ActorId actor_id, const Buffer& buffer) {
+  void TrackTraffic::UpdateGridPosition(const ActorId actor_id, const Buffer& buffer, const InMemoryMap& local_map) {
 
     if (!buffer.empty()) {
 
@@ -130,7 +131,7 @@ namespace LocalizationConstants {
       uint64_t buffer_size = buffer.size();
       uint64_t step_size = static_cast<uint64_t>(std::floor(buffer_size/BUFFER_STEP_THROUGH));
       for (uint64_t i = 0u; i <= BUFFER_STEP_THROUGH; ++i) {
-        GeoGridId ggid = buffer.at(std::min(i* step_size, buffer_size-1u))->GetGeodesicGridId();
+        GeoGridId ggid = local_map.GetGeodesicGridId(buffer.at(std::min(i* step_size, buffer_size-1u)));
         current_grids.insert(ggid);
 
         // Add grid entry if not present.
@@ -146,15 +147,15 @@ namespace LocalizationConstants {
     }
   }
 
-  ActorIdSet TrackTraffic::GetOverlappingVehicles(ActorId actor_id) {
+  ActorIdSet TrackTraffic::GetOverlappingVehicles(ActorId actor_id) const {
 
     ActorIdSet actor_id_set;
 
     if (actor_to_grids.find(actor_id) != actor_to_grids.end()) {
-      std::unordered_set<GeoGridId>& grid_ids = actor_to_grids.at(actor_id);
+      const std::unordered_set<GeoGridId>& grid_ids = actor_to_grids.at(actor_id);
       for (auto& grid_id: grid_ids) {
         if (grid_to_actors.find(grid_id) != grid_to_actors.end()) {
-          ActorIdSet& actor_ids = grid_to_actors.at(grid_id);
+          const ActorIdSet& actor_ids = grid_to_actors.at(grid_id);
           actor_id_set.insert(actor_ids.begin(), actor_ids.end());
         }
       }
@@ -223,7 +224,7 @@ namespace LocalizationConstants {
     }
   }
 
-  ActorIdSet TrackTraffic::GetPassingVehicles(uint64_t waypoint_id) {
+  ActorIdSet TrackTraffic::GetPassingVehicles(uint64_t waypoint_id) const {
 
     if (waypoint_overlap_tracker.find(waypoint_id) != waypoint_overlap_tracker.end()) {
       return waypoint_overlap_tracker.at(waypoint_id);
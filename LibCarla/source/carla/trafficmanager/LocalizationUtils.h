@@ -6,6 +6,9 @@
 
 #pragma once
 
+#include <unordered_map>
+#include <unordered_set>
+
 #include "carla/client/Actor.h"
 #include "carla/client/ActorList.h"
 #include "carla/client/Vehicle.h"
@@ -14,6 +17,7 @@
 #include "carla/road/RoadTypes.h"
 #include "carla/rpc/ActorId.h"
 
+#include "carla/trafficmanager/InMemoryMap.h"
 #include "carla/trafficmanager/SimpleWaypoint.h"
 
 namespace carla {
@@ -24,8 +28,7 @@ namespace traffic_manager {
   using Actor = carla::SharedPtr<cc::Actor>;
   using ActorId = carla::ActorId;
   using ActorIdSet = std::unordered_set<ActorId>;
-  using SimpleWaypointPtr = std::shared_ptr<SimpleWaypoint>;
-  using Buffer = std::deque<SimpleWaypointPtr>;
+  using Buffer = std::deque<WaypointId>;
   using GeoGridId = carla::road::JuncId;
 
   class TrackTraffic{
@@ -47,12 +50,12 @@ namespace traffic_manager {
     /// Methods to update, remove and retrieve vehicles passing through a waypoint.
     void UpdatePassingVehicle(uint64_t waypoint_id, ActorId actor_id);
     void RemovePassingVehicle(uint64_t waypoint_id, ActorId actor_id);
-    ActorIdSet GetPassingVehicles(uint64_t waypoint_id);
+    ActorIdSet GetPassingVehicles(uint64_t waypoint_id) const;
 
-    void UpdateGridPosition(const ActorId actor_id, const Buffer& buffer);
-    void UpdateUnregisteredGridPosition(const ActorId actor_id, const SimpleWaypointPtr& waypoint);
+    void UpdateGridPosition(const ActorId actor_id, const Buffer& buffer, const InMemoryMap& local_map);
+    void UpdateUnregisteredGridPosition(const ActorId actor_id, WaypointId waypoint, const InMemoryMap& local_map);
 
-    ActorIdSet GetOverlappingVehicles(ActorId actor_id);
+    ActorIdSet GetOverlappingVehicles(ActorId actor_id) const;
     /// Method to delete actor data from tracking.
     void DeleteActor(ActorId actor_id);
 
@@ -6,19 +6,31 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <deque>
 #include <condition_variable>
 #include <mutex>
+#include <thread>
 
 namespace carla {
 namespace traffic_manager {
 
   using namespace std::chrono_literals;
 
+  /// Messengers connect one sending stage to one receiving stage. The sender
+  /// Push()es a frame, blocking while the messenger is full. The receiver
+  /// Peek()s at the oldest frame, blocking while the messenger is empty, and
+  /// Pop()s it once done with it. Stages double buffer their output frames,
+  /// so a messenger must hold at most one frame: the sender only reuses a
+  /// frame after the receiver popped it.
+
+  /// Messenger keeping frames in a deque guarded by a mutex.
   template <typename Data>
-  class Messenger {
+  class LockingMessenger {
 
   private:
 
@@ -35,21 +47,19 @@ namespace traffic_manager {
 
   public:
 
-    Messenger() {
+    LockingMessenger() {
       stop_messenger.store(false);
     }
-    ~Messenger() {}
+    ~LockingMessenger() {}
 
     void Push(Data data) {
 
       std::unique_lock<std::mutex> lock(data_modification_mutex);
-      while (!d_queue.empty() && !stop_messenger.load()) {
-        send_condition.wait_for(lock, 1ms, [=] {
-          return (d_queue.empty() && stop_messenger.load());
-        });
-      }
+      send_condition.wait(lock, [this] {
+        return d_queue.empty() || stop_messenger.load();
+      });
       if(!stop_messenger.load()){
-        d_queue.push_front(data);
+        d_queue.push_front(std::move(data));
         receive_condition.notify_one();
       }
     }
@@ -57,11 +67,9 @@ namespace traffic_manager {
     Data Peek() {
 
       std::unique_lock<std::mutex> lock(data_modification_mutex);
-      while (d_queue.empty() && !stop_messenger.load()) {
-        receive_condition.wait_for(lock, 1ms, [=] {
-          return (!d_queue.empty() && stop_messenger.load());
-        });
-      }
+      receive_condition.wait(lock, [this] {
+        return !d_queue.empty() || stop_messenger.load();
+      });
 
       if(!stop_messenger.load()) {
         Data data = d_queue.back();
@@ -73,7 +81,7 @@ namespace traffic_manager {
     void Pop() {
 
       std::unique_lock<std::mutex> lock(data_modification_mutex);
-      if (!(d_queue.empty() && stop_messenger.load())) {
+      if (!d_queue.empty()) {
         d_queue.pop_back();
         send_condition.notify_one();
       }
@@ -84,13 +92,160 @@ namespace traffic_manager {
     }
 
     void Stop() {
-      stop_messenger.store(true);
-      d_queue.clear();
+      {
+        std::lock_guard<std::mutex> lock(data_modification_mutex);
+        stop_messenger.store(true);
+        d_queue.clear();
+      }
       send_condition.notify_one();
       receive_condition.notify_one();
     }
 
   };
 
+  /// Lets a thread wait for a condition on atomics updated by another thread
+  /// without locking in the common case. The waiting thread spins briefly
+  /// and then sleeps. Notify() only takes the lock if a thread is asleep.
+  class MessengerNotifier {
+
+  private:
+
+    /// Number of times the condition is polled before sleeping.
+    static constexpr int SPIN_COUNT = 64;
+
+    std::atomic<uint32_t> sleepers{0u};
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_condition;
+
+  public:
+
+    template <typename PredicateT>
+    void Wait(PredicateT &&ready) {
+
+      for (int i = 0; i < SPIN_COUNT; ++i) {
+        if (ready()) {
+          return;
+        }
+        std::this_thread::yield();
+      }
+
+      std::unique_lock<std::mutex> lock(sleep_mutex);
+      sleepers.fetch_add(1u);
+      // Pairs with the fence in Notify(): either the notifier sees this
+      // sleeper, or the condition below sees the notifier's update.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      sleep_condition.wait(lock, ready);
+      sleepers.fetch_sub(1u);
+    }
+
+    /// Call after updating the state the waiting thread's condition reads.
+    void Notify() {
+
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (sleepers.load() > 0u) {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        sleep_condition.notify_all();
+      }
+    }
+  };
+
+  /// Bounded single-producer/single-consumer ring buffer messenger. Frames
+  /// are moved in and out of their slots, and the sender and receiver only
+  /// synchronise through the read and write counters, so neither blocks the
+  /// other unless the messenger is full or empty.
+  template <typename Data, std::size_t Capacity>
+  class RingBufferMessenger {
+
+    static_assert(Capacity > 0u, "A messenger must hold at least one frame");
+
+  private:
+
+    std::array<Data, Capacity> slots;
+    /// Number of frames pushed, only written by the sender.
+    alignas(64) std::atomic<uint64_t> write_count{0u};
+    /// Number of frames popped, only written by the receiver.
+    alignas(64) std::atomic<uint64_t> read_count{0u};
+    /// Flag used to wake up and join any waiting function calls on this object.
+    std::atomic<bool> stop_messenger{false};
+    /// Wakes the sender when a slot is freed.
+    MessengerNotifier send_notifier;
+    /// Wakes the receiver when a frame is pushed.
+    MessengerNotifier receive_notifier;
+
+  public:
+
+    void Push(Data data) {
+
+      const uint64_t write_index = write_count.load(std::memory_order_relaxed);
+      send_notifier.Wait([this, write_index] {
+        return write_index - read_count.load(std::memory_order_acquire) < Capacity ||
+               stop_messenger.load();
+      });
+      if (!stop_messenger.load()) {
+        slots[write_index % Capacity] = std::move(data);
+        write_count.store(write_index + 1u, std::memory_order_release);
+        receive_notifier.Notify();
+      }
+    }
+
+    Data Peek() {
+
+      const uint64_t read_index = read_count.load(std::memory_order_relaxed);
+      receive_notifier.Wait([this, read_index] {
+        return write_count.load(std::memory_order_acquire) != read_index ||
+               stop_messenger.load();
+      });
+      if (!stop_messenger.load()) {
+        return slots[read_index % Capacity];
+      }
+      return Data();
+    }
+
+    void Pop() {
+
+      const uint64_t read_index = read_count.load(std::memory_order_relaxed);
+      if (write_count.load(std::memory_order_acquire) != read_index) {
+        // Releasing the frame here rather than when the slot is reused.
+        slots[read_index % Capacity] = Data();
+        read_count.store(read_index + 1u, std::memory_order_release);
+        send_notifier.Notify();
+      }
+    }
+
+    /// Must not be called while the sender or receiver is using the messenger.
+    void Start() {
+      for (Data &slot : slots) {
+        slot = Data();
+      }
+      write_count.store(0u);
+      read_count.store(0u);
+      stop_messenger.store(false);
+    }
+
+    void Stop() {
+      stop_messenger.store(true);
+      send_notifier.Notify();
+      receive_notifier.Notify();
+    }
+
+  };
+
+  /// Compile-time selection of the messenger implementation.
+  struct LockingMessengerPolicy {
+    template <typename Data>
+    using Type = LockingMessenger<Data>;
+  };
+
+  template <std::size_t Capacity = 1u>
+  struct RingBufferMessengerPolicy {
+    template <typename Data>
+    using Type = RingBufferMessenger<Data, Capacity>;
+  };
+
+  using DefaultMessengerPolicy = RingBufferMessengerPolicy<>;
+
+  template <typename Data, typename Policy = DefaultMessengerPolicy>
+  using Messenger = typename Policy::template Type<Data>;
+
 } // namespace traffic_manager
 } // namespace carla
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <deque>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -25,7 +26,7 @@ namespace traffic_manager {
   /// Convenience typing.
 
   /// Alias for waypoint buffer used in the localization stage.
-  using Buffer = std::deque<std::shared_ptr<SimpleWaypoint>>;
+  using Buffer = std::deque<WaypointId>;
   /// Alias used for the list of buffers in the localization stage.
   using BufferList = std::unordered_map<carla::ActorId, Buffer>;
 
@@ -55,9 +56,9 @@ namespace traffic_manager {
     Actor actor;
     Buffer buffer;
     std::unordered_map<ActorId, Actor> overlapping_actors;
-    std::shared_ptr<SimpleWaypoint> safe_point_after_junction;
-    std::shared_ptr<SimpleWaypoint> closest_waypoint;
-    std::shared_ptr<SimpleWaypoint> junction_look_ahead_waypoint;
+    WaypointId safe_point_after_junction;
+    WaypointId closest_waypoint;
+    WaypointId junction_look_ahead_waypoint;
   };
 
   /// Type of data sent by the collision stage to the motion planner stage.
@@ -68,8 +69,8 @@ namespace traffic_manager {
   /// Type of data sent by the localization stage to the traffic light stage.
   struct LocalizationToTrafficLightData {
     Actor actor;
-    std::shared_ptr<SimpleWaypoint> closest_waypoint;
-    std::shared_ptr<SimpleWaypoint> junction_look_ahead_waypoint;
+    WaypointId closest_waypoint;
+    WaypointId junction_look_ahead_waypoint;
   };
 
   /// Type of data sent by the traffic light stage to the motion planner stage.
@@ -40,9 +40,37 @@ namespace traffic_manager {
       inter_update_clock = current_time;
     } else {
       const chr::duration<float> last_update_duration = current_time - inter_update_clock;
+      std::lock_guard<std::mutex> lock(diagnostics_mutex);
       inter_update_duration = (inter_update_duration + last_update_duration) / 2.0f;
     }
   }
 
+  void PerformanceDiagnostics::RegisterSnippet(const std::string &snippet_name, chr::duration<float> duration) {
+
+    std::lock_guard<std::mutex> lock(diagnostics_mutex);
+    auto snippet_duration = snippet_durations.find(snippet_name);
+    if (snippet_duration == snippet_durations.end()) {
+      snippet_durations.insert({snippet_name, duration});
+    } else {
+      snippet_duration->second = (snippet_duration->second + duration) / 2.0f;
+    }
+  }
+
+  float PerformanceDiagnostics::GetAverageUpdateDuration() const {
+
+    std::lock_guard<std::mutex> lock(diagnostics_mutex);
+    return 1000.0f * inter_update_duration.count();
+  }
+
+  std::unordered_map<std::string, float> PerformanceDiagnostics::GetAverageSnippetDurations() const {
+
+    std::lock_guard<std::mutex> lock(diagnostics_mutex);
+    std::unordered_map<std::string, float> durations;
+    for (const auto &snippet_duration : snippet_durations) {
+      durations.insert({snippet_duration.first, 1000.0f * snippet_duration.second.count()});
+    }
+    return durations;
+  }
+
 } // namespace traffic_manager
 } // namespace carla
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <chrono>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 
@@ -32,11 +33,26 @@ namespace traffic_manager {
     TimePoint inter_update_clock;
     /// Inter-update duration.
     chr::duration<float> inter_update_duration;
+    /// Average durations of named parts of the stage update.
+    std::unordered_map<std::string, chr::duration<float>> snippet_durations;
+    /// Guards the durations, which are read from other threads.
+    mutable std::mutex diagnostics_mutex;
 
   public:
     PerformanceDiagnostics(std::string name);
 
     void RegisterUpdate(bool begin_or_end);
+
+    /// Records the duration of a named part of the stage update, such as
+    /// one of its parallel passes over vehicles.
+    void RegisterSnippet(const std::string &snippet_name, chr::duration<float> duration);
+
+    /// Average duration of the stage update, in milliseconds.
+    float GetAverageUpdateDuration() const;
+
+    /// Average durations of the parts registered with RegisterSnippet, in
+    /// milliseconds.
+    std::unordered_map<std::string, float> GetAverageSnippetDurations() const;
   };
 
   class SnippetProfiler {
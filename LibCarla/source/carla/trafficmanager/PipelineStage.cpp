@@ -12,7 +12,7 @@ namespace traffic_manager {
 PipelineStage::PipelineStage(
     const std::string &stage_name)
   : stage_name(stage_name),
-    performance_diagnostics(PerformanceDiagnostics(stage_name)) {
+    performance_diagnostics(stage_name) {
   run_stage.store(false);
 }
 
@@ -41,11 +41,11 @@ namespace traffic_manager {
     std::atomic<bool> run_stage;
     /// Stage name string.
     std::string stage_name;
-
-  private:
     /// Object to track stage performance.
     PerformanceDiagnostics performance_diagnostics;
 
+  private:
+
     void Update();
 
   protected:
@@ -71,6 +71,11 @@ namespace traffic_manager {
 
     void Stop();
 
+    /// Timings of the stage, safe to read while the stage is running.
+    const PerformanceDiagnostics &GetPerformanceDiagnostics() const {
+      return performance_diagnostics;
+    }
+
   };
 
 } // namespace traffic_manager
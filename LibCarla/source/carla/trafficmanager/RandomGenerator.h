@@ -0,0 +1,51 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include <cstdint>
+
+#include "carla/rpc/ActorId.h"
+
+namespace carla {
+namespace traffic_manager {
+
+  /// Pseudo-random number generator owned by a single vehicle.
+  /// Stages processing vehicles in parallel draw from the vehicle's own
+  /// generator instead of rand(), so the numbers each vehicle gets do not
+  /// depend on how vehicles are scheduled over threads.
+  class RandomGenerator {
+
+  private:
+
+    uint64_t state;
+
+    /// SplitMix64 step.
+    uint64_t Next() {
+      uint64_t value = (state += 0x9E3779B97F4A7C15ull);
+      value = (value ^ (value >> 30u)) * 0xBF58476D1CE4E5B9ull;
+      value = (value ^ (value >> 27u)) * 0x94D049BB133111EBull;
+      return value ^ (value >> 31u);
+    }
+
+  public:
+
+    RandomGenerator(uint64_t seed, carla::ActorId actor_id)
+      : state(seed ^ (static_cast<uint64_t>(actor_id) * 0xD6E8FEB86659FD93ull)) {}
+
+    /// Returns an integer in [0, bound). Replaces rand() % bound.
+    uint64_t NextIndex(uint64_t bound) {
+      return bound == 0u ? 0u : Next() % bound;
+    }
+
+    /// Returns an integer in [0, 100], as used with percentage parameters.
+    uint64_t NextPercentage() {
+      return NextIndex(101u);
+    }
+  };
+
+} // namespace traffic_manager
+} // namespace carla
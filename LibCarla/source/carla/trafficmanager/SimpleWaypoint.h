@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <stdexcept>
 #include <memory.h>
 
@@ -23,6 +24,8 @@ namespace traffic_manager {
   namespace cg = carla::geom;
   using WaypointPtr = carla::SharedPtr<cc::Waypoint>;
   using GeoGridId = carla::road::JuncId;
+  /// Index of a waypoint in the dense topology of the InMemoryMap.
+  using WaypointId = uint32_t;
 
   /// This is a simple wrapper class on Carla's waypoint object.
   /// The class is used to represent discrete samples of the world map.
@@ -17,11 +17,13 @@ namespace traffic_manager {
       std::string stage_name,
       std::shared_ptr<LocalizationToTrafficLightMessenger> localization_messenger,
       std::shared_ptr<TrafficLightToPlannerMessenger> planner_messenger,
+      const InMemoryMap &local_map,
       Parameters &parameters,
       cc::DebugHelper &debug_helper)
     : PipelineStage(stage_name),
       localization_messenger(localization_messenger),
       planner_messenger(planner_messenger),
+      local_map(local_map),
       parameters(parameters),
       debug_helper(debug_helper){
 
@@ -53,10 +55,9 @@ namespace traffic_manager {
 
       const Actor ego_actor = data.actor;
       const ActorId ego_actor_id = ego_actor->GetId();
-      const SimpleWaypointPtr closest_waypoint = data.closest_waypoint;
-      const SimpleWaypointPtr look_ahead_point = data.junction_look_ahead_waypoint;
+      const WaypointId look_ahead_point = data.junction_look_ahead_waypoint;
 
-      const JunctionID junction_id = look_ahead_point->GetWaypoint()->GetJunctionId();
+      const JunctionID junction_id = local_map.GetSimpleWaypoint(look_ahead_point)->GetJunctionId();
       const TimeInstance current_time = chr::system_clock::now();
 
       const auto ego_vehicle = boost::static_pointer_cast<cc::Vehicle>(ego_actor);
@@ -72,7 +73,7 @@ namespace traffic_manager {
       }
 
       // Handle entry negotiation at non-signalised junction.
-      else if (look_ahead_point->CheckJunction() &&
+      else if (local_map.CheckJunction(look_ahead_point) &&
                !ego_vehicle->IsAtTrafficLight() &&
                traffic_light_state != TLS::Green &&
                parameters.GetPercentageRunningSign(boost::shared_ptr<cc::Actor>(ego_actor)) <= (rand() % 101)) {
@@ -18,6 +18,7 @@
 #include "carla/Memory.h"
 #include "carla/rpc/TrafficLightState.h"
 
+#include "carla/trafficmanager/InMemoryMap.h"
 #include "carla/trafficmanager/MessengerAndDataTypes.h"
 #include "carla/trafficmanager/Parameters.h"
 #include "carla/trafficmanager/PipelineStage.h"
@@ -33,7 +34,6 @@ namespace traffic_manager {
   using ActorId = carla::ActorId;
   using Actor = carla::SharedPtr<cc::Actor>;
   using JunctionID = carla::road::JuncId;
-  using SimpleWaypointPtr = std::shared_ptr<SimpleWaypoint>;
   using TrafficLight = carla::SharedPtr<cc::TrafficLight>;
   using TLS = carla::rpc::TrafficLightState;
   using TimeInstance = chr::time_point<chr::system_clock, chr::nanoseconds>;
@@ -54,6 +54,8 @@ namespace traffic_manager {
     /// Pointers to messenger objects.
     std::shared_ptr<LocalizationToTrafficLightMessenger> localization_messenger;
     std::shared_ptr<TrafficLightToPlannerMessenger> planner_messenger;
+    /// Reference to local map-cache object.
+    const InMemoryMap &local_map;
     /// Runtime parameterization object.
     Parameters &parameters;
     /// Reference to Carla's debug helper object.
@@ -78,6 +80,7 @@ namespace traffic_manager {
         std::string stage_name,
         std::shared_ptr<LocalizationToTrafficLightMessenger> localization_messenger,
         std::shared_ptr<TrafficLightToPlannerMessenger> planner_messenger,
+        const InMemoryMap &local_map,
         Parameters &parameters,
         cc::DebugHelper &debug_helper);
     ~TrafficLightStage();
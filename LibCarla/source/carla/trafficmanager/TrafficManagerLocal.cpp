@@ -53,23 +53,25 @@ void TrafficManagerLocal::Start() {
   traffic_light_planner_messenger = std::make_shared<TrafficLightToPlannerMessenger>();
   planner_control_messenger = std::make_shared<PlannerToControlMessenger>();
 
+  worker_pool = std::make_shared<WorkerPool>();
+
   localization_stage = std::make_unique<LocalizationStage>(
     "Localization stage",
     localization_planner_messenger, localization_collision_messenger,
     localization_traffic_light_messenger,
-    registered_actors, *local_map.get(),
+    registered_actors, *local_map.get(), worker_pool,
     parameters, debug_helper,
     episodeProxyTM);
 
   collision_stage = std::make_unique<CollisionStage>(
     "Collision stage",
     localization_collision_messenger, collision_planner_messenger,
-    parameters, debug_helper);
+    *local_map.get(), worker_pool, parameters, debug_helper);
 
   traffic_light_stage = std::make_unique<TrafficLightStage>(
     "Traffic light stage",
     localization_traffic_light_messenger, traffic_light_planner_messenger,
-    parameters, debug_helper);
+    *local_map.get(), parameters, debug_helper);
 
   planner_stage = std::make_unique<MotionPlannerStage>(
     "Motion planner stage",
@@ -133,6 +135,7 @@ void TrafficManagerLocal::Release() {
   traffic_light_stage.reset();
   planner_stage.reset();
   control_stage.reset();
+  worker_pool.reset();
 }
 
 void TrafficManagerLocal::Reset() {
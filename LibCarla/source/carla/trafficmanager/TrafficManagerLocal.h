@@ -37,6 +37,7 @@
 
 #include "carla/trafficmanager/TrafficManagerBase.h"
 #include "carla/trafficmanager/TrafficManagerServer.h"
+#include "carla/trafficmanager/WorkerPool.h"
 
 namespace carla {
 namespace traffic_manager {
@@ -76,6 +77,8 @@ namespace traffic_manager {
     std::shared_ptr<LocalizationToPlannerMessenger> localization_planner_messenger;
     std::shared_ptr<PlannerToControlMessenger> planner_control_messenger;
     std::shared_ptr<TrafficLightToPlannerMessenger> traffic_light_planner_messenger;
+    /// Pool of threads shared by the stages for their per-vehicle loops.
+    std::shared_ptr<WorkerPool> worker_pool;
 
     /// Pointers to the stage objects of traffic manager.
     std::unique_ptr<CollisionStage> collision_stage;
@@ -0,0 +1,141 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/trafficmanager/WaypointGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "carla/geom/Math.h"
+
+namespace carla {
+namespace traffic_manager {
+
+  constexpr uint32_t WaypointGrid::NO_WAYPOINT;
+
+  WaypointGrid::WaypointGrid(float cell_size) : cell_size(cell_size) {}
+
+  int32_t WaypointGrid::CellCoordinate(float value) const {
+    // Clamping keeps the cast defined for far away or invalid locations, and
+    // leaves room for the neighbouring cells searched by FindClosest.
+    static constexpr double MAXIMUM_CELL_COORDINATE = 1 << 30;
+    const double cell = std::floor(static_cast<double>(value) / cell_size);
+    if (!(cell > -MAXIMUM_CELL_COORDINATE)) {
+      return static_cast<int32_t>(-MAXIMUM_CELL_COORDINATE);
+    }
+    return static_cast<int32_t>(std::min(cell, MAXIMUM_CELL_COORDINATE));
+  }
+
+  uint64_t WaypointGrid::MakeKey(int32_t x, int32_t y) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+  }
+
+  void WaypointGrid::Build(const std::vector<cg::Location> &locations) {
+
+    // Sorting waypoints by cell makes each cell a contiguous range.
+    std::vector<std::pair<uint64_t, uint32_t>> keyed_waypoints;
+    keyed_waypoints.reserve(locations.size());
+    for (uint32_t i = 0u; i < locations.size(); ++i) {
+      keyed_waypoints.emplace_back(
+          MakeKey(CellCoordinate(locations[i].x), CellCoordinate(locations[i].y)), i);
+    }
+    std::sort(keyed_waypoints.begin(), keyed_waypoints.end());
+
+    cell_waypoints.clear();
+    cell_locations.clear();
+    cell_waypoints.reserve(keyed_waypoints.size());
+    cell_locations.reserve(keyed_waypoints.size());
+    for (const auto &keyed_waypoint : keyed_waypoints) {
+      cell_waypoints.push_back(keyed_waypoint.second);
+      cell_locations.push_back(locations[keyed_waypoint.second]);
+    }
+
+    std::size_t num_cells = 0u;
+    for (std::size_t i = 0u; i < keyed_waypoints.size(); ++i) {
+      if (i == 0u || keyed_waypoints[i].first != keyed_waypoints[i - 1u].first) {
+        ++num_cells;
+      }
+    }
+    std::size_t capacity = 16u;
+    while (capacity < 2u * num_cells) {
+      capacity *= 2u;
+    }
+    cells.assign(capacity, Cell{0u, 0u, 0u});
+
+    const uint64_t mask = capacity - 1u;
+    for (std::size_t begin = 0u; begin < keyed_waypoints.size();) {
+      const uint64_t key = keyed_waypoints[begin].first;
+      std::size_t end = begin;
+      while (end < keyed_waypoints.size() && keyed_waypoints[end].first == key) {
+        ++end;
+      }
+      uint64_t slot = (key * 0x9E3779B97F4A7C15ull) & mask;
+      while (cells[slot].begin != cells[slot].end) {
+        slot = (slot + 1u) & mask;
+      }
+      cells[slot] = Cell{key, static_cast<uint32_t>(begin), static_cast<uint32_t>(end)};
+      begin = end;
+    }
+  }
+
+  const WaypointGrid::Cell *WaypointGrid::FindCell(uint64_t key) const {
+    if (cells.empty()) {
+      return nullptr;
+    }
+    const uint64_t mask = cells.size() - 1u;
+    for (uint64_t slot = (key * 0x9E3779B97F4A7C15ull) & mask;; slot = (slot + 1u) & mask) {
+      const Cell &cell = cells[slot];
+      if (cell.begin == cell.end) {
+        return nullptr;
+      }
+      if (cell.key == key) {
+        return &cell;
+      }
+    }
+  }
+
+  uint32_t WaypointGrid::FindClosest(const cg::Location &location) const {
+
+    const int32_t x = CellCoordinate(location.x);
+    const int32_t y = CellCoordinate(location.y);
+    uint32_t closest_waypoint = NO_WAYPOINT;
+    float closest_distance = std::numeric_limits<float>::infinity();
+
+    // Search all surrounding cells for the closest waypoint.
+    for (int32_t i = -1; i <= 1; ++i) {
+      for (int32_t j = -1; j <= 1; ++j) {
+        const Cell *cell = FindCell(MakeKey(x + i, y + j));
+        if (cell == nullptr) {
+          continue;
+        }
+        for (uint32_t k = cell->begin; k < cell->end; ++k) {
+          const float distance = cg::Math::DistanceSquared(cell_locations[k], location);
+          // Ties go to the lowest index, so results do not depend on the
+          // order cells are visited in.
+          if (distance < closest_distance ||
+              (distance == closest_distance && cell_waypoints[k] < closest_waypoint)) {
+            closest_waypoint = cell_waypoints[k];
+            closest_distance = distance;
+          }
+        }
+      }
+    }
+
+    return closest_waypoint;
+  }
+
+  std::vector<uint32_t> WaypointGrid::FindClosest(const std::vector<cg::Location> &locations) const {
+    std::vector<uint32_t> closest_waypoints;
+    closest_waypoints.reserve(locations.size());
+    for (const cg::Location &location : locations) {
+      closest_waypoints.push_back(FindClosest(location));
+    }
+    return closest_waypoints;
+  }
+
+} // namespace traffic_manager
+} // namespace carla
@@ -0,0 +1,70 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "carla/geom/Location.h"
+
+namespace carla {
+namespace traffic_manager {
+
+namespace cg = carla::geom;
+
+  /// Spatial hash of waypoint locations on a square grid.
+  /// Waypoints are referred to by their index in the list the grid was built
+  /// from. Each occupied cell is found through an open-addressing table keyed
+  /// by its packed 64-bit coordinates, and holds a contiguous range of
+  /// waypoint indices.
+  class WaypointGrid {
+
+  public:
+
+    static constexpr uint32_t NO_WAYPOINT = std::numeric_limits<uint32_t>::max();
+
+    explicit WaypointGrid(float cell_size);
+
+    void Build(const std::vector<cg::Location> &locations);
+
+    /// Returns the index of the closest waypoint in the cell of the given
+    /// location and its eight neighbours, or NO_WAYPOINT if all are empty.
+    uint32_t FindClosest(const cg::Location &location) const;
+
+    /// FindClosest for many locations.
+    std::vector<uint32_t> FindClosest(const std::vector<cg::Location> &locations) const;
+
+    float GetCellSize() const {
+      return cell_size;
+    }
+
+  private:
+
+    struct Cell {
+      uint64_t key;
+      /// Range of the cell in cell_waypoints, empty for free slots.
+      uint32_t begin;
+      uint32_t end;
+    };
+
+    int32_t CellCoordinate(float value) const;
+
+    static uint64_t MakeKey(int32_t x, int32_t y);
+
+    const Cell *FindCell(uint64_t key) const;
+
+    float cell_size;
+    /// Power of two sized, at most half full.
+    std::vector<Cell> cells;
+    std::vector<uint32_t> cell_waypoints;
+    /// Waypoint locations in cell order, parallel to cell_waypoints.
+    std::vector<cg::Location> cell_locations;
+  };
+
+} // namespace traffic_manager
+} // namespace carla
@@ -0,0 +1,47 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "carla/trafficmanager/WorkerPool.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace carla {
+namespace traffic_manager {
+
+namespace WorkerPoolConstants {
+
+  /// Smallest number of vehicles worth handing to another thread.
+  static const uint64_t MINIMUM_CHUNK_SIZE = 32u;
+
+} // namespace WorkerPoolConstants
+
+  using namespace WorkerPoolConstants;
+
+  WorkerPool::WorkerPool(uint64_t number_of_workers)
+    : number_of_workers(number_of_workers) {
+
+    if (this->number_of_workers == 0u) {
+      this->number_of_workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    thread_pool.AsyncRun(this->number_of_workers);
+  }
+
+  WorkerPool::~WorkerPool() {
+    thread_pool.Stop();
+  }
+
+  uint64_t WorkerPool::GetMaximumNumberOfChunks() const {
+    return number_of_workers + 1u;
+  }
+
+  uint64_t WorkerPool::GetNumberOfChunks(uint64_t size) const {
+    const uint64_t number_of_chunks = (size + MINIMUM_CHUNK_SIZE - 1u) / MINIMUM_CHUNK_SIZE;
+    return std::min(number_of_chunks, GetMaximumNumberOfChunks());
+  }
+
+} // namespace traffic_manager
+} // namespace carla
@@ -0,0 +1,68 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include <cstdint>
+
+#include "carla/NonCopyable.h"
+#include "carla/ParallelFor.h"
+#include "carla/ThreadPool.h"
+
+namespace carla {
+namespace traffic_manager {
+
+  /// Pool of worker threads shared by the pipeline stages to split their
+  /// per-vehicle loops into chunks processed in parallel.
+  class WorkerPool : private NonCopyable {
+
+  private:
+
+    /// Number of threads in the pool.
+    uint64_t number_of_workers;
+    /// Underlying thread pool.
+    ThreadPool thread_pool;
+
+  public:
+
+    /// Uses all available hardware concurrency if number_of_workers is zero.
+    explicit WorkerPool(uint64_t number_of_workers = 0u);
+
+    ~WorkerPool();
+
+    /// Maximum number of chunks a loop is split into, also counting the
+    /// chunk processed by the calling thread. Stages size their per-chunk
+    /// scratch state with this.
+    uint64_t GetMaximumNumberOfChunks() const;
+
+    /// Number of chunks a loop of the given size is split into.
+    uint64_t GetNumberOfChunks(uint64_t size) const;
+
+    /// Splits [0, size) into GetNumberOfChunks(size) contiguous chunks, in
+    /// order, and calls functor(chunk_index, begin, end) for each of them on
+    /// the calling thread and the pool. Returns once all chunks are done,
+    /// rethrowing the first exception thrown by any of them.
+    template <typename FunctorT>
+    void ParallelFor(uint64_t size, FunctorT &&functor) {
+
+      const uint64_t number_of_chunks = GetNumberOfChunks(size);
+      const auto chunk_begin = [size, number_of_chunks](uint64_t chunk_index) {
+        return size * chunk_index / number_of_chunks;
+      };
+
+      ParallelForChunks(
+          thread_pool,
+          number_of_workers,
+          number_of_chunks,
+          [&functor, &chunk_begin](size_t chunk) {
+            const uint64_t chunk_index = chunk;
+            functor(chunk_index, chunk_begin(chunk_index), chunk_begin(chunk_index + 1u));
+          });
+    }
+  };
+
+} // namespace traffic_manager
+} // namespace carla
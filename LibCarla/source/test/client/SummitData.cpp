@@ -0,0 +1,30 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "SummitData.h"
+
+#ifndef SUMMIT_DATA_FOLDER
+#  error Please define SUMMIT_DATA_FOLDER.
+#endif
+
+#include <carla/FileSystem.h>
+
+#include <algorithm>
+
+namespace util {
+
+  std::vector<std::string> SummitData::GetAvailableFiles(const std::string &wildcard_pattern) {
+    std::vector<std::string> files = carla::FileSystem::ListFolder(
+        SUMMIT_DATA_FOLDER "/",
+        wildcard_pattern);
+    std::sort(files.begin(), files.end());
+    for (std::string &file : files) {
+      file = SUMMIT_DATA_FOLDER "/" + file;
+    }
+    return files;
+  }
+
+} // namespace util
@@ -0,0 +1,22 @@
+// Copyright (c) 2020 Computer Vision Center (CVC) at the Universitat Autonoma
+// de Barcelona (UAB).
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace util {
+
+  /// Helper for listing the map files bundled in SUMMIT's Data folder.
+  class SummitData {
+  public:
+
+    /// Full paths of the files matching @a wildcard_pattern, sorted.
+    static std::vector<std::string> GetAvailableFiles(const std::string &wildcard_pattern);
+  };
+
+} // namespace util
@@ -0,0 +1,128 @@
+#include "test.h"
+
+#include <carla/aabb/AABBMap.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace carla;
+using namespace carla::aabb;
+
+static bool brute_force_intersects(const std::vector<geom::AABB2D>& aabbs, const geom::AABB2D& aabb) {
+  for (const geom::AABB2D& other : aabbs) {
+    if (other.bounds_min.x <= aabb.bounds_max.x && aabb.bounds_min.x <= other.bounds_max.x &&
+        other.bounds_min.y <= aabb.bounds_max.y && aabb.bounds_min.y <= other.bounds_max.y) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static std::vector<geom::AABB2D> random_aabbs(std::mt19937& rng, size_t count) {
+  std::uniform_real_distribution<float> position_dist(-100.0f, 100.0f);
+  std::uniform_real_distribution<float> extent_dist(0.1f, 3.0f);
+  std::vector<geom::AABB2D> aabbs;
+  for (size_t i = 0; i < count; i++) {
+    geom::Vector2D position(position_dist(rng), position_dist(rng));
+    geom::Vector2D extent(extent_dist(rng), extent_dist(rng));
+    aabbs.emplace_back(position - extent, position + extent);
+  }
+  return aabbs;
+}
+
+TEST(aabb, bulk_load_matches_brute_force) {
+  std::mt19937 rng(0);
+  std::vector<geom::AABB2D> aabbs = random_aabbs(rng, 500);
+  std::vector<geom::AABB2D> queries = random_aabbs(rng, 500);
+
+  AABBMap aabb_map(aabbs);
+  ASSERT_EQ(aabb_map.Count(), aabbs.size());
+
+  std::vector<bool> results = aabb_map.IntersectsMany(queries);
+  ASSERT_EQ(results.size(), queries.size());
+  for (size_t i = 0; i < queries.size(); i++) {
+    ASSERT_EQ(results[i], brute_force_intersects(aabbs, queries[i]));
+    ASSERT_EQ(aabb_map.Intersects(queries[i]), results[i]);
+  }
+
+  // The bulk load must not leave degenerate boxes at the origin.
+  ASSERT_FALSE(AABBMap(std::vector<geom::AABB2D>{
+      geom::AABB2D(geom::Vector2D(1.0f, 1.0f), geom::Vector2D(2.0f, 2.0f))}).Intersects(
+      geom::AABB2D(geom::Vector2D(-0.5f, -0.5f), geom::Vector2D(0.5f, 0.5f))));
+}
+
+TEST(aabb, remove_and_update) {
+  AABBMap aabb_map;
+  size_t a = aabb_map.Insert(geom::AABB2D(geom::Vector2D(0.0f, 0.0f), geom::Vector2D(1.0f, 1.0f)));
+  size_t b = aabb_map.Insert(geom::AABB2D(geom::Vector2D(5.0f, 5.0f), geom::Vector2D(6.0f, 6.0f)));
+  ASSERT_NE(a, b);
+  ASSERT_EQ(aabb_map.Count(), 2u);
+
+  geom::AABB2D query(geom::Vector2D(0.5f, 0.5f), geom::Vector2D(0.6f, 0.6f));
+  ASSERT_EQ(aabb_map.QueryIntersects(query), std::vector<size_t>{a});
+
+  aabb_map.Update(a, geom::AABB2D(geom::Vector2D(10.0f, 10.0f), geom::Vector2D(11.0f, 11.0f)));
+  ASSERT_FALSE(aabb_map.Intersects(query));
+  ASSERT_EQ(aabb_map.Get(a).bounds_min, geom::Vector2D(10.0f, 10.0f));
+  ASSERT_EQ(aabb_map.Count(), 2u);
+
+  ASSERT_TRUE(aabb_map.Remove(b));
+  ASSERT_FALSE(aabb_map.Remove(b));
+  ASSERT_FALSE(aabb_map.Contains(b));
+  ASSERT_EQ(aabb_map.Count(), 1u);
+  ASSERT_FALSE(aabb_map.Intersects(geom::AABB2D(geom::Vector2D(5.0f, 5.0f), geom::Vector2D(6.0f, 6.0f))));
+
+  // Removed handles are reused.
+  size_t c = aabb_map.Insert(geom::AABB2D(geom::Vector2D(7.0f, 7.0f), geom::Vector2D(8.0f, 8.0f)));
+  ASSERT_EQ(c, b);
+  ASSERT_TRUE(aabb_map.Contains(c));
+  ASSERT_EQ(aabb_map.Get(c).bounds_min, geom::Vector2D(7.0f, 7.0f));
+  ASSERT_EQ(aabb_map.Count(), 2u);
+}
+
+TEST(aabb, churn_keeps_storage_bounded) {
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<float> coordinate_dist(0.0f, 100.0f);
+  auto random_aabb = [&]() {
+    geom::Vector2D bounds_min(coordinate_dist(rng), coordinate_dist(rng));
+    return geom::AABB2D(bounds_min, bounds_min + geom::Vector2D(1.0f, 1.0f));
+  };
+
+  const size_t LIVE_COUNT = 50;
+  AABBMap aabb_map;
+  std::vector<size_t> handles;
+  std::vector<geom::AABB2D> aabbs;
+  for (size_t i = 0; i < LIVE_COUNT; i++) {
+    aabbs.emplace_back(random_aabb());
+    handles.emplace_back(aabb_map.Insert(aabbs.back()));
+  }
+
+  for (int step = 0; step < 10000; step++) {
+    size_t i = rng() % handles.size();
+    ASSERT_TRUE(aabb_map.Remove(handles[i]));
+    aabbs[i] = random_aabb();
+    handles[i] = aabb_map.Insert(aabbs[i]);
+    // Never more handles than AABBs alive at the peak.
+    ASSERT_LT(handles[i], LIVE_COUNT);
+  }
+
+  ASSERT_EQ(aabb_map.Count(), LIVE_COUNT);
+  for (size_t i = 0; i < handles.size(); i++) {
+    ASSERT_EQ(aabb_map.Get(handles[i]).bounds_min, aabbs[i].bounds_min);
+    std::vector<size_t> hits = aabb_map.QueryIntersects(aabbs[i]);
+    ASSERT_NE(std::find(hits.begin(), hits.end(), handles[i]), hits.end());
+  }
+}
+
+TEST(aabb, query_nearest) {
+  std::vector<geom::AABB2D> aabbs;
+  for (int i = 0; i < 10; i++) {
+    geom::Vector2D position(static_cast<float>(i) * 10.0f, 0.0f);
+    aabbs.emplace_back(position - geom::Vector2D(1.0f, 1.0f), position + geom::Vector2D(1.0f, 1.0f));
+  }
+  AABBMap aabb_map(aabbs);
+
+  ASSERT_EQ(aabb_map.QueryNearest(geom::Vector2D(31.0f, 0.0f), 3), (std::vector<size_t>{3, 4, 2}));
+  ASSERT_EQ(aabb_map.QueryNearest(geom::Vector2D(0.0f, 0.0f), 20).size(), aabbs.size());
+  ASSERT_TRUE(aabb_map.QueryNearest(geom::Vector2D(0.0f, 0.0f), 0).empty());
+}
@@ -0,0 +1,89 @@
+#include "test.h"
+
+#include <carla/StopWatch.h>
+#include <carla/gamma/RVOSimulator.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace RVO;
+
+// Agents are spread at a fixed density, so the neighbor count per agent is
+// the same at every scale.
+static void benchmark_do_step(size_t num_agents, size_t num_workers) {
+  constexpr float AREA_PER_AGENT = 25.0f;
+  constexpr size_t NUM_STEPS = 10;
+
+  const float half_extent = 0.5f * std::sqrt(AREA_PER_AGENT * static_cast<float>(num_agents));
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> position_dist(-half_extent, half_extent);
+  std::uniform_real_distribution<float> heading_dist(-3.14159f, 3.14159f);
+
+  RVOSimulator sim;
+  sim.setNumWorkers(num_workers);
+  std::vector<size_t> handles;
+  std::vector<float> positions;
+  std::vector<float> velocities;
+  for (size_t i = 0; i < num_agents; ++i) {
+    bool is_car = i % 2 == 1;
+    AgentParams params = AgentParams::getDefaultAgentParam(is_car ? "Car" : "People");
+    size_t agent_no = sim.addAgent(params);
+    Vector2 position(position_dist(rng), position_dist(rng));
+    float heading_angle = heading_dist(rng);
+    Vector2 heading(std::cos(heading_angle), std::sin(heading_angle));
+    Vector2 velocity = heading * (is_car ? 4.0f : 1.0f);
+    float half_length = is_car ? 2.5f : 0.25f;
+    float half_width = is_car ? 1.0f : 0.25f;
+    Vector2 side(-heading.y(), heading.x());
+
+    sim.setAgentHeading(static_cast<int>(agent_no), heading);
+    sim.setAgentBoundingBoxCorners(static_cast<int>(agent_no), {
+        position + heading * half_length + side * half_width,
+        position - heading * half_length + side * half_width,
+        position - heading * half_length - side * half_width,
+        position + heading * half_length - side * half_width});
+    sim.setAgentBehaviorType(static_cast<int>(agent_no), Gamma);
+
+    handles.emplace_back(agent_no);
+    positions.insert(positions.end(), {position.x(), position.y()});
+    velocities.insert(velocities.end(), {velocity.x(), velocity.y()});
+  }
+
+  sim.setAgentStates(handles.size(), handles.data(), positions.data(), velocities.data(), velocities.data());
+  sim.doStep();
+
+  carla::StopWatch watch;
+  for (size_t step = 0; step < NUM_STEPS; ++step) {
+    sim.setAgentStates(handles.size(), handles.data(), positions.data(), velocities.data(), velocities.data());
+    sim.doStep();
+  }
+  watch.Stop();
+
+  std::cout << num_agents << " agents, " << num_workers << " workers: "
+            << static_cast<double>(watch.GetElapsedTime()) / NUM_STEPS << "ms per doStep" << std::endl;
+
+  for (size_t agent_no : handles) {
+    const Vector2& velocity = sim.getAgentVelocity(agent_no);
+    ASSERT_TRUE(std::isfinite(velocity.x()));
+    ASSERT_TRUE(std::isfinite(velocity.y()));
+  }
+}
+
+// Timing runs are disabled by default. Run them with Check.sh --benchmark.
+
+TEST(benchmark_gamma, DISABLED_do_step_1k) {
+  benchmark_do_step(1000, 1);
+  benchmark_do_step(1000, std::max(1u, std::thread::hardware_concurrency()));
+}
+
+TEST(benchmark_gamma, DISABLED_do_step_5k) {
+  benchmark_do_step(5000, 1);
+  benchmark_do_step(5000, std::max(1u, std::thread::hardware_concurrency()));
+}
+
+TEST(benchmark_gamma, DISABLED_do_step_20k) {
+  benchmark_do_step(20000, 1);
+  benchmark_do_step(20000, std::max(1u, std::thread::hardware_concurrency()));
+}
@@ -0,0 +1,76 @@
+#include "test.h"
+
+#include <boost/filesystem.hpp>
+#include <carla/StopWatch.h>
+#include <carla/occupancy/OccupancyMap.h>
+#include <carla/sumonetwork/SumoNetwork.h>
+#include <string>
+
+#include "SummitData.h"
+
+using namespace carla::occupancy;
+using namespace carla::sumonetwork;
+using namespace boost::filesystem;
+
+// Benchmarks over the bundled maps take minutes, so they are disabled by
+// default. Run them with Check.sh --benchmark.
+
+TEST(benchmark_occupancy, DISABLED_union_all) {
+  for (const std::string& file : util::SummitData::GetAvailableFiles("*.net.xml")) {
+    SumoNetwork sumo_network = SumoNetwork::Load(file, false);
+
+    std::vector<OccupancyMap> lane_maps;
+    for (const auto& edge_entry : sumo_network.Edges()) {
+      for (const Lane& lane : edge_entry.second.lanes) {
+        lane_maps.emplace_back(lane.shape, 4.10f);
+      }
+    }
+
+    carla::StopWatch sequential_watch;
+    OccupancyMap sequential;
+    for (const OccupancyMap& lane_map : lane_maps) {
+      sequential = sequential.Union(lane_map);
+    }
+    sequential_watch.Stop();
+
+    carla::StopWatch cascaded_watch;
+    OccupancyMap cascaded = OccupancyMap::UnionAll(lane_maps);
+    cascaded_watch.Stop();
+
+    std::cout << path(file).filename().string() << ": " << lane_maps.size() << " lanes, "
+              << "sequential " << sequential_watch.GetElapsedTime() << "ms, "
+              << "cascaded " << cascaded_watch.GetElapsedTime() << "ms" << std::endl;
+
+    for (const auto& edge_entry : sumo_network.Edges()) {
+      for (const Lane& lane : edge_entry.second.lanes) {
+        for (const carla::geom::Vector2D& vertex : lane.shape) {
+          ASSERT_TRUE(cascaded.Contains(vertex));
+        }
+      }
+    }
+    ASSERT_TRUE(cascaded.Difference(sequential.Buffer(0.10f)).IsEmpty());
+    ASSERT_TRUE(sequential.Difference(cascaded.Buffer(0.10f)).IsEmpty());
+  }
+}
+
+TEST(benchmark_occupancy, DISABLED_load) {
+  for (const std::string& file : util::SummitData::GetAvailableFiles("*.wkt")) {
+    carla::StopWatch text_watch;
+    OccupancyMap text_map = OccupancyMap::Load(file);
+    text_watch.Stop();
+
+    path binary_file = temp_directory_path() / unique_path("%%%%-%%%%.occ");
+    text_map.SaveBinary(binary_file.string());
+
+    carla::StopWatch binary_watch;
+    OccupancyMap binary_map = OccupancyMap::Load(binary_file.string());
+    binary_watch.Stop();
+    remove(binary_file);
+
+    std::cout << path(file).filename().string() << ": "
+              << "text " << text_watch.GetElapsedTime<std::chrono::microseconds>() << "us, "
+              << "binary " << binary_watch.GetElapsedTime<std::chrono::microseconds>() << "us" << std::endl;
+
+    ASSERT_EQ(text_map.GetPolygons(), binary_map.GetPolygons());
+  }
+}
@@ -0,0 +1,143 @@
+#include "test.h"
+
+#include <boost/filesystem.hpp>
+#include <carla/StopWatch.h>
+#include <carla/geom/Math.h>
+#include <carla/sumonetwork/SumoNetwork.h>
+#include <carla/trafficmanager/WaypointGrid.h>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "SummitData.h"
+
+using namespace carla;
+using namespace carla::sumonetwork;
+using namespace carla::traffic_manager;
+using namespace boost::filesystem;
+
+// Same as the traffic manager's grid size. Lanes are sampled more sparsely
+// than the traffic manager's topology, to bound memory on the largest maps.
+static constexpr float GRID_SIZE = 4.0f;
+static constexpr float SAMPLING_DISTANCE = 1.0f;
+
+// Waypoints along every lane, as InMemoryMap samples the road network.
+static std::vector<geom::Location> sample_lanes(const SumoNetwork& sumo_network) {
+  std::vector<geom::Location> locations;
+  for (const auto& edge_entry : sumo_network.Edges()) {
+    for (const Lane& lane : edge_entry.second.lanes) {
+      for (size_t i = 0; i + 1 < lane.shape.size(); i++) {
+        geom::Vector2D start = lane.shape[i];
+        geom::Vector2D direction = lane.shape[i + 1] - start;
+        float length = direction.Length();
+        for (float s = 0; s < length; s += SAMPLING_DISTANCE) {
+          geom::Vector2D point = start + direction * (s / length);
+          locations.emplace_back(point.x, point.y, 0.0f);
+        }
+      }
+    }
+  }
+  return locations;
+}
+
+// The waypoint grid InMemoryMap had before: string keys and node based sets
+// of shared pointers.
+class StringKeyedGrid {
+public:
+
+  explicit StringKeyedGrid(const std::vector<geom::Location>& locations) {
+    for (size_t i = 0; i < locations.size(); i++) {
+      auto waypoint = std::make_shared<std::pair<geom::Location, uint32_t>>(locations[i], static_cast<uint32_t>(i));
+      _grid[MakeGridKey(MakeGridId(locations[i]))].insert(waypoint);
+    }
+  }
+
+  uint32_t FindClosest(const geom::Location& location) const {
+    const std::pair<int, int> grid_ids = MakeGridId(location);
+    uint32_t closest_waypoint = WaypointGrid::NO_WAYPOINT;
+    float closest_distance = std::numeric_limits<float>::infinity();
+    for (int i = -1; i <= 1; ++i) {
+      for (int j = -1; j <= 1; ++j) {
+        const std::string grid_key = MakeGridKey({grid_ids.first + i, grid_ids.second + j});
+        if (_grid.find(grid_key) != _grid.end()) {
+          for (auto& waypoint : _grid.at(grid_key)) {
+            const float distance = geom::Math::DistanceSquared(waypoint->first, location);
+            if (distance < closest_distance) {
+              closest_waypoint = waypoint->second;
+              closest_distance = distance;
+            }
+          }
+        }
+      }
+    }
+    return closest_waypoint;
+  }
+
+private:
+
+  static std::pair<int, int> MakeGridId(const geom::Location& location) {
+    return {static_cast<int>(std::floor(location.x / GRID_SIZE)), static_cast<int>(std::floor(location.y / GRID_SIZE))};
+  }
+
+  static std::string MakeGridKey(std::pair<int, int> grid_id) {
+    return std::to_string(grid_id.first) + "#" + std::to_string(grid_id.second);
+  }
+
+  std::unordered_map<std::string, std::unordered_set<std::shared_ptr<std::pair<geom::Location, uint32_t>>>> _grid;
+};
+
+// Benchmarks over the bundled maps are disabled by default. Run them with
+// Check.sh --benchmark.
+TEST(benchmark_traffic_manager, DISABLED_waypoint_grid) {
+  constexpr size_t NUM_VEHICLES = 2000;
+  constexpr size_t NUM_TICKS = 20;
+
+  for (const std::string& file : util::SummitData::GetAvailableFiles("*.net.xml")) {
+    std::vector<geom::Location> locations = sample_lanes(SumoNetwork::Load(file, false));
+
+    // Vehicles near waypoints, as they are when being localized.
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<size_t> waypoint_dist(0, locations.size() - 1);
+    std::uniform_real_distribution<float> offset_dist(-2.0f, 2.0f);
+    std::vector<geom::Location> vehicles;
+    for (size_t i = 0; i < NUM_VEHICLES; i++) {
+      vehicles.emplace_back(locations[waypoint_dist(rng)] + geom::Location(offset_dist(rng), offset_dist(rng), 0.0f));
+    }
+
+    StringKeyedGrid string_keyed_grid(locations);
+    WaypointGrid waypoint_grid(GRID_SIZE);
+    waypoint_grid.Build(locations);
+
+    std::vector<uint32_t> expected(vehicles.size());
+    StopWatch string_keyed_watch;
+    for (size_t tick = 0; tick < NUM_TICKS; tick++) {
+      for (size_t i = 0; i < vehicles.size(); i++) {
+        expected[i] = string_keyed_grid.FindClosest(vehicles[i]);
+      }
+    }
+    string_keyed_watch.Stop();
+
+    std::vector<uint32_t> actual;
+    StopWatch flat_watch;
+    for (size_t tick = 0; tick < NUM_TICKS; tick++) {
+      actual = waypoint_grid.FindClosest(vehicles);
+    }
+    flat_watch.Stop();
+
+    std::cout << path(file).filename().string() << ": " << locations.size() << " waypoints, "
+              << "string keyed " << static_cast<double>(string_keyed_watch.GetElapsedTime()) / NUM_TICKS << "ms, "
+              << "flat " << static_cast<double>(flat_watch.GetElapsedTime()) / NUM_TICKS << "ms per tick of "
+              << NUM_VEHICLES << " vehicles" << std::endl;
+
+    // Equidistant waypoints may be picked differently, so compare distances.
+    for (size_t i = 0; i < vehicles.size(); i++) {
+      ASSERT_NE(actual[i], WaypointGrid::NO_WAYPOINT);
+      ASSERT_EQ(geom::Math::DistanceSquared(locations[actual[i]], vehicles[i]),
+          geom::Math::DistanceSquared(locations[expected[i]], vehicles[i]));
+    }
+  }
+}
@@ -0,0 +1,49 @@
+#include "test.h"
+
+#include <carla/trafficmanager/CollisionBroadphase.h>
+#include <random>
+#include <vector>
+
+using namespace carla::traffic_manager;
+
+static BroadphaseBox random_box(std::mt19937 &generator, double size) {
+  std::uniform_real_distribution<double> position(-500.0, 500.0);
+  std::uniform_real_distribution<double> extent(0.0, size);
+  const double x = position(generator);
+  const double y = position(generator);
+  return BroadphaseBox{x, y, x + extent(generator), y + extent(generator)};
+}
+
+TEST(traffic_manager, collision_broadphase_matches_brute_force) {
+  std::mt19937 generator(7u);
+
+  std::vector<BroadphaseBox> boxes;
+  for (int i = 0; i < 2000; ++i) {
+    boxes.push_back(random_box(generator, 60.0));
+  }
+  // Empty boxes are never found, and boxes spanning a huge area always are.
+  boxes.push_back(BroadphaseBox{1.0, 1.0, 0.0, 0.0});
+  boxes.push_back(BroadphaseBox{-1e6, -1e6, 1e6, 1e6});
+
+  CollisionBroadphase broadphase(20.0);
+  broadphase.Build(boxes);
+
+  for (int i = 0; i < 200; ++i) {
+    // Large queries are answered by testing every box.
+    const BroadphaseBox query = random_box(generator, i % 50 == 0 ? 2000.0 : 40.0);
+    std::vector<uint32_t> expected;
+    for (uint32_t j = 0u; j < boxes.size(); ++j) {
+      if (!boxes[j].IsEmpty() && boxes[j].Intersects(query)) {
+        expected.push_back(j);
+      }
+    }
+
+    std::vector<uint32_t> result;
+    broadphase.Query(query, result);
+    ASSERT_EQ(result, expected);
+
+    // Queries accumulate without duplicates.
+    broadphase.Query(query, result);
+    ASSERT_EQ(result, expected);
+  }
+}
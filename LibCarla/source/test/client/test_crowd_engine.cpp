@@ -0,0 +1,87 @@
+#include "test.h"
+
+#include <carla/gamma/CrowdEngineSettings.h>
+#include <carla/gamma/CrowdSpawnArea.h>
+#include <carla/segments/SegmentMap.h>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace carla;
+using namespace carla::gamma;
+using namespace carla::segments;
+
+// A horizontal and a vertical road crossing at (50, 50).
+static SegmentMap cross_segment_map() {
+  return SegmentMap({
+      geom::Segment2D(geom::Vector2D(0, 50), geom::Vector2D(100, 50)),
+      geom::Segment2D(geom::Vector2D(50, 0), geom::Vector2D(50, 100))});
+}
+
+static void assert_in_bounds(SegmentMap& segment_map, const geom::Vector2D& bounds_min, const geom::Vector2D& bounds_max) {
+  ASSERT_FALSE(segment_map.IsEmpty());
+  for (const geom::Vector2D& point : segment_map.RandPoints(100)) {
+    ASSERT_GE(point.x, bounds_min.x - 0.01f);
+    ASSERT_GE(point.y, bounds_min.y - 0.01f);
+    ASSERT_LE(point.x, bounds_max.x + 0.01f);
+    ASSERT_LE(point.y, bounds_max.y + 0.01f);
+  }
+}
+
+TEST(crowd_engine, default_settings_are_valid) {
+  ASSERT_NO_THROW(ValidateCrowdEngineSettings(CrowdEngineSettings()));
+}
+
+TEST(crowd_engine, invalid_rate_is_rejected) {
+  for (float rate : {0.0f, -1.0f, std::numeric_limits<float>::infinity(), std::numeric_limits<float>::quiet_NaN()}) {
+    CrowdEngineSettings settings;
+    settings.rate = rate;
+    ASSERT_THROW(ValidateCrowdEngineSettings(settings), std::invalid_argument);
+  }
+}
+
+TEST(crowd_engine, invalid_probabilities_are_rejected) {
+  for (float probability : {-0.1f, 1.1f, std::numeric_limits<float>::quiet_NaN()}) {
+    CrowdEngineSettings settings;
+    settings.lane_change_probability = probability;
+    ASSERT_THROW(ValidateCrowdEngineSettings(settings), std::invalid_argument);
+
+    settings = CrowdEngineSettings();
+    settings.cross_probability = probability;
+    ASSERT_THROW(ValidateCrowdEngineSettings(settings), std::invalid_argument);
+  }
+
+  CrowdEngineSettings settings;
+  settings.lane_change_probability = 1.0f;
+  settings.cross_probability = 0.0f;
+  ASSERT_NO_THROW(ValidateCrowdEngineSettings(settings));
+}
+
+TEST(crowd_engine, spawn_area_clips_to_bounds) {
+  std::mt19937 rng(0);
+  CrowdSpawnArea spawn_area(cross_segment_map(), cross_segment_map());
+
+  geom::Vector2D bounds_min(0, 0);
+  geom::Vector2D bounds_max(60, 60);
+  ASSERT_TRUE(spawn_area.Update(bounds_min, bounds_max, rng));
+  assert_in_bounds(spawn_area.GetSumoNetworkSegments(), bounds_min, bounds_max);
+  assert_in_bounds(spawn_area.GetSidewalkSegments(), bounds_min, bounds_max);
+
+  bounds_min = geom::Vector2D(40, 40);
+  bounds_max = geom::Vector2D(100, 100);
+  ASSERT_TRUE(spawn_area.Update(bounds_min, bounds_max, rng));
+  assert_in_bounds(spawn_area.GetSumoNetworkSegments(), bounds_min, bounds_max);
+  assert_in_bounds(spawn_area.GetSidewalkSegments(), bounds_min, bounds_max);
+}
+
+TEST(crowd_engine, spawn_area_skips_unchanged_bounds) {
+  std::mt19937 rng(0);
+  CrowdSpawnArea spawn_area(cross_segment_map(), cross_segment_map());
+  ASSERT_TRUE(spawn_area.Update(geom::Vector2D(0, 0), geom::Vector2D(60, 60), rng));
+
+  // Unchanged bounds neither clip again nor draw from rng.
+  std::mt19937 expected_rng = rng;
+  ASSERT_FALSE(spawn_area.Update(geom::Vector2D(0, 0), geom::Vector2D(60, 60), rng));
+  ASSERT_EQ(rng, expected_rng);
+}
@@ -0,0 +1,308 @@
+#include "test.h"
+
+#include <carla/gamma/Minkowski.h>
+#include <carla/gamma/RVOSimulator.h>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace RVO;
+
+static std::vector<Vector2> square_corners(const Vector2& center, float half_width) {
+  return {
+    center + Vector2(half_width, half_width),
+    center + Vector2(-half_width, half_width),
+    center + Vector2(-half_width, -half_width),
+    center + Vector2(half_width, -half_width)
+  };
+}
+
+TEST(gamma, remove_agent_reuses_handle) {
+  RVOSimulator sim;
+  size_t a = sim.addAgent(AgentParams::getDefaultAgentParam("People"));
+  size_t b = sim.addAgent(AgentParams::getDefaultAgentParam("People"));
+  size_t c = sim.addAgent(AgentParams::getDefaultAgentParam("People"));
+  ASSERT_EQ(sim.getNumLiveAgents(), 3u);
+
+  sim.removeAgent(b);
+  ASSERT_EQ(sim.getNumLiveAgents(), 2u);
+  ASSERT_EQ(sim.getNumAgents(), 3u);
+  ASSERT_TRUE(sim.hasAgent(a));
+  ASSERT_FALSE(sim.hasAgent(b));
+  ASSERT_TRUE(sim.hasAgent(c));
+
+  size_t d = sim.addAgent(AgentParams::getDefaultAgentParam("Car"));
+  ASSERT_EQ(d, b);
+  ASSERT_EQ(sim.getAgentTag(static_cast<int>(d)), "Car");
+  ASSERT_EQ(sim.getNumLiveAgents(), 3u);
+  ASSERT_EQ(sim.getNumAgents(), 3u);
+
+  // Stepping with empty slots must work.
+  sim.removeAgent(a);
+  sim.removeAgent(c);
+  sim.removeAgent(d);
+  ASSERT_EQ(sim.getNumLiveAgents(), 0u);
+  sim.doStep();
+}
+
+// Loops up to getNumAgents() must still reach the agents after a removed one.
+TEST(gamma, iterate_agents_after_removal) {
+  RVOSimulator sim;
+  std::vector<size_t> handles;
+  for (int i = 0; i < 5; ++i) {
+    handles.push_back(sim.addAgent(AgentParams::getDefaultAgentParam("People")));
+    sim.setAgentPosition(handles.back(), Vector2(static_cast<float>(i), 0.0f));
+  }
+  sim.removeAgent(handles[1]);
+
+  std::vector<size_t> visited;
+  for (size_t agent_no = 0; agent_no < sim.getNumAgents(); ++agent_no) {
+    if (!sim.hasAgent(agent_no)) continue;
+    visited.push_back(agent_no);
+    ASSERT_EQ(sim.getAgentPosition(agent_no).x(), static_cast<float>(agent_no));
+  }
+  ASSERT_EQ(visited, std::vector<size_t>({handles[0], handles[2], handles[3], handles[4]}));
+  ASSERT_EQ(visited.size(), sim.getNumLiveAgents());
+}
+
+TEST(gamma, per_agent_access_checks_agent) {
+  RVOSimulator sim;
+  size_t a = sim.addAgent(AgentParams::getDefaultAgentParam("People"));
+  size_t b = sim.addAgent(AgentParams::getDefaultAgentParam("People"));
+  sim.setAgentPosition(a, Vector2(1.0f, 2.0f));
+  sim.removeAgent(b);
+
+  // Removed and never assigned numbers alike.
+  for (size_t agent_no : {b, b + 1, static_cast<size_t>(-1)}) {
+    ASSERT_THROW(sim.getAgentPosition(agent_no), std::out_of_range);
+    ASSERT_THROW(sim.getAgentVelocity(agent_no), std::out_of_range);
+    ASSERT_THROW(sim.getAgentMaxSpeed(agent_no), std::out_of_range);
+    ASSERT_THROW(sim.getAgentMaxNeighbors(agent_no), std::out_of_range);
+    ASSERT_THROW(sim.getAgentNeighborDist(agent_no), std::out_of_range);
+    ASSERT_THROW(sim.getAgentNumAgentNeighbors(agent_no), std::out_of_range);
+    ASSERT_THROW(sim.getAgentAgentNeighbor(agent_no, 0), std::out_of_range);
+    ASSERT_THROW(sim.setAgentPosition(agent_no, Vector2()), std::out_of_range);
+    ASSERT_THROW(sim.setAgentVelocity(agent_no, Vector2()), std::out_of_range);
+    ASSERT_THROW(sim.setAgentPrefVelocity(agent_no, Vector2()), std::out_of_range);
+    ASSERT_THROW(sim.setAgentMaxSpeed(agent_no, 1.0f), std::out_of_range);
+    ASSERT_THROW(sim.setAgentPathForward(agent_no, Vector2()), std::out_of_range);
+  }
+  ASSERT_THROW(sim.getAgentTag(static_cast<int>(b)), std::out_of_range);
+  ASSERT_THROW(sim.setAgentHeading(-1, Vector2()), std::out_of_range);
+  ASSERT_THROW(sim.setAgent(static_cast<int>(b), AgentParams::getDefaultAgentParam("Car")), std::out_of_range);
+  ASSERT_THROW(sim.getAgentAgentNeighbor(a, sim.getAgentNumAgentNeighbors(a)), std::out_of_range);
+
+  // No agent is updated if any of the numbers is invalid.
+  std::vector<size_t> agent_nos{a, b};
+  std::vector<float> positions{5.0f, 6.0f, 7.0f, 8.0f};
+  ASSERT_THROW(sim.setAgentStates(2, agent_nos.data(), positions.data(), NULL, NULL), std::out_of_range);
+  ASSERT_EQ(sim.getAgentPosition(a).x(), 1.0f);
+  ASSERT_EQ(sim.getAgentPosition(a).y(), 2.0f);
+}
+
+// A simulator kept across steps (with removals, additions and KD-tree refits)
+// must compute the same velocities as one rebuilt from scratch every step.
+TEST(gamma, persistent_matches_rebuild) {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> position_dist(-50.0f, 50.0f);
+  std::uniform_real_distribution<float> velocity_dist(-1.0f, 1.0f);
+
+  RVOSimulator persistent;
+  std::vector<size_t> handles;
+  std::vector<Vector2> positions;
+  std::vector<Vector2> velocities;
+  auto add = [&](const std::string& tag) {
+    handles.emplace_back(persistent.addAgent(AgentParams::getDefaultAgentParam(tag)));
+    positions.emplace_back(position_dist(rng), position_dist(rng));
+    velocities.emplace_back(velocity_dist(rng), velocity_dist(rng));
+  };
+  for (int i = 0; i < 300; ++i) {
+    add(i % 2 == 0 ? "People" : "Car");
+  }
+
+  for (int step = 0; step < 50; ++step) {
+    if (step % 10 == 5) {
+      for (int i = 0; i < 20; ++i) {
+        size_t j = rng() % handles.size();
+        persistent.removeAgent(handles[j]);
+        handles.erase(handles.begin() + static_cast<long>(j));
+        positions.erase(positions.begin() + static_cast<long>(j));
+        velocities.erase(velocities.begin() + static_cast<long>(j));
+      }
+      for (int i = 0; i < 10; ++i) {
+        add("Car");
+      }
+    }
+
+    // Mostly small moves (refit), occasionally large ones (rebuild).
+    for (Vector2& position : positions) {
+      position += Vector2(0.05f, 0.02f) * (step % 3 == 0 ? 20.0f : 1.0f);
+    }
+
+    std::vector<float> flat_positions;
+    std::vector<float> flat_velocities;
+    for (size_t i = 0; i < handles.size(); ++i) {
+      flat_positions.insert(flat_positions.end(), {positions[i].x(), positions[i].y()});
+      flat_velocities.insert(flat_velocities.end(), {velocities[i].x(), velocities[i].y()});
+      persistent.setAgentBoundingBoxCorners(static_cast<int>(handles[i]), square_corners(positions[i], 1.0f));
+      persistent.setAgentHeading(static_cast<int>(handles[i]), Vector2(1.0f, 0.0f));
+    }
+    persistent.setAgentStates(handles.size(), handles.data(),
+        flat_positions.data(), flat_velocities.data(), flat_velocities.data());
+    persistent.doStep();
+
+    RVOSimulator rebuilt;
+    for (size_t i = 0; i < handles.size(); ++i) {
+      size_t agent_no = rebuilt.addAgent(AgentParams::getDefaultAgentParam(
+            persistent.getAgentTag(static_cast<int>(handles[i]))));
+      rebuilt.setAgentPosition(agent_no, positions[i]);
+      rebuilt.setAgentVelocity(agent_no, velocities[i]);
+      rebuilt.setAgentPrefVelocity(agent_no, velocities[i]);
+      rebuilt.setAgentBoundingBoxCorners(static_cast<int>(agent_no), square_corners(positions[i], 1.0f));
+      rebuilt.setAgentHeading(static_cast<int>(agent_no), Vector2(1.0f, 0.0f));
+    }
+    rebuilt.doStep();
+
+    for (size_t i = 0; i < handles.size(); ++i) {
+      const Vector2& expected = rebuilt.getAgentVelocity(i);
+      const Vector2& actual = persistent.getAgentVelocity(handles[i]);
+      ASSERT_FLOAT_EQ(actual.x(), expected.x());
+      ASSERT_FLOAT_EQ(actual.y(), expected.y());
+    }
+  }
+}
+
+TEST(gamma, minkowski_diff_convex) {
+  std::mt19937 rng(2);
+  std::uniform_real_distribution<float> coordinate_dist(-10.0f, 10.0f);
+  std::uniform_real_distribution<float> extent_dist(0.2f, 3.0f);
+  std::uniform_real_distribution<float> angle_dist(-3.14159f, 3.14159f);
+  std::uniform_int_distribution<int> size_dist(3, 12);
+
+  auto random_rectangle = [&]() {
+    Vector2 center(coordinate_dist(rng), coordinate_dist(rng));
+    float angle = angle_dist(rng);
+    Vector2 forward(std::cos(angle), std::sin(angle));
+    Vector2 side(-forward.y(), forward.x());
+    float length = extent_dist(rng);
+    float width = extent_dist(rng);
+    return std::vector<Vector2>{
+      center + forward * length + side * width,
+      center - forward * length + side * width,
+      center - forward * length - side * width,
+      center + forward * length - side * width};
+  };
+  auto random_polygon = [&]() {
+    Vector2 center(coordinate_dist(rng), coordinate_dist(rng));
+    std::vector<Vector2> points;
+    for (int i = size_dist(rng); i > 0; --i) {
+      points.emplace_back(center + Vector2(extent_dist(rng), extent_dist(rng)) - Vector2(1.6f, 1.6f));
+    }
+    return points;
+  };
+
+  std::vector<Vector2> diff;
+  for (int i = 0; i < 1000; ++i) {
+    std::vector<Vector2> a = i % 2 == 0 ? random_rectangle() : random_polygon();
+    std::vector<Vector2> b = i % 3 == 0 ? random_rectangle() : random_polygon();
+    std::vector<Vector2> expected = Minkowski::Diff(a, b);
+    Minkowski::DiffConvex(Minkowski::Hull(a), Minkowski::Hull(b), diff);
+    ASSERT_EQ(diff, expected);
+  }
+}
+
+TEST(gamma, do_step_independent_of_num_workers) {
+  std::vector<std::vector<Vector2>> results;
+  for (size_t num_workers : {1u, 2u, 7u}) {
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> position_dist(-40.0f, 40.0f);
+    std::uniform_real_distribution<float> velocity_dist(-2.0f, 2.0f);
+
+    RVOSimulator sim;
+    sim.setNumWorkers(num_workers);
+    ASSERT_EQ(sim.getNumWorkers(), num_workers);
+    for (int i = 0; i < 1000; ++i) {
+      size_t agent_no = sim.addAgent(AgentParams::getDefaultAgentParam(i % 3 == 0 ? "Car" : "People"));
+      Vector2 position(position_dist(rng), position_dist(rng));
+      Vector2 velocity(velocity_dist(rng), velocity_dist(rng));
+      sim.setAgentPosition(agent_no, position);
+      sim.setAgentVelocity(agent_no, velocity);
+      sim.setAgentPrefVelocity(agent_no, velocity);
+      sim.setAgentBoundingBoxCorners(static_cast<int>(agent_no), square_corners(position, 0.5f));
+      sim.setAgentHeading(static_cast<int>(agent_no), Vector2(1.0f, 0.0f));
+      sim.setAgentBehaviorType(static_cast<int>(agent_no), Gamma);
+    }
+    for (int step = 0; step < 5; ++step) {
+      sim.doStep();
+    }
+
+    std::vector<Vector2> velocities;
+    for (size_t agent_no = 0; agent_no < sim.getNumAgents(); ++agent_no) {
+      velocities.emplace_back(sim.getAgentVelocity(agent_no));
+    }
+    results.emplace_back(std::move(velocities));
+  }
+
+  for (size_t i = 1; i < results.size(); ++i) {
+    ASSERT_EQ(results[i], results[0]);
+  }
+}
+
+// Velocities after one doStep of a fixed scene, recorded with the KD-tree
+// that scanned its leaves through agent pointers.
+TEST(gamma, do_step_matches_reference) {
+  const std::vector<Vector2> expected_velocities{
+    {-0.99252f, -0.12206f}, {-1.37584f, -3.75594f}, {0.88187f, -0.44687f}, {-0.60803f, -3.95352f},
+    {0.99685f, -0.07926f}, {4.57909f, -8.88999f}, {0.12556f, 0.99209f}, {3.93865f, 2.25332f},
+    {-0.62354f, 0.78179f}, {0.57972f, 2.18616f}, {-0.99173f, -0.12835f}, {-0.83589f, 1.77337f},
+    {-0.54685f, -0.83723f}, {1.50107f, 0.23611f}, {0.48327f, -0.48574f}, {-1.13985f, -3.83416f},
+    {-0.86407f, -0.50337f}, {-1.70363f, 0.54046f}, {-0.93944f, -0.34272f}, {-9.05829f, -2.62582f},
+    {-0.57746f, 0.81642f}, {-3.20119f, 2.39841f}, {0.94632f, 0.32323f}, {3.90315f, -0.87488f},
+    {0.52546f, -0.85082f}, {3.58826f, -1.76760f}, {-0.92100f, -0.38956f}, {-1.32682f, -3.77353f},
+    {-0.12644f, -0.82214f}, {-3.99716f, -0.15076f}, {-0.24930f, 0.96843f}, {-4.00858f, 0.22209f},
+    {0.66992f, 0.66477f}, {6.66292f, -7.45691f}, {-0.48825f, -0.87270f}, {0.00000f, 0.00000f},
+    {-0.92294f, -0.38493f}, {1.70546f, -3.61821f}, {0.31349f, -0.93336f}, {-3.81274f, 1.20956f}};
+
+  // mt19937 output is fully specified, unlike the standard distributions.
+  std::mt19937 rng(11);
+  auto uniform = [&rng](float min, float max) {
+    return min + (max - min) * static_cast<float>(rng() / 4294967296.0);
+  };
+
+  RVOSimulator sim;
+  std::vector<size_t> handles;
+  std::vector<float> positions;
+  std::vector<float> velocities;
+  for (size_t i = 0; i < expected_velocities.size(); ++i) {
+    bool is_car = i % 2 == 1;
+    size_t agent_no = sim.addAgent(AgentParams::getDefaultAgentParam(is_car ? "Car" : "People"));
+    Vector2 position(uniform(-15.0f, 15.0f), uniform(-15.0f, 15.0f));
+    float heading_angle = uniform(-3.14159f, 3.14159f);
+    Vector2 heading(std::cos(heading_angle), std::sin(heading_angle));
+    Vector2 velocity = heading * (is_car ? 4.0f : 1.0f);
+    float half_length = is_car ? 2.5f : 0.25f;
+    float half_width = is_car ? 1.0f : 0.25f;
+    Vector2 side(-heading.y(), heading.x());
+
+    sim.setAgentHeading(static_cast<int>(agent_no), heading);
+    sim.setAgentBoundingBoxCorners(static_cast<int>(agent_no), {
+        position + heading * half_length + side * half_width,
+        position - heading * half_length + side * half_width,
+        position - heading * half_length - side * half_width,
+        position + heading * half_length - side * half_width});
+    sim.setAgentBehaviorType(static_cast<int>(agent_no), Gamma);
+
+    handles.emplace_back(agent_no);
+    positions.insert(positions.end(), {position.x(), position.y()});
+    velocities.insert(velocities.end(), {velocity.x(), velocity.y()});
+  }
+  sim.setAgentStates(handles.size(), handles.data(), positions.data(), velocities.data(), velocities.data());
+  sim.doStep();
+
+  for (size_t i = 0; i < handles.size(); ++i) {
+    ASSERT_NEAR(sim.getAgentVelocity(handles[i]).x(), expected_velocities[i].x(), 1e-3f);
+    ASSERT_NEAR(sim.getAgentVelocity(handles[i]).y(), expected_velocities[i].y(), 1e-3f);
+  }
+}
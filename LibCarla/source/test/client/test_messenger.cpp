@@ -0,0 +1,95 @@
+#include "test.h"
+
+#include <carla/trafficmanager/Messenger.h>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace carla::traffic_manager;
+
+template <typename Policy>
+static void check_in_order_delivery() {
+  constexpr int NUM_FRAMES = 20000;
+  Messenger<std::shared_ptr<int>, Policy> messenger;
+  messenger.Start();
+
+  std::thread sender([&messenger]() {
+    for (int i = 0; i < NUM_FRAMES; i++) {
+      messenger.Push(std::make_shared<int>(i));
+    }
+  });
+  // Asserting only after joining, so a failure cannot leave the thread
+  // joinable.
+  std::vector<int> received;
+  for (int i = 0; i < NUM_FRAMES; i++) {
+    std::shared_ptr<int> frame = messenger.Peek();
+    received.push_back(frame != nullptr ? *frame : -1);
+    messenger.Pop();
+  }
+  sender.join();
+
+  for (int i = 0; i < NUM_FRAMES; i++) {
+    ASSERT_EQ(received[i], i);
+  }
+}
+
+template <typename Policy>
+static void check_stop_wakes_receiver() {
+  Messenger<std::shared_ptr<int>, Policy> messenger;
+  messenger.Start();
+  std::thread stopper([&messenger]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    messenger.Stop();
+  });
+  std::shared_ptr<int> frame = messenger.Peek();
+  stopper.join();
+  ASSERT_EQ(frame, nullptr);
+}
+
+// Round trip latency between two threads, each waiting on the other, as
+// pipeline stages do.
+template <typename Policy>
+static double ping_pong_microseconds() {
+  constexpr int NUM_ROUND_TRIPS = 2000;
+  Messenger<std::shared_ptr<int>, Policy> ping;
+  Messenger<std::shared_ptr<int>, Policy> pong;
+  ping.Start();
+  pong.Start();
+
+  std::thread echo([&]() {
+    for (int i = 0; i < NUM_ROUND_TRIPS; i++) {
+      std::shared_ptr<int> frame = ping.Peek();
+      ping.Pop();
+      pong.Push(frame);
+    }
+  });
+  const auto start = std::chrono::steady_clock::now();
+  auto frame = std::make_shared<int>(0);
+  for (int i = 0; i < NUM_ROUND_TRIPS; i++) {
+    ping.Push(frame);
+    pong.Peek();
+    pong.Pop();
+  }
+  const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+  echo.join();
+  return elapsed.count() / NUM_ROUND_TRIPS;
+}
+
+TEST(traffic_manager, messenger_delivers_in_order) {
+  check_in_order_delivery<LockingMessengerPolicy>();
+  check_in_order_delivery<RingBufferMessengerPolicy<>>();
+  check_in_order_delivery<RingBufferMessengerPolicy<4u>>();
+}
+
+TEST(traffic_manager, messenger_stop_wakes_receiver) {
+  check_stop_wakes_receiver<LockingMessengerPolicy>();
+  check_stop_wakes_receiver<RingBufferMessengerPolicy<>>();
+}
+
+// Timing runs are disabled by default. Run them with Check.sh --benchmark.
+TEST(benchmark_traffic_manager, DISABLED_messenger) {
+  std::cout << "locking: " << ping_pong_microseconds<LockingMessengerPolicy>() << "us, "
+            << "ring buffer: " << ping_pong_microseconds<RingBufferMessengerPolicy<>>() << "us per round trip"
+            << std::endl;
+}
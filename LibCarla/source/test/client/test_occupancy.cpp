@@ -0,0 +1,212 @@
+#include "test.h"
+
+#include <boost/filesystem.hpp>
+#include <carla/geom/IndexedMesh.h>
+#include <carla/occupancy/OccupancyMap.h>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace carla;
+using namespace carla::occupancy;
+
+// A road network with a hole, so that inner rings are covered too.
+static OccupancyMap ring_road() {
+  std::vector<geom::Vector2D> loop{
+    {0, 0}, {100, 0}, {100, 60}, {0, 60}, {0, 0}};
+  return OccupancyMap(loop, 8.0f).Union(OccupancyMap({{50, 0}, {50, 60}}, 4.0f));
+}
+
+// Expands an indexed mesh into a triangle soup, each front face followed by
+// its back face if double sided.
+static std::vector<geom::Vector3D> expand(const geom::IndexedMesh& mesh) {
+  std::vector<geom::Vector3D> triangles;
+  for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+    const geom::Vector3D& a = mesh.vertices[mesh.indices[i]];
+    const geom::Vector3D& b = mesh.vertices[mesh.indices[i + 1]];
+    const geom::Vector3D& c = mesh.vertices[mesh.indices[i + 2]];
+    triangles.insert(triangles.end(), {a, b, c});
+    if (mesh.double_sided) {
+      triangles.insert(triangles.end(), {c, b, a});
+    }
+  }
+  return triangles;
+}
+
+TEST(occupancy, indexed_mesh_matches_triangles) {
+  OccupancyMap occupancy_map = ring_road();
+
+  geom::IndexedMesh mesh = occupancy_map.GetIndexedMesh(0.5f);
+  ASSERT_EQ(expand(mesh), occupancy_map.GetMeshTriangles(0.5f));
+  // Every vertex is shared by at least one triangle in the triangulation.
+  ASSERT_LT(mesh.vertices.size(), mesh.indices.size());
+
+  // The triangle soup also has quads for the zero length closing edges.
+  std::vector<geom::Vector3D> wall_triangles;
+  std::vector<geom::Vector3D> all_wall_triangles = occupancy_map.GetWallMeshTriangles(2.0f);
+  for (size_t i = 0; i < all_wall_triangles.size(); i += 12) {
+    const geom::Vector3D& start = all_wall_triangles[i + 2];
+    const geom::Vector3D& end = all_wall_triangles[i];
+    if (start.x != end.x || start.y != end.y) {
+      wall_triangles.insert(wall_triangles.end(), all_wall_triangles.begin() + i, all_wall_triangles.begin() + i + 12);
+    }
+  }
+  ASSERT_EQ(expand(occupancy_map.GetIndexedWallMesh(2.0f)), wall_triangles);
+
+  geom::IndexedMesh single_sided = occupancy_map.GetIndexedMesh(0.5f, false);
+  ASSERT_FALSE(single_sided.double_sided);
+  ASSERT_EQ(single_sided.indices, mesh.indices);
+}
+
+TEST(occupancy, tiles_cover_map) {
+  OccupancyMap occupancy_map = ring_road();
+  const float tile_size = 15.0f;
+  std::vector<OccupancyTile> tiles = occupancy_map.Tile(tile_size);
+
+  std::map<std::pair<int32_t, int32_t>, const OccupancyTile*> tile_lookup;
+  for (const OccupancyTile& tile : tiles) {
+    ASSERT_FALSE(tile.occupancy_map.IsEmpty());
+    ASSERT_TRUE(tile.occupancy_map.Intersection(OccupancyMap(tile.bounds_min, tile.bounds_max))
+        == tile.occupancy_map);
+    tile_lookup[{tile.x, tile.y}] = &tile;
+  }
+  // Inside the loop, left of the middle road, is empty.
+  ASSERT_EQ(tile_lookup.count({1, 1}), 0u);
+
+  std::mt19937 rng(4);
+  std::uniform_real_distribution<float> x_dist(-10.0f, 110.0f);
+  std::uniform_real_distribution<float> y_dist(-10.0f, 70.0f);
+  for (int i = 0; i < 2000; i++) {
+    geom::Vector2D point(x_dist(rng), y_dist(rng));
+    auto it = tile_lookup.find({
+        static_cast<int32_t>(std::floor(point.x / tile_size)),
+        static_cast<int32_t>(std::floor(point.y / tile_size))});
+    bool tile_contains = it != tile_lookup.end() && it->second->occupancy_map.Contains(point);
+    ASSERT_EQ(tile_contains, occupancy_map.Contains(point));
+  }
+}
+
+TEST(occupancy, union_all_matches_sequential_union) {
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<float> position_dist(0.0f, 200.0f);
+  std::uniform_real_distribution<float> offset_dist(-30.0f, 30.0f);
+  std::vector<OccupancyMap> lanes;
+  for (int i = 0; i < 100; i++) {
+    geom::Vector2D start(position_dist(rng), position_dist(rng));
+    geom::Vector2D middle = start + geom::Vector2D(offset_dist(rng), offset_dist(rng));
+    geom::Vector2D end = middle + geom::Vector2D(offset_dist(rng), offset_dist(rng));
+    lanes.emplace_back(std::vector<geom::Vector2D>{start, middle, end}, 4.0f);
+  }
+  lanes.emplace_back();
+
+  OccupancyMap sequential;
+  for (const OccupancyMap& lane : lanes) {
+    sequential = sequential.Union(lane);
+  }
+  OccupancyMap cascaded = OccupancyMap::UnionAll(lanes);
+
+  ASSERT_FALSE(cascaded.IsEmpty());
+  ASSERT_TRUE(cascaded.Difference(sequential.Buffer(0.01f)).IsEmpty());
+  ASSERT_TRUE(sequential.Difference(cascaded.Buffer(0.01f)).IsEmpty());
+  ASSERT_TRUE(OccupancyMap::UnionAll({}).IsEmpty());
+}
+
+TEST(occupancy, difference_all_matches_difference) {
+  OccupancyMap occupancy_map = ring_road();
+
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<float> position_dist(-20.0f, 120.0f);
+  std::uniform_real_distribution<float> size_dist(1.0f, 15.0f);
+  std::vector<OccupancyMap> buildings;
+  for (int i = 0; i < 200; i++) {
+    geom::Vector2D bounds_min(position_dist(rng), position_dist(rng));
+    buildings.emplace_back(bounds_min, bounds_min + geom::Vector2D(size_dist(rng), size_dist(rng)));
+  }
+  buildings.emplace_back();
+
+  std::vector<OccupancyMap> results = OccupancyMap::DifferenceAll(buildings, occupancy_map);
+  ASSERT_EQ(results.size(), buildings.size());
+  for (size_t i = 0; i < buildings.size(); i++) {
+    ASSERT_TRUE(results[i] == buildings[i].Difference(occupancy_map));
+  }
+}
+
+TEST(occupancy, binary_pack_round_trip) {
+  std::vector<OccupancyMap> occupancy_maps{
+    ring_road(),
+    OccupancyMap(),
+    OccupancyMap(geom::Vector2D(1, 2), geom::Vector2D(3, 5))};
+  boost::filesystem::path file = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%.occp");
+  OccupancyMap::SaveBinaryPack(occupancy_maps, file.string());
+  std::vector<OccupancyMap> loaded = OccupancyMap::LoadBinaryPack(file.string());
+  std::ifstream stream(file.string(), std::ios::binary);
+  std::vector<char> bytes{std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+  stream.close();
+  boost::filesystem::remove(file);
+
+  // The reserved header field is written as zero, so output is reproducible.
+  ASSERT_GE(bytes.size(), 16u);
+  ASSERT_EQ(std::vector<char>(bytes.begin() + 12, bytes.begin() + 16), std::vector<char>(4, 0));
+
+  ASSERT_EQ(loaded.size(), occupancy_maps.size());
+  for (size_t i = 0; i < occupancy_maps.size(); i++) {
+    ASSERT_EQ(loaded[i].GetPolygons(), occupancy_maps[i].GetPolygons());
+  }
+}
+
+TEST(occupancy, spatial_index_matches_geometry) {
+  OccupancyMap occupancy_map = ring_road();
+
+  std::mt19937 rng(6);
+  std::uniform_real_distribution<float> x_dist(-10.0f, 110.0f);
+  std::uniform_real_distribution<float> y_dist(-10.0f, 70.0f);
+  std::vector<geom::Vector2D> points;
+  std::vector<bool> expected;
+  for (int i = 0; i < 3000; i++) {
+    geom::Vector2D point(x_dist(rng), y_dist(rng));
+    // Small maps are not indexed, so a tiny square around the point is tested
+    // directly against the geometry. Points too close to the boundary for
+    // either to be certain are skipped.
+    OccupancyMap square(point - geom::Vector2D(1e-3f, 1e-3f), point + geom::Vector2D(1e-3f, 1e-3f));
+    bool inside = square.Difference(occupancy_map).IsEmpty();
+    bool outside = !square.Intersects(occupancy_map);
+    if (inside != outside) {
+      points.emplace_back(point);
+      expected.emplace_back(inside);
+    }
+  }
+  ASSERT_GT(points.size(), 2900u);
+  ASSERT_EQ(occupancy_map.ContainsMany(points), expected);
+  for (size_t i = 0; i < points.size(); i++) {
+    ASSERT_EQ(occupancy_map.Contains(points[i]), expected[i]);
+  }
+  // Vertices are on the boundary, hence covered.
+  for (const auto& polygon : occupancy_map.GetPolygons()) {
+    for (const auto& ring : polygon) {
+      for (const geom::Vector2D& vertex : ring) {
+        ASSERT_TRUE(occupancy_map.Contains(vertex));
+      }
+    }
+  }
+
+  std::vector<OccupancyMap> others;
+  for (int i = 0; i < 200; i++) {
+    geom::Vector2D center(x_dist(rng), y_dist(rng));
+    others.emplace_back(std::vector<geom::Vector2D>{center, center + geom::Vector2D(3.0f, 1.0f)}, 0.5f);
+  }
+  std::vector<bool> intersects = occupancy_map.IntersectsMany(others);
+  for (size_t i = 0; i < others.size(); i++) {
+    ASSERT_EQ(intersects[i], others[i].Intersects(occupancy_map));
+  }
+
+  // Maps modified in place must not keep a stale index.
+  OccupancyMap copy = occupancy_map;
+  ASSERT_TRUE(copy.Contains(geom::Vector2D(50, 30)));
+  OccupancyMap cut(geom::Vector2D(40, 20), geom::Vector2D(60, 40));
+  std::vector<OccupancyMap> results = OccupancyMap::DifferenceAll({copy}, cut);
+  ASSERT_FALSE(results[0].Contains(geom::Vector2D(50, 30)));
+  ASSERT_TRUE(results[0].Contains(geom::Vector2D(50, 10)));
+}
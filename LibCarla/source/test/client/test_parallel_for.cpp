@@ -0,0 +1,45 @@
+#include "test.h"
+
+#include <carla/ParallelFor.h>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+TEST(parallel_for, covers_range_once) {
+  for (size_t size : {0u, 1u, 7u, 100u, 1000u}) {
+    std::vector<int> visits(size, 0);
+    carla::ParallelFor(size, 16u, [&visits](size_t begin, size_t end) {
+      ASSERT_LE(end - begin, 16u);
+      for (size_t i = begin; i < end; ++i) {
+        ++visits[i];
+      }
+    });
+    for (int count : visits) {
+      ASSERT_EQ(count, 1);
+    }
+  }
+}
+
+TEST(parallel_for, nested_calls_finish) {
+  // Inner loops run on workers of the same pool as the outer loop.
+  std::atomic<size_t> total{0u};
+  carla::ParallelFor(64u, 1u, [&total](size_t, size_t) {
+    carla::ParallelFor(64u, 1u, [&total](size_t begin, size_t end) {
+      total += end - begin;
+    });
+  });
+  ASSERT_EQ(total, 64u * 64u);
+}
+
+TEST(parallel_for, rethrows_after_all_chunks) {
+  std::atomic<size_t> processed{0u};
+  ASSERT_THROW(
+      carla::ParallelFor(1000u, 10u, [&processed](size_t begin, size_t end) {
+        processed += end - begin;
+        if (begin == 500u) {
+          throw std::runtime_error("chunk failed");
+        }
+      }),
+      std::runtime_error);
+  ASSERT_EQ(processed, 1000u);
+}
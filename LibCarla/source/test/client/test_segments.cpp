@@ -0,0 +1,143 @@
+#include "test.h"
+
+#include <carla/aabb/AABBMap.h>
+#include <carla/geom/AABB2D.h>
+#include <carla/occupancy/OccupancyMap.h>
+#include <carla/segments/SegmentMap.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace carla;
+using namespace carla::segments;
+using namespace carla::occupancy;
+
+static float total_length(const SegmentMap& segment_map) {
+  float length = 0;
+  for (const geom::Segment2D& segment : segment_map.GetSegments()) {
+    length += (segment.end - segment.start).Length();
+  }
+  return length;
+}
+
+// A grid of horizontal and vertical roads.
+static SegmentMap grid_segment_map(int size, float spacing) {
+  std::vector<geom::Segment2D> segments;
+  for (int i = 0; i < size; i++) {
+    for (int j = 0; j + 1 < size; j++) {
+      float a = static_cast<float>(i) * spacing;
+      float b = static_cast<float>(j) * spacing;
+      segments.emplace_back(geom::Vector2D(b, a), geom::Vector2D(b + spacing, a));
+      segments.emplace_back(geom::Vector2D(a, b), geom::Vector2D(a, b + spacing));
+    }
+  }
+  return SegmentMap(segments);
+}
+
+TEST(segments, union_concatenates) {
+  SegmentMap a(std::vector<geom::Segment2D>{
+      geom::Segment2D(geom::Vector2D(0.0f, 0.0f), geom::Vector2D(1.0f, 0.0f))});
+  SegmentMap b(std::vector<geom::Segment2D>{
+      geom::Segment2D(geom::Vector2D(5.0f, 5.0f), geom::Vector2D(5.0f, 7.0f)),
+      geom::Segment2D(geom::Vector2D(0.0f, 0.0f), geom::Vector2D(1.0f, 0.0f))});
+
+  SegmentMap result = a.Union(b);
+  ASSERT_EQ(result.GetSegments().size(), 3u);
+  ASSERT_FLOAT_EQ(total_length(result), 4.0f);
+  ASSERT_TRUE(SegmentMap().Union(SegmentMap()).IsEmpty());
+}
+
+TEST(segments, difference_and_intersection_partition_length) {
+  SegmentMap segment_map = grid_segment_map(11, 10.0f);
+  std::vector<OccupancyMap> pieces;
+  pieces.emplace_back(geom::Vector2D(5.0f, 5.0f), geom::Vector2D(25.0f, 35.0f));
+  pieces.emplace_back(geom::Vector2D(61.0f, 61.0f), geom::Vector2D(62.0f, 89.0f));
+  OccupancyMap occupancy_map = OccupancyMap::UnionAll(std::move(pieces));
+
+  SegmentMap difference = segment_map.Difference(occupancy_map);
+  SegmentMap intersection = segment_map.Intersection(occupancy_map);
+
+  // The 20x30 box is crossed by 2 vertical and 3 horizontal lines, the 1x28
+  // box by 2 horizontal lines.
+  ASSERT_NEAR(total_length(intersection), 2 * 30.0f + 3 * 20.0f + 2 * 1.0f, 1e-3f);
+  ASSERT_NEAR(total_length(difference) + total_length(intersection), total_length(segment_map), 1e-2f);
+  for (const geom::Segment2D& segment : difference.GetSegments()) {
+    ASSERT_FALSE(occupancy_map.Contains(0.5f * (segment.start + segment.end)));
+  }
+  for (const geom::Segment2D& segment : intersection.GetSegments()) {
+    ASSERT_TRUE(occupancy_map.Contains(0.5f * (segment.start + segment.end)));
+  }
+}
+
+TEST(segments, rand_points_follow_length) {
+  // One segment 9 times as long as the other.
+  SegmentMap segment_map(std::vector<geom::Segment2D>{
+      geom::Segment2D(geom::Vector2D(0.0f, 0.0f), geom::Vector2D(9.0f, 0.0f)),
+      geom::Segment2D(geom::Vector2D(0.0f, 10.0f), geom::Vector2D(1.0f, 10.0f)),
+      geom::Segment2D(geom::Vector2D(0.0f, 20.0f), geom::Vector2D(0.0f, 20.0f))});
+  segment_map.SeedRand(0);
+
+  std::vector<geom::Vector2D> points = segment_map.RandPoints(100000);
+  ASSERT_EQ(points.size(), 100000u);
+  size_t num_long = 0;
+  for (const geom::Vector2D& point : points) {
+    ASSERT_NE(point.y, 20.0f);
+    if (point.y == 0.0f) {
+      ASSERT_GE(point.x, 0.0f);
+      ASSERT_LE(point.x, 9.0f);
+      num_long++;
+    }
+  }
+  ASSERT_NEAR(static_cast<float>(num_long) / static_cast<float>(points.size()), 0.9f, 0.01f);
+  ASSERT_TRUE(SegmentMap().RandPoints(10).empty());
+}
+
+TEST(segments, rand_point_excluding_avoids_aabbs) {
+  SegmentMap segment_map = grid_segment_map(11, 10.0f);
+  segment_map.SeedRand(1);
+  aabb::AABBMap aabb_map;
+  aabb_map.Insert(geom::AABB2D(geom::Vector2D(-5.0f, -5.0f), geom::Vector2D(45.0f, 105.0f)));
+  aabb_map.Insert(geom::AABB2D(geom::Vector2D(70.0f, 70.0f), geom::Vector2D(80.0f, 80.0f)));
+
+  const float clearance = 2.0f;
+  size_t num_found = 0;
+  for (int i = 0; i < 1000; i++) {
+    boost::optional<geom::Vector2D> point = segment_map.RandPointExcluding(aabb_map, clearance, 16);
+    if (!point) continue;
+    num_found++;
+    ASSERT_FALSE(aabb_map.Intersects(geom::AABB2D(
+        *point - geom::Vector2D(clearance, clearance),
+        *point + geom::Vector2D(clearance, clearance))));
+  }
+  // Most of the map is free, so 16 tries almost always find a point.
+  ASSERT_GT(num_found, 990u);
+
+  // Nothing is returned once everything is excluded.
+  aabb_map.Insert(geom::AABB2D(geom::Vector2D(-5.0f, -5.0f), geom::Vector2D(105.0f, 105.0f)));
+  ASSERT_FALSE(segment_map.RandPointExcluding(aabb_map, clearance, 16));
+  ASSERT_FALSE(SegmentMap().RandPointExcluding(aabb::AABBMap(), clearance, 16));
+}
+
+TEST(segments, rand_points_excluding_keeps_spacing) {
+  SegmentMap segment_map = grid_segment_map(11, 10.0f);
+  segment_map.SeedRand(2);
+  aabb::AABBMap aabb_map;
+  aabb_map.Insert(geom::AABB2D(geom::Vector2D(-5.0f, -5.0f), geom::Vector2D(45.0f, 105.0f)));
+
+  const float clearance = 3.0f;
+  std::vector<geom::Vector2D> points = segment_map.RandPointsExcluding(aabb_map, clearance, 50, 100);
+  ASSERT_GT(points.size(), 10u);
+  ASSERT_LE(points.size(), 50u);
+  for (size_t i = 0; i < points.size(); i++) {
+    ASSERT_FALSE(aabb_map.Intersects(geom::AABB2D(
+        points[i] - geom::Vector2D(clearance, clearance),
+        points[i] + geom::Vector2D(clearance, clearance))));
+    for (size_t j = 0; j < i; j++) {
+      geom::Vector2D offset = points[i] - points[j];
+      ASSERT_GE(std::max(std::abs(offset.x), std::abs(offset.y)), clearance);
+    }
+  }
+
+  ASSERT_TRUE(SegmentMap().RandPointsExcluding(aabb_map, clearance, 10, 10).empty());
+}
@@ -0,0 +1,126 @@
+#include "test.h"
+
+#include <carla/sidewalk/Sidewalk.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace carla;
+using namespace carla::sidewalk;
+
+// Rings of random polygons, with enough vertices for batches to span several
+// chunks.
+static Sidewalk random_sidewalk(std::mt19937& rng) {
+  std::uniform_real_distribution<float> radius_dist(5.0f, 10.0f);
+  std::vector<std::vector<geom::Vector2D>> polygons;
+  for (int i = 0; i < 20; i++) {
+    geom::Vector2D center(static_cast<float>(i % 5) * 30.0f, static_cast<float>(i / 5) * 30.0f);
+    std::vector<geom::Vector2D> polygon;
+    for (int j = 0; j < 72; j++) {
+      float angle = static_cast<float>(j) * 2.0f * 3.14159265f / 72.0f;
+      polygon.emplace_back(center + radius_dist(rng) * geom::Vector2D(std::cos(angle), std::sin(angle)));
+    }
+    polygons.emplace_back(std::move(polygon));
+  }
+  return Sidewalk(polygons);
+}
+
+static void assert_route_point_eq(const SidewalkRoutePoint& actual, const SidewalkRoutePoint& expected) {
+  ASSERT_EQ(actual.polygon_id, expected.polygon_id);
+  ASSERT_EQ(actual.segment_id, expected.segment_id);
+  ASSERT_FLOAT_EQ(actual.offset, expected.offset);
+}
+
+TEST(sidewalk, batch_queries_match_single_queries) {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> position_dist(-20.0f, 140.0f);
+  Sidewalk sidewalk = random_sidewalk(rng);
+
+  std::vector<geom::Vector2D> positions;
+  std::vector<geom::Segment2D> segments;
+  for (int i = 0; i < 2000; i++) {
+    positions.emplace_back(position_dist(rng), position_dist(rng));
+    segments.emplace_back(positions.back(), positions.back() + geom::Vector2D(4.0f, 0.0f));
+  }
+
+  std::vector<SidewalkRoutePoint> route_points = sidewalk.GetNearestRoutePoints(positions);
+  std::vector<geom::Vector2D> route_point_positions = sidewalk.GetRoutePointPositions(route_points);
+  std::vector<SidewalkRoutePoint> next_route_points = sidewalk.GetNextRoutePoints(route_points, 3.0f);
+  std::vector<SidewalkRoutePoint> previous_route_points = sidewalk.GetPreviousRoutePoints(route_points, 3.0f);
+  std::vector<boost::optional<SidewalkRoutePoint>> adjacent_route_points = sidewalk.GetAdjacentRoutePoints(route_points, 50.0f);
+  std::vector<bool> intersects = sidewalk.IntersectsMany(segments);
+  ASSERT_EQ(route_points.size(), positions.size());
+  ASSERT_EQ(intersects.size(), segments.size());
+
+  size_t num_intersects = 0;
+  for (size_t i = 0; i < positions.size(); i++) {
+    assert_route_point_eq(route_points[i], sidewalk.GetNearestRoutePoint(positions[i]));
+    ASSERT_EQ(route_point_positions[i], sidewalk.GetRoutePointPosition(route_points[i]));
+    assert_route_point_eq(next_route_points[i], sidewalk.GetNextRoutePoint(route_points[i], 3.0f));
+    assert_route_point_eq(previous_route_points[i], sidewalk.GetPreviousRoutePoint(route_points[i], 3.0f));
+
+    boost::optional<SidewalkRoutePoint> adjacent_route_point = sidewalk.GetAdjacentRoutePoint(route_points[i], 50.0f);
+    ASSERT_EQ(static_cast<bool>(adjacent_route_points[i]), static_cast<bool>(adjacent_route_point));
+    if (adjacent_route_point) {
+      assert_route_point_eq(*adjacent_route_points[i], *adjacent_route_point);
+    }
+
+    ASSERT_EQ(intersects[i], sidewalk.Intersects(segments[i]));
+    num_intersects += intersects[i] ? 1 : 0;
+  }
+  ASSERT_GT(num_intersects, 0u);
+  ASSERT_LT(num_intersects, segments.size());
+}
+
+// Walks segment by segment, as Sidewalk did before it precomputed ring
+// lengths.
+static geom::Vector2D walk_reference(const Sidewalk& sidewalk, SidewalkRoutePoint route_point, float distance) {
+  const std::vector<geom::Vector2D>& polygon = sidewalk.Polygons()[route_point.polygon_id];
+  auto segment_length = [&](size_t segment_id) {
+    return (polygon[(segment_id + 1) % polygon.size()] - polygon[segment_id]).Length();
+  };
+  if (distance >= 0) {
+    while (route_point.offset + distance > segment_length(route_point.segment_id)) {
+      distance -= segment_length(route_point.segment_id) - route_point.offset;
+      route_point.segment_id = (route_point.segment_id + 1) % polygon.size();
+      route_point.offset = 0;
+    }
+    route_point.offset += distance;
+  } else {
+    distance = -distance;
+    while (route_point.offset - distance < 0) {
+      distance -= route_point.offset;
+      route_point.segment_id = (route_point.segment_id == 0 ? polygon.size() : route_point.segment_id) - 1;
+      route_point.offset = segment_length(route_point.segment_id);
+    }
+    route_point.offset -= distance;
+  }
+  return sidewalk.GetRoutePointPosition(route_point);
+}
+
+TEST(sidewalk, walk_matches_reference) {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> position_dist(-20.0f, 140.0f);
+  std::uniform_real_distribution<float> distance_dist(0.0f, 100.0f);
+  Sidewalk sidewalk = random_sidewalk(rng);
+
+  for (int i = 0; i < 2000; i++) {
+    SidewalkRoutePoint route_point = sidewalk.GetNearestRoutePoint(geom::Vector2D(position_dist(rng), position_dist(rng)));
+    float distance = i % 10 == 0 ? 0.0f : distance_dist(rng);
+
+    SidewalkRoutePoint next = sidewalk.GetNextRoutePoint(route_point, distance);
+    SidewalkRoutePoint previous = sidewalk.GetPreviousRoutePoint(route_point, distance);
+    ASSERT_LT((sidewalk.GetRoutePointPosition(next) - walk_reference(sidewalk, route_point, distance)).Length(), 1e-3f);
+    ASSERT_LT((sidewalk.GetRoutePointPosition(previous) - walk_reference(sidewalk, route_point, -distance)).Length(), 1e-3f);
+
+    // Arc lengths stay on the ring and advance by the walked distance.
+    for (const SidewalkRoutePoint& walked : {route_point, next, previous}) {
+      ASSERT_GE(walked.arc_length, 0.0f);
+      ASSERT_LE(walked.arc_length, sidewalk.RingLength(walked.polygon_id));
+    }
+    float ring_length = sidewalk.RingLength(route_point.polygon_id);
+    float advanced = std::fmod(next.arc_length - route_point.arc_length + 2 * ring_length, ring_length);
+    float expected = std::fmod(distance, ring_length);
+    ASSERT_LT(std::min(std::abs(advanced - expected), ring_length - std::abs(advanced - expected)), 1e-3f);
+  }
+}
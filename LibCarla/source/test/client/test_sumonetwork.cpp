@@ -1,9 +1,15 @@
 #include "test.h"
 
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem.hpp>
 #include <carla/sumonetwork/SumoNetwork.h>
+#include <algorithm>
 #include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 using namespace carla::sumonetwork;
 using namespace boost::filesystem;
@@ -12,11 +18,156 @@ const std::string BASE_PATH = LIBCARLA_TEST_CONTENT_FOLDER "/SUMO/";
 
 TEST(sumonetwork, load_sumo_network) {
   for (directory_iterator it(BASE_PATH); it != directory_iterator(); ++it) {
+    if (!boost::algorithm::ends_with(it->path().string(), ".net.xml")) continue;
     std::cout << "Loading SUMO Network from " << it->path().string() << std::endl;
-    std::ifstream t(it->path().string());
-    std::stringstream buffer;
-    buffer << t.rdbuf();
-    SumoNetwork::Load(buffer.str());
+    SumoNetwork::Load(it->path().string());
   }
 
 }
+
+TEST(sumonetwork, load_sumo_network_cache) {
+  for (directory_iterator it(BASE_PATH); it != directory_iterator(); ++it) {
+    if (!boost::algorithm::ends_with(it->path().string(), ".net.xml")) continue;
+    path file = temp_directory_path() / unique_path("%%%%-%%%%.net.xml");
+    copy_file(it->path(), file);
+
+    SumoNetwork parsed = SumoNetwork::Load(file.string(), false);
+    SumoNetwork::Load(file.string());
+    ASSERT_FALSE(exists(file.string() + ".cache"));
+    SumoNetwork::Load(file.string(), true);
+    ASSERT_TRUE(exists(file.string() + ".cache"));
+    SumoNetwork cached = SumoNetwork::Load(file.string(), true);
+    remove(file.string() + ".cache");
+    remove(file);
+
+    ASSERT_EQ(parsed.Edges().size(), cached.Edges().size());
+    for (const auto& edge_entry : parsed.Edges()) {
+      const Edge& cached_edge = cached.Edges().at(edge_entry.first);
+      ASSERT_EQ(edge_entry.second.lanes.size(), cached_edge.lanes.size());
+      for (size_t i = 0; i < cached_edge.lanes.size(); i++) {
+        ASSERT_EQ(edge_entry.second.lanes[i].shape, cached_edge.lanes[i].shape);
+      }
+    }
+    ASSERT_EQ(parsed.Junctions().size(), cached.Junctions().size());
+    ASSERT_EQ(parsed.Connections().size(), cached.Connections().size());
+
+    for (const auto& edge_entry : parsed.Edges()) {
+      for (const Lane& lane : edge_entry.second.lanes) {
+        RoutePoint route_point{edge_entry.first, lane.index, 0, 0};
+        ASSERT_EQ(parsed.GetNextRoutePoints(route_point, 10.0f).size(),
+            cached.GetNextRoutePoints(route_point, 10.0f).size());
+
+        carla::geom::Vector2D position = lane.shape[0] + carla::geom::Vector2D(0.5f, 0.5f);
+        ASSERT_FLOAT_EQ(
+            (parsed.GetRoutePointPosition(parsed.GetNearestRoutePoint(position)) - position).Length(),
+            (cached.GetRoutePointPosition(cached.GetNearestRoutePoint(position)) - position).Length());
+      }
+    }
+  }
+}
+
+TEST(sumonetwork, load_sumo_network_corrupt_cache) {
+  path file = temp_directory_path() / unique_path("%%%%-%%%%.net.xml");
+  copy_file(BASE_PATH + "highway.net.xml", file);
+  SumoNetwork parsed = SumoNetwork::Load(file.string(), true);
+  std::string cache_file = file.string() + ".cache";
+  size_t cache_size = file_size(cache_file);
+
+  // Sizes read from a corrupt cache are all ones, so the cache must be
+  // rejected before allocating for them.
+  std::ifstream ifs(cache_file, std::ios::binary);
+  std::vector<char> contents{std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+  ifs.close();
+  for (size_t offset = 0; offset + 4 <= std::min<size_t>(cache_size, 2048); offset++) {
+    std::vector<char> corrupt = contents;
+    std::fill(corrupt.begin() + offset, corrupt.begin() + offset + 4, static_cast<char>(0xFF));
+    std::ofstream ofs(cache_file, std::ios::binary | std::ios::trunc);
+    ofs.write(corrupt.data(), corrupt.size());
+    ofs.close();
+
+    SumoNetwork loaded = SumoNetwork::Load(file.string(), true);
+    ASSERT_EQ(parsed.Edges().size(), loaded.Edges().size());
+    ASSERT_EQ(parsed.Junctions().size(), loaded.Junctions().size());
+    ASSERT_EQ(parsed.Connections().size(), loaded.Connections().size());
+  }
+
+  remove(cache_file);
+  remove(file);
+}
+
+TEST(sumonetwork, indexed_route_points) {
+  for (directory_iterator it(BASE_PATH); it != directory_iterator(); ++it) {
+    if (!boost::algorithm::ends_with(it->path().string(), ".net.xml")) continue;
+    SumoNetwork sumo_network = SumoNetwork::Load(it->path().string(), false);
+
+    for (const auto& edge_entry : sumo_network.Edges()) {
+      for (const Lane& lane : edge_entry.second.lanes) {
+        RoutePoint route_point{edge_entry.first, lane.index, 0, 0.5f};
+        IndexedRoutePoint indexed_route_point = sumo_network.ToIndexedRoutePoint(route_point);
+        ASSERT_EQ(sumo_network.GetEdgeId(sumo_network.GetLaneEdgeHandle(indexed_route_point.lane)), edge_entry.first);
+        ASSERT_EQ(sumo_network.GetLaneIndex(indexed_route_point.lane), lane.index);
+
+        std::vector<RoutePoint> next_route_points = sumo_network.GetNextRoutePoints(route_point, 5.0f);
+        std::vector<IndexedRoutePoint> next_indexed_route_points = sumo_network.GetNextRoutePoints(indexed_route_point, 5.0f);
+        ASSERT_EQ(next_route_points.size(), next_indexed_route_points.size());
+        for (size_t i = 0; i < next_route_points.size(); i++) {
+          RoutePoint converted = sumo_network.ToRoutePoint(next_indexed_route_points[i]);
+          ASSERT_EQ(next_route_points[i].edge, converted.edge);
+          ASSERT_EQ(next_route_points[i].lane, converted.lane);
+          ASSERT_EQ(next_route_points[i].segment, converted.segment);
+          ASSERT_EQ(next_route_points[i].offset, converted.offset);
+        }
+      }
+    }
+  }
+}
+
+TEST(sumonetwork, route_path_tree) {
+  std::mt19937 rng(0);
+  for (directory_iterator it(BASE_PATH); it != directory_iterator(); ++it) {
+    if (!boost::algorithm::ends_with(it->path().string(), ".net.xml")) continue;
+    SumoNetwork sumo_network = SumoNetwork::Load(it->path().string(), false);
+
+    for (const auto& edge_entry : sumo_network.Edges()) {
+      if (edge_entry.second.lanes.empty()) continue;
+      RoutePoint route_point{edge_entry.first, edge_entry.second.lanes[0].index, 0, 0.5f};
+      IndexedRoutePoint indexed_route_point = sumo_network.ToIndexedRoutePoint(route_point);
+
+      std::vector<std::vector<IndexedRoutePoint>> paths = sumo_network.GetNextRoutePaths(indexed_route_point, 10, 1.0f);
+      RoutePathTree tree = sumo_network.GetNextRoutePathTree(indexed_route_point, 10, 1.0f);
+      ASSERT_EQ(tree.NumPaths(), paths.size());
+      ASSERT_THROW(tree.GetPath(paths.size()), std::out_of_range);
+      for (size_t i = 0; i < paths.size(); i++) {
+        std::vector<IndexedRoutePoint> path = tree.GetPath(i);
+        ASSERT_EQ(path.size(), 11u);
+        for (size_t j = 0; j < path.size(); j++) {
+          ASSERT_EQ(path[j].lane, paths[i][j].lane);
+          ASSERT_EQ(path[j].segment, paths[i][j].segment);
+          ASSERT_EQ(path[j].offset, paths[i][j].offset);
+        }
+      }
+
+      std::vector<IndexedRoutePoint> sampled = sumo_network.SampleNextRoutePath(indexed_route_point, 10, 1.0f, rng);
+      ASSERT_EQ(sampled.empty(), paths.empty());
+      if (sampled.empty()) continue;
+      ASSERT_EQ(sampled.size(), 11u);
+      bool found = false;
+      for (size_t i = 0; i < paths.size() && !found; i++) {
+        found = true;
+        for (size_t j = 0; j < sampled.size() && found; j++) {
+          found = sampled[j].lane == paths[i][j].lane && sampled[j].segment == paths[i][j].segment && sampled[j].offset == paths[i][j].offset;
+        }
+      }
+      ASSERT_TRUE(found);
+    }
+  }
+}
+
+TEST(sumonetwork, empty_route_path_tree) {
+  std::mt19937 rng(0);
+  RoutePathTree tree;
+  ASSERT_EQ(tree.NumPaths(), 0u);
+  ASSERT_EQ(tree.NumPoints(), 0u);
+  ASSERT_THROW(tree.GetPath(0), std::out_of_range);
+  ASSERT_THROW(tree.Sample(rng), std::out_of_range);
+}
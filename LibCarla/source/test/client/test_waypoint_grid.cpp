@@ -0,0 +1,87 @@
+#include "test.h"
+
+#include <carla/geom/Math.h>
+#include <carla/trafficmanager/WaypointGrid.h>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace carla;
+using namespace carla::traffic_manager;
+
+TEST(traffic_manager, waypoint_grid_finds_closest) {
+  std::mt19937 rng(4);
+  auto uniform = [&rng](float min, float max) {
+    return min + (max - min) * static_cast<float>(rng() / 4294967296.0);
+  };
+  std::vector<geom::Location> locations;
+  for (int i = 0; i < 500; ++i) {
+    locations.emplace_back(uniform(-50.0f, 50.0f), uniform(-50.0f, 50.0f), 0.0f);
+  }
+  WaypointGrid grid(4.0f);
+  grid.Build(locations);
+
+  // Queries within a cell of a waypoint always see the closest one.
+  for (int i = 0; i < 500; ++i) {
+    const geom::Location query(uniform(-50.0f, 50.0f), uniform(-50.0f, 50.0f), 0.0f);
+    uint32_t expected = 0u;
+    for (uint32_t j = 1u; j < locations.size(); ++j) {
+      if (geom::Math::DistanceSquared(locations[j], query) <
+          geom::Math::DistanceSquared(locations[expected], query)) {
+        expected = j;
+      }
+    }
+    if (geom::Math::DistanceSquared(locations[expected], query) < 4.0f * 4.0f) {
+      ASSERT_EQ(grid.FindClosest(query), expected);
+    }
+  }
+
+  std::vector<geom::Location> queries(locations.begin(), locations.begin() + 10);
+  std::vector<uint32_t> closest = grid.FindClosest(queries);
+  ASSERT_EQ(closest.size(), queries.size());
+  for (uint32_t i = 0u; i < closest.size(); ++i) {
+    ASSERT_EQ(closest[i], i);
+  }
+}
+
+TEST(traffic_manager, waypoint_grid_ties_go_to_lowest_index) {
+  // Equidistant from the query and listed in different cells and orders.
+  std::vector<geom::Location> locations{
+    {5.0f, 1.0f, 0.0f},
+    {1.0f, 5.0f, 0.0f},
+    {-3.0f, 1.0f, 0.0f},
+    {1.0f, -3.0f, 0.0f},
+  };
+  WaypointGrid grid(4.0f);
+  grid.Build(locations);
+  ASSERT_EQ(grid.FindClosest(geom::Location(1.0f, 1.0f, 0.0f)), 0u);
+
+  std::vector<geom::Location> reversed(locations.rbegin(), locations.rend());
+  grid.Build(reversed);
+  ASSERT_EQ(grid.FindClosest(geom::Location(1.0f, 1.0f, 0.0f)), 0u);
+
+  // A closer waypoint in a neighbouring cell wins over one in the same cell.
+  grid.Build({{3.5f, 0.5f, 0.0f}, {4.1f, 0.5f, 0.0f}});
+  ASSERT_EQ(grid.FindClosest(geom::Location(3.9f, 0.5f, 0.0f)), 1u);
+}
+
+TEST(traffic_manager, waypoint_grid_empty_and_out_of_range) {
+  WaypointGrid grid(4.0f);
+  ASSERT_EQ(grid.FindClosest(geom::Location(0.0f, 0.0f, 0.0f)), WaypointGrid::NO_WAYPOINT);
+
+  grid.Build({});
+  ASSERT_EQ(grid.FindClosest(geom::Location(0.0f, 0.0f, 0.0f)), WaypointGrid::NO_WAYPOINT);
+
+  grid.Build({{1.0f, 1.0f, 0.0f}});
+  // Only the cell of the query and its eight neighbours are searched.
+  ASSERT_EQ(grid.FindClosest(geom::Location(-3.0f, 7.0f, 0.0f)), 0u);
+  ASSERT_EQ(grid.FindClosest(geom::Location(9.0f, 1.0f, 0.0f)), WaypointGrid::NO_WAYPOINT);
+  ASSERT_EQ(grid.FindClosest(geom::Location(1.0f, -5.0f, 0.0f)), WaypointGrid::NO_WAYPOINT);
+
+  // Far away and invalid locations find nothing.
+  const float infinity = std::numeric_limits<float>::infinity();
+  ASSERT_EQ(grid.FindClosest(geom::Location(1e30f, -1e30f, 0.0f)), WaypointGrid::NO_WAYPOINT);
+  ASSERT_EQ(grid.FindClosest(geom::Location(infinity, 0.0f, 0.0f)), WaypointGrid::NO_WAYPOINT);
+  ASSERT_EQ(grid.FindClosest(geom::Location(std::nanf(""), 0.0f, 0.0f)), WaypointGrid::NO_WAYPOINT);
+}
@@ -0,0 +1,65 @@
+#include "test.h"
+
+#include <carla/trafficmanager/RandomGenerator.h>
+#include <carla/trafficmanager/WorkerPool.h>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace carla::traffic_manager;
+
+TEST(traffic_manager, worker_pool_chunks_cover_range) {
+  WorkerPool worker_pool(3u);
+
+  for (uint64_t size : {0u, 1u, 31u, 100u, 1000u}) {
+    const uint64_t number_of_chunks = worker_pool.GetNumberOfChunks(size);
+    ASSERT_LE(number_of_chunks, worker_pool.GetMaximumNumberOfChunks());
+
+    std::vector<uint64_t> chunk_begins(number_of_chunks);
+    std::vector<uint64_t> chunk_ends(number_of_chunks);
+    std::vector<int> visits(size, 0);
+    worker_pool.ParallelFor(size, [&](uint64_t chunk, uint64_t begin, uint64_t end) {
+      chunk_begins[chunk] = begin;
+      chunk_ends[chunk] = end;
+      for (uint64_t i = begin; i < end; ++i) {
+        ++visits[i];
+      }
+    });
+
+    // Chunks are contiguous and in order.
+    for (uint64_t chunk = 0u; chunk < number_of_chunks; ++chunk) {
+      ASSERT_EQ(chunk_begins[chunk], chunk == 0u ? 0u : chunk_ends[chunk - 1u]);
+    }
+    if (number_of_chunks > 0u) {
+      ASSERT_EQ(chunk_ends.back(), size);
+    }
+    ASSERT_EQ(visits, std::vector<int>(size, 1));
+  }
+}
+
+TEST(traffic_manager, worker_pool_rethrows_after_all_chunks) {
+  WorkerPool worker_pool(3u);
+  std::atomic<uint64_t> processed{0u};
+  ASSERT_THROW(worker_pool.ParallelFor(1000u, [&](uint64_t chunk, uint64_t begin, uint64_t end) {
+    processed += end - begin;
+    if (chunk == 1u) {
+      throw std::runtime_error("chunk failed");
+    }
+  }), std::runtime_error);
+  ASSERT_EQ(processed.load(), 1000u);
+}
+
+TEST(traffic_manager, random_generator_is_per_vehicle) {
+  RandomGenerator a(42u, 1u);
+  RandomGenerator b(42u, 1u);
+  RandomGenerator other(42u, 2u);
+  bool differs = false;
+  for (int i = 0; i < 100; ++i) {
+    const uint64_t value = a.NextPercentage();
+    ASSERT_LE(value, 100u);
+    ASSERT_EQ(value, b.NextPercentage());
+    differs = differs || value != other.NextPercentage();
+  }
+  ASSERT_TRUE(differs);
+  ASSERT_EQ(a.NextIndex(0u), 0u);
+}
@@ -17,8 +17,44 @@ void export_aabb() {
               stl_input_iterator<carla::geom::AABB2D>()};
             return boost::shared_ptr<AABBMap>(new AABBMap(aabbs));
           }))
+    .def("__init__", make_constructor(
+          +[](const numpy::ndarray& aabbs_np) {
+            return boost::shared_ptr<AABBMap>(new AABBMap(
+                  NumPyArrayToVector<geom::AABB2D>(aabbs_np)));
+          }))
     .def("__len__", &AABBMap::Count)
     .def("insert", &AABBMap::Insert)
+    .def("remove", &AABBMap::Remove)
+    .def("update", &AABBMap::Update)
+    .def("contains", &AABBMap::Contains)
+    .def("get", &AABBMap::Get, return_value_policy<copy_const_reference>())
     .def("intersects", &AABBMap::Intersects)
+    .def("intersects_many",
+        +[](const AABBMap& self, const list& aabbs_py) {
+          std::vector<geom::AABB2D> aabbs{
+            stl_input_iterator<carla::geom::AABB2D>(aabbs_py),
+            stl_input_iterator<carla::geom::AABB2D>()};
+          list results;
+          for (bool result : self.IntersectsMany(aabbs)) {
+            results.append(result);
+          }
+          return results;
+        })
+    .def("query_intersects",
+        +[](const AABBMap& self, const geom::AABB2D& aabb) {
+          list handles;
+          for (size_t handle : self.QueryIntersects(aabb)) {
+            handles.append(handle);
+          }
+          return handles;
+        })
+    .def("query_nearest",
+        +[](const AABBMap& self, const geom::Vector2D& point, size_t k) {
+          list handles;
+          for (size_t handle : self.QueryNearest(point, k)) {
+            handles.append(handle);
+          }
+          return handles;
+        })
   ;
 }
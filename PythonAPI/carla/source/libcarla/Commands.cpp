@@ -79,11 +79,23 @@ void export_commands() {
               stl_input_iterator<carla::geom::Vector3D>()};
             return boost::shared_ptr<cr::Command::SpawnDynamicMesh>(new cr::Command::SpawnDynamicMesh(triangles, material, semantic_segmentation_label));
           }))
+    .def("__init__", make_constructor(
+          +[](const boost::python::numpy::ndarray& triangles_np, const std::string& material, uint8_t semantic_segmentation_label) {
+            return boost::shared_ptr<cr::Command::SpawnDynamicMesh>(new cr::Command::SpawnDynamicMesh(
+                  NumPyArrayToVector<carla::geom::Vector3D>(triangles_np), material, semantic_segmentation_label));
+          }))
     .def_readwrite("triangles", &cr::Command::SpawnDynamicMesh::triangles)
     .def_readwrite("material", &cr::Command::SpawnDynamicMesh::material)
     .def_readwrite("semantic_tag", &cr::Command::SpawnDynamicMesh::semantic_segmentation_label)
   ;
 
+  class_<cr::Command::SpawnDynamicIndexedMesh>("SpawnDynamicIndexedMesh")
+    .def(init<carla::geom::IndexedMesh, std::string, uint8_t>((arg("mesh"), arg("material"), arg("semantic_tag"))))
+    .def_readwrite("mesh", &cr::Command::SpawnDynamicIndexedMesh::mesh)
+    .def_readwrite("material", &cr::Command::SpawnDynamicIndexedMesh::material)
+    .def_readwrite("semantic_tag", &cr::Command::SpawnDynamicIndexedMesh::semantic_segmentation_label)
+  ;
+
   class_<cr::Command::DestroyDynamicMesh>("DestroyDynamicMesh")
     .def("__init__", &command_impl::CustomInit<uint32_t>, (arg("id")))
     .def(init<uint32_t>((arg("id"))))
@@ -180,6 +192,7 @@ void export_commands() {
   ;
 
   implicitly_convertible<cr::Command::SpawnDynamicMesh, cr::Command>();
+  implicitly_convertible<cr::Command::SpawnDynamicIndexedMesh, cr::Command>();
   implicitly_convertible<cr::Command::DestroyDynamicMesh, cr::Command>();
   implicitly_convertible<cr::Command::SpawnActor, cr::Command>();
   implicitly_convertible<cr::Command::DestroyActor, cr::Command>();
@@ -1,6 +1,7 @@
 #include <carla/geom/Vector2D.h>
 #include <carla/gamma/Vector2.h>
 #include <carla/gamma/RVOSimulator.h>
+#include <carla/gamma/CrowdEngine.h>
 #include <boost/python/register_ptr_to_python.hpp>
 
 void export_gamma() {
@@ -54,12 +55,51 @@ void export_gamma() {
   ;
 
 
-  class_<RVOSimulator>("RVOSimulator", init<>())
+  class_<RVOSimulator, boost::noncopyable>("RVOSimulator", init<>())
     // RVO2
     .def("add_agent", 
         +[](RVOSimulator& self, const AgentParams& params, int agent_id) {
           return static_cast<int>(self.addAgent(params, agent_id));
         })
+    .def("remove_agent",
+        +[](RVOSimulator& self, int agent_no) {
+          self.removeAgent(static_cast<size_t>(agent_no));
+        })
+    .def("has_agent",
+        +[](RVOSimulator& self, int agent_no) {
+          return agent_no >= 0 && self.hasAgent(static_cast<size_t>(agent_no));
+        })
+    .def("get_num_agents", &RVOSimulator::getNumAgents)
+    .def("get_num_live_agents", &RVOSimulator::getNumLiveAgents)
+    .def("clear_all_agents", &RVOSimulator::clearAllAgents)
+    .def("set_agent_states",
+        +[](RVOSimulator& self, const list& agent_nos_py, const list& positions_py,
+            const list& velocities_py, const list& pref_velocities_py) {
+          std::vector<size_t> agent_nos{
+            stl_input_iterator<size_t>(agent_nos_py),
+            stl_input_iterator<size_t>()};
+          std::vector<float> positions;
+          std::vector<float> velocities;
+          std::vector<float> pref_velocities;
+          auto flatten = [&agent_nos](const list& vectors_py, std::vector<float>& out) {
+            std::vector<geom::Vector2D> vectors{
+              stl_input_iterator<geom::Vector2D>(vectors_py),
+              stl_input_iterator<geom::Vector2D>()};
+            if (vectors.size() != agent_nos.size()) {
+              throw std::invalid_argument("agent state lists must have equal lengths!");
+            }
+            out.reserve(2 * vectors.size());
+            for (const geom::Vector2D& v : vectors) {
+              out.emplace_back(v.x);
+              out.emplace_back(v.y);
+            }
+          };
+          flatten(positions_py, positions);
+          flatten(velocities_py, velocities);
+          flatten(pref_velocities_py, pref_velocities);
+          self.setAgentStates(agent_nos.size(), agent_nos.data(),
+              positions.data(), velocities.data(), pref_velocities.data());
+        })
     .def("add_obstacle",
         +[](RVOSimulator& self, const list& vertices_py) {
           std::vector<geom::Vector2D> vertices{
@@ -73,7 +113,13 @@ void export_gamma() {
           self.addObstacle(vertices_gamma);
         })
     .def("process_obstacles", &RVOSimulator::processObstacles)
-    .def("do_step", &RVOSimulator::doStep)
+    .def("do_step",
+        +[](RVOSimulator& self) {
+          carla::PythonUtil::ReleaseGIL unlock;
+          self.doStep();
+        })
+    .def("set_num_workers", &RVOSimulator::setNumWorkers)
+    .def("get_num_workers", &RVOSimulator::getNumWorkers)
     .def("set_agent_position",
         +[](RVOSimulator& self, int agent_no, const geom::Vector2D& position) {
           self.setAgentPosition(
@@ -157,4 +203,60 @@ void export_gamma() {
               behavior_type);
         })
   ;
+
+  class_<gamma::CrowdEngineSettings>("CrowdEngineSettings", init<>())
+    .def_readwrite("bounds_min", &gamma::CrowdEngineSettings::bounds_min)
+    .def_readwrite("bounds_max", &gamma::CrowdEngineSettings::bounds_max)
+    .def_readwrite("use_forbidden_bounds", &gamma::CrowdEngineSettings::use_forbidden_bounds)
+    .def_readwrite("forbidden_bounds_min", &gamma::CrowdEngineSettings::forbidden_bounds_min)
+    .def_readwrite("forbidden_bounds_max", &gamma::CrowdEngineSettings::forbidden_bounds_max)
+    .def_readwrite("num_cars", &gamma::CrowdEngineSettings::num_cars)
+    .def_readwrite("num_bikes", &gamma::CrowdEngineSettings::num_bikes)
+    .def_readwrite("num_pedestrians", &gamma::CrowdEngineSettings::num_pedestrians)
+    .def_readwrite("speed_car", &gamma::CrowdEngineSettings::speed_car)
+    .def_readwrite("speed_bike", &gamma::CrowdEngineSettings::speed_bike)
+    .def_readwrite("speed_pedestrian", &gamma::CrowdEngineSettings::speed_pedestrian)
+    .def_readwrite("clearance_car", &gamma::CrowdEngineSettings::clearance_car)
+    .def_readwrite("clearance_bike", &gamma::CrowdEngineSettings::clearance_bike)
+    .def_readwrite("clearance_pedestrian", &gamma::CrowdEngineSettings::clearance_pedestrian)
+    .def_readwrite("lane_change_probability", &gamma::CrowdEngineSettings::lane_change_probability)
+    .def_readwrite("cross_probability", &gamma::CrowdEngineSettings::cross_probability)
+    .def_readwrite("stuck_speed", &gamma::CrowdEngineSettings::stuck_speed)
+    .def_readwrite("stuck_duration", &gamma::CrowdEngineSettings::stuck_duration)
+    .def_readwrite("collision", &gamma::CrowdEngineSettings::collision)
+    .def_readwrite("rate", &gamma::CrowdEngineSettings::rate)
+  ;
+
+  class_<gamma::CrowdStatistics>("CrowdStatistics", no_init)
+    .def_readonly("total_num_cars", &gamma::CrowdStatistics::total_num_cars)
+    .def_readonly("total_num_bikes", &gamma::CrowdStatistics::total_num_bikes)
+    .def_readonly("total_num_pedestrians", &gamma::CrowdStatistics::total_num_pedestrians)
+    .def_readonly("stuck_num_cars", &gamma::CrowdStatistics::stuck_num_cars)
+    .def_readonly("stuck_num_bikes", &gamma::CrowdStatistics::stuck_num_bikes)
+    .def_readonly("stuck_num_pedestrians", &gamma::CrowdStatistics::stuck_num_pedestrians)
+    .def_readonly("avg_speed_cars", &gamma::CrowdStatistics::avg_speed_cars)
+    .def_readonly("avg_speed_bikes", &gamma::CrowdStatistics::avg_speed_bikes)
+    .def_readonly("avg_speed_pedestrians", &gamma::CrowdStatistics::avg_speed_pedestrians)
+  ;
+
+  class_<gamma::CrowdEngine, boost::noncopyable>("CrowdEngine",
+      init<client::Client, const sumonetwork::SumoNetwork&, const occupancy::OccupancyMap&, uint32_t>(
+        (arg("client"), arg("sumo_network"), arg("sumo_network_occupancy"), arg("seed"))))
+    .def("configure", &gamma::CrowdEngine::Configure)
+    .add_property("settings", &gamma::CrowdEngine::GetSettings)
+    .add_property("statistics", &gamma::CrowdEngine::GetStatistics)
+    .add_property("num_agents", &gamma::CrowdEngine::NumAgents)
+    .add_property("is_running", &gamma::CrowdEngine::IsRunning)
+    .def("start", &gamma::CrowdEngine::Start)
+    .def("stop",
+        +[](gamma::CrowdEngine& self) {
+          carla::PythonUtil::ReleaseGIL unlock;
+          self.Stop();
+        })
+    .def("tick",
+        +[](gamma::CrowdEngine& self) {
+          carla::PythonUtil::ReleaseGIL unlock;
+          self.Tick();
+        })
+  ;
 }
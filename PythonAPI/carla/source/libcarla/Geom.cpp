@@ -14,10 +14,12 @@
 #include <carla/geom/Triangle2D.h>
 #include <carla/geom/Segment2D.h>
 #include <carla/geom/AABB2D.h>
+#include <carla/geom/IndexedMesh.h>
 
 #include <boost/python/implicit.hpp>
 #include <boost/python/suite/indexing/vector_indexing_suite.hpp>
 
+#include <array>
 #include <ostream>
 
 namespace carla {
@@ -292,4 +294,41 @@ void export_geom() {
     .def(boost::python::vector_indexing_suite<std::vector<cg::AABB2D>>())
     .def(self_ns::str(self_ns::self))
   ;
+
+  class_<cg::IndexedMesh>("IndexedMesh")
+    .def("__init__", make_constructor(
+          +[](const numpy::ndarray& vertices_np, const numpy::ndarray& indices_np, bool double_sided) {
+            auto mesh = boost::shared_ptr<cg::IndexedMesh>(new cg::IndexedMesh());
+            mesh->vertices = NumPyArrayToVector<cg::Vector3D>(vertices_np);
+            mesh->indices = NumPyArrayToVector<uint32_t, uint32_t>(
+                indices_np.reshape(make_tuple(-1)));
+            mesh->double_sided = double_sided;
+            if (mesh->indices.size() % 3 != 0) {
+              throw std::invalid_argument("number of indices is not a multiple of 3!");
+            }
+            for (uint32_t index : mesh->indices) {
+              if (index >= mesh->vertices.size()) {
+                throw std::invalid_argument("vertex index out of range!");
+              }
+            }
+            return mesh;
+          },
+          default_call_policies(),
+          (arg("vertices"), arg("indices"), arg("double_sided")=true)))
+    .def_readwrite("double_sided", &cg::IndexedMesh::double_sided)
+    .add_property("num_triangles", &cg::IndexedMesh::NumTriangles)
+    // Read-only views; the buffers are only ever replaced from C++.
+    .add_property("vertices",
+        +[](object self_py) {
+          const cg::IndexedMesh& self = extract<const cg::IndexedMesh&>(self_py);
+          return VectorToNumPyView(self.vertices, {3}, self_py);
+        })
+    .add_property("indices",
+        +[](object self_py) {
+          // One row of three vertex indices per triangle.
+          const cg::IndexedMesh& self = extract<const cg::IndexedMesh&>(self_py);
+          return ScalarsToNumPyArray<std::array<uint32_t, 3>, uint32_t>(
+              static_cast<const void *>(self.indices.data()), self.NumTriangles(), {3}, self_py);
+        })
+  ;
 }
@@ -0,0 +1,36 @@
+#include <carla/PythonUtil.h>
+#include <carla/mapgen/MapGen.h>
+
+void export_mapgen() {
+  using namespace boost::python;
+  using namespace carla;
+  using namespace carla::mapgen;
+
+  class_<MapGenSettings>("MapGenSettings")
+    .def_readwrite("sidewalk_distance", &MapGenSettings::sidewalk_distance)
+    .def_readwrite("sidewalk_width", &MapGenSettings::sidewalk_width)
+    .def_readwrite("num_workers", &MapGenSettings::num_workers)
+  ;
+
+  class_<MapAssets>("MapAssets")
+    .def_readwrite("network_occupancy", &MapAssets::network_occupancy)
+    .def_readwrite("roadmark_occupancy", &MapAssets::roadmark_occupancy)
+    .def_readwrite("sidewalk_occupancy", &MapAssets::sidewalk_occupancy)
+    .def_readwrite("landmark_occupancies", &MapAssets::landmark_occupancies)
+    .def("save",
+        +[](const MapAssets& self, const std::string& prefix) {
+          carla::PythonUtil::ReleaseGIL unlock;
+          self.Save(prefix);
+        })
+  ;
+
+  class_<MapGen>("MapGen", no_init)
+    .def("extract",
+        +[](const std::string& sumo_network_file, const std::string& osm_file, const MapGenSettings& settings) {
+          carla::PythonUtil::ReleaseGIL unlock;
+          return MapGen::Extract(sumo_network_file, osm_file, settings);
+        },
+        (arg("sumo_network_file"), arg("osm_file"), arg("settings")=MapGenSettings()))
+    .staticmethod("extract")
+  ;
+}
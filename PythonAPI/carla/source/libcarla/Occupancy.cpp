@@ -1,3 +1,4 @@
+#include <carla/PythonUtil.h>
 #include <carla/geom/Vector2D.h>
 #include <carla/occupancy/OccupancyMap.h>
 #include <boost/python/numpy.hpp>
@@ -8,9 +9,22 @@ void export_occupancy() {
   using namespace carla;
   using namespace carla::occupancy;
 
+  class_<OccupancyTile>("OccupancyTile", no_init)
+    .def_readonly("x", &OccupancyTile::x)
+    .def_readonly("y", &OccupancyTile::y)
+    .def_readonly("bounds_min", &OccupancyTile::bounds_min)
+    .def_readonly("bounds_max", &OccupancyTile::bounds_max)
+    .def_readonly("occupancy_map", &OccupancyTile::occupancy_map)
+  ;
+
   class_<OccupancyMap>("OccupancyMap", no_init)
     .def(init<>())
     .def(init<const std::vector<geom::Vector2D>&, float>())
+    .def("__init__", make_constructor(
+          +[](const numpy::ndarray& line_np, float width) {
+            return boost::shared_ptr<OccupancyMap>(new OccupancyMap(
+                  NumPyArrayToVector<geom::Vector2D>(line_np), width));
+          }))
     .def("__init__", make_constructor(
           +[](const list& line_py, float width) {
             std::vector<carla::geom::Vector2D> line{
@@ -19,6 +33,11 @@ void export_occupancy() {
             return boost::shared_ptr<OccupancyMap>(new OccupancyMap(line, width));
           }))
     .def(init<const std::vector<geom::Vector2D>&>())
+    .def("__init__", make_constructor(
+          +[](const numpy::ndarray& polygon_np) {
+            return boost::shared_ptr<OccupancyMap>(new OccupancyMap(
+                  NumPyArrayToVector<geom::Vector2D>(polygon_np)));
+          }))
     .def("__init__", make_constructor(
           +[](const list& polygon_py) {
             std::vector<carla::geom::Vector2D> polygon{
@@ -30,18 +49,138 @@ void export_occupancy() {
     .def("load", &OccupancyMap::Load)
     .staticmethod("load")
     .def("save", &OccupancyMap::Save)
+    .def("load_binary", &OccupancyMap::LoadBinary)
+    .staticmethod("load_binary")
+    .def("save_binary", &OccupancyMap::SaveBinary)
+    .def("load_binary_pack", &OccupancyMap::LoadBinaryPack)
+    .staticmethod("load_binary_pack")
+    .def("save_binary_pack",
+        +[](const list& occupancy_maps_py, const std::string& file) {
+          std::vector<OccupancyMap> occupancy_maps{
+            stl_input_iterator<OccupancyMap>(occupancy_maps_py),
+            stl_input_iterator<OccupancyMap>()};
+          OccupancyMap::SaveBinaryPack(occupancy_maps, file);
+        })
+    .staticmethod("save_binary_pack")
     .add_property("is_empty", make_function(&OccupancyMap::IsEmpty)) 
     .def("union", &OccupancyMap::Union)
+    .def("union_all", +[](const list& occupancy_maps_py) {
+          std::vector<OccupancyMap> occupancy_maps{
+            stl_input_iterator<OccupancyMap>(occupancy_maps_py),
+            stl_input_iterator<OccupancyMap>()};
+          return OccupancyMap::UnionAll(std::move(occupancy_maps));
+        })
+    .staticmethod("union_all")
     .def("difference", &OccupancyMap::Difference)
+    .def("difference_all", +[](const list& occupancy_maps_py, const OccupancyMap& occupancy_map) {
+          std::vector<OccupancyMap> occupancy_maps{
+            stl_input_iterator<OccupancyMap>(occupancy_maps_py),
+            stl_input_iterator<OccupancyMap>()};
+          carla::PythonUtil::ReleaseGIL unlock;
+          return OccupancyMap::DifferenceAll(std::move(occupancy_maps), occupancy_map);
+        })
+    .staticmethod("difference_all")
     .def("intersection", &OccupancyMap::Intersection)
     .def("buffer", &OccupancyMap::Buffer)
     .def("intersects", &OccupancyMap::Intersects)
+    .def("intersects_many",
+        +[](const OccupancyMap& self, const list& occupancy_maps_py) {
+          std::vector<OccupancyMap> occupancy_maps{
+            stl_input_iterator<OccupancyMap>(occupancy_maps_py),
+            stl_input_iterator<OccupancyMap>()};
+          std::vector<bool> results;
+          {
+            carla::PythonUtil::ReleaseGIL unlock;
+            results = self.IntersectsMany(occupancy_maps);
+          }
+          list results_py;
+          for (bool result : results) {
+            results_py.append(result);
+          }
+          return results_py;
+        })
     .def("contains", &OccupancyMap::Contains)
+    .def("contains_many",
+        +[](const OccupancyMap& self, const list& points_py) {
+          std::vector<geom::Vector2D> points{
+            stl_input_iterator<geom::Vector2D>(points_py),
+            stl_input_iterator<geom::Vector2D>()};
+          list results;
+          for (bool result : self.ContainsMany(points)) {
+            results.append(result);
+          }
+          return results;
+        })
+    .def("contains_many",
+        +[](const OccupancyMap& self, const numpy::ndarray& points_np) {
+          list results;
+          for (bool result : self.ContainsMany(NumPyArrayToVector<geom::Vector2D>(points_np))) {
+            results.append(result);
+          }
+          return results;
+        })
+    .def("tile",
+        +[](const OccupancyMap& self, float tile_size) {
+          std::vector<OccupancyTile> tiles;
+          {
+            carla::PythonUtil::ReleaseGIL unlock;
+            tiles = self.Tile(tile_size);
+          }
+          list tiles_py;
+          for (OccupancyTile& tile : tiles) {
+            tiles_py.append(std::move(tile));
+          }
+          return tiles_py;
+        })
     .def("create_sidewalk", &OccupancyMap::CreateSidewalk)
     .def("get_polygons", &OccupancyMap::GetPolygons)
     .def("get_triangles", &OccupancyMap::GetTriangles)
     .def("get_mesh_triangles", &OccupancyMap::GetMeshTriangles, (arg("height")=0.0f))
     .def("get_wall_mesh_triangles", &OccupancyMap::GetWallMeshTriangles)
+    // NumPy views of the same geometry, backed by the C++ result.
+    .def("get_polygons_array",
+        +[](const OccupancyMap& self) {
+          // Vertices of all rings as (V, 2); ring_offsets[i]:ring_offsets[i + 1]
+          // are the vertices of ring i, polygon_offsets[j]:polygon_offsets[j + 1]
+          // the rings (outer ring first) of polygon j.
+          std::vector<geom::Vector2D> vertices;
+          std::vector<int64_t> ring_offsets{0};
+          std::vector<int64_t> polygon_offsets{0};
+          for (const auto& polygon : self.GetPolygons()) {
+            for (const auto& ring : polygon) {
+              vertices.insert(vertices.end(), ring.begin(), ring.end());
+              ring_offsets.emplace_back(static_cast<int64_t>(vertices.size()));
+            }
+            polygon_offsets.emplace_back(static_cast<int64_t>(ring_offsets.size() - 1));
+          }
+          auto to_array = [](const std::vector<int64_t>& offsets) {
+            numpy::ndarray array = numpy::empty(
+                make_tuple(offsets.size()), numpy::dtype::get_builtin<int64_t>());
+            std::copy(offsets.begin(), offsets.end(), reinterpret_cast<int64_t*>(array.get_data()));
+            return array;
+          };
+          return make_tuple(
+              VectorToNumPyArray(std::move(vertices), {2}),
+              to_array(ring_offsets),
+              to_array(polygon_offsets));
+        })
+    .def("get_triangles_array",
+        +[](const OccupancyMap& self) {
+          return VectorToNumPyArray(self.GetTriangles(), {3, 2});
+        })
+    .def("get_mesh_triangles_array",
+        +[](const OccupancyMap& self, float height) {
+          return VectorToNumPyArray(self.GetMeshTriangles(height), {3});
+        },
+        (arg("height")=0.0f))
+    .def("get_indexed_mesh", &OccupancyMap::GetIndexedMesh,
+        (arg("height")=0.0f, arg("double_sided")=true))
+    .def("get_indexed_wall_mesh", &OccupancyMap::GetIndexedWallMesh,
+        (arg("height"), arg("double_sided")=true))
+    .def("get_wall_mesh_triangles_array",
+        +[](const OccupancyMap& self, float height) {
+          return VectorToNumPyArray(self.GetWallMeshTriangles(height), {3});
+        })
   ;
   
   class_<std::vector<OccupancyMap>>("vector_of_occupancy_map")
@@ -17,12 +17,41 @@ void export_segments() {
               stl_input_iterator<carla::geom::Segment2D>()};
             return boost::shared_ptr<SegmentMap>(new SegmentMap(segments));
           }))
+    .def("__init__", make_constructor(
+          +[](const numpy::ndarray& segments_np) {
+            return boost::shared_ptr<SegmentMap>(new SegmentMap(
+                  NumPyArrayToVector<geom::Segment2D>(segments_np)));
+          }))
     .add_property("is_empty", make_function(&SegmentMap::IsEmpty)) 
     .def("seed_rand", &SegmentMap::SeedRand)
     .def("union", &SegmentMap::Union)
     .def("difference", &SegmentMap::Difference)
     .def("intersection", &SegmentMap::Intersection)
     .def("rand_point", &SegmentMap::RandPoint)
-    .def("get_segments", &SegmentMap::GetSegments)
+    .def("rand_points", &SegmentMap::RandPoints)
+    .def("rand_point_excluding",
+        +[](SegmentMap& self, const aabb::AABBMap& aabb_map, float clearance, size_t max_tries) {
+          boost::optional<geom::Vector2D> point = self.RandPointExcluding(aabb_map, clearance, max_tries);
+          if (point) {
+            return object(*point);
+          } else {
+            return object();
+          }
+        })
+    .def("rand_points_excluding",
+        +[](SegmentMap& self, const aabb::AABBMap& aabb_map, float clearance, size_t count, size_t max_tries) {
+          list points_py;
+          for (const geom::Vector2D& point : self.RandPointsExcluding(aabb_map, clearance, count, max_tries)) {
+            points_py.append(point);
+          }
+          return points_py;
+        })
+    .def("get_segments", &SegmentMap::GetSegments, return_value_policy<copy_const_reference>())
+    .def("get_segments_array",
+        +[](object self_py) {
+          // Segments never change after construction, so this is a view.
+          const SegmentMap& self = extract<const SegmentMap&>(self_py);
+          return VectorToNumPyView(self.GetSegments(), {2, 2}, self_py);
+        })
   ;
 }
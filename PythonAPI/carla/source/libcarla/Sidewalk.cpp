@@ -1,3 +1,4 @@
+#include <carla/PythonUtil.h>
 #include <carla/geom/Vector2D.h>
 #include <carla/occupancy/OccupancyMap.h>
 #include <carla/sidewalk/Sidewalk.h>
@@ -10,7 +11,8 @@ namespace sidewalk {
   std::ostream &operator<<(std::ostream &out, const SidewalkRoutePoint &route_point) {
     out << "SidewalkRoutePoint(polygon_id=" << route_point.polygon_id
         << ", segment_id=" << route_point.segment_id
-        << ", offset=" << route_point.offset << ')';
+        << ", offset=" << route_point.offset
+        << ", arc_length=" << route_point.arc_length << ')';
     return out;
   }
   
@@ -36,6 +38,7 @@ void export_sidewalk() {
     .def_readwrite("polygon_id", &SidewalkRoutePoint::polygon_id)
     .def_readwrite("segment_id", &SidewalkRoutePoint::segment_id)
     .def_readwrite("offset", &SidewalkRoutePoint::offset)
+    .def_readwrite("arc_length", &SidewalkRoutePoint::arc_length)
     .def(self_ns::str(self_ns::self))
   ;
   
@@ -45,6 +48,8 @@ void export_sidewalk() {
   ;
 
   class_<Sidewalk>("Sidewalk", no_init)
+    .def("ring_length",
+        &Sidewalk::RingLength)
     .def("create_occupancy_map",
         &Sidewalk::CreateOccupancyMap)
     .def("create_segment_map",
@@ -69,5 +74,105 @@ void export_sidewalk() {
         })
     .def("intersects",
         &Sidewalk::Intersects)
+    .def("get_route_point_positions",
+        +[](const Sidewalk& self, const list& route_points_py) {
+          std::vector<SidewalkRoutePoint> route_points{
+            stl_input_iterator<SidewalkRoutePoint>(route_points_py),
+            stl_input_iterator<SidewalkRoutePoint>()};
+          std::vector<geom::Vector2D> positions;
+          {
+            carla::PythonUtil::ReleaseGIL unlock;
+            positions = self.GetRoutePointPositions(route_points);
+          }
+          list positions_py;
+          for (const geom::Vector2D& position : positions) {
+            positions_py.append(position);
+          }
+          return positions_py;
+        })
+    .def("get_nearest_route_points",
+        +[](const Sidewalk& self, const list& positions_py) {
+          std::vector<geom::Vector2D> positions{
+            stl_input_iterator<geom::Vector2D>(positions_py),
+            stl_input_iterator<geom::Vector2D>()};
+          std::vector<SidewalkRoutePoint> route_points;
+          {
+            carla::PythonUtil::ReleaseGIL unlock;
+            route_points = self.GetNearestRoutePoints(positions);
+          }
+          list route_points_py;
+          for (const SidewalkRoutePoint& route_point : route_points) {
+            route_points_py.append(route_point);
+          }
+          return route_points_py;
+        })
+    .def("get_next_route_points",
+        +[](const Sidewalk& self, const list& route_points_py, float lookahead_distance) {
+          std::vector<SidewalkRoutePoint> route_points{
+            stl_input_iterator<SidewalkRoutePoint>(route_points_py),
+            stl_input_iterator<SidewalkRoutePoint>()};
+          std::vector<SidewalkRoutePoint> next_route_points;
+          {
+            carla::PythonUtil::ReleaseGIL unlock;
+            next_route_points = self.GetNextRoutePoints(route_points, lookahead_distance);
+          }
+          list next_route_points_py;
+          for (const SidewalkRoutePoint& route_point : next_route_points) {
+            next_route_points_py.append(route_point);
+          }
+          return next_route_points_py;
+        })
+    .def("get_previous_route_points",
+        +[](const Sidewalk& self, const list& route_points_py, float lookahead_distance) {
+          std::vector<SidewalkRoutePoint> route_points{
+            stl_input_iterator<SidewalkRoutePoint>(route_points_py),
+            stl_input_iterator<SidewalkRoutePoint>()};
+          std::vector<SidewalkRoutePoint> previous_route_points;
+          {
+            carla::PythonUtil::ReleaseGIL unlock;
+            previous_route_points = self.GetPreviousRoutePoints(route_points, lookahead_distance);
+          }
+          list previous_route_points_py;
+          for (const SidewalkRoutePoint& route_point : previous_route_points) {
+            previous_route_points_py.append(route_point);
+          }
+          return previous_route_points_py;
+        })
+    .def("get_adjacent_route_points",
+        +[](const Sidewalk& self, const list& route_points_py, float max_cross_distance) {
+          std::vector<SidewalkRoutePoint> route_points{
+            stl_input_iterator<SidewalkRoutePoint>(route_points_py),
+            stl_input_iterator<SidewalkRoutePoint>()};
+          std::vector<boost::optional<SidewalkRoutePoint>> adjacent_route_points;
+          {
+            carla::PythonUtil::ReleaseGIL unlock;
+            adjacent_route_points = self.GetAdjacentRoutePoints(route_points, max_cross_distance);
+          }
+          list adjacent_route_points_py;
+          for (const boost::optional<SidewalkRoutePoint>& adjacent_route_point : adjacent_route_points) {
+            if (adjacent_route_point) {
+              adjacent_route_points_py.append(*adjacent_route_point);
+            } else {
+              adjacent_route_points_py.append(object());
+            }
+          }
+          return adjacent_route_points_py;
+        })
+    .def("intersects_many",
+        +[](const Sidewalk& self, const list& segments_py) {
+          std::vector<geom::Segment2D> segments{
+            stl_input_iterator<geom::Segment2D>(segments_py),
+            stl_input_iterator<geom::Segment2D>()};
+          std::vector<bool> intersects;
+          {
+            carla::PythonUtil::ReleaseGIL unlock;
+            intersects = self.IntersectsMany(segments);
+          }
+          list intersects_py;
+          for (bool result : intersects) {
+            intersects_py.append(result);
+          }
+          return intersects_py;
+        })
   ;
 }
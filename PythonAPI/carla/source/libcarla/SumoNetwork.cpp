@@ -39,6 +39,16 @@ inline bool operator!=(const RoutePoint& lhs, const RoutePoint& rhs) {
   return !(lhs == rhs);
 }
 
+inline bool operator==(const IndexedRoutePoint& lhs, const IndexedRoutePoint& rhs) {
+  return lhs.lane == rhs.lane &&
+    lhs.segment == rhs.segment &&
+    lhs.offset == rhs.offset;
+}
+
+inline bool operator!=(const IndexedRoutePoint& lhs, const IndexedRoutePoint& rhs) {
+  return !(lhs == rhs);
+}
+
 std::ostream &operator<<(std::ostream &out, const Function& function) {
   switch (function) {
   case Function::Normal:
@@ -101,9 +111,27 @@ std::ostream &operator<<(std::ostream &out, const RoutePoint& route_point) {
   return out;
 }
 
+std::ostream &operator<<(std::ostream &out, const IndexedRoutePoint& route_point) {
+  out << "IndexedRoutePoint(lane=" << route_point.lane
+      << ", segment=" << route_point.segment
+      << ", offset=" << route_point.offset << ')';
+  return out;
+}
+
 }
 }
 
+static std::vector<carla::sumonetwork::IndexedRoutePoint> RoutePathTreeSample(const carla::sumonetwork::RoutePathTree& self, uint32_t seed) {
+  std::mt19937 rng(seed);
+  return self.Sample(rng);
+}
+
+template <typename T>
+static std::vector<T> SampleNextRoutePath(const carla::sumonetwork::SumoNetwork& self, const T& route_point, size_t num_points, float interval, uint32_t seed) {
+  std::mt19937 rng(seed);
+  return self.SampleNextRoutePath(route_point, num_points, interval, rng);
+}
+
 void export_sumo_network() {
   using namespace boost::python;
   using namespace carla;
@@ -185,8 +213,30 @@ void export_sumo_network() {
     .def(self_ns::str(self_ns::self))
   ;
 
+  class_<IndexedRoutePoint>("SumoNetworkIndexedRoutePoint", init<>())
+    .def_readwrite("lane", &IndexedRoutePoint::lane)
+    .def_readwrite("segment", &IndexedRoutePoint::segment)
+    .def_readwrite("offset", &IndexedRoutePoint::offset)
+    .def(self_ns::str(self_ns::self))
+  ;
+  class_<std::vector<IndexedRoutePoint>>("vector_of_indexed_route_point")
+    .def(vector_indexing_suite<std::vector<IndexedRoutePoint>>())
+    .def(self_ns::str(self_ns::self))
+  ;
+  class_<std::vector<std::vector<IndexedRoutePoint>>>("vector_of_vector_of_indexed_route_point")
+    .def(vector_indexing_suite<std::vector<std::vector<IndexedRoutePoint>>>())
+    .def(self_ns::str(self_ns::self))
+  ;
+
+  class_<RoutePathTree>("SumoNetworkRoutePathTree", no_init)
+    .add_property("num_points", &RoutePathTree::NumPoints)
+    .def("__len__", &RoutePathTree::NumPaths)
+    .def("get_path", &RoutePathTree::GetPath)
+    .def("sample", &RoutePathTreeSample)
+  ;
+
   class_<SumoNetwork>("SumoNetwork", no_init)
-    .def("load", &SumoNetwork::Load)
+    .def("load", &SumoNetwork::Load, (arg("file"), arg("use_cache")=false))
     .staticmethod("load")
     .add_property("offset", make_function(&SumoNetwork::Offset))
     .add_property("bounds_min", make_function(&SumoNetwork::BoundsMin)) 
@@ -201,10 +251,27 @@ void export_sumo_network() {
         make_function(&SumoNetwork::Junctions, return_internal_reference<>()))
     .add_property("connections", 
         make_function(&SumoNetwork::Connections, return_internal_reference<>()))
-    .def("get_route_point_position", &SumoNetwork::GetRoutePointPosition)
+    .def("get_edge_handle", &SumoNetwork::GetEdgeHandle)
+    .def("get_edge_id", &SumoNetwork::GetEdgeId, return_value_policy<copy_const_reference>())
+    .def("to_indexed_route_point", &SumoNetwork::ToIndexedRoutePoint)
+    .def("to_route_point", &SumoNetwork::ToRoutePoint)
+    .def("get_route_point_position",
+        static_cast<geom::Vector2D (SumoNetwork::*)(const RoutePoint&) const>(&SumoNetwork::GetRoutePointPosition))
+    .def("get_route_point_position",
+        static_cast<geom::Vector2D (SumoNetwork::*)(const IndexedRoutePoint&) const>(&SumoNetwork::GetRoutePointPosition))
     .def("get_nearest_route_point", &SumoNetwork::GetNearestRoutePoint)
-    .def("get_next_route_points", &SumoNetwork::GetNextRoutePoints)
-    .def("get_next_route_paths", &SumoNetwork::GetNextRoutePaths)
+    .def("get_nearest_indexed_route_point", &SumoNetwork::GetNearestIndexedRoutePoint)
+    .def("get_next_route_points",
+        static_cast<std::vector<RoutePoint> (SumoNetwork::*)(const RoutePoint&, float) const>(&SumoNetwork::GetNextRoutePoints))
+    .def("get_next_route_points",
+        static_cast<std::vector<IndexedRoutePoint> (SumoNetwork::*)(const IndexedRoutePoint&, float) const>(&SumoNetwork::GetNextRoutePoints))
+    .def("get_next_route_paths",
+        static_cast<std::vector<std::vector<RoutePoint>> (SumoNetwork::*)(const RoutePoint&, size_t, float) const>(&SumoNetwork::GetNextRoutePaths))
+    .def("get_next_route_paths",
+        static_cast<std::vector<std::vector<IndexedRoutePoint>> (SumoNetwork::*)(const IndexedRoutePoint&, size_t, float) const>(&SumoNetwork::GetNextRoutePaths))
+    .def("get_next_route_path_tree", &SumoNetwork::GetNextRoutePathTree)
+    .def("sample_next_route_path", &SampleNextRoutePath<RoutePoint>)
+    .def("sample_next_route_path", &SampleNextRoutePath<IndexedRoutePoint>)
     .def("create_occupancy_map", &SumoNetwork::CreateOccupancyMap)
     .def("create_roadmark_occupancy_map", &SumoNetwork::CreateRoadmarkOccupancyMap)
     .def("create_segment_map", &SumoNetwork::CreateSegmentMap)
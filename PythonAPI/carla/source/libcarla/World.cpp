@@ -159,6 +159,17 @@ void export_world() {
             stl_input_iterator<carla::geom::Vector3D>()};
           return self.SpawnDynamicMesh(triangles, material, semantic_segmentation_label);
         })
+    .def("spawn_dynamic_mesh", 
+        +[](cc::World& self, const boost::python::numpy::ndarray& triangles_np, std::string material, uint8_t semantic_segmentation_label) {
+          std::vector<carla::geom::Vector3D> triangles = NumPyArrayToVector<carla::geom::Vector3D>(triangles_np);
+          carla::PythonUtil::ReleaseGIL unlock;
+          return self.SpawnDynamicMesh(triangles, material, semantic_segmentation_label);
+        })
+    .def("spawn_dynamic_indexed_mesh",
+        +[](cc::World& self, const carla::geom::IndexedMesh& mesh, std::string material, uint8_t semantic_segmentation_label) {
+          carla::PythonUtil::ReleaseGIL unlock;
+          return self.SpawnDynamicIndexedMesh(mesh, material, semantic_segmentation_label);
+        })
     .def("spawn_dynamic_tile_mesh", 
         +[](cc::World& self, const carla::geom::Vector3D& bounds_min, const carla::geom::Vector3D& bounds_max, 
             const std::vector<uint8_t>& data, uint8_t semantic_segmentation_label) {
@@ -8,7 +8,11 @@
 #include <carla/PythonUtil.h>
 #include <carla/Time.h>
 
+#include <boost/python/numpy.hpp>
+
+#include <cstring>
 #include <ostream>
+#include <stdexcept>
 #include <type_traits>
 #include <vector>
 
@@ -17,6 +21,73 @@ static boost::python::object OptionalToPythonObject(OptionalT &optional) {
   return optional.has_value() ? boost::python::object(*optional) : boost::python::object();
 }
 
+template <typename T>
+static void DeleteVectorCapsule(PyObject *capsule) {
+  delete static_cast<std::vector<T> *>(PyCapsule_GetPointer(capsule, nullptr));
+}
+
+// Wraps count structs made only of ScalarT (Vector2D, Vector3D, Segment2D...)
+// at data as a NumPy array kept alive by owner. item_shape is the shape of one
+// struct, e.g. {3} for Vector3D, {} for plain scalars. Const data gives a
+// read-only array.
+template <typename T, typename ScalarT = float, typename DataT>
+static boost::python::numpy::ndarray ScalarsToNumPyArray(
+    DataT *data, size_t count, std::vector<Py_intptr_t> item_shape, boost::python::object owner) {
+  namespace np = boost::python::numpy;
+
+  std::vector<Py_intptr_t> shape{static_cast<Py_intptr_t>(count)};
+  shape.insert(shape.end(), item_shape.begin(), item_shape.end());
+  std::vector<Py_intptr_t> strides(shape.size(), sizeof(ScalarT));
+  for (size_t i = shape.size() - 1; i > 0; --i) {
+    strides[i - 1] = strides[i] * shape[i];
+  }
+  if (static_cast<size_t>(strides[0]) != sizeof(T)) {
+    throw std::invalid_argument("item shape does not match item size!");
+  }
+  return np::from_data(data, np::dtype::get_builtin<ScalarT>(), shape, strides, owner);
+}
+
+// Read-only view of a vector owned by owner, e.g. the Python object holding it.
+template <typename T, typename ScalarT = float>
+static boost::python::numpy::ndarray VectorToNumPyView(
+    const std::vector<T> &values, std::vector<Py_intptr_t> item_shape, boost::python::object owner) {
+  return ScalarsToNumPyArray<T, ScalarT>(static_cast<const void *>(values.data()), values.size(), std::move(item_shape), owner);
+}
+
+// Moves a vector into a writable NumPy array without copying; the array owns it.
+template <typename T, typename ScalarT = float>
+static boost::python::numpy::ndarray VectorToNumPyArray(std::vector<T> &&values, std::vector<Py_intptr_t> item_shape) {
+  auto *owned = new std::vector<T>(std::move(values));
+  boost::python::object owner(boost::python::handle<>(PyCapsule_New(owned, nullptr, &DeleteVectorCapsule<T>)));
+  return ScalarsToNumPyArray<T, ScalarT>(static_cast<void *>(owned->data()), owned->size(), std::move(item_shape), owner);
+}
+
+// Copies an array of any shape (N, ...) whose trailing dimensions hold exactly
+// one T of ScalarT, e.g. (N, 2) for Vector2D, into a vector.
+template <typename T, typename ScalarT = float>
+static std::vector<T> NumPyArrayToVector(const boost::python::numpy::ndarray &array) {
+  namespace np = boost::python::numpy;
+
+  np::ndarray scalars = array.astype(np::dtype::get_builtin<ScalarT>());
+  if (!(scalars.get_flags() & np::ndarray::C_CONTIGUOUS)) {
+    scalars = scalars.copy();
+  }
+  Py_intptr_t num_scalars = 1;
+  for (int i = 0; i < scalars.get_nd(); ++i) {
+    num_scalars *= scalars.shape(i);
+  }
+  size_t scalars_per_item = sizeof(T) / sizeof(ScalarT);
+  if (scalars.get_nd() < 1 || static_cast<size_t>(num_scalars) != static_cast<size_t>(scalars.shape(0)) * scalars_per_item) {
+    throw std::invalid_argument("array shape does not match item size!");
+  }
+
+  std::vector<T> values(static_cast<size_t>(scalars.shape(0)));
+  if (!values.empty()) {
+    std::memcpy(values.data(), scalars.get_data(), values.size() * sizeof(T));
+  }
+  return values;
+}
+
 // Convenient for requests without arguments.
 #define CALL_WITHOUT_GIL(cls, fn) +[](cls &self) { \
       carla::PythonUtil::ReleaseGIL unlock; \
@@ -200,6 +271,7 @@ static auto MakeCallback(boost::python::object callback) {
 #include "Occupancy.cpp"
 #include "Gamma.cpp"
 #include "OsmLandmarks.cpp"
+#include "MapGen.cpp"
 #include "Segments.cpp"
 #include "AABB.cpp"
 #include "Actor.cpp"
@@ -231,6 +303,7 @@ BOOST_PYTHON_MODULE(libcarla) {
   export_sumo_network();
   export_occupancy();
   export_osm_landmark();
+  export_mapgen();
   export_control();
   export_gamma();
   export_sidewalk();
@@ -43,6 +43,7 @@ GAMMA_MAX_RATE = 40.0
 CONTROL_MAX_RATE = 20.0
 COLLISION_STATISTICS_MAX_RATE = 5.0
 SPAWN_DESTROY_REPETITIONS = 3
+SPAWN_MAX_TRIES = 16
 
 # Ziegler-Nichols tuning params: K_p, T_u
 CAR_SPEED_PID_PROFILES = {
@@ -196,13 +197,15 @@ Pyro4.util.SerializerBase.register_class_to_dict(
             '__class__': 'carla.SidewalkRoutePoint',    
             'polygon_id': o.polygon_id, 
             'segment_id': o.segment_id, 
-            'offset': o.offset  
+            'offset': o.offset,
+            'arc_length': o.arc_length
         })  
 def dict_to_sidewalk_route_point(c, o): 
     r = carla.SidewalkRoutePoint()  
     r.polygon_id = o['polygon_id']  
     r.segment_id = o['segment_id']  
     r.offset = o['offset']
+    r.arc_length = o['arc_length']
     return r    
 Pyro4.util.SerializerBase.register_dict_to_class(   
         'carla.SidewalkRoutePoint', dict_to_sidewalk_route_point)
@@ -433,6 +436,11 @@ class CrowdService():
 
 
 ''' ========== UTILITY FUNCTIONS AND CLASSES ========== '''
+def load_occupancy_map(path):
+    # Prefer the binary occupancy map written by Scripts/convert_occupancy_maps.py.
+    binary_path = path.with_suffix('.occ')
+    return carla.OccupancyMap.load(str(binary_path if binary_path.exists() else path))
+
 def get_signed_angle_diff(vector1, vector2):
     theta = math.atan2(vector1.y, vector1.x) - math.atan2(vector2.y, vector2.x)
     theta = np.rad2deg(theta)
@@ -525,8 +533,9 @@ def get_pedestrian_bounding_box_corners(actor):
 def get_lane_constraints(sidewalk, position, forward_vec):
     left_line_end = position + (1.5 + 2.0 + 0.8) * ((forward_vec.rotate(np.deg2rad(-90))).make_unit_vector())
     right_line_end = position + (1.5 + 2.0 + 0.8) * ((forward_vec.rotate(np.deg2rad(90))).make_unit_vector())
-    left_lane_constrained_by_sidewalk = sidewalk.intersects(carla.Segment2D(position, left_line_end))
-    right_lane_constrained_by_sidewalk = sidewalk.intersects(carla.Segment2D(position, right_line_end))
+    left_lane_constrained_by_sidewalk, right_lane_constrained_by_sidewalk = sidewalk.intersects_many([
+        carla.Segment2D(position, left_line_end),
+        carla.Segment2D(position, right_line_end)])
     return left_lane_constrained_by_sidewalk, right_lane_constrained_by_sidewalk
 
 def is_car(actor):
@@ -547,13 +556,13 @@ class SumoNetworkAgentPath:
     @staticmethod
     def rand_path(sumo_network, min_points, interval, segment_map, rng=random):
         spawn_point = None
-        route_paths = None
-        while not spawn_point or len(route_paths) < 1:
+        route_path = None
+        while not spawn_point or len(route_path) < 1:
             spawn_point = segment_map.rand_point()
             spawn_point = sumo_network.get_nearest_route_point(spawn_point)
-            route_paths = sumo_network.get_next_route_paths(spawn_point, min_points - 1, interval)
+            route_path = sumo_network.sample_next_route_path(spawn_point, min_points - 1, interval, rng.getrandbits(32))
 
-        return SumoNetworkAgentPath(rng.choice(route_paths), min_points, interval)
+        return SumoNetworkAgentPath(route_path, min_points, interval)
 
     def resize(self, sumo_network, rng=random):
         while len(self.route_points) < self.min_points:
@@ -646,9 +655,10 @@ class SidewalkAgentPath:
         cut_index = 0
         min_offset = None
         min_offset_index = None
-        for i in range(int(len(self.route_points) / 2)):
-            route_point = self.route_points[i]
-            offset = position - sidewalk.get_route_point_position(route_point)
+        route_point_positions = sidewalk.get_route_point_positions(
+                self.route_points[:int(len(self.route_points) / 2)])
+        for i in range(len(route_point_positions)):
+            offset = position - route_point_positions[i]
             offset = offset.length()
             if min_offset is None or offset < min_offset:
                 min_offset = offset
@@ -708,19 +718,18 @@ class Context(object):
         
         self.forbidden_bounds_min = None
         self.forbidden_bounds_max = None
-        self.forbidden_bounds_occupancy = None
 
         self.sumo_network = carla.SumoNetwork.load(str(DATA_PATH/'{}.net.xml'.format(args.dataset)))
         self.sumo_network_segments = self.sumo_network.create_segment_map()
         self.sumo_network_spawn_segments = self.sumo_network_segments.intersection(carla.OccupancyMap(self.bounds_min, self.bounds_max))
         self.sumo_network_spawn_segments.seed_rand(self.rng.getrandbits(32))
-        self.sumo_network_occupancy = carla.OccupancyMap.load(str(DATA_PATH/'{}.network.wkt'.format(args.dataset)))
+        self.sumo_network_occupancy = load_occupancy_map(DATA_PATH/'{}.network.wkt'.format(args.dataset))
 
         self.sidewalk = self.sumo_network_occupancy.create_sidewalk(1.5)
         self.sidewalk_segments = self.sidewalk.create_segment_map()
         self.sidewalk_spawn_segments = self.sidewalk_segments.intersection(carla.OccupancyMap(self.bounds_min, self.bounds_max))
         self.sidewalk_spawn_segments.seed_rand(self.rng.getrandbits(32))
-        self.sidewalk_occupancy = carla.OccupancyMap.load(str(DATA_PATH/'{}.sidewalk.wkt'.format(args.dataset)))
+        self.sidewalk_occupancy = load_occupancy_map(DATA_PATH/'{}.sidewalk.wkt'.format(args.dataset))
 
         self.client = carla.Client(args.host, args.port)
         self.client.set_timeout(10.0)
@@ -785,23 +794,25 @@ def do_spawn(c):
     if not spawn_car and not spawn_bike and not spawn_pedestrian:
         return
 
-    # Find car spawn point.
-    if spawn_car:
-        aabb_occupancy = carla.OccupancyMap() if c.forbidden_bounds_occupancy is None else c.forbidden_bounds_occupancy
-        for actor in c.world.get_actors():
-            if isinstance(actor, carla.Vehicle) or isinstance(actor, carla.Walker):
-                aabb = get_aabb(actor)
-                aabb_occupancy = aabb_occupancy.union(carla.OccupancyMap(
-                    carla.Vector2D(aabb.bounds_min.x - c.args.clearance_car, aabb.bounds_min.y - c.args.clearance_car), 
-                    carla.Vector2D(aabb.bounds_max.x + c.args.clearance_car, aabb.bounds_max.y + c.args.clearance_car)))
+    # Occupied areas; clearances are applied when sampling.
+    occupied = carla.AABBMap([get_aabb(actor) for actor in c.world.get_actors()
+        if isinstance(actor, carla.Vehicle) or isinstance(actor, carla.Walker)])
+    if c.forbidden_bounds_min is not None and c.forbidden_bounds_max is not None:
+        occupied.insert(carla.AABB2D(c.forbidden_bounds_min, c.forbidden_bounds_max))
 
+    def spawn_vehicle(spawn_segments, clearance, blueprints, append_new):
+        spawn_segments.seed_rand(c.rng.getrandbits(32))
         for _ in range(SPAWN_DESTROY_REPETITIONS):
-            spawn_segments = c.sumo_network_spawn_segments.difference(aabb_occupancy)
-            if spawn_segments.is_empty:
+            position = spawn_segments.rand_point_excluding(occupied, clearance, SPAWN_MAX_TRIES)
+            if position is None:
+                continue
+            route_path = c.sumo_network.sample_next_route_path(
+                    c.sumo_network.get_nearest_route_point(position),
+                    PATH_MIN_POINTS - 1, PATH_INTERVAL, c.rng.getrandbits(32))
+            if len(route_path) == 0:
                 continue
-            spawn_segments.seed_rand(c.rng.getrandbits(32))
+            path = SumoNetworkAgentPath(route_path, PATH_MIN_POINTS, PATH_INTERVAL)
 
-            path = SumoNetworkAgentPath.rand_path(c.sumo_network, PATH_MIN_POINTS, PATH_INTERVAL, spawn_segments, rng=c.rng)
             position = path.get_position(c.sumo_network, 0)
             trans = carla.Transform()
             trans.location.x = position.x
@@ -809,78 +820,44 @@ def do_spawn(c):
             trans.location.z = 0.2
             trans.rotation.yaw = path.get_yaw(c.sumo_network, 0)
 
-            actor = c.world.try_spawn_actor(c.rng.choice(c.car_blueprints), trans)
+            actor = c.world.try_spawn_actor(c.rng.choice(blueprints), trans)
             if actor:
                 actor.set_collision_enabled(c.args.collision)
                 c.world.wait_for_tick(1.0)  # For actor to update pos and bounds, and for collision to apply.
-                c.crowd_service.acquire_new_cars()
-                c.crowd_service.append_new_cars((
+                append_new((
                     actor.id, 
                     [p for p in path.route_points], # Convert to python list.
                     get_steer_angle_range(actor)))
-                c.crowd_service.release_new_cars()
-                aabb = get_aabb(actor)
-                aabb_occupancy = aabb_occupancy.union(carla.OccupancyMap(
-                    carla.Vector2D(aabb.bounds_min.x - c.args.clearance_car, aabb.bounds_min.y - c.args.clearance_car), 
-                    carla.Vector2D(aabb.bounds_max.x + c.args.clearance_car, aabb.bounds_max.y + c.args.clearance_car)))
+                occupied.insert(get_aabb(actor))
 
+    # Find car spawn point.
+    if spawn_car:
+        def append_new_car(new_car):
+            c.crowd_service.acquire_new_cars()
+            c.crowd_service.append_new_cars(new_car)
+            c.crowd_service.release_new_cars()
+        spawn_vehicle(c.sumo_network_spawn_segments, c.args.clearance_car, c.car_blueprints, append_new_car)
 
     # Find bike spawn point.
     if spawn_bike:
-        aabb_occupancy = carla.OccupancyMap() if c.forbidden_bounds_occupancy is None else c.forbidden_bounds_occupancy
-        for actor in c.world.get_actors():
-            if isinstance(actor, carla.Vehicle) or isinstance(actor, carla.Walker):
-                aabb = get_aabb(actor)
-                aabb_occupancy = aabb_occupancy.union(carla.OccupancyMap(
-                    carla.Vector2D(aabb.bounds_min.x - c.args.clearance_bike, aabb.bounds_min.y - c.args.clearance_bike), 
-                    carla.Vector2D(aabb.bounds_max.x + c.args.clearance_bike, aabb.bounds_max.y + c.args.clearance_bike)))
-        
-        for _ in range(SPAWN_DESTROY_REPETITIONS):
-            spawn_segments = c.sumo_network_spawn_segments.difference(aabb_occupancy)
-            if spawn_segments.is_empty:
-                continue
-            spawn_segments.seed_rand(c.rng.getrandbits(32))
-
-            path = SumoNetworkAgentPath.rand_path(c.sumo_network, PATH_MIN_POINTS, PATH_INTERVAL, spawn_segments, rng=c.rng)
-            position = path.get_position(c.sumo_network, 0)
-            trans = carla.Transform()
-            trans.location.x = position.x
-            trans.location.y = position.y
-            trans.location.z = 0.2
-            trans.rotation.yaw = path.get_yaw(c.sumo_network, 0)
-
-            actor = c.world.try_spawn_actor(c.rng.choice(c.bike_blueprints), trans)
-            if actor:
-                actor.set_collision_enabled(c.args.collision)
-                c.world.wait_for_tick(1.0)  # For actor to update pos and bounds, and for collision to apply.
-                c.crowd_service.acquire_new_bikes()
-                c.crowd_service.append_new_bikes((
-                    actor.id, 
-                    [p for p in path.route_points], # Convert to python list.
-                    get_steer_angle_range(actor)))
-                c.crowd_service.release_new_bikes()
-                aabb = get_aabb(actor)
-                aabb_occupancy = aabb_occupancy.union(carla.OccupancyMap(
-                    carla.Vector2D(aabb.bounds_min.x - c.args.clearance_bike, aabb.bounds_min.y - c.args.clearance_bike), 
-                    carla.Vector2D(aabb.bounds_max.x + c.args.clearance_bike, aabb.bounds_max.y + c.args.clearance_bike)))
-
+        def append_new_bike(new_bike):
+            c.crowd_service.acquire_new_bikes()
+            c.crowd_service.append_new_bikes(new_bike)
+            c.crowd_service.release_new_bikes()
+        spawn_vehicle(c.sumo_network_spawn_segments, c.args.clearance_bike, c.bike_blueprints, append_new_bike)
 
     if spawn_pedestrian:
-        aabb_occupancy = carla.OccupancyMap() if c.forbidden_bounds_occupancy is None else c.forbidden_bounds_occupancy
-        for actor in c.world.get_actors():
-            if isinstance(actor, carla.Vehicle) or isinstance(actor, carla.Walker):
-                aabb = get_aabb(actor)
-                aabb_occupancy = aabb_occupancy.union(carla.OccupancyMap(
-                    carla.Vector2D(aabb.bounds_min.x - c.args.clearance_pedestrian, aabb.bounds_min.y - c.args.clearance_pedestrian), 
-                    carla.Vector2D(aabb.bounds_max.x + c.args.clearance_pedestrian, aabb.bounds_max.y + c.args.clearance_pedestrian)))
-        
+        c.sidewalk_spawn_segments.seed_rand(c.rng.getrandbits(32))
         for _ in range(SPAWN_DESTROY_REPETITIONS):
-            spawn_segments = c.sidewalk_spawn_segments.difference(aabb_occupancy)
-            if spawn_segments.is_empty:
+            position = c.sidewalk_spawn_segments.rand_point_excluding(
+                    occupied, c.args.clearance_pedestrian, SPAWN_MAX_TRIES)
+            if position is None:
                 continue
-            spawn_segments.seed_rand(c.rng.getrandbits(32))
+            path = SidewalkAgentPath(
+                    [c.sidewalk.get_nearest_route_point(position)], [c.rng.choice([True, False])],
+                    PATH_MIN_POINTS, PATH_INTERVAL)
+            path.resize(c.sidewalk, c.args.cross_probability)
 
-            path = SidewalkAgentPath.rand_path(c.sidewalk, PATH_MIN_POINTS, PATH_INTERVAL, c.args.cross_probability, c.sidewalk_spawn_segments, c.rng)
             position = path.get_position(c.sidewalk, 0)
             trans = carla.Transform()
             trans.location.x = position.x
@@ -897,10 +874,7 @@ def do_spawn(c):
                     [p for p in path.route_points], # Convert to python list.
                     path.route_orientations))
                 c.crowd_service.release_new_pedestrians()
-                aabb = get_aabb(actor)
-                aabb_occupancy = aabb_occupancy.union(carla.OccupancyMap(
-                    carla.Vector2D(aabb.bounds_min.x - c.args.clearance_pedestrian, aabb.bounds_min.y - c.args.clearance_pedestrian), 
-                    carla.Vector2D(aabb.bounds_max.x + c.args.clearance_pedestrian, aabb.bounds_max.y + c.args.clearance_pedestrian)))
+                occupied.insert(get_aabb(actor))
 
 
 def do_destroy(c):
@@ -1039,13 +1013,13 @@ def do_collision_statistics(c, timestamp, log_file):
     actors = c.world.get_actors()
     actors = [a for a in actors if is_car(a) or is_bike(a) or is_pedestrian(a)]
     bounding_boxes = [carla.OccupancyMap(get_bounding_box_corners(actor)) for actor in actors]
+    aabbs = [get_aabb(actor) for actor in actors]
+    aabb_map = carla.AABBMap(aabbs) # Handles match actor indices.
     collisions = [0 for _ in range(len(actors))]
 
-    for i in range(len(actors) - 1):
-        if collisions[i] == 1:
-            continue
-        for j in range(i + 1, len(actors)):
-            if bounding_boxes[i].intersects(bounding_boxes[j]):
+    for i in range(len(actors)):
+        for j in aabb_map.query_intersects(aabbs[i]):
+            if j > i and bounding_boxes[i].intersects(bounding_boxes[j]):
                 collisions[i] = 1
                 collisions[j] = 1
 
@@ -1115,11 +1089,11 @@ def do_gamma(c, car_agents, bike_agents, pedestrian_agents, destroy_list):
                 position = get_position(actor)
                 # Lane change if possible.
                 if c.rng.uniform(0.0, 1.0) <= c.args.lane_change_probability:
-                    new_path_candidates = c.sumo_network.get_next_route_paths(
+                    new_route_path = c.sumo_network.sample_next_route_path(
                             c.sumo_network.get_nearest_route_point(position),
-                            agent.path.min_points - 1, agent.path.interval)
-                    if len(new_path_candidates) > 0:
-                        new_path = SumoNetworkAgentPath(c.rng.choice(new_path_candidates)[0:agent.path.min_points], 
+                            agent.path.min_points - 1, agent.path.interval, c.rng.getrandbits(32))
+                    if len(new_route_path) > 0:
+                        new_path = SumoNetworkAgentPath(new_route_path, 
                                 agent.path.min_points, agent.path.interval)
                         agent.path = new_path
                 # Cut, resize, check.
@@ -1444,7 +1418,6 @@ def gamma_loop(args):
                         (new_forbidden_bounds[1] is not None and new_forbidden_bounds[1] != c.forbidden_bounds_max):
                     c.forbidden_bounds_min = new_forbidden_bounds[0]
                     c.forbidden_bounds_max = new_forbidden_bounds[1]
-                    c.forbidden_bounds_occupancy = carla.OccupancyMap(c.forbidden_bounds_min, c.forbidden_bounds_max)
 
                 last_bounds_update = time.time()
 
@@ -1506,6 +1479,49 @@ def collision_statistics_loop(args):
         pass
 
 
+def native_main(args):
+    with (DATA_PATH/'{}.sim_bounds'.format(args.dataset)).open('r') as f:
+        bounds_min = carla.Vector2D(*[float(v) for v in f.readline().split(',')])
+        bounds_max = carla.Vector2D(*[float(v) for v in f.readline().split(',')])
+
+    client = carla.Client(args.host, args.port)
+    client.set_timeout(10.0)
+    sumo_network = carla.SumoNetwork.load(str(DATA_PATH/'{}.net.xml'.format(args.dataset)))
+    sumo_network_occupancy = load_occupancy_map(DATA_PATH/'{}.network.wkt'.format(args.dataset))
+
+    engine = carla.CrowdEngine(client, sumo_network, sumo_network_occupancy, random.Random(args.seed).getrandbits(32))
+
+    settings = carla.CrowdEngineSettings()
+    settings.bounds_min = bounds_min
+    settings.bounds_max = bounds_max
+    settings.num_cars = args.num_car
+    settings.num_bikes = args.num_bike
+    settings.num_pedestrians = args.num_pedestrian
+    settings.speed_car = args.speed_car
+    settings.speed_bike = args.speed_bike
+    settings.speed_pedestrian = args.speed_pedestrian
+    settings.clearance_car = args.clearance_car
+    settings.clearance_bike = args.clearance_bike
+    settings.clearance_pedestrian = args.clearance_pedestrian
+    settings.lane_change_probability = args.lane_change_probability
+    settings.cross_probability = args.cross_probability
+    settings.stuck_speed = args.stuck_speed
+    settings.stuck_duration = args.stuck_duration
+    settings.collision = args.collision
+    settings.rate = GAMMA_MAX_RATE
+    engine.configure(settings)
+
+    engine.start()
+    print('Crowd engine running.')
+    try:
+        while True:
+            time.sleep(1.0)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        engine.stop()
+
+
 def main(args):
     spawn_destroy_process = Process(target=spawn_destroy_loop, args=(args,))
     spawn_destroy_process.daemon = True
@@ -1627,5 +1643,12 @@ if __name__ == '__main__':
         default='5.0',
         help='Minimum duration (s) for an agent to be considered stuck (default: 5)',
         type=float)
+    argparser.add_argument(
+        '--legacy',
+        help='Run the Pyro4 multi-process crowd loops instead of the native crowd engine',
+        action='store_true')
     args = argparser.parse_args()
-    main(args)
+    if args.legacy:
+        main(args)
+    else:
+        native_main(args)
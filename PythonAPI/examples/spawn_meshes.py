@@ -1,6 +1,7 @@
 #!/usr/bin/env python
 
-"""Spawns meshes extracted from a dataset located in (<summit_root>/Data/)."""
+"""Spawns meshes extracted from a dataset located in (<summit_root>/Data/),
+either all at once or streamed in tiles around a moving point."""
 
 import glob
 import os
@@ -17,8 +18,11 @@ except IndexError:
 
 import carla
 
+from collections import defaultdict, OrderedDict
 import argparse
+import math
 import random
+import time
 if sys.version_info.major == 2:
     from pathlib2 import Path
 else:
@@ -51,70 +55,190 @@ WALL_MAT = [
         '/Game/Carla/Static/Walls/WallTunnel01/M_WallTunnel01',
         '/Game/Carla/Static/Walls/Wall15/T_Wall15']
 
-def spawn_meshes(client, dataset):
-    sumo_network = carla.SumoNetwork.load(str(DATA_PATH/'{}.net.xml'.format(dataset)))
-    sumo_network_occupancy = carla.OccupancyMap.load(str(DATA_PATH/'{}.network.wkt'.format(dataset)))
-    roadmark_occupancy = carla.OccupancyMap.load(str(DATA_PATH/'{}.roadmark.wkt'.format(dataset)))
-    sidewalk_occupancy = carla.OccupancyMap.load(str(DATA_PATH/'{}.sidewalk.wkt'.format(dataset)))
-    landmark_occupancies = []
-    for p in (DATA_PATH/'{}.landmarks'.format(dataset)).glob('*.landmark.wkt'):
-        landmark_occupancies.append(carla.OccupancyMap.load(str(p)))
+def load_occupancy_map(path):
+    # Prefer the binary occupancy map written by Scripts/convert_occupancy_maps.py.
+    binary_path = path.with_suffix('.occ')
+    return carla.OccupancyMap.load(str(binary_path if binary_path.exists() else path))
+
+ROADMARK_MAT = '/Game/Carla/Static/GenericMaterials/LaneMarking/M_MarkingLane_W'
+ROAD_MAT = '/Game/Carla/Static/GenericMaterials/Masters/LowComplexity/M_Road1'
+SIDEWALK_MAT = '/Game/Carla/Static/GenericMaterials/Ground/GroundWheatField_Mat'
+LANDMARK_HEIGHT = 20
+
+def load_dataset(dataset):
+    sumo_network_occupancy = load_occupancy_map(DATA_PATH/'{}.network.wkt'.format(dataset))
+    roadmark_occupancy = load_occupancy_map(DATA_PATH/'{}.roadmark.wkt'.format(dataset))
+    sidewalk_occupancy = load_occupancy_map(DATA_PATH/'{}.sidewalk.wkt'.format(dataset))
+    layers = [
+        (roadmark_occupancy, ROADMARK_MAT, 6), # 6 = Road line
+        (sumo_network_occupancy.difference(roadmark_occupancy), ROAD_MAT, 7), # 7 = Road
+        (sidewalk_occupancy, SIDEWALK_MAT, 8)] # 8 = Sidewalk
+    # Prefer the packed landmarks written by Scripts/extract_meshes.py.
+    landmarks_pack_path = DATA_PATH/'{}.landmarks.occp'.format(dataset)
+    if landmarks_pack_path.exists():
+        landmark_occupancies = carla.OccupancyMap.load_binary_pack(str(landmarks_pack_path))
+    else:
+        landmark_occupancies = [load_occupancy_map(p)
+                for p in (DATA_PATH/'{}.landmarks'.format(dataset)).glob('*.landmark.wkt')]
+    landmarks = [(occupancy, random.choice(WALL_MAT)) for occupancy in landmark_occupancies]
     with (DATA_PATH/'{}.sim_bounds'.format(dataset)).open('r') as f:
         bounds_min = carla.Vector2D(*[float(v) for v in f.readline().split(',')])
         bounds_max = carla.Vector2D(*[float(v) for v in f.readline().split(',')])
+    return (layers, landmarks, bounds_min, bounds_max)
 
-    commands = []
+def layer_commands(occupancy, material, semantic_tag):
+    return [carla.command.SpawnDynamicIndexedMesh(occupancy.get_indexed_mesh(), material, semantic_tag)]
 
-    # Roadmark mesh.
-    commands.append(carla.command.SpawnDynamicMesh(
-        roadmark_occupancy.get_mesh_triangles(),
-        '/Game/Carla/Static/GenericMaterials/LaneMarking/M_MarkingLane_W',
-        6)) # 6 = Road line
-
-    # SUMO network mesh.
-    commands.append(carla.command.SpawnDynamicMesh(
-        sumo_network_occupancy.difference(roadmark_occupancy).get_mesh_triangles(),
-        '/Game/Carla/Static/GenericMaterials/Masters/LowComplexity/M_Road1',
-        7)) # 7 = Road
-    
-    # Sidewalk mesh.
-    commands.append(carla.command.SpawnDynamicMesh(
-        sidewalk_occupancy.get_mesh_triangles(),
-        '/Game/Carla/Static/GenericMaterials/Ground/GroundWheatField_Mat',
-        8)) # 8 = Sidewalk
-    
-    # Landmark meshes.
-    for landmark_occupancy in landmark_occupancies:
-        commands.append(carla.command.SpawnDynamicMesh(
-            landmark_occupancy.get_mesh_triangles(20), # Ceiling
-            random.choice(WALL_MAT),
-            1)) # 1 = Building
-        commands.append(carla.command.SpawnDynamicMesh(
-            landmark_occupancy.get_mesh_triangles(0), # Ground
-            random.choice(WALL_MAT),
-            1)) # 1 = Building
-        commands.append(carla.command.SpawnDynamicMesh(
-            landmark_occupancy.get_wall_mesh_triangles(20), # Walls
-            random.choice(WALL_MAT),
-            1)) # 1 = Building
-        
+def landmark_commands(occupancy, material):
+    return [
+        carla.command.SpawnDynamicIndexedMesh(
+            occupancy.get_indexed_mesh(LANDMARK_HEIGHT), material, 1), # Ceiling; 1 = Building
+        carla.command.SpawnDynamicIndexedMesh(
+            occupancy.get_indexed_mesh(0), material, 1), # Ground
+        carla.command.SpawnDynamicIndexedMesh(
+            occupancy.get_indexed_wall_mesh(LANDMARK_HEIGHT), material, 1)] # Walls
+
+def draw_bounds(client, bounds_min, bounds_max):
     box = carla.BoundingBox(
             carla.Location((bounds_min.x + bounds_max.x) / 2, (bounds_min.y + bounds_max.y) / 2, 0),
             carla.Vector3D((bounds_max.x - bounds_min.x) / 2, (bounds_max.y - bounds_min.y) / 2, 0))
     client.get_world().debug.draw_box(box, carla.Rotation(), 2, carla.Color(255, 0, 0), -1.0)
 
+def spawn_meshes(client, dataset):
+    (layers, landmarks, bounds_min, bounds_max) = load_dataset(dataset)
+
+    commands = []
+    for (occupancy, material, semantic_tag) in layers:
+        commands.extend(layer_commands(occupancy, material, semantic_tag))
+    for (occupancy, material) in landmarks:
+        commands.extend(landmark_commands(occupancy, material))
+
+    draw_bounds(client, bounds_min, bounds_max)
+
     client.apply_batch_sync(commands)
 
     client.get_world().get_spectator().set_transform(carla.Transform(
         carla.Location((bounds_min.x + bounds_max.x) / 2, (bounds_min.y + bounds_max.y) / 2, 200),
         carla.Rotation(-90, 0, 0)))
 
+class MeshTileStreamer(object):
+    """Keeps the meshes of the tiles nearest to a moving point spawned, up to a
+    budget of tiles, and destroys the rest. Tile commands are built on first
+    use and kept in a bounded cache."""
+
+    def __init__(self, client, layers, landmarks, tile_size, radius, max_tiles):
+        self.client = client
+        self.tile_size = tile_size
+        self.radius = radius
+        self.max_tiles = max_tiles
+
+        # (x, y) -> [(occupancy, material, semantic_tag or None for landmarks)]
+        self.tile_sources = defaultdict(list)
+        for (occupancy, material, semantic_tag) in layers:
+            for tile in occupancy.tile(tile_size):
+                self.tile_sources[(tile.x, tile.y)].append((tile.occupancy_map, material, semantic_tag))
+        # Landmarks are not clipped, which would add walls along tile edges;
+        # each goes whole to the tile of its first vertex.
+        for (occupancy, material) in landmarks:
+            polygons = occupancy.get_polygons()
+            if len(polygons) == 0:
+                continue
+            self.tile_sources[self.tile_key(polygons[0][0][0])].append((occupancy, material, None))
+
+        self.command_cache = OrderedDict()
+        self.command_cache_size = 4 * max_tiles
+        self.spawned = dict() # (x, y) -> [mesh id]
+
+    def tile_key(self, position):
+        return (int(math.floor(position.x / self.tile_size)), int(math.floor(position.y / self.tile_size)))
+
+    def tile_distance(self, key, position):
+        dx = max(key[0] * self.tile_size - position.x, 0, position.x - (key[0] + 1) * self.tile_size)
+        dy = max(key[1] * self.tile_size - position.y, 0, position.y - (key[1] + 1) * self.tile_size)
+        return math.sqrt(dx * dx + dy * dy)
+
+    def tile_commands(self, key):
+        if key in self.command_cache:
+            commands = self.command_cache.pop(key)
+        else:
+            commands = []
+            for (occupancy, material, semantic_tag) in self.tile_sources[key]:
+                if semantic_tag is None:
+                    commands.extend(landmark_commands(occupancy, material))
+                else:
+                    commands.extend(layer_commands(occupancy, material, semantic_tag))
+        self.command_cache[key] = commands
+        while len(self.command_cache) > self.command_cache_size:
+            self.command_cache.popitem(last=False)
+        return commands
+
+    def update(self, position):
+        (x_min, y_min) = self.tile_key(carla.Vector2D(position.x - self.radius, position.y - self.radius))
+        (x_max, y_max) = self.tile_key(carla.Vector2D(position.x + self.radius, position.y + self.radius))
+        candidates = []
+        for x in range(x_min, x_max + 1):
+            for y in range(y_min, y_max + 1):
+                if (x, y) in self.tile_sources:
+                    distance = self.tile_distance((x, y), position)
+                    if distance <= self.radius:
+                        candidates.append((distance, (x, y)))
+        wanted = set(key for (_, key) in sorted(candidates)[:self.max_tiles])
+
+        commands = []
+        for key in [key for key in self.spawned if key not in wanted]:
+            commands.extend(carla.command.DestroyDynamicMesh(mesh_id) for mesh_id in self.spawned.pop(key))
+        if len(commands) > 0:
+            self.client.apply_batch_sync(commands)
+
+        # Nearest tiles first, so that they show up before the rest.
+        for (_, key) in sorted(candidates):
+            if key in wanted and key not in self.spawned:
+                responses = self.client.apply_batch_sync(self.tile_commands(key))
+                self.spawned[key] = [response.actor_id for response in responses if not response.has_error()]
+
+    def destroy(self):
+        commands = []
+        for mesh_ids in self.spawned.values():
+            commands.extend(carla.command.DestroyDynamicMesh(mesh_id) for mesh_id in mesh_ids)
+        self.spawned.clear()
+        if len(commands) > 0:
+            self.client.apply_batch_sync(commands)
+
+def stream_meshes(client, dataset, tile_size, radius, max_tiles, role_name, interval):
+    (layers, landmarks, bounds_min, bounds_max) = load_dataset(dataset)
+    streamer = MeshTileStreamer(client, layers, landmarks, tile_size, radius, max_tiles)
+    print('{} tiles of {}m.'.format(len(streamer.tile_sources), tile_size))
+
+    world = client.get_world()
+    draw_bounds(client, bounds_min, bounds_max)
+
+    try:
+        while True:
+            # Follows the actor with the given role name, or the spectator.
+            target = None
+            if role_name is not None:
+                for actor in world.get_actors():
+                    if actor.attributes.get('role_name') == role_name:
+                        target = actor
+                        break
+            if target is None:
+                target = world.get_spectator()
+            location = target.get_location()
+            streamer.update(carla.Vector2D(location.x, location.y))
+            time.sleep(interval)
+    finally:
+        streamer.destroy()
+
 def main(args):
 
     client = carla.Client(args.host, args.port)
     client.set_timeout(10.0)
 
-    spawn_meshes(client, args.dataset)
+    if args.stream:
+        stream_meshes(client, args.dataset, args.tile_size, args.radius, args.max_tiles,
+                args.role_name, args.interval)
+    else:
+        spawn_meshes(client, args.dataset)
 
 if __name__ == '__main__':
     argparser = argparse.ArgumentParser(
@@ -135,6 +259,39 @@ if __name__ == '__main__':
         metavar='D',
         default='meskel_square',
         help='Name of dataset (default: meskel_square)')
+    argparser.add_argument(
+        '--stream',
+        action='store_true',
+        help='spawn tiles around the spectator or --role-name actor as it moves, instead of everything at once')
+    argparser.add_argument(
+        '--tile-size',
+        metavar='S',
+        default=200.0,
+        type=float,
+        help='tile size in meters when streaming (default: 200)')
+    argparser.add_argument(
+        '--radius',
+        metavar='R',
+        default=500.0,
+        type=float,
+        help='distance in meters within which tiles are spawned when streaming (default: 500)')
+    argparser.add_argument(
+        '--max-tiles',
+        metavar='N',
+        default=25,
+        type=int,
+        help='maximum number of spawned tiles when streaming (default: 25)')
+    argparser.add_argument(
+        '--role-name',
+        metavar='NAME',
+        default=None,
+        help='role name of the actor to stream tiles around (default: the spectator)')
+    argparser.add_argument(
+        '--interval',
+        metavar='T',
+        default=0.5,
+        type=float,
+        help='seconds between tile updates when streaming (default: 0.5)')
     args = argparser.parse_args()
 
     main(args)
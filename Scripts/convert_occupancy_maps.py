@@ -0,0 +1,45 @@
+#!/usr/bin/env python3
+
+'''
+Converts the occupancy map files (*.wkt) of a map located in (<summit_root>/Data/)
+into the binary occupancy map format (*.occ), written alongside the originals.
+Binary occupancy maps are memory-mapped on load instead of being parsed.
+'''
+
+import glob
+import os
+import sys
+
+sys.path.append(glob.glob('../PythonAPI/carla/dist/carla-*%d.%d-%s.egg' % (
+    sys.version_info.major,
+    sys.version_info.minor,
+    'win-amd64' if os.name == 'nt' else 'linux-x86_64'))[0])
+
+import carla
+
+import argparse
+from pathlib import Path
+
+DATA_PATH = Path(os.path.realpath(__file__)).parent.parent/'Data'
+
+if __name__ == '__main__':
+
+    argparser = argparse.ArgumentParser(description=__doc__)
+    argparser.add_argument(
+        '-d', '--dataset',
+        metavar='D',
+        default=None,
+        help='Name of dataset (default: all datasets)')
+    args = argparser.parse_args()
+
+    patterns = ['*.wkt'] if args.dataset is None else ['{}.wkt'.format(args.dataset), '{}.*.wkt'.format(args.dataset)]
+    paths = [path for pattern in patterns for path in DATA_PATH.glob(pattern)]
+    landmarks_pattern = '*.landmarks' if args.dataset is None else '{}.landmarks'.format(args.dataset)
+    for landmarks_path in DATA_PATH.glob(landmarks_pattern):
+        paths.extend(landmarks_path.glob('*.landmark.wkt'))
+
+    print('Converting {} occupancy maps...'.format(len(paths)))
+    for path in paths:
+        carla.OccupancyMap.load(str(path)).save_binary(str(path.with_suffix('.occ')))
+
+    print('Occupancy conversion complete!')
@@ -3,6 +3,7 @@
 '''
 Processes a map (using its OSM file and SUMO network located in (<summit_root>/Data/)
 to produce the respective map object mesh files in the same folder (<summit_root>/Data/).
+Stages run natively on a thread pool; landmarks are written to a single packed file.
 '''
 
 import glob
@@ -20,40 +21,49 @@ import carla
 import argparse
 from pathlib import Path
 import shutil
+import time
 
 DATA_PATH = Path(os.path.realpath(__file__)).parent.parent/'Data'
 
+def extract(dataset, num_workers):
+    print('Extracting {}...'.format(dataset))
+    start = time.time()
+    settings = carla.MapGenSettings()
+    settings.num_workers = num_workers
+    assets = carla.MapGen.extract(
+            str(DATA_PATH/'{}.net.xml'.format(dataset)),
+            str(DATA_PATH/'{}.osm'.format(dataset)),
+            settings)
+    assets.save(str(DATA_PATH/dataset))
+    # Landmarks are now packed into <dataset>.landmarks.occp.
+    shutil.rmtree(str(DATA_PATH/'{}.landmarks'.format(dataset)), ignore_errors=True)
+    print('Extracted {} in {:.1f}s ({} landmarks).'.format(
+        dataset, time.time() - start, len(assets.landmark_occupancies)))
+
 if __name__ == '__main__':
 
     argparser = argparse.ArgumentParser(description=__doc__)
     argparser.add_argument(
         '-d', '--dataset',
         metavar='D',
-        default='meskel_square',
-        help='Name of dataset (default: meskel_square)')
+        default=None,
+        help='Name of dataset (default: all datasets with both a SUMO network and an OSM file)')
+    argparser.add_argument(
+        '-j', '--jobs',
+        metavar='J',
+        default=0,
+        type=int,
+        help='Number of worker threads (default: one per hardware thread)')
     args = argparser.parse_args()
 
-    print('Reading from OSM file and SUMO network...')
-    sumo_network = carla.SumoNetwork.load(str(DATA_PATH/'{}.net.xml'.format(args.dataset)))
-    landmark_occupancies = carla.OsmLandmarks.load(
-            str(DATA_PATH/'{}.osm'.format(args.dataset)), sumo_network.offset)
-   
-    print('Creating occupancy data...')
-    sumo_network_occupancy = sumo_network.create_occupancy_map()
-    roadmark_occupancy = sumo_network.create_roadmark_occupancy_map()
-    sidewalk_occupancy = sumo_network_occupancy.create_sidewalk(1.5).create_occupancy_map(3.0)
-    landmark_occupancies = [l.difference(sumo_network_occupancy).difference(sidewalk_occupancy) 
-            for l in landmark_occupancies]
-    landmark_occupancies = [l for l in landmark_occupancies if not l.is_empty]
-
-    print('Writing occupancy data...')
-    sumo_network_occupancy.save(str(DATA_PATH/'{}.network.wkt'.format(args.dataset)))
-    roadmark_occupancy.save(str(DATA_PATH/'{}.roadmark.wkt'.format(args.dataset)))
-    sidewalk_occupancy.save(str(DATA_PATH/'{}.sidewalk.wkt'.format(args.dataset)))
-    shutil.rmtree(str((DATA_PATH/'{}.landmarks'.format(args.dataset))), ignore_errors=True)
-    (DATA_PATH/'{}.landmarks'.format(args.dataset)).mkdir(exist_ok=True)
-    for (i, landmark_occupancy) in enumerate(landmark_occupancies):
-        landmark_occupancy.save(
-                str(DATA_PATH/'{}.landmarks'.format(args.dataset)/'{:06d}.landmark.wkt'.format(i)))
+    if args.dataset is None:
+        datasets = sorted(path.name[:-len('.net.xml')] for path in DATA_PATH.glob('*.net.xml')
+                if (DATA_PATH/path.name.replace('.net.xml', '.osm')).exists())
+    else:
+        datasets = [args.dataset]
+
+    # Each dataset already runs on all workers, so datasets go one at a time.
+    for dataset in datasets:
+        extract(dataset, args.jobs)
 
     print('Occupancy extraction complete!')
@@ -59,7 +59,72 @@ void ADynamicMeshActor::SetTriangles(const TArray<FVector>& Triangles) {
       true);
   MeshComponent->ContainsPhysicsTriMeshData(true);
 }
-  
+
+void ADynamicMeshActor::SetIndexedMesh(const TArray<FVector>& Vertices, const TArray<int32>& Indices, bool bDoubleSided) {
+  const int32 NumVertices = Vertices.Num();
+
+  TArray<FVector> MeshVertices = Vertices;
+  TArray<int32> MeshIndices = Indices;
+
+  // Unnormalized face normals weigh each face by its area.
+  TArray<FVector> Normals;
+  Normals.Init(FVector::ZeroVector, NumVertices);
+  for (int32 I = 0; I + 2 < Indices.Num(); I += 3) {
+    const FVector& A = Vertices[Indices[I]];
+    const FVector& B = Vertices[Indices[I + 1]];
+    const FVector& C = Vertices[Indices[I + 2]];
+    FVector FaceNormal = FVector::CrossProduct(C - A, B - A);
+    Normals[Indices[I]] += FaceNormal;
+    Normals[Indices[I + 1]] += FaceNormal;
+    Normals[Indices[I + 2]] += FaceNormal;
+  }
+  for (FVector& Normal : Normals) {
+    Normal = Normal.GetSafeNormal();
+  }
+
+  if (bDoubleSided) {
+    MeshVertices.Append(Vertices);
+    for (int32 I = 0; I < NumVertices; I++) {
+      Normals.Add(-Normals[I]);
+    }
+    for (int32 I = 0; I + 2 < Indices.Num(); I += 3) {
+      MeshIndices.Add(Indices[I + 2] + NumVertices);
+      MeshIndices.Add(Indices[I + 1] + NumVertices);
+      MeshIndices.Add(Indices[I] + NumVertices);
+    }
+  }
+
+  // Planar mapping, one unit per meter: floors use XY, walls run along their
+  // horizontal tangent and up.
+  TArray<FVector2D> UV;
+  UV.SetNum(MeshVertices.Num(), true);
+  TArray<FProcMeshTangent> Tangents;
+  Tangents.SetNum(MeshVertices.Num(), true);
+  for (int32 I = 0; I < MeshVertices.Num(); I++) {
+    const FVector& Vertex = MeshVertices[I];
+    if (FMath::Abs(Normals[I].Z) > 0.5f) {
+      UV[I] = FVector2D(Vertex.X, Vertex.Y) / 100.0f;
+      Tangents[I].TangentX = FVector(1.0f, 0.0f, 0.0f);
+    } else {
+      FVector Tangent = FVector::CrossProduct(FVector::UpVector, Normals[I]).GetSafeNormal();
+      UV[I] = FVector2D(FVector::DotProduct(Tangent, Vertex), Vertex.Z) / 100.0f;
+      Tangents[I].TangentX = Tangent;
+    }
+  }
+
+  MeshComponent->bUseComplexAsSimpleCollision = true;
+  MeshComponent->CreateMeshSection_LinearColor(
+      0,
+      MeshVertices,
+      MeshIndices,
+      Normals,
+      UV,
+      {},
+      Tangents,
+      true);
+  MeshComponent->ContainsPhysicsTriMeshData(true);
+}
+
 /*
  * https://github.com/EpicGames/UnrealEngine/blob/ab237f46dc0eee40263acbacbe938312eb0dffbb/Engine/Source/Runtime/UMG/Private/Blueprint/AsyncTaskDownloadImage.cpp#L61
  * https://wiki.unrealengine.com/Procedural_Materials
@@ -19,6 +19,9 @@ public:
 
   void SetTriangles(const TArray<FVector>& Triangles);
 
+  // Back faces of double sided meshes are built here, with flipped normals.
+  void SetIndexedMesh(const TArray<FVector>& Vertices, const TArray<int32>& Indices, bool bDoubleSided);
+
   void SetTileMesh(FVector BoundsMin, FVector BoundsMax, const TArray<uint8>& RawData);
 
   void SetSemanticSegmentationLabel(uint8 Label);
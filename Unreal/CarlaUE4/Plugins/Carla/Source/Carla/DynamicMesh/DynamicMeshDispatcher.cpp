@@ -15,7 +15,23 @@ uint32 ADynamicMeshDispatcher::SpawnDynamicMesh(const TArray<FVector>& Triangles
 
   return SpawnId - 1;
 }
-  
+
+uint32 ADynamicMeshDispatcher::SpawnDynamicIndexedMesh(const TArray<FVector>& Vertices, const TArray<int32>& Indices, bool bDoubleSided, const FString& Material, uint8 SemanticSegmentationLabel) {
+  if (GetWorld() == nullptr) {
+    UE_LOG(LogCarla, Display, TEXT("NULL WORLD"));
+    return -1;
+  }
+
+  ADynamicMeshActor* DynamicMeshActor = GetWorld()->SpawnActor<ADynamicMeshActor>();
+  DynamicMeshActor->SetMaterial(Material);
+  DynamicMeshActor->SetIndexedMesh(Vertices, Indices, bDoubleSided);
+  DynamicMeshActor->SetSemanticSegmentationLabel(SemanticSegmentationLabel);
+  ActorMap.Add(SpawnId++, DynamicMeshActor);
+  DynamicMeshActor->OnDestroyed.AddDynamic(this, &ADynamicMeshDispatcher::OnActorDestroyed);
+
+  return SpawnId - 1;
+}
+
 uint32 ADynamicMeshDispatcher::SpawnDynamicTileMesh(FVector BoundsMin, FVector BoundsMax, const TArray<uint8>& Data, uint8 SemanticSegmentationLabel) {
   if (GetWorld() == nullptr) {
     UE_LOG(LogCarla, Display, TEXT("NULL WORLD"));
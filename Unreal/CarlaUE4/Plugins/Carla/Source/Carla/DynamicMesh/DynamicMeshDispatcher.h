@@ -12,6 +12,8 @@ public:
 
   uint32 SpawnDynamicMesh(const TArray<FVector>& Triangles, const FString& Material, uint8_t SemanticSegmentationLabel);
 
+  uint32 SpawnDynamicIndexedMesh(const TArray<FVector>& Vertices, const TArray<int32>& Indices, bool bDoubleSided, const FString& Material, uint8_t SemanticSegmentationLabel);
+
   uint32 SpawnDynamicTileMesh(FVector BoundsMin, FVector BoundsMax, const TArray<uint8_t>& Data, uint8_t SemanticSegmentationLabel);
 
   bool DestroyDynamicMesh(uint32 Id);
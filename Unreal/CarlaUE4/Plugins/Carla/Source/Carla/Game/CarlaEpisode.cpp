@@ -235,7 +235,12 @@ uint32 UCarlaEpisode::SpawnDynamicMesh(const TArray<FVector>& Triangles, const F
 {
   return DynamicMeshDispatcher->SpawnDynamicMesh(Triangles, Material, SemanticSegmentationLabel);
 }
-  
+
+uint32 UCarlaEpisode::SpawnDynamicIndexedMesh(const TArray<FVector>& Vertices, const TArray<int32>& Indices, bool bDoubleSided, const FString& Material, uint8 SemanticSegmentationLabel)
+{
+  return DynamicMeshDispatcher->SpawnDynamicIndexedMesh(Vertices, Indices, bDoubleSided, Material, SemanticSegmentationLabel);
+}
+
 uint32 UCarlaEpisode::SpawnDynamicTileMesh(FVector BoundsMin, FVector BoundsMax, const TArray<uint8>& Data, uint8 SemanticSegmentationLabel) { 
   return DynamicMeshDispatcher->SpawnDynamicTileMesh(BoundsMin, BoundsMax, Data, SemanticSegmentationLabel);
 }
@@ -227,6 +227,8 @@ public:
 
   uint32 SpawnDynamicMesh(const TArray<FVector>& Triangles, const FString& Material, uint8 SemanticSegmentationLabel);
   
+  uint32 SpawnDynamicIndexedMesh(const TArray<FVector>& Vertices, const TArray<int32>& Indices, bool bDoubleSided, const FString& Material, uint8 SemanticSegmentationLabel);
+
   uint32 SpawnDynamicTileMesh(FVector BoundsMin, FVector BoundsMax, const TArray<uint8>& Data, uint8 SemanticSegmentationLabel);
   
   bool DestroyDynamicMesh(uint32 id);
@@ -298,6 +298,28 @@ void FCarlaServer::FPimpl::BindActions()
     return Episode->SpawnDynamicMesh(Triangles, FString(material.c_str()), semantic_segmentation_label);
   };
   
+  BIND_SYNC(spawn_dynamic_indexed_mesh) << [this](const cg::IndexedMesh &mesh, std::string material, uint8_t semantic_segmentation_label) -> R<uint32_t>
+  {
+    REQUIRE_CARLA_EPISODE();
+    TArray<FVector> Vertices;
+    Vertices.Reserve(mesh.vertices.size());
+    for (const cg::Vector3D& vertex : mesh.vertices) {
+      Vertices.Emplace(vertex.x * 100.0f, vertex.y * 100.0f, vertex.z * 100.0f);
+    }
+    TArray<int32> Indices;
+    Indices.Reserve(mesh.indices.size());
+    for (uint32_t index : mesh.indices) {
+      if (index >= mesh.vertices.size()) {
+        RESPOND_ERROR("unable to spawn dynamic mesh: vertex index out of range");
+      }
+      Indices.Add(static_cast<int32>(index));
+    }
+    if (Indices.Num() % 3 != 0) {
+      RESPOND_ERROR("unable to spawn dynamic mesh: number of indices is not a multiple of 3");
+    }
+    return Episode->SpawnDynamicIndexedMesh(Vertices, Indices, mesh.double_sided, FString(material.c_str()), semantic_segmentation_label);
+  };
+
   BIND_SYNC(spawn_dynamic_tile_mesh) << [this](cg::Vector3D bounds_min, cg::Vector3D bounds_max, const std::vector<uint8_t>& data, uint8_t semantic_segmentation_label) -> R<uint32_t>
   {
     REQUIRE_CARLA_EPISODE();
@@ -1063,6 +1085,7 @@ void FCarlaServer::FPimpl::BindActions()
           auto set_id = carla::Functional::MakeOverload(
               [](C::SpawnActor &) {},
               [](C::SpawnDynamicMesh &) {},
+              [](C::SpawnDynamicIndexedMesh &) {},
               [](C::DestroyDynamicMesh &) {},
               [id](auto &s) { s.actor = id; });
           for (auto command : c.do_after)
@@ -1079,6 +1102,13 @@ void FCarlaServer::FPimpl::BindActions()
         auto result = spawn_dynamic_mesh(c.triangles, c.material, c.semantic_segmentation_label);
         return CR{result.Get()};
       },
+      [=](auto, const C::SpawnDynamicIndexedMesh &c) {
+        auto result = spawn_dynamic_indexed_mesh(c.mesh, c.material, c.semantic_segmentation_label);
+        if (result.HasError()) {
+          return CR{result.GetError()};
+        }
+        return CR{result.Get()};
+      },
       [=](auto, const C::DestroyDynamicMesh &c) { 
         auto result = destroy_dynamic_mesh(c.id);
         if (result.Get()) {
@@ -87,7 +87,8 @@ while true; do
     --benchmark )
       LIBCARLA_RELEASE=true;
       RUN_BENCHMARK=true;
-      GTEST_ARGS="--gtest_filter=benchmark*";
+      # Client benchmarks are disabled tests, so they stay out of regular runs.
+      GTEST_ARGS="--gtest_filter=benchmark* --gtest_also_run_disabled_tests";
       shift ;;
     -h | --help )
       echo "$DOC_STRING"
@@ -159,13 +160,9 @@ if ${LIBCARLA_RELEASE} ; then
   echo "Running: ${GDB} libcarla_test_server_release ${GTEST_ARGS} ${EXTRA_ARGS}"
   LD_LIBRARY_PATH=${LIBCARLA_INSTALL_SERVER_FOLDER}/lib ${GDB} ${LIBCARLA_INSTALL_SERVER_FOLDER}/test/libcarla_test_server_release ${GTEST_ARGS} ${EXTRA_ARGS}
 
-  if ! { ${RUN_BENCHMARK} ; }; then
-
-    log "Running LibCarla.client unit tests (release)."
-    echo "Running: ${GDB} libcarla_test_client_debug ${GTEST_ARGS} ${EXTRA_ARGS}"
-    ${GDB} ${LIBCARLA_INSTALL_CLIENT_FOLDER}/test/libcarla_test_client_release ${GTEST_ARGS} ${EXTRA_ARGS}
-
-  fi
+  log "Running LibCarla.client unit tests (release)."
+  echo "Running: ${GDB} libcarla_test_client_release ${GTEST_ARGS} ${EXTRA_ARGS}"
+  ${GDB} ${LIBCARLA_INSTALL_CLIENT_FOLDER}/test/libcarla_test_client_release ${GTEST_ARGS} ${EXTRA_ARGS}
 
 fi
 